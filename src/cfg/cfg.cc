@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include "src/cfg/cfg.h"
+#include "src/profiler/profiler.h"
 
 using namespace cpputil;
 using namespace std;
@@ -61,17 +62,40 @@ bool Cfg::invariant_no_undef_live_outs() const {
 }
 
 bool Cfg::invariant_can_assemble() const {
-  bool need_check = false;
-  auto code = get_code();
-  for (auto instr : code) {
-    Opcode op = instr.get_opcode();
-    if (label32_transform(op) != op) {
-      need_check = true;
-      break;
+  // Only 8-bit jumps can fail to assemble, when their target is out of range.
+  // The function's hex offsets are enough to check that without assembling.
+  const auto& fxn = get_function();
+  const auto& code = get_code();
+  unordered_map<Label, size_t> label_offsets;
+  bool need_assembler = false;
+
+  for (size_t i = 0, ie = code.size(); i < ie; ++i) {
+    const auto& instr = code[i];
+    const auto op = instr.get_opcode();
+    if (label32_transform(op) == op) {
+      continue;
+    }
+
+    if (label_offsets.empty()) {
+      for (size_t j = 0; j < ie; ++j) {
+        if (code[j].is_label_defn()) {
+          label_offsets[code[j].get_operand<Label>(0)] = fxn.hex_offset(j);
+        }
+      }
+    }
+
+    const auto itr = label_offsets.find(instr.get_operand<Label>(0));
+    if (itr == label_offsets.end()) {
+      need_assembler = true;
+      continue;
+    }
+    const auto rel = (int64_t)itr->second - (int64_t)(fxn.hex_offset(i) + fxn.hex_size(i));
+    if (rel < -128 || rel > 127) {
+      return false;
     }
   }
 
-  if (!need_check)
+  if (!need_assembler)
     return true;
 
   buffer_.clear();
@@ -235,6 +259,7 @@ void Cfg::recompute_defs_gen_kill() {
   }
 }
 void Cfg::recompute_defs() {
+  Profiler::Timer timer(Profiler::RECOMPUTE_DEFS);
   recompute_defs_gen_kill();
 
   // Need a little extra room for def_ins_[get_exit()]
@@ -123,53 +123,110 @@ void CfgPaths::enumerate_paths_helper(const Cfg& cfg,
 
 }
 
+CfgPathEnumerator::CfgPathEnumerator(const Cfg& cfg, size_t max_loops, Cfg::id_type start, Cfg::id_type end, const std::vector<Cfg::id_type>* nopass) :
+  cfg_(cfg), max_loops_(max_loops), nopass_(nopass), next_order_(0), pruned_(0), prune_(NULL), prune_arg_(NULL) {
+
+  if (start == (Cfg::id_type)-1)
+    start = cfg.get_entry();
+
+  if (end == (Cfg::id_type)-1)
+    end = cfg.get_exit();
+  end_ = end;
+
+  if (max_loops > 0) {
+    Prefix p;
+    p.blocks.push_back(start);
+    p.length = cfg.num_instrs(start) ? 1 : 0;
+    p.order = next_order_++;
+    frontier_.push(p);
+  }
+}
+
+bool CfgPathEnumerator::next(CfgPath& path) {
+
+  while (!frontier_.empty()) {
+    auto p = frontier_.top();
+    frontier_.pop();
+
+    auto stripped = strip(p.blocks);
+    if (prune_ && prune_(stripped, prune_arg_)) {
+      pruned_++;
+      continue;
+    }
+
+    // Extensions are never shorter, so they can wait in the frontier
+    extend(p);
+
+    if (p.blocks.back() == end_ && p.blocks.size() > 1) {
+      path = stripped;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+CfgPath CfgPathEnumerator::strip(const CfgPath& blocks) const {
+  CfgPath result;
+  for (auto b : blocks) {
+    if (cfg_.num_instrs(b))
+      result.push_back(b);
+  }
+  return result;
+}
+
+void CfgPathEnumerator::extend(const Prefix& p) {
+
+  auto last_block = p.blocks.back();
+
+  if (nopass_ && p.blocks.size() > 1 && find(nopass_->begin(), nopass_->end(), last_block) != nopass_->end())
+    return;
+
+  if (last_block == cfg_.get_exit())
+    return;
+
+  for (auto it = cfg_.succ_begin(last_block), ie = cfg_.succ_end(last_block); it != ie; ++it) {
+
+    // as in enumerate_paths_helper, the first block doesn't count
+    size_t count = 1;
+    for (size_t i = 1; i < p.blocks.size(); ++i) {
+      if (p.blocks[i] == *it)
+        count++;
+    }
+    if (count > max_loops_)
+      continue;
+
+    Prefix q;
+    q.blocks = p.blocks;
+    q.blocks.push_back(*it);
+    q.length = p.length + (cfg_.num_instrs(*it) ? 1 : 0);
+    q.order = next_order_++;
+    frontier_.push(q);
+  }
+}
+
 /** Find the path this testcase takes through the CFG. */
 bool CfgPaths::learn_path(CfgPath& path, const Cfg& cfg, const CpuState& tc) {
 
-  auto code = cfg.get_code();
-  auto label = code[0].get_operand<x64asm::Label>(0);
+  const auto& label = cfg.get_function().get_leading_label();
   sandbox_->clear_callbacks();
+  sandbox_->clear_counters();
   sandbox_->clear_inputs();
   sandbox_->insert_input(tc);
   sandbox_->insert_function(cfg);
   sandbox_->set_entrypoint(label);
 
-  /** Insert code either before or after the first instruction in a block to
-   * record the path took */
-  vector<pair<CfgPaths*, Cfg::id_type>*> to_delete;
-  for (size_t i = 0; i < code.size(); ++i) {
-    // figure out if we're at the beginning of a block
-    auto loc = cfg.get_loc(i);
-    auto steps = loc.second;
-    if (steps > 0)
-      continue;
-
-    // build a pair with a pointer to our object and the basic block of this
-    // instruction
-    auto pair = new std::pair<CfgPaths*, Cfg::id_type>(this, loc.first);
-    to_delete.push_back(pair);
-
-    // insert callback after labels (so jumps don't skip them), but before
-    // returns and everything else (so if segfault or exit we still get
-    // called).
-    auto instr = code[i];
-    if (instr.is_label_defn()) {
-      sandbox_->insert_after(label, i, learn_path_callback, pair);
-    } else {
-      sandbox_->insert_before(label, i, learn_path_callback, pair);
-    }
-  }
-
-  // Now learn the path!
-  current_path_ = &path;
+  // The sandbox records blocks as they are entered (after their label, so
+  // that jumps don't skip the record)
+  sandbox_->insert_block_trace(label);
   sandbox_->run();
 
-  for (auto it : to_delete)
-    delete it;
+  const auto& trace = sandbox_->get_block_trace(0);
+  path.insert(path.end(), trace.begin(), trace.end());
 
   auto err = sandbox_->get_output(0)->code;
 
-  return (err == ErrorCode::NORMAL);
+  return (err == ErrorCode::NORMAL) && !sandbox_->block_trace_truncated(0);
 
 }
 
@@ -185,17 +242,6 @@ bool CfgPaths::is_prefix(const CfgPath& p, const CfgPath& q) {
   return true;
 }
 
-/** Callback used for learning a path. */
-void CfgPaths::learn_path_callback(const StateCallbackData&, void* arg) {
-
-  auto pair = (std::pair<CfgPaths*, Cfg::id_type>*)arg;
-
-  auto bb = pair->second;
-  pair->first->current_path_->push_back(bb);
-
-
-}
-
 namespace std {
 
 ostream& operator<<(ostream& os, const stoke::CfgPath& path) {
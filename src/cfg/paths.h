@@ -16,6 +16,8 @@
 #ifndef STOKE_SRC_CFG_PATHS_H
 #define STOKE_SRC_CFG_PATHS_H
 
+#include <queue>
+
 #include "src/ext/x64asm/include/x64asm.h"
 
 #include "src/cfg/cfg.h"
@@ -52,7 +54,8 @@ public:
 
   /** Enumerate all paths through a CFG that don't pass through any basic block
    * more than 'max_loops' times.  They will begin at 'start' and stop at 'end'.
-   * 'nopass' (optionally) has a vector of blocks that may not be passed through. */
+   * 'nopass' (optionally) has a vector of blocks that may not be passed through.
+   * This materializes every path; for large bounds use CfgPathEnumerator. */
 
   static std::vector<CfgPath> enumerate_paths(const Cfg& cfg, size_t max_loops, Cfg::id_type start = -1, Cfg::id_type end = -1, std::vector<Cfg::id_type>* nopass = NULL);
 
@@ -64,14 +67,10 @@ public:
     passed in the 'path' variable. */
   bool learn_path(CfgPath& path, const Cfg& cfg, const CpuState& tc);
 
-  /** Callback used for learning a path. */
-  static void learn_path_callback(const StateCallbackData&, void*);
-
 private:
 
   /** Used for path learning. */
   Sandbox* sandbox_;
-  CfgPath* current_path_;
 
   static void cleanup_path(CfgPath& p);
 
@@ -86,6 +85,77 @@ private:
 
 };
 
+/** Produces the same paths as CfgPaths::enumerate_paths one at a time,
+ * shortest first (by number of non-empty blocks, like the callers used to sort
+ * them).  Only the frontier of unfinished prefixes is kept in memory.  A
+ * prune callback may reject prefixes, e.g. ones already known to be
+ * infeasible; no path extending a rejected prefix is produced. */
+class CfgPathEnumerator {
+public:
+
+  /** Returns true if no path starting with this prefix should be produced.
+    The prefix is given without empty blocks, as paths are returned. */
+  typedef bool (*PruneCallback)(const CfgPath& prefix, void* arg);
+
+  /** Enumerate paths of 'cfg'; arguments are as for CfgPaths::enumerate_paths. */
+  CfgPathEnumerator(const Cfg& cfg, size_t max_loops, Cfg::id_type start = -1, Cfg::id_type end = -1, const std::vector<Cfg::id_type>* nopass = NULL);
+
+  /** Set a callback to reject prefixes; NULL disables pruning. */
+  CfgPathEnumerator& set_prune_callback(PruneCallback cb, void* arg) {
+    prune_ = cb;
+    prune_arg_ = arg;
+    return *this;
+  }
+
+  /** Writes the next path into 'path'.  Returns false when there are no more. */
+  bool next(CfgPath& path);
+
+  /** Number of prefixes waiting to be extended. */
+  size_t frontier_size() const {
+    return frontier_.size();
+  }
+  /** Number of prefixes rejected by the prune callback so far. */
+  size_t num_pruned() const {
+    return pruned_;
+  }
+
+private:
+
+  /** A path prefix waiting in the frontier. */
+  struct Prefix {
+    /** Blocks visited, including empty ones. */
+    CfgPath blocks;
+    /** Number of non-empty blocks; paths are produced in this order. */
+    size_t length;
+    /** Insertion order, so that equal lengths come out deterministically. */
+    size_t order;
+
+    bool operator<(const Prefix& rhs) const {
+      // std::priority_queue is a max-heap
+      if (length != rhs.length)
+        return length > rhs.length;
+      return order > rhs.order;
+    }
+  };
+
+  const Cfg& cfg_;
+  size_t max_loops_;
+  Cfg::id_type end_;
+  const std::vector<Cfg::id_type>* nopass_;
+
+  std::priority_queue<Prefix> frontier_;
+  size_t next_order_;
+  size_t pruned_;
+
+  PruneCallback prune_;
+  void* prune_arg_;
+
+  /** Returns the prefix without empty blocks. */
+  CfgPath strip(const CfgPath& blocks) const;
+  /** Pushes all admissible one-block extensions of a prefix. */
+  void extend(const Prefix& p);
+};
+
 } // namespace stoke
 
 namespace std {
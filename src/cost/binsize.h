@@ -17,29 +17,55 @@
 
 namespace stoke {
 
+/** The size, in bytes, of the code that is reachable (less nops).  Sizes are
+  summed from the encoding lengths that the TUnit keeps for each instruction,
+  so nothing is assembled or allocated.  Optionally, jump targets are padded
+  to an alignment boundary the way an assembler would with .p2align. */
 class BinSizeCost : public CostFunction {
 
 public:
 
+  BinSizeCost() : align_(1) {}
+
+  /** Pad jump targets to a multiple of this many bytes; 1 disables padding. */
+  BinSizeCost& set_target_alignment(size_t align) {
+    assert(align > 0 && (align & (align - 1)) == 0);
+    align_ = align;
+    return *this;
+  }
+
   /** Return the size, in bytes, of the assembled CFG
       (less unreachable blocks and nops) */
   result_type operator()(const Cfg& cfg, Cost max = max_cost) {
-
+    const auto& fxn = cfg.get_function();
     const auto& code = cfg.get_code();
 
-    x64asm::Function buffer;
-    buffer.reserve(code.size()*15 + 15);
-    assm_.start(buffer);
+    Cost size = 0;
+    for (auto b = ++cfg.reachable_begin(), be = cfg.reachable_end(); b != be; ++b) {
+      if (cfg.is_exit(*b) || cfg.num_instrs(*b) == 0) {
+        continue;
+      }
 
-    for (auto instr : code)
-      assm_.assemble(instr);
+      const auto first = cfg.get_index(Cfg::loc_type(*b, 0));
+      for (size_t i = first, ie = first + cfg.num_instrs(*b); i < ie; ++i) {
+        if (code[i].is_nop()) {
+          continue;
+        }
+        // Labels past the first are only there to be jumped to
+        if (code[i].is_label_defn() && i > 0) {
+          size += (align_ - size % align_) % align_;
+        }
+        size += fxn.hex_size(i);
+      }
+    }
 
-    return result_type(true, buffer.size());
+    return result_type(true, size);
   }
 
 private:
 
-  x64asm::Assembler assm_;
+  /** Alignment of jump targets. */
+  size_t align_;
 
 };
 
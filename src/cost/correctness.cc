@@ -20,6 +20,7 @@
 
 #include "src/cost/correctness.h"
 #include "src/ext/x64asm/include/x64asm.h"
+#include "src/profiler/profiler.h"
 
 using namespace cpputil;
 using namespace std;
@@ -81,7 +82,19 @@ CorrectnessCost::result_type CorrectnessCost::operator()(const Cfg& cfg, const C
   return result_type(correct, cost);
 }
 
+vector<Cost> CorrectnessCost::testcase_errors(const Cfg& cfg) {
+
+  run_test_sandbox(cfg);
+
+  vector<Cost> res;
+  for (size_t i = 0, ie = test_sandbox_->size(); i < ie; ++i) {
+    res.push_back(evaluate_error(reference_out_[i], *(test_sandbox_->get_result(i)), cfg.def_outs()));
+  }
+  return res;
+}
+
 Cost CorrectnessCost::evaluate_correctness(const Cfg& cfg, const Cost max) {
+  Profiler::Timer timer(Profiler::CORRECTNESS);
 
   switch (reduction_) {
   case Reduction::MAX:
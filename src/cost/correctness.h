@@ -101,6 +101,10 @@ public:
     result would equal or exceed that value. */
   virtual result_type operator()(const Cfg& cfg, const Cost max = max_cost);
 
+  /** Evaluate a rewrite on each testcase separately; an entry is zero exactly
+    when the rewrite agrees with the target on that testcase. */
+  std::vector<Cost> testcase_errors(const Cfg& cfg);
+
   /** Returns the number of testcases used in this function's correctness term. */
   size_t num_testcases() const {
     return test_sandbox_->size();
@@ -31,6 +31,8 @@ public:
 
   /** The maximum cost that any rewrite should produce. */
   static constexpr auto max_cost = (Cost)(0x1ull << 62);
+  /** The evaluation cost of the most expensive cost functions. */
+  static constexpr uint64_t max_evaluation_cost = 1000000;
 
   /** By default, run the sandbox unless we're told otherwise. */
   CostFunction() {
@@ -48,6 +50,17 @@ public:
     of the CostFunction or by the CostFunction itself.*/
   virtual result_type operator()(const Cfg& cfg, const Cost max = max_cost) = 0;
 
+  /** Adds the number of lookups into any cache of results this cost function
+    keeps, and how many of them hit, to the arguments. */
+  virtual void get_cache_statistics(size_t& lookups, size_t& hits) const { }
+
+  /** A rough guide to how long one evaluation takes, compared to other cost
+    functions; ExprCost evaluates cheaper operands first.  By default, running
+    a sandbox is assumed to dwarf anything else a cost function does. */
+  virtual uint64_t get_evaluation_cost() {
+    return (need_test_sandbox() || need_perf_sandbox()) ? 1000 : 1;
+  }
+
   /** Does this CostFunction require a test Sandbox object?
       Contract for clients:
 
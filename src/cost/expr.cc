@@ -36,6 +36,12 @@ ExprCost& ExprCost::setup_perf_sandbox(Sandbox* sb) {
   return *this;
 }
 
+void ExprCost::get_cache_statistics(size_t& lookups, size_t& hits) const {
+  for (auto cf : all_leaf_functions()) {
+    cf->get_cache_statistics(lookups, hits);
+  }
+}
+
 set<CostFunction*> ExprCost::all_leaf_functions() const {
 
   auto leaves = leaf_functions();
@@ -73,82 +79,173 @@ set<CostFunction*> ExprCost::leaf_functions() const {
 
 ExprCost::result_type ExprCost::operator()(const Cfg& cfg, Cost max) {
 
-  // Get the full list of leaf functions
-  auto leaves = all_leaf_functions();
-
-  // run the sandbox, if needed
-  if (need_test_sandbox_)
-    run_test_sandbox(cfg);
-  if (need_perf_sandbox_)
-    run_perf_sandbox(cfg);
+  if (!compiled_) {
+    compile();
+  }
 
-  // build the environment (i.e. run the actual cost functions)
-  std::map<CostFunction*, Cost> env;
-  for (auto it : leaves) {
-    env[it] = (*it)(cfg, max).second;
+  // start a new evaluation
+  cfg_ = &cfg;
+  ran_test_sandbox_ = false;
+  ran_perf_sandbox_ = false;
+  for (auto& leaf : leaves_) {
+    leaf.done = false;
   }
 
-  // compute cost and correctness (i.e. combine the results together)
-  Cost cost = run(env);
+  // compute the cost; the correctness term only matters below max, and then
+  // needs to be exact
+  Cost cost = eval(cost_root_, max);
+  if (cost >= max) {
+    return result_type(false, cost);
+  }
 
   bool correct = true;
-  if (correctness_) {
-    correct = (correctness_->run(env) != 0);
+  if (correctness_root_ != (size_t)-1) {
+    correct = (eval(correctness_root_, max_cost) != 0);
   }
 
   return result_type(correct, cost);
 }
 
-Cost ExprCost::run(const std::map<CostFunction*, Cost>& env) const {
+void ExprCost::compile() {
 
-  if (arity_ == 0) {
-    return constant_;
-  } else if (arity_ == 1) {
-    assert(a1_);
-    assert(env.count(a1_) > 0);
-    return env.at(a1_);
-  } else if (arity_ == 2) {
-    assert(a1_);
-    assert(a2_);
-    auto c1 = static_cast<ExprCost*>(a1_)->run(env);
-    auto c2 = static_cast<ExprCost*>(a2_)->run(env);
-
-    switch (op_) {
-    case NONE:
-      assert(false);
-    case PLUS:
-      return c1+c2;
-    case MINUS:
-      return c1-c2;
-    case TIMES:
-      return c1*c2;
-    case DIV:
-      return c1/c2;
-    case MOD:
-      return c1%c2;
-    case AND:
-      return c1&c2;
-    case OR:
-      return c1|c2;
-    case SHL:
-      return c1 << c2;
-    case SHR:
-      return c1 >> c2;
-    case LT:
-      return c1 < c2;
-    case LTE:
-      return c1 <= c2;
-    case GT:
-      return c1 > c2;
-    case GTE:
-      return c1 >= c2;
-    case EQ:
-      return c1 == c2;
-    default:
-      assert(false);
+  program_.clear();
+  leaves_.clear();
+
+  unordered_map<CostFunction*, size_t> leaf_ids;
+  uint64_t weight = 0;
+  cost_root_ = compile(this, leaf_ids, weight);
+  correctness_root_ = correctness_ ? compile(correctness_, leaf_ids, weight) : -1;
+
+  compiled_ = true;
+}
+
+size_t ExprCost::compile(const ExprCost* e, unordered_map<CostFunction*, size_t>& leaf_ids,
+                         uint64_t& weight) {
+
+  Node n;
+  n.op = NONE;
+  n.first = n.second = -1;
+  n.leaf = -1;
+  n.constant = 0;
+
+  if (e->arity_ == 0) {
+    n.constant = e->constant_;
+  } else if (e->arity_ == 1) {
+    assert(e->a1_);
+    auto itr = leaf_ids.find(e->a1_);
+    if (itr == leaf_ids.end()) {
+      itr = leaf_ids.insert({e->a1_, leaves_.size()}).first;
+      leaves_.push_back({e->a1_, e->a1_->need_test_sandbox(), e->a1_->need_perf_sandbox(),
+                         false, 0, 0
+                        });
     }
+    n.leaf = itr->second;
+    weight += e->a1_->get_evaluation_cost();
+  } else {
+    assert(e->a1_);
+    assert(e->a2_);
+    uint64_t w1 = 0;
+    uint64_t w2 = 0;
+    n.op = e->op_;
+    n.first = compile(static_cast<ExprCost*>(e->a1_), leaf_ids, w1);
+    n.second = compile(static_cast<ExprCost*>(e->a2_), leaf_ids, w2);
+    if ((n.op == PLUS || n.op == TIMES) && w2 < w1) {
+      swap(n.first, n.second);
+    }
+    weight += w1 + w2;
   }
-  assert(false);
-  return 0;
+
+  program_.push_back(n);
+  return program_.size() - 1;
+}
+
+Cost ExprCost::eval_leaf(Leaf& leaf, Cost bound) {
+
+  // a value from earlier is good if it was exact, or if it was cut off at
+  // least as high as we need now
+  if (leaf.done && (leaf.value < leaf.bound || leaf.bound >= bound)) {
+    return leaf.value;
+  }
+
+  if (leaf.test_sandbox && !ran_test_sandbox_) {
+    run_test_sandbox(*cfg_);
+    ran_test_sandbox_ = true;
+  }
+  if (leaf.perf_sandbox && !ran_perf_sandbox_) {
+    run_perf_sandbox(*cfg_);
+    ran_perf_sandbox_ = true;
+  }
+
+  leaf.value = (*leaf.fxn)(*cfg_, bound).second;
+  leaf.bound = bound;
+  leaf.done = true;
+  return leaf.value;
 }
 
+Cost ExprCost::eval(size_t node, Cost bound) {
+
+  const auto& n = program_[node];
+
+  if (n.op == NONE) {
+    return n.leaf == (size_t)-1 ? n.constant : eval_leaf(leaves_[n.leaf], bound);
+  }
+
+  // + and * (and |) never come out smaller than their operands, so once an
+  // operand reaches the bound, so does the result
+  if (n.op == PLUS) {
+    const auto c1 = eval(n.first, bound);
+    if (c1 >= bound) {
+      return c1;
+    }
+    return c1 + eval(n.second, bound - c1);
+  }
+  if (n.op == TIMES) {
+    const auto c1 = eval(n.first, bound);
+    if (c1 == 0) {
+      return 0;
+    }
+    if (c1 >= bound) {
+      return eval(n.second, 1) == 0 ? 0 : c1;
+    }
+    return c1 * eval(n.second, (bound + c1 - 1) / c1);
+  }
+  if (n.op == OR) {
+    const auto c1 = eval(n.first, bound);
+    if (c1 >= bound) {
+      return c1;
+    }
+    return c1 | eval(n.second, bound);
+  }
+
+  // everything else needs exact operands
+  const auto c1 = eval(n.first, max_cost);
+  const auto c2 = eval(n.second, max_cost);
+
+  switch (n.op) {
+  case MINUS:
+    return c1-c2;
+  case DIV:
+    return c1/c2;
+  case MOD:
+    return c1%c2;
+  case AND:
+    return c1&c2;
+  case SHL:
+    return c1 << c2;
+  case SHR:
+    return c1 >> c2;
+  case LT:
+    return c1 < c2;
+  case LTE:
+    return c1 <= c2;
+  case GT:
+    return c1 > c2;
+  case GTE:
+    return c1 >= c2;
+  case EQ:
+    return c1 == c2;
+  default:
+    assert(false);
+  }
+  return 0;
+}
@@ -19,6 +19,8 @@
 #include "gtest/gtest_prod.h"
 
 #include <set>
+#include <unordered_map>
+#include <vector>
 
 namespace stoke {
 
@@ -80,12 +82,16 @@ public:
     reset();
   }
 
-  /** Compute the cost of this expression. */
+  /** Compute the cost of this expression.  Leaves are only evaluated (and
+    sandboxes only run) once they are needed: the cheaper side of + and * goes
+    first, and once the cost reaches max the rest is skipped.  In that case the
+    correctness term isn't evaluated either, and is reported as false. */
   result_type operator()(const Cfg& cfg, Cost max = max_cost);
 
   /** Set the correctness term to another expression. */
   ExprCost& set_correctness(ExprCost* correctness) {
     correctness_ = correctness;
+    compiled_ = false;
     return *this;
   }
 
@@ -101,16 +107,62 @@ public:
   ExprCost& setup_test_sandbox(Sandbox* sb);
   ExprCost& setup_perf_sandbox(Sandbox* sb);
 
+  /** Sums the cache statistics of the leaves. */
+  void get_cache_statistics(size_t& lookups, size_t& hits) const;
+
 private:
   /** Called by all constructors. */
   void reset() {
     correctness_ = NULL;
     need_test_sandbox_ = false;
     need_perf_sandbox_ = false;
+    compiled_ = false;
   }
 
-  /** Compute the cost associated with this node. */
-  Cost run(const std::map<CostFunction*, Cost>& environment) const;
+  /** A node of the compiled expression. */
+  struct Node {
+    /** NONE for leaves and constants. */
+    Operator op;
+    /** Operands; for + and * the cheaper one is first. */
+    size_t first;
+    size_t second;
+    /** Index into leaves_, or -1 for a constant. */
+    size_t leaf;
+    Cost constant;
+  };
+  /** A leaf cost function, and what it returned for the current rewrite. */
+  struct Leaf {
+    CostFunction* fxn;
+    bool test_sandbox;
+    bool perf_sandbox;
+    /** Has it been evaluated, and with what max? */
+    bool done;
+    Cost bound;
+    Cost value;
+  };
+
+  /** Flatten this expression and its correctness term into program_. */
+  void compile();
+  /** Add the nodes of an expression to program_; returns its root and adds
+    a rough evaluation cost to 'weight'. */
+  size_t compile(const ExprCost* e, std::unordered_map<CostFunction*, size_t>& leaf_ids,
+                 uint64_t& weight);
+  /** Value of a node.  Exact if less than 'bound', otherwise at least 'bound'. */
+  Cost eval(size_t node, Cost bound);
+  /** Value of a leaf, with the same guarantee. */
+  Cost eval_leaf(Leaf& leaf, Cost bound);
+
+  /** The compiled expression. */
+  bool compiled_;
+  std::vector<Node> program_;
+  std::vector<Leaf> leaves_;
+  size_t cost_root_;
+  size_t correctness_root_;
+
+  /** State of the current evaluation. */
+  const Cfg* cfg_;
+  bool ran_test_sandbox_;
+  bool ran_perf_sandbox_;
 
   /** Do we need a sandbox? */
   bool need_test_sandbox_;
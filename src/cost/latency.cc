@@ -40,7 +40,7 @@ LatencyCost::result_type LatencyCost::operator()(const Cfg& cfg, Cost max) {
       }
     }
 
-    // Increment latency by block latency scaled by nesting penalty
+    // Increment latency by block latency; see LoopLatencyCost for loops
     latency += block_latency;
 
     if (latency >= max) {
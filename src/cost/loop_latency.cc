@@ -0,0 +1,125 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/cfg/sccs.h"
+#include "src/cost/loop_latency.h"
+
+using namespace std;
+using namespace x64asm;
+
+namespace stoke {
+
+LoopLatencyCost::result_type LoopLatencyCost::operator()(const Cfg& cfg, Cost max) {
+  const auto s = shape(cfg);
+  if (s != shape_ || weights_.size() != cfg.num_blocks()) {
+    reweight(cfg);
+    shape_ = s;
+  }
+
+  Cost latency = 0;
+
+  const auto& code = cfg.get_code();
+  for (auto b = ++cfg.reachable_begin(), be = cfg.reachable_end(); b != be; ++b) {
+    if (cfg.is_exit(*b)) {
+      continue;
+    }
+
+    Cost block_latency = 0;
+    const auto first = cfg.get_index(Cfg::loc_type(*b, 0));
+    for (size_t i = first, ie = first + cfg.num_instrs(*b); i < ie; ++i) {
+      if (!code[i].is_nop()) {
+        block_latency += code[i].haswell_latency();
+      }
+    }
+
+    latency += block_latency * weights_[*b];
+    if (latency >= max) {
+      return result_type(true, max);
+    }
+  }
+
+  return result_type(true, latency);
+}
+
+uint64_t LoopLatencyCost::shape(const Cfg& cfg) {
+  // Blocks only begin at labels and end at jumps and returns
+  const auto& code = cfg.get_code();
+  uint64_t h = cfg.num_blocks();
+  for (size_t i = 0, ie = code.size(); i < ie; ++i) {
+    const auto& instr = code[i];
+    if (instr.is_label_defn() || instr.is_any_jump() || instr.is_any_return()) {
+      h = (h * 31 + i) * 31 + instr.get_opcode();
+      if (instr.is_label_defn() || (instr.is_any_jump() && !instr.is_any_indirect_jump())) {
+        h = h * 31 + (uint64_t)instr.get_operand<Label>(0);
+      }
+    }
+  }
+  return h;
+}
+
+void LoopLatencyCost::reweight(const Cfg& cfg) {
+  weights_.assign(cfg.num_blocks(), 1);
+
+  CfgSccs sccs(cfg);
+  if (sccs.count() == 0) {
+    return;
+  }
+
+  if (sandbox_ != NULL) {
+    if (profile_sb_ == nullptr) {
+      profile_sb_.reset(new Sandbox(*sandbox_));
+    }
+    profile_sb_->clear_counters();
+    profile_sb_->insert_function(cfg);
+
+    const auto& label = cfg.get_function().get_leading_label();
+    profile_sb_->set_entrypoint(label);
+    counters_.assign(cfg.num_blocks(), 0);
+    for (auto b = cfg.reachable_begin(), be = cfg.reachable_end(); b != be; ++b) {
+      if (sccs.in_scc(*b) && cfg.num_instrs(*b) > 0) {
+        counters_[*b] = profile_sb_->insert_block_counter(label, *b);
+      }
+    }
+
+    profile_sb_->run();
+
+    size_t runs = 0;
+    for (size_t i = 0, ie = profile_sb_->size(); i < ie; ++i) {
+      runs += (profile_sb_->get_output(i)->code == ErrorCode::NORMAL);
+    }
+
+    if (runs > 0) {
+      for (auto b = cfg.reachable_begin(), be = cfg.reachable_end(); b != be; ++b) {
+        if (sccs.in_scc(*b) && cfg.num_instrs(*b) > 0) {
+          Cost hits = 0;
+          for (size_t i = 0, ie = profile_sb_->size(); i < ie; ++i) {
+            if (profile_sb_->get_output(i)->code == ErrorCode::NORMAL) {
+              hits += profile_sb_->get_counter(i, counters_[*b]);
+            }
+          }
+          weights_[*b] = max<Cost>(1, (hits + runs - 1) / runs);
+        }
+      }
+      return;
+    }
+  }
+
+  for (size_t b = 0, be = cfg.num_blocks(); b < be; ++b) {
+    if (sccs.in_scc(b)) {
+      weights_[b] = nesting_penalty_;
+    }
+  }
+}
+
+} // namespace stoke
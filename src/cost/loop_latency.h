@@ -0,0 +1,84 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STOKE_SRC_COST_LOOP_LATENCY_H
+#define STOKE_SRC_COST_LOOP_LATENCY_H
+
+#include <memory>
+#include <vector>
+
+#include "src/cost/cost_function.h"
+
+namespace stoke {
+
+/** Sums the latency of each block, weighted by how often the block runs per
+  testcase.  Blocks outside of loops (as found by CfgSccs) run at most once.
+  Blocks in loops are weighted by hit counts taken with counters in a private
+  copy of the perf sandbox; the counts are only retaken when the shape of the control flow
+  changes, so most rewrites are costed without running anything.  Without a
+  sandbox, or if no testcase runs, loop blocks are weighted by the nesting
+  penalty instead. */
+class LoopLatencyCost : public CostFunction {
+
+public:
+  LoopLatencyCost() : nesting_penalty_(1), shape_(0), sandbox_(NULL) {}
+
+  /** Weight of blocks in loops when there are no hit counts. */
+  LoopLatencyCost& set_nesting_penalty(Cost penalty) {
+    nesting_penalty_ = penalty;
+    return *this;
+  }
+
+  /** Remember the sandbox to take hit counts with; it's never run itself. */
+  LoopLatencyCost& setup_perf_sandbox(Sandbox* sb) {
+    sandbox_ = sb;
+    profile_sb_.reset();
+    shape_ = 0;
+    weights_.clear();
+    return *this;
+  }
+
+  result_type operator()(const Cfg& cfg, Cost max = max_cost);
+
+  /** The execution count per testcase of each block that weights were last
+    computed for, indexed by block id. */
+  const std::vector<Cost>& get_weights() const {
+    return weights_;
+  }
+
+private:
+
+  /** Hash of the block structure of a cfg. */
+  static uint64_t shape(const Cfg& cfg);
+  /** Recompute weights_ for this cfg. */
+  void reweight(const Cfg& cfg);
+
+  /** Weight of loop blocks without hit counts. */
+  Cost nesting_penalty_;
+
+  /** The shape that weights_ were computed for. */
+  uint64_t shape_;
+  /** Block weights. */
+  std::vector<Cost> weights_;
+
+  /** The perf sandbox and our copy of it. */
+  Sandbox* sandbox_;
+  std::unique_ptr<Sandbox> profile_sb_;
+  /** Sandbox counter of each block in a loop. */
+  std::vector<size_t> counters_;
+};
+
+} // namespace stoke
+
+#endif
@@ -29,10 +29,10 @@ public:
     return true;
   }
 
-  /** And we need to set it up. */
+  /** And we need to set it up: the sandbox sums latencies as it runs. */
   MeasuredCost& setup_perf_sandbox(Sandbox* sb) {
     perf_sandbox_ = sb;
-    perf_sandbox_->insert_before(measured_callback, this);
+    counter_ = perf_sandbox_->insert_latency_counter();
     return *this;
   }
 
@@ -41,27 +41,23 @@ public:
 
     run_perf_sandbox(cfg);
 
-    uint64_t res = latency_;
     size_t tc_count = perf_sandbox_->size();
-    latency_ = 0;
     if (tc_count == 0) {
       LatencyCost lc;
       return lc(cfg, max);
     }
-    else
-      return result_type(true, res/tc_count);
-  }
 
-  /** Add to the measured latency */
-  static void measured_callback(const StateCallbackData& data, void* arg) {
-    MeasuredCost* ptr = (MeasuredCost*)arg;
-    ptr->latency_ += data.code[data.line].haswell_latency();
+    uint64_t res = 0;
+    for (size_t i = 0; i < tc_count; ++i) {
+      res += perf_sandbox_->get_counter(i, counter_);
+    }
+    return result_type(true, res/tc_count);
   }
 
 private:
 
-  /** The latency seem so far. */
-  uint64_t latency_ = 0;
+  /** The sandbox counter with the latency of each run. */
+  size_t counter_ = 0;
 };
 
 } // namespace stoke
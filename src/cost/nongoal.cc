@@ -0,0 +1,189 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/cost/nongoal.h"
+
+using namespace std;
+using namespace x64asm;
+
+namespace {
+
+/** Instructions that remove_redundant() never removes. */
+bool is_kept(const Instruction& instr) {
+  return instr.is_label_defn() || instr.is_any_jump() ||
+         instr.is_any_call() || instr.is_any_return() ||
+         instr.is_any_loop() || instr.is_memory_dereference();
+}
+
+inline uint64_t mix(uint64_t h, uint64_t x) {
+  h ^= x + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+  return h;
+}
+
+/** Hash an instruction.  Rip-relative displacements are taken as they will
+  be once 'removed' bytes in front of them are gone. */
+uint64_t hash_instr(const Instruction& instr, uint64_t removed) {
+  uint64_t h = instr.get_opcode();
+
+  const auto has_mem = instr.is_explicit_memory_dereference() || instr.is_lea();
+  const auto mi = has_mem ? instr.mem_index() : instr.arity();
+
+  for (size_t i = 0, ie = instr.arity(); i < ie; ++i) {
+    if (i != mi) {
+      h = mix(h, (uint64_t)instr.get_operand<R64>(i));
+      continue;
+    }
+
+    const auto& m = instr.get_operand<M8>(i);
+    h = mix(h, m.contains_base() ? (uint64_t)m.get_base() : 0xff);
+    h = mix(h, m.contains_index() ? (uint64_t)m.get_index() : 0xff);
+    h = mix(h, (uint64_t)m.get_scale());
+    h = mix(h, m.contains_seg() ? (uint64_t)m.get_seg() : 0xff);
+    h = mix(h, m.addr_or());
+    h = mix(h, m.rip_offset());
+
+    auto disp = (int64_t)m.get_disp();
+    if (m.rip_offset()) {
+      disp += removed;
+    }
+    h = mix(h, (uint64_t)disp);
+  }
+
+  return h;
+}
+
+} // namespace
+
+namespace stoke {
+
+NonGoalCost& NonGoalCost::set_nongoals(const vector<TUnit>& nongoals, const Cfg& target) {
+  nongoals_.clear();
+  fingerprints_.clear();
+  for (auto& t : nongoals) {
+    auto cfg = Cfg(t, target.def_ins(), target.live_outs());
+    cfg.fncs_summary = target.fncs_summary;
+    cfg.recompute();
+    auto& min = CfgTransforms::remove_redundant(cfg);
+    nongoals_.push_back(min.get_code());
+
+    uint64_t fp = 0;
+    if (fingerprint(min, fp)) {
+      fingerprints_.insert(fp);
+    }
+  }
+  return *this;
+}
+
+NonGoalCost::result_type NonGoalCost::operator()(const Cfg& cfg, Cost max) {
+  // Rewrites whose fingerprint isn't known can't match.  Without a
+  // fingerprint, or on a match, minimize and compare the actual code.
+  uint64_t fp = 0;
+  if (fingerprint(cfg, fp) && fingerprints_.find(fp) == fingerprints_.end()) {
+    return result_type(true, 0);
+  }
+
+  const auto code = minimize(cfg);
+  for (auto& ng : nongoals_) {
+    if (code == ng) {
+      return result_type(true, 1);
+    }
+  }
+  return result_type(true, 0);
+}
+
+Code NonGoalCost::minimize(const Cfg& cfg) {
+  Cfg tmp(cfg.get_function(), cfg.def_ins(), cfg.live_outs());
+  tmp.fncs_summary = cfg.fncs_summary;
+  tmp.recompute();
+  return CfgTransforms::remove_redundant(tmp).get_code();
+}
+
+RegSet NonGoalCost::transfer(const Cfg& cfg, Cfg::id_type block, RegSet live) {
+  const auto& code = cfg.get_code();
+  const auto first = cfg.get_index({block, 0});
+  for (size_t i = first + cfg.num_instrs(block); i-- > first;) {
+    const auto& instr = code[i];
+
+    // Dead code doesn't read anything.  Under the least fixpoint this also
+    // kills code that only feeds itself around a loop, which
+    // remove_redundant() keeps, so this can drop more than minimize().  It
+    // never drops less, which is all the fingerprint needs
+    dead_[i] = !is_kept(instr) && (cfg.maybe_write_set(instr) & live) == RegSet::empty();
+    if (dead_[i]) {
+      continue;
+    }
+
+    live -= cfg.must_write_set(instr);
+    live -= cfg.must_undef_set(instr);
+    live |= cfg.maybe_read_set(instr);
+  }
+  return live;
+}
+
+bool NonGoalCost::fingerprint(const Cfg& cfg, uint64_t& fp) {
+  const auto& code = cfg.get_code();
+  const auto size = code.size();
+
+  for (const auto& instr : code) {
+    if (instr.is_any_indirect_jump()) {
+      return false;
+    }
+  }
+
+  // Liveness of the code that stays, as in Cfg::recompute_liveness(); the
+  // live-ins of a block are kept at the index of its first instruction.
+  live_ins_.assign(size + 1, RegSet::empty());
+  dead_.assign(size, true);
+  live_ins_[size] = cfg.live_outs();
+
+  for (auto changed = true; changed;) {
+    changed = false;
+    for (auto b = cfg.reachable_begin(), be = cfg.reachable_end(); b != be; ++b) {
+      if (cfg.num_instrs(*b) == 0) {
+        continue;
+      }
+
+      auto live = RegSet::empty();
+      for (auto s = cfg.succ_begin(*b), se = cfg.succ_end(*b); s != se; ++s) {
+        if (cfg.is_reachable(*s)) {
+          live |= live_ins_[cfg.is_exit(*s) ? size : cfg.get_index({*s, 0})];
+        }
+      }
+
+      const auto idx = cfg.get_index({*b, 0});
+      const auto in = transfer(cfg, *b, live);
+      if (in != live_ins_[idx]) {
+        live_ins_[idx] = in;
+        changed = true;
+      }
+    }
+  }
+
+  // Hash what stays, in order.  Removing code moves what follows, and
+  // TUnit::remove() fixes up rip displacements to match.
+  const auto& fxn = cfg.get_function();
+  uint64_t removed = 0;
+  fp = 0;
+  for (size_t i = 0; i < size; ++i) {
+    if (dead_[i]) {
+      removed += fxn.hex_size(i);
+    } else {
+      fp = mix(fp, hash_instr(code[i], removed));
+    }
+  }
+
+  return true;
+}
+
+} // namespace stoke
@@ -15,13 +15,22 @@
 #ifndef STOKE_SRC_COST_NONGOAL_H
 #define STOKE_SRC_COST_NONGOAL_H
 
+#include <unordered_set>
+#include <vector>
+
 #include "src/cfg/cfg_transforms.h"
 #include "src/cost/cost_function.h"
 
 namespace stoke {
 
 /** This class is a penalty of 1 if the code (when minimized) is equivalent
-    to one provided in --non_goal. */
+    to one provided in --non_goal.
+
+    Non-goals are indexed by a fingerprint of their minimized code.
+    Rewrites are fingerprinted straight from their Cfg, without building the
+    minimized code, so most of them are turned away with one hash lookup;
+    only on a fingerprint match is the rewrite minimized and compared for
+    real. */
 
 class NonGoalCost : public CostFunction {
 
@@ -29,34 +38,31 @@ public:
 
   /** Set the list of non-goals. */
   NonGoalCost& set_nongoals(const std::vector<TUnit>& nongoals,
-                            const Cfg& target) {
-    nongoals_.clear();
-    for (auto& t : nongoals) {
-      auto cfg = Cfg(t, target.def_ins(), target.live_outs());
-      cfg.fncs_summary = target.fncs_summary;
-      cfg.recompute();
-      nongoals_.push_back(CfgTransforms::remove_redundant(cfg).get_code());
-    }
-    return *this;
-  }
+                            const Cfg& target);
 
   /** Returns 1 <=> code is equivalent as one in --non_goal. */
-  result_type operator()(const Cfg& cfg, Cost max = max_cost) {
-    Cfg tmp(cfg.get_function(), cfg.def_ins(), cfg.live_outs());
-    tmp.fncs_summary = cfg.fncs_summary;
-    tmp.recompute();
-    const auto& code = CfgTransforms::remove_redundant(tmp).get_code();
-    for (auto& ng : nongoals_) {
-      if (code == ng) {
-        return result_type(true, 1);
-      }
-    }
-    return result_type(true, 0);
-  }
+  result_type operator()(const Cfg& cfg, Cost max = max_cost);
+
+  /** Hash of this cfg without its dead code.  Code that minimizes the same
+    hashes the same; the converse needn't hold, since dead code here includes
+    loops that only feed themselves, which minimization keeps.  Returns false
+    if the code has indirect jumps, whose liveness depends on dead code too. */
+  bool fingerprint(const Cfg& cfg, uint64_t& fp);
 
 private:
+  /** Minimized non-goals. */
   std::vector<x64asm::Code> nongoals_;
+  /** Fingerprints of the non-goals. */
+  std::unordered_set<uint64_t> fingerprints_;
+
+  /** Scratch space for fingerprint(), kept to avoid allocations. */
+  std::vector<x64asm::RegSet> live_ins_;
+  std::vector<bool> dead_;
 
+  /** Minimize a copy of this cfg. */
+  static x64asm::Code minimize(const Cfg& cfg);
+  /** Live registers before a block, given those after it; marks dead code. */
+  x64asm::RegSet transfer(const Cfg& cfg, Cfg::id_type block, x64asm::RegSet live);
 };
 
 } // namespace stoke
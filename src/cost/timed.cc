@@ -0,0 +1,180 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <sstream>
+
+#include "src/cost/timed.h"
+
+using namespace std;
+using namespace x64asm;
+
+namespace {
+
+/** Reads the time stamp counter after everything before it has finished. */
+inline uint64_t tsc_begin() {
+  uint32_t lo, hi;
+  asm volatile("cpuid\n\t"
+               "rdtsc"
+               : "=a"(lo), "=d"(hi) : "a"(0) : "rbx", "rcx", "memory");
+  return ((uint64_t)hi << 32) | lo;
+}
+
+/** Reads the time stamp counter before anything after it has started. */
+inline uint64_t tsc_end() {
+  uint32_t lo, hi;
+  asm volatile("rdtscp\n\t"
+               "mov %%eax, %0\n\t"
+               "mov %%edx, %1\n\t"
+               "xor %%eax, %%eax\n\t"
+               "cpuid"
+               : "=r"(lo), "=r"(hi) : : "rax", "rbx", "rcx", "rdx", "memory");
+  return ((uint64_t)hi << 32) | lo;
+}
+
+/** A function that does nothing, to time the sandbox itself. */
+const Label baseline_label(".stoke_timed_cost_baseline");
+
+} // namespace
+
+namespace stoke {
+
+TimedCost::result_type TimedCost::operator()(const Cfg& cfg, Cost max) {
+  ostringstream key;
+  key << cfg.get_code();
+  const auto itr = cache_.find(key.str());
+  lookups_++;
+  if (itr != cache_.end()) {
+    hits_++;
+    return result_type(true, itr->second);
+  }
+
+  double cycles = 0;
+  if (!measure(cfg, cycles)) {
+    return result_type(true, error_penalty_);
+  }
+
+  auto cost = (Cost)(cycles + quantum_ / 2.0);
+  cost -= cost % quantum_;
+
+  // Keep the cache from growing without bound over a long search
+  if (cache_.size() >= 4096) {
+    cache_.clear();
+  }
+  cache_[key.str()] = cost;
+
+  return result_type(true, cost);
+}
+
+bool TimedCost::measure(const Cfg& cfg, double& cycles) {
+  calibrate();
+  if (timing_sb_ == nullptr) {
+    return false;
+  }
+
+  timing_sb_->insert_function(cfg);
+  timing_sb_->set_entrypoint(cfg.get_function().get_leading_label());
+
+  const auto count = timing_sb_->size();
+  if (count == 0) {
+    return false;
+  }
+
+  // A testcase that faults may do so long before it would have finished, so
+  // its timing means nothing; charge the penalty instead
+  double total = 0;
+  for (size_t i = 0; i < count; ++i) {
+    const auto t = time_testcase(i);
+    if (timing_sb_->get_output(i)->code == ErrorCode::NORMAL) {
+      total += max(0.0, t - baseline_[i]);
+    } else {
+      total += error_penalty_;
+    }
+  }
+
+  cycles = total / count;
+  return true;
+}
+
+void TimedCost::calibrate() {
+  if (has_baseline_ || sandbox_ == NULL) {
+    return;
+  }
+  has_baseline_ = true;
+
+  // A copy has none of the callbacks or counters of the original
+  timing_sb_.reset(new Sandbox(*sandbox_));
+
+  Code code;
+  code.push_back(Instruction(LABEL_DEFN, {baseline_label}));
+  code.push_back(Instruction(RET));
+  timing_sb_->insert_function(Cfg(TUnit(code), RegSet::empty(), RegSet::empty()));
+  timing_sb_->set_entrypoint(baseline_label);
+
+  baseline_.resize(timing_sb_->size());
+  for (size_t i = 0, ie = baseline_.size(); i < ie; ++i) {
+    baseline_[i] = time_testcase(i);
+  }
+}
+
+double TimedCost::time_testcase(size_t index) {
+  for (size_t i = 0; i < warmup_; ++i) {
+    timing_sb_->run(index);
+  }
+
+  samples_.resize(repetitions_);
+  for (size_t i = 0; i < repetitions_; ++i) {
+    const auto start = tsc_begin();
+    timing_sb_->run(index);
+    samples_[i] = tsc_end() - start;
+  }
+
+  return robust_median();
+}
+
+double TimedCost::robust_median() {
+  const auto median = [](vector<uint64_t>& xs, size_t n) {
+    const auto mid = xs.begin() + n / 2;
+    nth_element(xs.begin(), mid, xs.begin() + n);
+    if (n % 2) {
+      return (double)*mid;
+    }
+    return (*mid + *max_element(xs.begin(), mid)) / 2.0;
+  };
+
+  const auto n = samples_.size();
+  const auto m = median(samples_, n);
+  if (outlier_ <= 0) {
+    return m;
+  }
+
+  deviations_.resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    deviations_[i] = (uint64_t)(samples_[i] > m ? samples_[i] - m : m - samples_[i]);
+  }
+  const auto mad = median(deviations_, n);
+
+  // Keep the samples close to the median; with no spread at all, that's all
+  // of them
+  size_t kept = 0;
+  for (size_t i = 0; i < n; ++i) {
+    const auto d = samples_[i] > m ? samples_[i] - m : m - samples_[i];
+    if (d <= outlier_ * mad) {
+      samples_[kept++] = samples_[i];
+    }
+  }
+  return kept == 0 ? m : median(samples_, kept);
+}
+
+} // namespace stoke
@@ -0,0 +1,139 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STOKE_SRC_COST_TIMED_H
+#define STOKE_SRC_COST_TIMED_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "src/cost/cost_function.h"
+
+namespace stoke {
+
+/** Measures the running time of a rewrite, in cycles per call, by running it
+  in a private copy of the perf sandbox between serializing reads of the time
+  stamp counter.  Each testcase is run a few times to warm up and then timed
+  repeatedly; samples further than a few median absolute deviations from the
+  median are dropped, and the median of the rest is taken.  The same is done
+  once for a function that only returns, and that baseline is subtracted.
+  A testcase that doesn't run cleanly counts as a fixed penalty instead.
+
+  Measurements are rounded to a quantum and cached by code, so a rewrite
+  costs the same every time the search sees it. */
+class TimedCost : public CostFunction {
+
+public:
+  TimedCost() : warmup_(16), repetitions_(64), outlier_(3.0), quantum_(1),
+    error_penalty_(10000), sandbox_(NULL), has_baseline_(false), lookups_(0), hits_(0) {}
+
+  /** Number of untimed runs of each testcase before timing it. */
+  TimedCost& set_warmup(size_t n) {
+    warmup_ = n;
+    return *this;
+  }
+  /** Number of timed runs of each testcase. */
+  TimedCost& set_repetitions(size_t n) {
+    assert(n > 0);
+    repetitions_ = n;
+    return *this;
+  }
+  /** Drop samples more than this many median absolute deviations from the
+    median; 0 keeps every sample. */
+  TimedCost& set_outlier_threshold(double k) {
+    outlier_ = k;
+    return *this;
+  }
+  /** Round costs to a multiple of this many cycles. */
+  TimedCost& set_quantum(Cost q) {
+    assert(q > 0);
+    quantum_ = q;
+    return *this;
+  }
+
+  /** Cycles charged for a testcase that ends in an error. */
+  TimedCost& set_error_penalty(Cost p) {
+    error_penalty_ = p;
+    clear_cache();
+    return *this;
+  }
+
+  /** Remember the sandbox to copy the testcases from; it's never run itself. */
+  TimedCost& setup_perf_sandbox(Sandbox* sb) {
+    sandbox_ = sb;
+    timing_sb_.reset();
+    has_baseline_ = false;
+    clear_cache();
+    return *this;
+  }
+
+  /** Cycles per call, averaged over testcases, less the baseline. */
+  result_type operator()(const Cfg& cfg, Cost max = max_cost);
+
+  /** Time a rewrite without looking at the cache.  Returns false if there
+    are no testcases to time. */
+  bool measure(const Cfg& cfg, double& cycles);
+
+  /** Forget cached measurements. */
+  void clear_cache() {
+    cache_.clear();
+  }
+  /** Each measurement runs every testcase dozens of times; nothing costs more. */
+  uint64_t get_evaluation_cost() {
+    return max_evaluation_cost;
+  }
+
+  /** Counts lookups into the cache of measurements. */
+  void get_cache_statistics(size_t& lookups, size_t& hits) const {
+    lookups += lookups_;
+    hits += hits_;
+  }
+
+private:
+
+  /** Time one testcase in the timing sandbox; returns the robust median. */
+  double time_testcase(size_t index);
+  /** The median of samples_ after dropping outliers. */
+  double robust_median();
+  /** Copy the sandbox and time the baseline, if not done yet. */
+  void calibrate();
+
+  /** Settings. */
+  size_t warmup_;
+  size_t repetitions_;
+  double outlier_;
+  Cost quantum_;
+  Cost error_penalty_;
+
+  /** The perf sandbox and our copy of it. */
+  Sandbox* sandbox_;
+  std::unique_ptr<Sandbox> timing_sb_;
+  /** Cycles of the baseline, per testcase. */
+  bool has_baseline_;
+  std::vector<double> baseline_;
+
+  /** Measured costs, by code. */
+  std::unordered_map<std::string, Cost> cache_;
+  size_t lookups_;
+  size_t hits_;
+  /** Scratch space for samples. */
+  std::vector<uint64_t> samples_;
+  std::vector<uint64_t> deviations_;
+};
+
+} // namespace stoke
+
+#endif
@@ -13,10 +13,14 @@
 // limitations under the License.
 
 
+#include <atomic>
+#include <condition_variable>
 #include <sstream>
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include <regex>
+#include <thread>
 
 #include "src/ext/cpputil/include/io/fail.h"
 #include "src/ext/x64asm/include/x64asm.h"
@@ -60,6 +64,10 @@ uint64_t hex_to_int(const string& s) {
   return val;
 }
 
+/** Guards the x64asm parser and cpputil's fail() messages when objdump runs on
+  several ranges at once; neither is meant to be used from several threads. */
+mutex parse_mutex;
+
 /** Mangle @s and .s into _s (this is a hack around dealing with @plt functions) */
 string mangle_lable(string label) {
   for (auto& c : label) {
@@ -113,27 +121,21 @@ bool Disassembler::check_filename(const string& s) {
   return false;
 }
 
-ipstream* Disassembler::run_objdump(const string& filename, bool only_header) {
-  if (!check_filename(filename)) {
-    return NULL;
-  }
-
+ipstream* Disassembler::run_objdump(const string& filename, uint64_t start, uint64_t stop) {
   string target = "";
-  if (only_header) {
-    target = "/usr/bin/objdump -h " + filename;
-  } else if (flat_binary_) {
+  if (flat_binary_) {
     target = "/usr/bin/objdump -D -Msuffix -b binary -m i386:x86-64 " + filename;
-  } else {
+  } else if (stop == 0) {
     target = "/usr/bin/objdump -j .text -Msuffix -d " + filename;
+  } else {
+    ostringstream oss;
+    oss << "/usr/bin/objdump -j .text -Msuffix -d";
+    oss << " --start-address=0x" << hex << start << " --stop-address=0x" << stop << " ";
+    target = oss.str() + filename;
   }
 
   auto stream = new ipstream(target, pstreams::pstdout);
-  if (!stream) {
-    set_error("Unknown error spawning objdump: no memory allocated.");
-    return NULL;
-  }
   if (!stream->is_open()) {
-    set_error("Unknown error spawning objdump.");
     delete stream;
     return NULL;
   }
@@ -141,27 +143,24 @@ ipstream* Disassembler::run_objdump(const string& filename, bool only_header) {
   return stream;
 }
 
-map<string, uint64_t> Disassembler::parse_section_offsets(ipstream& ips) {
-  map<string, uint64_t> section_offsets;
-
-  // Skip ahead to table
-  strip_lines(ips, 5);
-
-  // Read entries one at a time
-  string line;
-  while (getline(ips, line)) {
-    istringstream iss(line);
-    string section, temp;
-    uint64_t lma, offset;
+vector<pair<uint64_t, uint64_t>> Disassembler::split_text(const ElfReader& elf) {
+  const auto begin = elf.section_address(".text");
+  const auto end = begin + elf.section_size(".text");
 
-    iss >> temp >> section >> temp >> temp >> hex >> lma >> offset;
-    section_offsets[section] = lma - offset;
+  // A few ranges per thread, so that one big function doesn't hold up the rest
+  const auto target = elf.section_size(".text") / (4 * threads_) + 1;
 
-    // Trailing second line
-    getline(ips, line);
+  vector<pair<uint64_t, uint64_t>> ranges;
+  auto start = begin;
+  for (const auto& sym : elf.get_symbols(".text")) {
+    if (sym.address > start && sym.address < end && sym.address - start >= target) {
+      ranges.push_back({start, sym.address});
+      start = sym.address;
+    }
   }
+  ranges.push_back({start, end});
 
-  return section_offsets;
+  return ranges;
 }
 
 string Disassembler::fix_instruction(const string& line) {
@@ -416,6 +415,7 @@ bool Disassembler::parse_function(ipstream& ips, FunctionCallbackData& data, uin
   // This function inserts missing lines such as labels and splits lock into two instructions
   const auto lines = parse_lines(ips, name);
   stringstream ss;
+  lock_guard<mutex> lock(parse_mutex);
 
   for (const auto& l : lines) {
 
@@ -469,48 +469,98 @@ bool Disassembler::parse_function(ipstream& ips, FunctionCallbackData& data, uin
   return true;
 }
 
+vector<FunctionCallbackData> Disassembler::parse_functions(ipstream& ips, uint64_t text_offset) {
+  // Skip the first four lines of output and lines starting with 'D'
+  strip_lines(ips, 4);
+  for (string line; getline(ips, line) && line[0] == 'D';) {
+    // Does nothing
+  }
+
+  vector<FunctionCallbackData> result;
+  FunctionCallbackData data;
+  while (parse_function(ips, data, text_offset)) {
+    result.push_back(data);
+  }
+  return result;
+}
+
 void Disassembler::disassemble(const std::string& filename) {
   // We're starting out fresh, so reset the error tracker
   clear_error();
+  if (!check_filename(filename)) {
+    return;
+  }
 
-  auto text_offset = 0;
+  // Read the .text offset and the symbols to split .text at straight from the file
+  uint64_t text_offset = 0;
+  vector<pair<uint64_t, uint64_t>> ranges = {{0, 0}};
   if (!flat_binary_) {
-
-    // Get the headers from the objdump
-    auto headers = run_objdump(filename, true);
-    if (has_error()) {
+    ElfReader elf;
+    elf.read(filename);
+    if (elf.has_error()) {
+      set_error(elf.get_error());
       return;
     }
-
-    // Parse the headers
-    const auto section_offsets = parse_section_offsets(*headers);
-    const auto text_itr = section_offsets.find(".text");
-    if (text_itr == section_offsets.end()) {
+    if (!elf.has_section(".text")) {
       set_error("Unable to find value for text section offset");
       return;
     }
-    text_offset = text_itr->second;
+    text_offset = elf.section_offset(".text");
+    ranges = split_text(elf);
+  }
+
+  // Disassemble the ranges in parallel; hand results back in order as they finish
+  vector<vector<FunctionCallbackData>> results(ranges.size());
+  vector<char> done(ranges.size(), false);
+  vector<char> ok(ranges.size(), false);
+  mutex done_mutex;
+  condition_variable done_cv;
+  atomic<size_t> next(0);
+
+  auto work = [&]() {
+    for (size_t i = next++; i < ranges.size(); i = next++) {
+      auto body = run_objdump(filename, ranges[i].first, ranges[i].second);
+      const auto spawned = body != NULL;
+      if (spawned) {
+        results[i] = parse_functions(*body, text_offset);
+        delete body;
+      }
+      lock_guard<mutex> lock(done_mutex);
+      ok[i] = spawned;
+      done[i] = true;
+      done_cv.notify_all();
+    }
+  };
 
+  vector<thread> pool;
+  for (size_t i = 0, ie = min(threads_, ranges.size()); i < ie; ++i) {
+    pool.push_back(thread(work));
   }
 
-  // Get the disassembly from objdump
-  auto body = run_objdump(filename, false);
-  if (has_error()) {
-    return;
-  }
-  // Skip the first four lines of output and lines starting with 'D'
-  strip_lines(*body, 4);
-  for (string line; getline(*body, line) && line[0] == 'D';) {
-    // Does nothing
-  }
   // Read the functions and invoke the callback.
-  FunctionCallbackData data;
-  while (parse_function(*body, data, text_offset)) {
-    if (!callback_closure_) {
-      fxn_cb_(data, fxn_cb_arg_);
-    } else {
-      (*callback_closure_)(data);
+  for (size_t i = 0; i < ranges.size() && !has_error(); ++i) {
+    unique_lock<mutex> lock(done_mutex);
+    done_cv.wait(lock, [&] {
+      return done[i] != 0;
+    });
+    lock.unlock();
+
+    if (!ok[i]) {
+      set_error("Unknown error spawning objdump.");
+      break;
     }
+    for (const auto& data : results[i]) {
+      if (!callback_closure_) {
+        fxn_cb_(data, fxn_cb_arg_);
+      } else {
+        (*callback_closure_)(data);
+      }
+    }
+    results[i].clear();
+  }
+
+  for (auto& t : pool) {
+    t.join();
   }
 }
 
@@ -17,9 +17,11 @@
 
 #include <map>
 #include <set>
+#include <vector>
 
 #include "src/ext/pstreams-0.8.1/pstream.h"
 
+#include "src/disassembler/elf_reader.h"
 #include "src/disassembler/function_callback.h"
 
 namespace stoke {
@@ -33,6 +35,7 @@ public:
   Disassembler() {
     set_function_callback(nullptr, nullptr);
     set_flat_binary(false);
+    set_threads(1);
     clear_error();
   }
 
@@ -55,6 +58,13 @@ public:
     return *this;
   }
 
+  /** Run this many objdump processes at once on different ranges of .text.
+    Functions are still reported in address order, on the calling thread. */
+  Disassembler& set_threads(size_t threads) {
+    threads_ = threads == 0 ? 1 : threads;
+    return *this;
+  }
+
   /** Reports if an error occurred in the last operation.  Whether an error
    * has occurred is cleared whenever disassemble() is called. */
   bool has_error() {
@@ -83,6 +93,8 @@ private:
 
   /** Should we tell objdump that we want a flat binary, rather than ELF? */
   bool flat_binary_;
+  /** Number of objdump processes to run at once. */
+  size_t threads_;
 
   /** POD struct for recording line info */
   struct LineInfo {
@@ -104,11 +116,10 @@ private:
 
   /* Checks if a filename is whitelisted for use. Prevents accidental shell injection. */
   bool check_filename(const std::string& filename);
-  /* Runs objdump and provides the output stream */
-  redi::ipstream* run_objdump(const std::string& filename, bool only_header);
-
-  /* Parse the section offsets from objdump's stdout. */
-  std::map<std::string, uint64_t> parse_section_offsets(redi::ipstream& ips);
+  /* Runs objdump on [start, stop) of .text (all of it if stop is 0) and provides the output stream */
+  redi::ipstream* run_objdump(const std::string& filename, uint64_t start = 0, uint64_t stop = 0);
+  /* Splits .text into ranges of about equal size that begin at symbols */
+  std::vector<std::pair<uint64_t, uint64_t>> split_text(const ElfReader& elf);
 
   /* Rewrite a line from objdump for our parser :( */
   std::string fix_instruction(const std::string& line);
@@ -123,6 +134,8 @@ private:
 
   /* Parse a single function from objdump's stdout; returns true until eof */
   bool parse_function(redi::ipstream& ips, FunctionCallbackData& data, uint64_t text_offset);
+  /* Parse all the functions in one objdump's stdout */
+  std::vector<FunctionCallbackData> parse_functions(redi::ipstream& ips, uint64_t text_offset);
 };
 
 } // namespace stoke
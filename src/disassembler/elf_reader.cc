@@ -0,0 +1,164 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstring>
+#include <elf.h>
+#include <fstream>
+
+#include "src/disassembler/elf_reader.h"
+
+using namespace std;
+
+namespace {
+
+/** Reads a range of a file; returns false if it is out of bounds. */
+bool read_range(ifstream& ifs, uint64_t offset, uint64_t size, string& buf) {
+  // Offsets and sizes come from the file itself; check them against its
+  // length before allocating anything
+  ifs.clear();
+  ifs.seekg(0, ios::end);
+  const auto end = ifs.tellg();
+  if (end < 0 || offset > (uint64_t)end || size > (uint64_t)end - offset) {
+    return false;
+  }
+
+  buf.resize(size);
+  ifs.seekg(offset);
+  ifs.read(&buf[0], size);
+  return ifs.good() || (size == 0 && !ifs.bad());
+}
+
+/** Returns the null-terminated string at an offset into a string table. */
+string get_name(const string& strtab, uint64_t offset) {
+  if (offset >= strtab.size()) {
+    return "";
+  }
+  return string(strtab.c_str() + offset);
+}
+
+} // namespace
+
+namespace stoke {
+
+ElfReader& ElfReader::read(const string& filename) {
+  sections_.clear();
+  symbols_.clear();
+  error_ = "";
+
+  ifstream ifs(filename, ios::binary);
+  if (!ifs.is_open()) {
+    error_ = "Error opening file.";
+    return *this;
+  }
+
+  Elf64_Ehdr ehdr;
+  ifs.read((char*)&ehdr, sizeof(ehdr));
+  if (!ifs.good() || memcmp(ehdr.e_ident, ELFMAG, SELFMAG) ||
+      ehdr.e_ident[EI_CLASS] != ELFCLASS64 || ehdr.e_ident[EI_DATA] != ELFDATA2LSB) {
+    error_ = "Not a 64-bit little-endian ELF file.";
+    return *this;
+  }
+  if (ehdr.e_shentsize != sizeof(Elf64_Shdr) || ehdr.e_shstrndx >= ehdr.e_shnum) {
+    error_ = "Unable to read ELF section headers.";
+    return *this;
+  }
+
+  string buf;
+  if (!read_range(ifs, ehdr.e_shoff, ehdr.e_shnum * sizeof(Elf64_Shdr), buf)) {
+    error_ = "Unable to read ELF section headers.";
+    return *this;
+  }
+  vector<Elf64_Shdr> shdrs(ehdr.e_shnum);
+  memcpy(shdrs.data(), buf.data(), buf.size());
+
+  vector<Elf64_Phdr> phdrs(ehdr.e_phnum);
+  if (ehdr.e_phnum > 0 && ehdr.e_phentsize == sizeof(Elf64_Phdr) &&
+      read_range(ifs, ehdr.e_phoff, ehdr.e_phnum * sizeof(Elf64_Phdr), buf)) {
+    memcpy(phdrs.data(), buf.data(), buf.size());
+  } else {
+    phdrs.clear();
+  }
+
+  string shstrtab;
+  const auto& names = shdrs[ehdr.e_shstrndx];
+  if (!read_range(ifs, names.sh_offset, names.sh_size, shstrtab)) {
+    error_ = "Unable to read ELF section names.";
+    return *this;
+  }
+
+  for (size_t i = 0; i < shdrs.size(); ++i) {
+    const auto& sh = shdrs[i];
+
+    // Sections that are loaded may be loaded somewhere other than their address
+    auto lma = sh.sh_addr;
+    for (const auto& ph : phdrs) {
+      if (ph.p_type == PT_LOAD && (sh.sh_flags & SHF_ALLOC) &&
+          sh.sh_addr >= ph.p_vaddr && sh.sh_addr + sh.sh_size <= ph.p_vaddr + ph.p_memsz) {
+        lma = sh.sh_addr - ph.p_vaddr + ph.p_paddr;
+        break;
+      }
+    }
+    sections_[get_name(shstrtab, sh.sh_name)] = {i, sh.sh_addr, lma, sh.sh_offset, sh.sh_size};
+  }
+
+  // Stripped binaries don't have a symbol table; that's not an error
+  for (const auto& sh : shdrs) {
+    if (sh.sh_type != SHT_SYMTAB || sh.sh_link >= shdrs.size() || sh.sh_entsize != sizeof(Elf64_Sym)) {
+      continue;
+    }
+    string syms, strtab;
+    if (!read_range(ifs, sh.sh_offset, sh.sh_size, syms) ||
+        !read_range(ifs, shdrs[sh.sh_link].sh_offset, shdrs[sh.sh_link].sh_size, strtab)) {
+      error_ = "Unable to read ELF symbol table.";
+      return *this;
+    }
+    for (size_t i = 0, ie = syms.size() / sizeof(Elf64_Sym); i < ie; ++i) {
+      Elf64_Sym sym;
+      memcpy(&sym, syms.data() + i * sizeof(Elf64_Sym), sizeof(sym));
+
+      const auto type = ELF64_ST_TYPE(sym.st_info);
+      if (type == STT_SECTION || type == STT_FILE || sym.st_shndx == SHN_UNDEF || sym.st_shndx >= SHN_LORESERVE) {
+        continue;
+      }
+      const auto name = get_name(strtab, sym.st_name);
+      if (name != "") {
+        symbols_.push_back({sym.st_shndx, {name, sym.st_value, sym.st_size}});
+      }
+    }
+  }
+
+  return *this;
+}
+
+vector<ElfReader::Symbol> ElfReader::get_symbols(const string& section) const {
+  vector<Symbol> result;
+
+  const auto itr = sections_.find(section);
+  if (itr == sections_.end()) {
+    return result;
+  }
+  for (const auto& s : symbols_) {
+    if (s.first == itr->second.index) {
+      result.push_back(s.second);
+    }
+  }
+
+  stable_sort(result.begin(), result.end(), [](const Symbol& a, const Symbol& b) {
+    return a.address < b.address;
+  });
+  return result;
+}
+
+} // namespace stoke
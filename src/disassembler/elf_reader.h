@@ -0,0 +1,88 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STOKE_SRC_DISASSEMBLER_ELF_READER_H
+#define STOKE_SRC_DISASSEMBLER_ELF_READER_H
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace stoke {
+
+/** Reads the section headers and symbol table of a 64-bit little-endian ELF
+  file; this is everything the disassembler needs besides the instructions. */
+class ElfReader {
+public:
+  /** A symbol defined in some section. */
+  struct Symbol {
+    std::string name;
+    uint64_t address;
+    uint64_t size;
+  };
+
+  /** Read the headers of a file; sets an error if it isn't a 64-bit ELF file. */
+  ElfReader& read(const std::string& filename);
+
+  /** Reports if an error occurred in the last read(). */
+  bool has_error() const {
+    return error_ != "";
+  }
+  /** Returns the latest error message. */
+  const std::string& get_error() const {
+    return error_;
+  }
+
+  /** Is there a section of this name? */
+  bool has_section(const std::string& name) const {
+    return sections_.find(name) != sections_.end();
+  }
+  /** The address of a section, as symbols and objdump -d see it. */
+  uint64_t section_address(const std::string& name) const {
+    return sections_.at(name).address;
+  }
+  /** The size of a section. */
+  uint64_t section_size(const std::string& name) const {
+    return sections_.at(name).size;
+  }
+  /** The load address of a section minus its file offset, as objdump -h reports them. */
+  uint64_t section_offset(const std::string& name) const {
+    return sections_.at(name).lma - sections_.at(name).offset;
+  }
+
+  /** The named symbols defined in a section, ordered by address. */
+  std::vector<Symbol> get_symbols(const std::string& section) const;
+
+private:
+  /** What we keep of a section header. */
+  struct Section {
+    size_t index;
+    uint64_t address;
+    uint64_t lma;
+    uint64_t offset;
+    uint64_t size;
+  };
+
+  /** Sections by name. */
+  std::map<std::string, Section> sections_;
+  /** Named symbols, with the index of the section they're defined in. */
+  std::vector<std::pair<size_t, Symbol>> symbols_;
+  /** The error from the last read(). */
+  std::string error_;
+};
+
+} // namespace stoke
+
+#endif
@@ -0,0 +1,56 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <cassert>
+
+#include "src/profiler/profiler.h"
+
+using namespace std;
+
+namespace stoke {
+
+bool Profiler::enabled_ = false;
+thread_local PhaseProfile Profiler::profile_[Profiler::NUM_PHASES];
+
+void Profiler::clear() {
+  for (size_t i = 0; i < NUM_PHASES; ++i) {
+    profile_[i].calls = 0;
+    profile_[i].cycles = 0;
+  }
+}
+
+string Profiler::get_name(Phase p) {
+  switch (p) {
+  case TRANSFORM:
+    return "transform";
+  case UNDO:
+    return "undo";
+  case COST:
+    return "cost";
+  case CORRECTNESS:
+    return "correctness";
+  case SANDBOX_RECOMPILE:
+    return "sandbox_recompile";
+  case SANDBOX_RUN:
+    return "sandbox_run";
+  case RECOMPUTE_DEFS:
+    return "recompute_defs";
+  default:
+    assert(false);
+    return "";
+  }
+}
+
+} // namespace stoke
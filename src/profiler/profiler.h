@@ -0,0 +1,103 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef STOKE_SRC_PROFILER_PROFILER_H
+#define STOKE_SRC_PROFILER_PROFILER_H
+
+#include <cstdint>
+#include <string>
+
+namespace stoke {
+
+/** Cycles spent in a phase, and the number of times it was entered. */
+struct PhaseProfile {
+  uint64_t calls;
+  uint64_t cycles;
+};
+
+/** Counts the cycles spent in the phases of the hot path of search, using the
+  time stamp counter.  The timers are always compiled in, but do nothing unless
+  profiling is enabled; reading the counter costs a few dozen cycles, which is
+  small next to a sandbox run.  Counts are kept per thread, so profiling the
+  search thread isn't disturbed by validators running sandboxes elsewhere. */
+class Profiler {
+public:
+  /** The phases that are timed.  Phases can nest; a cost function evaluation
+    includes the sandbox runs and correctness evaluation it does. */
+  enum Phase {
+    TRANSFORM,
+    UNDO,
+    COST,
+    CORRECTNESS,
+    SANDBOX_RECOMPILE,
+    SANDBOX_RUN,
+    RECOMPUTE_DEFS,
+    NUM_PHASES
+  };
+
+  /** Times the scope it lives in, if profiling was enabled on entry. */
+  class Timer {
+  public:
+    Timer(Phase p) : phase_(p), start_(enabled_ ? now() : 0) { }
+    ~Timer() {
+      if (start_ != 0) {
+        add(phase_, now() - start_);
+      }
+    }
+
+  private:
+    Phase phase_;
+    uint64_t start_;
+  };
+
+  /** Turn profiling on or off, for all threads. */
+  static void set_enabled(bool enabled) {
+    enabled_ = enabled;
+  }
+  /** Is profiling on? */
+  static bool enabled() {
+    return enabled_;
+  }
+
+  /** Reads the time stamp counter.  Not serializing; the phases are long
+    enough that a few cycles of reordering don't matter. */
+  static uint64_t now() {
+    uint32_t lo, hi;
+    asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+  }
+  /** Count one call of a phase. */
+  static void add(Phase p, uint64_t cycles) {
+    profile_[p].calls++;
+    profile_[p].cycles += cycles;
+  }
+
+  /** Returns the counts of this thread for a phase. */
+  static const PhaseProfile& get(Phase p) {
+    return profile_[p];
+  }
+  /** Resets the counts of this thread. */
+  static void clear();
+  /** Returns a name for a phase. */
+  static std::string get_name(Phase p);
+
+private:
+  static bool enabled_;
+  static thread_local PhaseProfile profile_[NUM_PHASES];
+};
+
+} // namespace stoke
+
+#endif
@@ -14,11 +14,15 @@
 
 #include "src/sandbox/sandbox.h"
 
+#include <algorithm>
 #include <cassert>
+#include <mutex>
 #include <set>
 #include <setjmp.h>
 #include <signal.h>
+#include <tuple>
 
+#include "src/profiler/profiler.h"
 #include "src/sandbox/dispatch_table.h"
 
 using namespace std;
@@ -32,7 +36,9 @@ set<Opcode> unsupported_ {{
   }
 };
 
-sigjmp_buf buf_;
+// SIGFPE is delivered to the thread that raised it, so each thread running a
+// sandbox needs its own jump buffer.
+thread_local sigjmp_buf buf_;
 void sigfpe_handler(int signum, siginfo_t* si, void* data) {
   siglongjmp(buf_, 1);
 }
@@ -106,14 +112,20 @@ void Sandbox::init() {
   set_stack_check(true);
   set_max_jumps(16);
 
+  has_latency_counter_ = false;
+  has_block_trace_ = false;
+  recompile_pending_ = false;
+
+  num_runs_ = 0;
+  run_time_ = chrono::duration<double>::zero();
+
   harness_ = emit_harness();
   signal_trap_ = emit_signal_trap();
   reset();
 
-  static bool once = false;
-  if (!once) {
-    once = true;
-
+  // Sandboxes may be copied on several threads at once (see DdecValidator)
+  static once_flag once;
+  call_once(once, [] {
     struct sigaction sa;
     sa.sa_sigaction = sigfpe_handler;
     sigemptyset(&sa.sa_mask);
@@ -122,7 +134,7 @@ void Sandbox::init() {
     const auto res = sigaction(SIGFPE, &sa, 0);
     (void) res;
     assert(res != -1 && "Unable to install sigfpe handler!");
-  }
+  });
 }
 
 Sandbox& Sandbox::insert_input(const CpuState& input) {
@@ -149,10 +161,16 @@ Sandbox& Sandbox::clear_inputs() {
     delete io;
   }
   io_pairs_.clear();
+
+  counts_.clear();
+  traces_.clear();
+  truncated_.clear();
   return *this;
 }
 
 Sandbox& Sandbox::insert_function(const Cfg& cfg) {
+  const auto start = chrono::steady_clock::now();
+
   // Look up the name of this function
   assert(cfg.get_function().invariant_first_instr_is_label());
   const auto label = cfg.get_function().get_leading_label();
@@ -162,9 +180,10 @@ Sandbox& Sandbox::insert_function(const Cfg& cfg) {
   if (!contains_function(label)) {
     fxns_[label] = new x64asm::Function(512 * cfg.get_code().size() + 8192);
     fxns_src_[label] = new Cfg(cfg);
-    recompile(cfg);
   } else {
     *fxns_src_[label] = cfg;
+  }
+  if (!recompile_pending_) {
     recompile(cfg);
   }
 
@@ -172,6 +191,8 @@ Sandbox& Sandbox::insert_function(const Cfg& cfg) {
   if (num_functions() == 1) {
     set_entrypoint(label);
   }
+
+  run_time_ += chrono::steady_clock::now() - start;
   return *this;
 }
 
@@ -198,7 +219,9 @@ Sandbox& Sandbox::insert_before(StateCallback cb, void* arg) {
 Sandbox& Sandbox::insert_before(const Label& l, size_t line, StateCallback cb, void* arg) {
   assert(contains_function(l));
   before_[l][line] = {cb, arg};
-  recompile(*get_function(l));
+  if (!recompile_pending_) {
+    recompile(*get_function(l));
+  }
   return *this;
 }
 
@@ -211,7 +234,9 @@ Sandbox& Sandbox::insert_after(StateCallback cb, void* arg) {
 Sandbox& Sandbox::insert_after(const Label& l, size_t line, StateCallback cb, void* arg) {
   assert(contains_function(l));
   after_[l][line] = {cb, arg};
-  recompile(*get_function(l));
+  if (!recompile_pending_) {
+    recompile(*get_function(l));
+  }
   return *this;
 }
 
@@ -220,18 +245,104 @@ Sandbox& Sandbox::clear_callbacks() {
   before_.clear();
   global_after_ = {nullptr, nullptr};
   after_.clear();
-  recompile();
+  recompile_pending_ = true;
+  return *this;
+}
+
+size_t Sandbox::insert_block_counter(const Label& l, Cfg::id_type block) {
+  assert(contains_function(l));
+  const auto counter = counters_.size();
+  counters_.push_back(0);
+  block_counters_[l][block] = counter;
+  // Counter addresses are compiled in, and may have moved
+  recompile_pending_ = true;
+  return counter;
+}
+
+size_t Sandbox::insert_branch_counter(const Label& l, size_t line) {
+  assert(contains_function(l));
+  assert(line < get_function(l)->get_code().size());
+  assert(get_function(l)->get_code()[line].is_jcc());
+  const auto counter = counters_.size();
+  counters_.push_back(0);
+  branch_counters_[l][line] = counter;
+  recompile_pending_ = true;
+  return counter;
+}
+
+size_t Sandbox::insert_address_counter(const Label& l, size_t line) {
+  assert(contains_function(l));
+  assert(line < get_function(l)->get_code().size());
+  const auto& instr = get_function(l)->get_code()[line];
+  assert(instr.is_explicit_memory_dereference() || instr.is_push() || instr.is_pop());
+  const auto counter = counters_.size();
+  counters_.push_back(0);
+  address_counters_[l][line] = counter;
+  recompile_pending_ = true;
+  return counter;
+}
+
+size_t Sandbox::insert_latency_counter() {
+  if (!has_latency_counter_) {
+    has_latency_counter_ = true;
+    latency_counter_ = counters_.size();
+    counters_.push_back(0);
+    recompile_pending_ = true;
+  }
+  return latency_counter_;
+}
+
+Sandbox& Sandbox::insert_block_trace(const Label& l) {
+  assert(contains_function(l));
+  has_block_trace_ = true;
+  block_trace_fxn_ = l;
+  recompile_pending_ = true;
+  return *this;
+}
+
+Sandbox& Sandbox::clear_counters() {
+  counters_.clear();
+  counts_.clear();
+  block_counters_.clear();
+  branch_counters_.clear();
+  address_counters_.clear();
+  has_latency_counter_ = false;
+
+  has_block_trace_ = false;
+  traces_.clear();
+  truncated_.clear();
+
+  recompile_pending_ = true;
   return *this;
 }
 
 Sandbox& Sandbox::run(size_t index) {
+  Profiler::Timer timer(Profiler::SANDBOX_RUN);
 
   assert(num_functions() > 0);
   assert(index < num_inputs());
   auto io = io_pairs_[index];
+  num_runs_++;
+
+  // Catch up on instrumentation changes; code may move, so look up the
+  // entrypoint again
+  if (recompile_pending_) {
+    recompile();
+    entrypoint_ = fxns_[main_fxn_]->get_entrypoint();
+  }
+
+  // Reset counters and the block trace
+  fill(counters_.begin(), counters_.end(), 0);
+  if (has_block_trace_) {
+    const auto blocks = fxns_src_[block_trace_fxn_]->num_blocks();
+    trace_buf_.resize((max_jumps_ + 1) * blocks);
+    trace_next_ = trace_buf_.data();
+    trace_remaining_ = trace_buf_.size();
+  }
 
   // Don't bother executing testcases that are in error states
   if (io->in_.code != ErrorCode::NORMAL) {
+    save_counters(index);
     return *this;
   }
 
@@ -272,14 +383,17 @@ Sandbox& Sandbox::run(size_t index) {
   if (abi_check_ && !check_abi(*io)) {
     io->out_.code = ErrorCode::SIGCUSTOM_ABI_VIOLATION;
   }
+  save_counters(index);
 
   return *this;
 }
 
 Sandbox& Sandbox::run() {
+  const auto start = chrono::steady_clock::now();
   for (size_t i = 0, ie = size(); i < ie; ++i) {
     run(i);
   }
+  run_time_ += chrono::steady_clock::now() - start;
   return *this;
 }
 
@@ -294,6 +408,21 @@ bool Sandbox::check_abi(const IoPair& iop) const {
   return true;
 }
 
+void Sandbox::save_counters(size_t index) {
+  if (!counters_.empty()) {
+    const auto n = counters_.size();
+    counts_.resize(max(counts_.size(), num_inputs() * n));
+    copy(counters_.begin(), counters_.end(), counts_.begin() + index * n);
+  }
+
+  if (has_block_trace_) {
+    traces_.resize(max(traces_.size(), num_inputs()));
+    truncated_.resize(traces_.size());
+    traces_[index].assign(trace_buf_.data(), trace_next_);
+    truncated_[index] = trace_remaining_ == 0;
+  }
+}
+
 size_t Sandbox::get_unused_reg(const Instruction& instr) const {
   const auto rs = instr.maybe_read_set();
   const auto ws = instr.maybe_write_set();
@@ -307,6 +436,8 @@ size_t Sandbox::get_unused_reg(const Instruction& instr) const {
 }
 
 void Sandbox::recompile(const Cfg& cfg) {
+  Profiler::Timer timer(Profiler::SANDBOX_RECOMPILE);
+
   // Grab the name of this function
   assert(cfg.get_function().invariant_first_instr_is_label());
   const auto& label = cfg.get_function().get_leading_label();
@@ -330,6 +461,7 @@ void Sandbox::recompile() {
   for (const auto& fxn : fxns_src_) {
     recompile(*fxn.second);
   }
+  recompile_pending_ = false;
 }
 
 // Main entrypoint for sandboxed code.
@@ -724,6 +856,11 @@ bool Sandbox::emit_function(const Cfg& cfg, Function* fxn) {
   // Make a unique label for representing the end
   const auto exit = get_label();
 
+  // Taken branches that are counted go through a trampoline at the end
+  const auto branches = branch_counters_.find(label);
+  const auto addresses = address_counters_.find(label);
+  vector<tuple<Label, Label, size_t>> trampolines;
+
   // Assemble instructions and add instrumentation for reachable blocks
   for (Cfg::id_type b = 0, be = cfg.num_blocks(); b < be; ++b) {
     if (!cfg.is_reachable(b)) {
@@ -740,19 +877,49 @@ bool Sandbox::emit_function(const Cfg& cfg, Function* fxn) {
       const auto& instr = f.get_code()[i];
       const auto hex_offset = f.get_rip_offset() + f.hex_offset(i) + f.hex_size(i);
 
+      // Jumps land after a label, so count blocks that begin with one there
+      if (i == begin && !instr.is_label_defn()) {
+        emit_block_entry(label, b);
+      }
+
       // Emit callbacks and instruction
       if (global_before_.first != nullptr || !before_.empty()) {
         emit_before(cfg.get_function().get_leading_label(), i);
       }
-      emit_instruction(instr, label, hex_offset, entry, exit);
+      if (has_latency_counter_ && instr.haswell_latency() > 0) {
+        emit_add_counter(latency_counter_, instr.haswell_latency());
+      }
+      if (addresses != address_counters_.end() && addresses->second.count(i)) {
+        emit_address_counter(addresses->second.at(i), instr, hex_offset);
+      }
+      if (branches != branch_counters_.end() && branches->second.count(i)) {
+        const auto target = instr.get_operand<Label>(0);
+        const auto trampoline = get_label();
+        trampolines.push_back(make_tuple(trampoline, target == label ? entry : target, branches->second.at(i)));
+        emit_jump({instr.get_opcode(), {trampoline}});
+      } else {
+        emit_instruction(instr, label, hex_offset, entry, exit);
+      }
       if (global_after_.first != nullptr || !after_.empty()) {
         emit_after(cfg.get_function().get_leading_label(), i);
       }
+
+      if (i == begin && instr.is_label_defn()) {
+        emit_block_entry(label, b);
+      }
     }
   }
   // Catch for run-away code
   emit_signal_trap_call(ErrorCode::SIGCUSTOM_NO_RETURN);
 
+  // Count the branch and carry on to its target; the jump was already
+  // counted against max_jumps on the way here
+  for (const auto& t : trampolines) {
+    assm_.bind(get<0>(t));
+    emit_add_counter(get<2>(t), 1);
+    assm_.assemble({JMP_LABEL_1, {get<1>(t)}});
+  }
+
   // All returns in this function point to here
   assm_.bind(exit);
 
@@ -830,6 +997,93 @@ void Sandbox::emit_after(const Label& label, size_t line) {
   emit_callback(j->second, label, line);
 }
 
+void Sandbox::emit_block_entry(const Label& fxn, Cfg::id_type block) {
+  const auto i = block_counters_.find(fxn);
+  if (i != block_counters_.end()) {
+    const auto j = i->second.find(block);
+    if (j != i->second.end()) {
+      emit_add_counter(j->second, 1);
+    }
+  }
+  if (has_block_trace_ && fxn == block_trace_fxn_) {
+    emit_trace(block);
+  }
+}
+
+void Sandbox::emit_add_counter(size_t counter, uint64_t inc) {
+  assert(counter < counters_.size());
+  assert(inc < 0x80000000);
+
+  // Only rax can move to and from an absolute address, and lea adds without
+  // touching the flags, so there's no need to switch stacks and save them
+  assm_.mov(Moffs64(&scratch_[rax]), rax);
+  assm_.mov(rax, Moffs64(&counters_[counter]));
+  assm_.lea(rax, M64(rax, Imm32(inc)));
+  assm_.mov(Moffs64(&counters_[counter]), rax);
+  assm_.mov(rax, Moffs64(&scratch_[rax]));
+}
+
+void Sandbox::emit_address_counter(size_t counter, const Instruction& instr, uint64_t hex_offset) {
+  assert(counter < counters_.size());
+
+  // The user's %rsp is live here, so lea computes the same address the
+  // instruction will; like emit_add_counter, this needs neither the flags
+  // nor the STOKE stack
+  assm_.mov(Moffs64(&scratch_[rax]), rax);
+  if (instr.is_explicit_memory_dereference()) {
+    const auto op = instr.get_operand<M64>(instr.mem_index());
+    if (op.rip_offset()) {
+      const int32_t disp = op.get_disp();
+      assm_.mov((R64)rax, Imm64(hex_offset + (uint64_t)(int64_t)disp));
+    } else {
+      assm_.lea(rax, op);
+    }
+  } else if (instr.is_push()) {
+    // Pushes write below %rsp; these are the quadword ones (as in CpuState::get_addr)
+    int32_t bytes = 2;
+    switch (instr.get_opcode()) {
+    case PUSHQ_IMM32:
+    case PUSHQ_IMM16:
+    case PUSHQ_IMM8:
+    case PUSH_M64:
+    case PUSH_R64:
+    case PUSH_R64_1:
+      bytes = 8;
+      break;
+    default:
+      break;
+    }
+    assm_.lea(rax, M64(rsp, Imm32(-bytes)));
+  } else {
+    assm_.mov((R64)rax, rsp);
+  }
+  assm_.mov(Moffs64(&counters_[counter]), rax);
+  assm_.mov(rax, Moffs64(&scratch_[rax]));
+}
+
+void Sandbox::emit_trace(uint64_t value) {
+  // Checking for space needs the flags; save them on the STOKE stack
+  emit_load_stoke_rsp();
+  assm_.push_1(rax);
+  assm_.pushfq();
+
+  const auto full = get_label();
+  assm_.mov(rax, Moffs64(&trace_remaining_));
+  assm_.test((R64)rax, (R64)rax);
+  assm_.je_1(full);
+  assm_.dec((R64)rax);
+  assm_.mov(Moffs64(&trace_remaining_), rax);
+  assm_.mov(rax, Moffs64(&trace_next_));
+  assm_.mov(M64(rax), Imm32((uint32_t)value));
+  assm_.lea(rax, M64(rax, Imm32(8)));
+  assm_.mov(Moffs64(&trace_next_), rax);
+  assm_.bind(full);
+
+  assm_.popfq();
+  assm_.pop_1(rax);
+  emit_load_user_rsp();
+}
+
 void Sandbox::emit_instruction(const Instruction& instr, const Label& fxn, uint64_t hex_offset, const Label& entry, const Label& exit) {
   static DispatchTable table;
   switch (table.lookup(instr)) {
@@ -15,6 +15,7 @@
 #ifndef STOKE_SRC_SANDBOX_SANDBOX_H
 #define STOKE_SRC_SANDBOX_SANDBOX_H
 
+#include <chrono>
 #include <unordered_map>
 #include <vector>
 
@@ -90,11 +91,13 @@ public:
     return *this;
   }
 
-  /** Resets the sandbox to a consistent state. Clears all inputs, functions and callbacks. */
+  /** Resets the sandbox to a consistent state. Clears all inputs, functions,
+    callbacks and counters. */
   Sandbox& reset() {
     clear_inputs();
     clear_functions();
     clear_callbacks();
+    clear_counters();
     clear_label_pools();
     return *this;
   }
@@ -173,6 +176,47 @@ public:
   /** Clears the set of callbacks to invoke during execution. */
   Sandbox& clear_callbacks();
 
+  /** Count the number of times a block of a function is entered; returns the
+    index of the counter.  Unlike a callback, which saves the whole machine
+    state and calls back into STOKE, a counter is a handful of instructions
+    emitted inline, so counting costs little more than a plain run.  Counter
+    values are kept separately for each input. */
+  size_t insert_block_counter(const x64asm::Label& l, Cfg::id_type block);
+  /** Count the number of times the conditional jump on a line of a function
+    is taken; returns the index of the counter. */
+  size_t insert_branch_counter(const x64asm::Label& l, size_t line);
+  /** Record the address that the memory dereference on a line of a function
+    reads or writes; returns the index of the counter, which holds the
+    address from the last time the line ran (or zero if it never did). */
+  size_t insert_address_counter(const x64asm::Label& l, size_t line);
+  /** Count the latency of every line executed in every function; returns the
+    index of the counter. */
+  size_t insert_latency_counter();
+  /** Record the blocks of a function that are entered, in order. */
+  Sandbox& insert_block_trace(const x64asm::Label& l);
+  /** Clears all counters and traces. */
+  Sandbox& clear_counters();
+  /** Returns the number of counters. */
+  size_t num_counters() const {
+    return counters_.size();
+  }
+  /** Returns the value of a counter after the last run of an input. */
+  uint64_t get_counter(size_t index, size_t counter) const {
+    assert(counter < num_counters());
+    const auto i = index * num_counters() + counter;
+    return i < counts_.size() ? counts_[i] : 0;
+  }
+  /** Returns the blocks entered during the last run of an input. */
+  const std::vector<Cfg::id_type>& get_block_trace(size_t index) const {
+    assert(index < traces_.size());
+    return traces_[index];
+  }
+  /** Did the block trace of an input run out of space? */
+  bool block_trace_truncated(size_t index) const {
+    assert(index < truncated_.size());
+    return truncated_[index];
+  }
+
   /** Designates a function as the entrypoint. */
   Sandbox& set_entrypoint(const x64asm::Label& l) {
     assert(contains_function(l));
@@ -185,6 +229,15 @@ public:
   /** Run a main function for all inputs. */
   Sandbox& run();
 
+  /** Returns the number of times an input has been run. */
+  size_t num_runs() const {
+    return num_runs_;
+  }
+  /** Returns the time spent in insert_function() and run() for all inputs. */
+  std::chrono::duration<double> get_run_time() const {
+    return run_time_;
+  }
+
   /** @deprecated */
   size_t size() const {
     return num_inputs();
@@ -250,6 +303,10 @@ private:
   /** The maximum number of jumps to take before raising SIGINT. */
   size_t max_jumps_;
 
+  /** Inputs run and time spent, for monitoring. */
+  size_t num_runs_;
+  std::chrono::duration<double> run_time_;
+
   /** Assembler, no sense in always creating these. */
   x64asm::Assembler assm_;
   /** Linker, no sense in always creating these either. */
@@ -315,11 +372,38 @@ private:
   /** Auxiliary function source (saved in case recompilation is necessary). */
   std::unordered_map<x64asm::Label, Cfg*> fxns_src_;
 
+  /** Counters, as updated in place by compiled code. */
+  std::vector<uint64_t> counters_;
+  /** Counter values after each input, num_counters() per input. */
+  std::vector<uint64_t> counts_;
+  /** Block counters by function and block. */
+  std::unordered_map<x64asm::Label, std::unordered_map<Cfg::id_type, size_t>> block_counters_;
+  /** Branch counters by function and line. */
+  std::unordered_map<x64asm::Label, std::unordered_map<size_t, size_t>> branch_counters_;
+  /** Address counters by function and line. */
+  std::unordered_map<x64asm::Label, std::unordered_map<size_t, size_t>> address_counters_;
+  /** The latency counter, if there is one. */
+  bool has_latency_counter_;
+  size_t latency_counter_;
+
+  /** The function whose blocks are traced, if any. */
+  bool has_block_trace_;
+  x64asm::Label block_trace_fxn_;
+  /** Trace buffer for the current run, its next free slot and space left. */
+  std::vector<uint64_t> trace_buf_;
+  uint64_t* trace_next_;
+  uint64_t trace_remaining_;
+  /** Block traces after each input. */
+  std::vector<std::vector<Cfg::id_type>> traces_;
+  std::vector<bool> truncated_;
+
   /** Do setup in constructor. */
   void init();
 
   /** Check for abi violations between input and output states */
   bool check_abi(const IoPair& iop) const;
+  /** Keep the counter values and block trace of a run of an input. */
+  void save_counters(size_t index);
 
   /** Returns true if this instruction uses rh */
   bool uses_rh(const x64asm::Instruction& instr) const {
@@ -373,6 +457,10 @@ private:
   void recompile(const Cfg& cfg);
   /** Recompiles every function */
   void recompile();
+  /** Does every function need recompiling before the next run?  Changes to
+    instrumentation set this rather than recompiling on the spot, so that
+    adding several counters costs one recompile. */
+  bool recompile_pending_;
 
   /** Assembles the harness function */
   x64asm::Function emit_harness();
@@ -395,6 +483,15 @@ private:
   void emit_before(const x64asm::Label& fxn, size_t line);
   /** Emit all after callbacks */
   void emit_after(const x64asm::Label& fxn, size_t line);
+  /** Emit the counters and trace for entering a block. */
+  void emit_block_entry(const x64asm::Label& fxn, Cfg::id_type block);
+  /** Emit code that adds to a counter, leaving registers and flags alone. */
+  void emit_add_counter(size_t counter, uint64_t inc);
+  /** Emit code that stores the address an instruction dereferences in a
+    counter, leaving registers and flags alone. */
+  void emit_address_counter(size_t counter, const x64asm::Instruction& instr, uint64_t hex_offset);
+  /** Emit code that appends a value to the block trace. */
+  void emit_trace(uint64_t value);
   /** Emit an instruction (and possibly sandbox memory). */
   void emit_instruction(const x64asm::Instruction& instr, const x64asm::Label& fxn, uint64_t hex_offset, const x64asm::Label& entry, const x64asm::Label& exit);
   /** Emit a memory instruction. */
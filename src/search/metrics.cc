@@ -0,0 +1,181 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <cstdio>
+#include <fstream>
+
+#include "src/search/metrics.h"
+#include "src/transform/weighted.h"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+/** Writes the help and type lines of a metric. */
+void header(ostream& os, const string& name, const string& type, const string& help) {
+  os << "# HELP " << name << " " << help << endl;
+  os << "# TYPE " << name << " " << type << endl;
+}
+
+} // namespace
+
+namespace stoke {
+
+MetricsWriter& MetricsWriter::clear() {
+  done_iterations_ = 0;
+  done_elapsed_ = duration<double>::zero();
+  done_transform_ = duration<double>::zero();
+  done_cost_ = duration<double>::zero();
+  done_moves_.clear();
+  done_lookups_ = 0;
+  done_hits_ = 0;
+
+  iterations_ = 0;
+  elapsed_ = duration<double>::zero();
+  transform_time_ = duration<double>::zero();
+  cost_time_ = duration<double>::zero();
+  moves_.clear();
+  current_cost_ = 0;
+  best_yet_cost_ = 0;
+  best_correct_cost_ = 0;
+  rate_ = 0;
+
+  return *this;
+}
+
+MetricsWriter& MetricsWriter::record(const StatisticsCallbackData& data) {
+  // FIXME: Like stoke_search, this only works with 'WeightedTransform'
+  const auto transform = static_cast<const WeightedTransform*>(data.transform);
+  move_names_.resize(transform->size());
+  for (size_t i = 0, ie = transform->size(); i < ie; ++i) {
+    move_names_[i] = transform->get_transform(i)->get_name();
+  }
+
+  const auto dt = (data.elapsed - elapsed_).count();
+  if (dt > 0 && data.iterations >= iterations_) {
+    rate_ = (data.iterations - iterations_) / dt;
+  }
+
+  iterations_ = data.iterations;
+  elapsed_ = data.elapsed;
+  transform_time_ = data.transform_time;
+  cost_time_ = data.cost_time;
+  moves_ = data.move_statistics;
+  current_cost_ = data.current_cost;
+  best_yet_cost_ = data.best_yet_cost;
+  best_correct_cost_ = data.best_correct_cost;
+
+  return *this;
+}
+
+MetricsWriter& MetricsWriter::next_search() {
+  done_iterations_ += iterations_;
+  done_elapsed_ += elapsed_;
+  done_transform_ += transform_time_;
+  done_cost_ += cost_time_;
+  done_moves_.resize(moves_.size());
+  for (size_t i = 0, ie = moves_.size(); i < ie; ++i) {
+    done_moves_[i] += moves_[i];
+  }
+  if (fxn_ != nullptr) {
+    fxn_->get_cache_statistics(done_lookups_, done_hits_);
+    fxn_ = nullptr;
+  }
+
+  iterations_ = 0;
+  elapsed_ = duration<double>::zero();
+  transform_time_ = duration<double>::zero();
+  cost_time_ = duration<double>::zero();
+  moves_.clear();
+
+  return *this;
+}
+
+void MetricsWriter::write(ostream& os) const {
+  header(os, "stoke_search_iterations_total", "counter", "Proposals made.");
+  os << "stoke_search_iterations_total " << done_iterations_ + iterations_ << endl;
+  header(os, "stoke_search_iterations_per_second", "gauge", "Proposals per second since the last update.");
+  os << "stoke_search_iterations_per_second " << rate_ << endl;
+  header(os, "stoke_search_elapsed_seconds_total", "counter", "Time spent searching.");
+  os << "stoke_search_elapsed_seconds_total " << (done_elapsed_ + elapsed_).count() << endl;
+
+  header(os, "stoke_search_moves_total", "counter", "Moves by type and outcome.");
+  for (size_t i = 0, ie = move_names_.size(); i < ie; ++i) {
+    Statistics total;
+    if (i < done_moves_.size()) {
+      total += done_moves_[i];
+    }
+    if (i < moves_.size()) {
+      total += moves_[i];
+    }
+    const auto label = "stoke_search_moves_total{move=\"" + move_names_[i] + "\",outcome=";
+    os << label << "\"proposed\"} " << total.num_proposed << endl;
+    os << label << "\"succeeded\"} " << total.num_succeeded << endl;
+    os << label << "\"accepted\"} " << total.num_accepted << endl;
+  }
+
+  header(os, "stoke_search_cost", "gauge", "Cost of the current, best and best correct rewrites.");
+  os << "stoke_search_cost{rewrite=\"current\"} " << current_cost_ << endl;
+  os << "stoke_search_cost{rewrite=\"best\"} " << best_yet_cost_ << endl;
+  os << "stoke_search_cost{rewrite=\"best_correct\"} " << best_correct_cost_ << endl;
+
+  // The sandboxes run inside the cost function, so their time is taken out
+  // of it.  Sandbox time also counts setup outside of search, hence the clamp.
+  duration<double> sandbox_time = duration<double>::zero();
+  header(os, "stoke_sandbox_runs_total", "counter", "Testcases run, by sandbox.");
+  for (const auto& sb : sandboxes_) {
+    os << "stoke_sandbox_runs_total{sandbox=\"" << sb.first << "\"} " << sb.second->num_runs() << endl;
+    sandbox_time += sb.second->get_run_time();
+  }
+  const auto cost_time = done_cost_ + cost_time_;
+  if (sandbox_time > cost_time) {
+    sandbox_time = cost_time;
+  }
+  header(os, "stoke_search_phase_seconds_total", "counter", "Time spent in each phase of search.");
+  os << "stoke_search_phase_seconds_total{phase=\"transform\"} " << (done_transform_ + transform_time_).count() << endl;
+  os << "stoke_search_phase_seconds_total{phase=\"sandbox\"} " << sandbox_time.count() << endl;
+  os << "stoke_search_phase_seconds_total{phase=\"cost\"} " << (cost_time - sandbox_time).count() << endl;
+
+  auto lookups = done_lookups_;
+  auto hits = done_hits_;
+  if (fxn_ != nullptr) {
+    fxn_->get_cache_statistics(lookups, hits);
+  }
+  header(os, "stoke_cost_cache_lookups_total", "counter", "Lookups into cost function caches.");
+  os << "stoke_cost_cache_lookups_total " << lookups << endl;
+  header(os, "stoke_cost_cache_hits_total", "counter", "Lookups into cost function caches that hit.");
+  os << "stoke_cost_cache_hits_total " << hits << endl;
+  header(os, "stoke_cost_cache_hit_ratio", "gauge", "Fraction of cost function cache lookups that hit.");
+  os << "stoke_cost_cache_hit_ratio " << (lookups == 0 ? 0.0 : (double)hits / lookups) << endl;
+}
+
+MetricsWriter& MetricsWriter::update(const StatisticsCallbackData& data) {
+  record(data);
+  error_ = "";
+
+  const auto tmp = path_ + ".tmp";
+  ofstream ofs(tmp);
+  write(ofs);
+  ofs.close();
+  if (!ofs.good()) {
+    error_ = "Unable to write metrics to " + tmp;
+  } else if (rename(tmp.c_str(), path_.c_str()) != 0) {
+    error_ = "Unable to replace " + path_;
+  }
+  return *this;
+}
+
+} // namespace stoke
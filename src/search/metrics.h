@@ -0,0 +1,119 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef STOKE_SRC_SEARCH_METRICS_H
+#define STOKE_SRC_SEARCH_METRICS_H
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/cost/cost_function.h"
+#include "src/sandbox/sandbox.h"
+#include "src/search/statistics.h"
+#include "src/search/statistics_callback.h"
+
+namespace stoke {
+
+/** Reports the progress of a search in the Prometheus text format, for
+  dashboards to scrape while the search runs.  Counters are totals over every
+  search the writer has seen, so restarts don't reset them.  The time in the
+  cost function is split into the time in the sandboxes it runs and the
+  rest. */
+class MetricsWriter {
+public:
+  MetricsWriter() : fxn_(nullptr) {
+    clear();
+  }
+
+  /** Set the file that update() replaces. */
+  MetricsWriter& set_path(const std::string& path) {
+    path_ = path;
+    return *this;
+  }
+  /** Report the cache statistics of the cost function of the current search. */
+  MetricsWriter& set_cost_function(const CostFunction* fxn) {
+    fxn_ = fxn;
+    return *this;
+  }
+  /** Report the runs of a sandbox that the cost function uses. */
+  MetricsWriter& add_sandbox(const std::string& name, const Sandbox* sb) {
+    sandboxes_.push_back({name, sb});
+    return *this;
+  }
+  /** Forget the totals of previous searches. */
+  MetricsWriter& clear();
+
+  /** Take the latest statistics of the current search. */
+  MetricsWriter& record(const StatisticsCallbackData& data);
+  /** Add the current search to the totals, and forget its cost function; the
+    next record() starts a new search.  Call this with the final statistics of
+    a search recorded, while its cost function is still alive. */
+  MetricsWriter& next_search();
+  /** Write the totals. */
+  void write(std::ostream& os) const;
+  /** Record statistics and replace the file with the totals.  The metrics are
+    written to a temporary file which is then renamed, so readers never see a
+    partial update. */
+  MetricsWriter& update(const StatisticsCallbackData& data);
+
+  /** Reports if the last update() failed. */
+  bool has_error() const {
+    return error_ != "";
+  }
+  /** Returns the latest error message. */
+  const std::string& get_error() const {
+    return error_;
+  }
+
+private:
+  /** Where to write. */
+  std::string path_;
+  /** What to report on besides the search. */
+  const CostFunction* fxn_;
+  std::vector<std::pair<std::string, const Sandbox*>> sandboxes_;
+
+  /** Totals over finished searches. */
+  size_t done_iterations_;
+  std::chrono::duration<double> done_elapsed_;
+  std::chrono::duration<double> done_transform_;
+  std::chrono::duration<double> done_cost_;
+  std::vector<Statistics> done_moves_;
+  size_t done_lookups_;
+  size_t done_hits_;
+
+  /** Latest statistics of the current search. */
+  size_t iterations_;
+  std::chrono::duration<double> elapsed_;
+  std::chrono::duration<double> transform_time_;
+  std::chrono::duration<double> cost_time_;
+  std::vector<Statistics> moves_;
+  std::vector<std::string> move_names_;
+  Cost current_cost_;
+  Cost best_yet_cost_;
+  Cost best_correct_cost_;
+
+  /** Iterations per second since the previous record(). */
+  double rate_;
+
+  /** Error from the last update(). */
+  std::string error_;
+};
+
+} // namespace stoke
+
+#endif
@@ -17,6 +17,7 @@
 #include <csignal>
 #include <unistd.h>
 
+#include "src/profiler/profiler.h"
 #include "src/search/search.h"
 #include "src/transform/weighted.h"
 
@@ -44,6 +45,8 @@ Search::Search(Transform* transform) : transform_(transform) {
   set_progress_callback(nullptr, nullptr);
   set_statistics_callback(nullptr, nullptr);
   set_statistics_interval(100000);
+  set_metrics_callback(nullptr, nullptr);
+  set_metrics_period(duration<double>(1.0));
 
   static bool once = false;
   if (!once) {
@@ -73,8 +76,21 @@ void Search::run(const Cfg& target, CostFunction& fxn, Init init, SearchState& s
   // statistics.
   move_statistics = vector<Statistics>(static_cast<WeightedTransform*>(transform_)->size());
   num_iterations = 0;
+  transform_time_ = duration<double>::zero();
+  cost_time_ = duration<double>::zero();
   const auto start = chrono::steady_clock::now();
 
+  // Profile this search only, not setup or previous searches
+  const auto profile = Profiler::enabled();
+  Profiler::clear();
+  phases_.clear();
+  update_statistics(state, 0, start);
+
+  // Phases are only timed for the metrics callback; reading the clock a few
+  // times per iteration is cheap next to running the testcases, but not free.
+  const auto timed = metrics_cb_ != nullptr;
+  auto last_metrics = start;
+
   // Early corner case bailouts
   if (state.current_cost == 0) {
     state.success = true;
@@ -90,10 +106,18 @@ void Search::run(const Cfg& target, CostFunction& fxn, Init init, SearchState& s
   for (iterations = 0; (state.current_cost > 0) && !give_up_now; ++iterations) {
     // Invoke statistics callback if we've been running for long enough
     if ((statistics_cb_ != nullptr) && (iterations % interval_ == 0) && iterations > 0) {
-      elapsed = duration_cast<duration<double>>(steady_clock::now() - start);
-      num_iterations = iterations;
+      update_statistics(state, iterations, start);
       statistics_cb_(get_statistics(), statistics_cb_arg_);
     }
+    // Likewise for metrics, but by wall time; don't read the clock every time
+    if (timed && (iterations % 64 == 0)) {
+      const auto now = steady_clock::now();
+      if (now - last_metrics >= metrics_period_) {
+        last_metrics = now;
+        update_statistics(state, iterations, start);
+        metrics_cb_(get_statistics(), metrics_cb_arg_);
+      }
+    }
 
     // This is just here to clean up the for loop; check early exit conditions
     if (timeout_itr_ > 0 && iterations >= timeout_itr_) {
@@ -104,25 +128,59 @@ void Search::run(const Cfg& target, CostFunction& fxn, Init init, SearchState& s
     }
 
 
+    const auto transform_start = timed ? steady_clock::now() : start;
+    const auto transform_tsc = profile ? Profiler::now() : 0;
     ti = (*transform_)(state.current);
-    move_statistics[ti.move_type].num_proposed++;
+    auto& move = move_statistics[ti.move_type];
+    move.num_proposed++;
+    if (profile) {
+      const auto cycles = Profiler::now() - transform_tsc;
+      Profiler::add(Profiler::TRANSFORM, cycles);
+      move.transform_cycles += cycles;
+    }
     if (!ti.success) {
+      if (timed) {
+        transform_time_ += steady_clock::now() - transform_start;
+      }
       continue;
     }
-    move_statistics[ti.move_type].num_succeeded++;
+    move.num_succeeded++;
 
     const auto p = prob_(gen_);
     const auto max = state.current_cost - (log(p) / beta_);
 
+    const auto cost_start = timed ? steady_clock::now() : start;
+    if (timed) {
+      transform_time_ += cost_start - transform_start;
+    }
+    const auto cost_tsc = profile ? Profiler::now() : 0;
     const auto new_res = fxn(state.current, max + 1);
     const auto is_correct = new_res.first;
     const auto new_cost = new_res.second;
+    if (profile) {
+      const auto cycles = Profiler::now() - cost_tsc;
+      Profiler::add(Profiler::COST, cycles);
+      move.cost_cycles += cycles;
+    }
+    if (timed) {
+      cost_time_ += steady_clock::now() - cost_start;
+    }
 
     if (new_cost > max) {
+      const auto undo_start = timed ? steady_clock::now() : start;
+      const auto undo_tsc = profile ? Profiler::now() : 0;
       (*transform_).undo(state.current, ti);
+      if (profile) {
+        const auto cycles = Profiler::now() - undo_tsc;
+        Profiler::add(Profiler::UNDO, cycles);
+        move.transform_cycles += cycles;
+      }
+      if (timed) {
+        transform_time_ += steady_clock::now() - undo_start;
+      }
       continue;
     }
-    move_statistics[ti.move_type].num_accepted++;
+    move.num_accepted++;
     state.current_cost = new_cost;
 
     const auto new_best_yet = new_cost < state.best_yet_cost;
@@ -144,8 +202,7 @@ void Search::run(const Cfg& target, CostFunction& fxn, Init init, SearchState& s
   }
 
   // update values for statistics
-  elapsed = duration_cast<duration<double>>(steady_clock::now() - start);
-  num_iterations = iterations;
+  update_statistics(state, iterations, start);
 
   if (give_up_now) {
     state.interrupted = true;
@@ -159,7 +216,23 @@ void Search::run(const Cfg& target, CostFunction& fxn, Init init, SearchState& s
 }
 
 StatisticsCallbackData Search::get_statistics() const {
-  return {move_statistics, num_iterations, elapsed, transform_};
+  return {move_statistics, num_iterations, elapsed, transform_,
+          current_cost_, best_yet_cost_, best_correct_cost_, transform_time_, cost_time_, phases_};
+}
+
+void Search::update_statistics(const SearchState& state, size_t iterations, steady_clock::time_point start) {
+  elapsed = duration_cast<duration<double>>(steady_clock::now() - start);
+  num_iterations = iterations;
+  current_cost_ = state.current_cost;
+  best_yet_cost_ = state.best_yet_cost;
+  best_correct_cost_ = state.best_correct_cost;
+
+  if (Profiler::enabled()) {
+    phases_.resize(Profiler::NUM_PHASES);
+    for (size_t i = 0; i < Profiler::NUM_PHASES; ++i) {
+      phases_[i] = Profiler::get((Profiler::Phase)i);
+    }
+  }
 }
 
 void Search::stop() {
@@ -19,6 +19,7 @@
 #include <random>
 
 #include "src/cost/cost_function.h"
+#include "src/profiler/profiler.h"
 #include "src/search/init.h"
 #include "src/search/progress_callback.h"
 #include "src/search/search_state.h"
@@ -72,6 +73,19 @@ public:
     return *this;
   }
 
+  /** Set a callback to invoke about once a period of wall time, for example to
+    export metrics; while one is set, the search also times its phases. */
+  Search& set_metrics_callback(StatisticsCallback cb, void* arg) {
+    metrics_cb_ = cb;
+    metrics_cb_arg_ = arg;
+    return *this;
+  }
+  /** Set the wall time between metrics updates. */
+  Search& set_metrics_period(std::chrono::duration<double> period) {
+    metrics_period_ = period;
+    return *this;
+  }
+
   /** Run search beginning from a search state using a user-supplied cost function. */
   void run(const Cfg& target, CostFunction& fxn, Init init, SearchState& state, std::vector<stoke::TUnit>& aux_fxn);
   /** Stops an in-progress search.  To be used from a callback, for example. */
@@ -106,12 +120,24 @@ private:
   void* statistics_cb_arg_;
   /** How often are statistics printed? */
   size_t interval_;
+  /** Metrics callback, and how often to invoke it. */
+  StatisticsCallback metrics_cb_;
+  void* metrics_cb_arg_;
+  std::chrono::duration<double> metrics_period_;
 
   /** Statistics so far. */
   std::vector<Statistics> move_statistics;
   size_t num_iterations;
   std::chrono::duration<double> elapsed;
-
+  Cost current_cost_;
+  Cost best_yet_cost_;
+  Cost best_correct_cost_;
+  std::chrono::duration<double> transform_time_;
+  std::chrono::duration<double> cost_time_;
+  std::vector<PhaseProfile> phases_;
+
+  /** Records the iterations, elapsed time and costs for get_statistics(). */
+  void update_statistics(const SearchState& state, size_t iterations, std::chrono::steady_clock::time_point start);
   /** Configures a search state. */
   void configure(const Cfg& target, CostFunction& fxn, SearchState& state, std::vector<stoke::TUnit>& aux_fxn) const;
 };
@@ -15,17 +15,23 @@
 #ifndef STOKE_SRC_SEARCH_STATISTICS_H
 #define STOKE_SRC_SEARCH_STATISTICS_H
 
+#include <cstddef>
+#include <cstdint>
+
 namespace stoke {
 
 struct Statistics {
   /** Creates a new statistics triple. */
-  Statistics() : num_proposed(0), num_succeeded(0), num_accepted(0) { }
+  Statistics() : num_proposed(0), num_succeeded(0), num_accepted(0),
+    transform_cycles(0), cost_cycles(0) { }
 
   /** Pointwise increment. */
   Statistics& operator+=(const Statistics& rhs) {
     num_proposed += rhs.num_proposed;
     num_succeeded += rhs.num_succeeded;
     num_accepted += rhs.num_accepted;
+    transform_cycles += rhs.transform_cycles;
+    cost_cycles += rhs.cost_cycles;
     return *this;
   }
 
@@ -35,6 +41,10 @@ struct Statistics {
   size_t num_succeeded;
   /** The number of proposals that were accepted. */
   size_t num_accepted;
+  /** Cycles spent proposing and undoing these moves, and evaluating the cost
+    of the proposals; only counted while profiling is enabled. */
+  uint64_t transform_cycles;
+  uint64_t cost_cycles;
 };
 
 } // namespace stoke
@@ -18,6 +18,8 @@
 #include <chrono>
 #include <vector>
 
+#include "src/cost/cost.h"
+#include "src/profiler/profiler.h"
 #include "src/search/statistics.h"
 #include "src/transform/transform.h"
 
@@ -34,6 +36,18 @@ struct StatisticsCallbackData {
     (This is used to figure out what kind of transform each
     member of the move_statistics corresponds to.) */
   const Transform* transform;
+  /** The costs of the current rewrite, the best rewrite and the best correct
+    rewrite. */
+  const Cost current_cost;
+  const Cost best_yet_cost;
+  const Cost best_correct_cost;
+  /** Time spent proposing and undoing moves, and in the cost function.  Only
+    measured while a metrics callback is set. */
+  const std::chrono::duration<double> transform_time;
+  const std::chrono::duration<double> cost_time;
+  /** Cycles and calls of each Profiler::Phase in the search loop; empty unless
+    profiling is enabled. */
+  const std::vector<PhaseProfile>& phases;
 };
 
 /** Callback signature */
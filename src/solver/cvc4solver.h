@@ -40,6 +40,13 @@ public:
     delete smt_;
   }
 
+  /** Make a new solver with its own engine and the same timeout. */
+  SMTSolver* clone() const {
+    auto s = new Cvc4Solver();
+    s->set_timeout(timeout_);
+    return s;
+  }
+
   SMTSolver& set_timeout(uint64_t ms) {
     timeout_ = ms;
     smt_->setTimeLimit(timeout_, true);
@@ -0,0 +1,133 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+#include "src/solver/query_trace.h"
+
+using namespace std;
+using namespace stoke;
+
+atomic<bool> QueryTrace::enabled_(false);
+atomic<uint64_t> QueryTrace::count_(0);
+mutex QueryTrace::mutex_;
+string QueryTrace::dir_;
+uint64_t QueryTrace::sample_ = 1;
+uint64_t QueryTrace::max_bytes_ = 0;
+uint64_t QueryTrace::max_files_ = 0;
+ofstream QueryTrace::index_;
+deque<string> QueryTrace::files_;
+string QueryTrace::error_;
+string QueryTrace::env_error_;
+
+// Defined after the members above so that they are constructed first.
+bool QueryTrace::from_env_ = QueryTrace::open_from_env();
+
+namespace {
+
+uint64_t env_value(const char* name, uint64_t def) {
+  auto value = getenv(name);
+  return value ? strtoull(value, NULL, 10) : def;
+}
+
+} // namespace
+
+bool QueryTrace::open_from_env() {
+  auto dir = getenv("STOKE_SMT_TRACE");
+  if (!dir || !*dir)
+    return false;
+
+  if (!open(dir, env_value("STOKE_SMT_TRACE_SAMPLE", 1),
+            env_value("STOKE_SMT_TRACE_MAX_BYTES", 0),
+            env_value("STOKE_SMT_TRACE_MAX_FILES", 0))) {
+    env_error_ = error_;
+    return false;
+  }
+  return true;
+}
+
+bool QueryTrace::open(const string& dir, uint64_t sample, uint64_t max_bytes, uint64_t max_files) {
+  close();
+
+  lock_guard<mutex> lock(mutex_);
+  error_ = "";
+
+  index_.open(dir + "/queries.tsv");
+  if (!index_.is_open()) {
+    error_ = "Unable to write to " + dir + "/queries.tsv";
+    return false;
+  }
+  index_ << "id\tnodes\tbytes\ttypecheck_us\tconvert_us\tsolve_us\tresult\tfile" << endl;
+
+  dir_ = dir;
+  sample_ = sample == 0 ? 1 : sample;
+  max_bytes_ = max_bytes;
+  max_files_ = max_files;
+  files_.clear();
+  count_ = 0;
+
+  enabled_.store(true, memory_order_release);
+  return true;
+}
+
+void QueryTrace::close() {
+  enabled_.store(false, memory_order_release);
+
+  lock_guard<mutex> lock(mutex_);
+  if (index_.is_open())
+    index_.close();
+}
+
+bool QueryTrace::sample(uint64_t& id) {
+  if (!enabled_.load(memory_order_acquire))
+    return false;
+
+  auto n = count_.fetch_add(1, memory_order_relaxed);
+  if (n % sample_ != 0)
+    return false;
+
+  id = n;
+  return true;
+}
+
+void QueryTrace::record(uint64_t id, const Record& r, const string& smt2) {
+  lock_guard<mutex> lock(mutex_);
+  if (!index_.is_open())
+    return;
+
+  string file = "-";
+  if (max_bytes_ == 0 || smt2.size() <= max_bytes_) {
+    stringstream name;
+    name << dir_ << "/query-" << id << ".smt2";
+    ofstream ofs(name.str());
+    if (ofs.is_open()) {
+      ofs << smt2;
+      file = name.str();
+
+      if (max_files_ > 0) {
+        files_.push_back(file);
+        if (files_.size() > max_files_) {
+          remove(files_.front().c_str());
+          files_.pop_front();
+        }
+      }
+    }
+  }
+
+  index_ << id << "\t" << r.nodes << "\t" << smt2.size() << "\t"
+         << r.typecheck_us << "\t" << r.convert_us << "\t" << r.solve_us << "\t"
+         << r.result << "\t" << file << endl;
+}
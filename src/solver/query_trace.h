@@ -0,0 +1,110 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _STOKE_SRC_SOLVER_QUERY_TRACE_H
+#define _STOKE_SRC_SOLVER_QUERY_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+namespace stoke {
+
+/** Records SMT queries for offline inspection.  Off by default; turned on by
+  open(), or at startup by setting STOKE_SMT_TRACE to a directory (and
+  optionally STOKE_SMT_TRACE_SAMPLE, STOKE_SMT_TRACE_MAX_BYTES and
+  STOKE_SMT_TRACE_MAX_FILES).  Every sampled query gets a line in
+  <dir>/queries.tsv with its size, timings and result, and its SMT-LIB2 script
+  is written to <dir>/query-<id>.smt2 unless that would exceed the limits.
+  When tracing is off, a solver only pays for one relaxed atomic load. */
+class QueryTrace {
+
+public:
+
+  /** What is known about a query once it has been answered. */
+  struct Record {
+    /** Number of distinct nodes in the constraints. */
+    uint64_t nodes = 0;
+    /** Time spent typechecking, converting and solving, in microseconds. */
+    uint64_t typecheck_us = 0;
+    uint64_t convert_us = 0;
+    uint64_t solve_us = 0;
+    /** One of "sat", "unsat", "unknown" or "error". */
+    std::string result;
+  };
+
+  /** Start tracing into a directory, which must exist.  Records every
+    sample-th query; skips scripts larger than max_bytes and keeps only the
+    newest max_files scripts (0 means no limit).  False on error. */
+  static bool open(const std::string& dir, uint64_t sample = 1,
+                   uint64_t max_bytes = 0, uint64_t max_files = 0);
+  /** Stop tracing. */
+  static void close();
+
+  /** Is tracing on? */
+  static bool enabled() {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+  /** Should the next query be recorded?  Sets its id if so. */
+  static bool sample(uint64_t& id);
+  /** Log a sampled query, along with its script. */
+  static void record(uint64_t id, const Record& r, const std::string& smt2);
+
+  /** Microseconds on a monotonic clock. */
+  static uint64_t now_us() {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+  }
+
+  /** Why did the last open() fail? */
+  static const std::string& get_error() {
+    return error_;
+  }
+  /** Why couldn't STOKE_SMT_TRACE be used at startup?  Empty if it was
+    unset or tracing started; tools should report anything else. */
+  static const std::string& get_env_error() {
+    return env_error_;
+  }
+
+private:
+
+  /** Turn tracing on if STOKE_SMT_TRACE is set; runs at startup. */
+  static bool open_from_env();
+
+  static std::atomic<bool> enabled_;
+  /** Number of queries seen since tracing started. */
+  static std::atomic<uint64_t> count_;
+
+  /** Guards everything below. */
+  static std::mutex mutex_;
+  static std::string dir_;
+  static uint64_t sample_;
+  static uint64_t max_bytes_;
+  static uint64_t max_files_;
+  static std::ofstream index_;
+  /** Scripts written so far, oldest first; only kept when max_files_ is set. */
+  static std::deque<std::string> files_;
+  static std::string error_;
+  static std::string env_error_;
+
+  static bool from_env_;
+};
+
+} // namespace stoke
+
+#endif
@@ -37,6 +37,12 @@ public:
 
   virtual ~SMTSolver() {}
 
+  /** Make a new solver of the same kind, with the same timeout, that can be
+    used on another thread.  Returns NULL if the solver doesn't support this. */
+  virtual SMTSolver* clone() const {
+    return NULL;
+  }
+
   /** Set the maximum time to spend solving */
   virtual SMTSolver& set_timeout(uint64_t ms) {
     timeout_ = ms;
@@ -14,13 +14,14 @@
 
 
 #include <iostream>
-#include <fstream> //thuanpv
 #include <chrono>
 
+#include "src/solver/query_trace.h"
 #include "src/solver/z3solver.h"
 #include "src/symstate/bitvector.h"
 #include "src/symstate/typecheck_visitor.h"
 #include "src/symstate/memo_visitor.h"
+#include "src/symstate/size_visitor.h"
 #include "src/symstate/visitor.h"
 
 using namespace stoke;
@@ -29,22 +30,13 @@ using namespace std;
 using namespace std::chrono;
 
 #ifdef DEBUG_Z3_INTERFACE_PERFORMANCE
-uint64_t Z3Solver::number_queries_ = 0;
-uint64_t Z3Solver::typecheck_time_ = 0;
-uint64_t Z3Solver::convert_time_ = 0;
-uint64_t Z3Solver::solver_time_ = 0;
+atomic<uint64_t> Z3Solver::number_queries_{0};
+atomic<uint64_t> Z3Solver::typecheck_time_{0};
+atomic<uint64_t> Z3Solver::convert_time_{0};
+atomic<uint64_t> Z3Solver::solver_time_{0};
 #endif
 
-bool Z3Solver::is_sat(const vector<SymBool>& constraints) {
-
-#ifdef DEBUG_Z3_INTERFACE_PERFORMANCE
-  number_queries_++;
-#endif
-
-  /* Reset state. */
-  error_ = "";
-  model_ = 0;
-  solver_.reset();
+bool Z3Solver::add_constraints(const vector<SymBool>& constraints) {
 
   /* Convert constraints and query to z3 object */
   SymTypecheckVisitor tc;
@@ -60,10 +52,7 @@ bool Z3Solver::is_sat(const vector<SymBool>& constraints) {
     ExprConverter ec(context_, *new_constraints);
 
     for (auto it : *current) {
-#ifdef DEBUG_Z3_INTERFACE_PERFORMANCE
-      number_queries_++;
-      microseconds typecheck_start = duration_cast<microseconds>(system_clock::now().time_since_epoch());
-#endif
+      auto typecheck_start = timed_ ? QueryTrace::now_us() : 0;
       if (tc(it) != 1) {
         stringstream ss;
         ss << "Typechecking failed for constraint: " << it << endl;
@@ -74,10 +63,8 @@ bool Z3Solver::is_sat(const vector<SymBool>& constraints) {
         error_ = ss.str();
         return false;
       }
-#ifdef DEBUG_Z3_INTERFACE_PERFORMANCE
-      microseconds typecheck_end = duration_cast<microseconds>(system_clock::now().time_since_epoch());
-      typecheck_time_ += (typecheck_end - typecheck_start).count();
-#endif
+      auto typecheck_end = timed_ ? QueryTrace::now_us() : 0;
+      typecheck_us_ += typecheck_end - typecheck_start;
 
       auto constraint = ec(it);
       if (ec.has_error()) {
@@ -85,10 +72,8 @@ bool Z3Solver::is_sat(const vector<SymBool>& constraints) {
         return false;
       }
 
-#ifdef DEBUG_Z3_INTERFACE_PERFORMANCE
-      microseconds convert_end = duration_cast<microseconds>(system_clock::now().time_since_epoch());
-      convert_time_ += (convert_end - typecheck_end).count();
-#endif
+      if (timed_)
+        convert_us_ += QueryTrace::now_us() - typecheck_end;
       solver_.add(constraint);
     }
 
@@ -100,30 +85,83 @@ bool Z3Solver::is_sat(const vector<SymBool>& constraints) {
   }
   delete current;
 
-  /* Run the solver and see */
-  try {
+  return true;
+}
+
+string Z3Solver::to_smt2(const vector<SymBool>& constraints) {
+  error_ = "";
+  solver_.reset();
+  timed_ = false;
+
+  if (!add_constraints(constraints))
+    return "";
+  return solver_.to_smt2();
+}
+
+bool Z3Solver::is_sat(const vector<SymBool>& constraints) {
+
+  uint64_t trace_id = 0;
+  bool traced = QueryTrace::enabled() && QueryTrace::sample(trace_id);
+
 #ifdef DEBUG_Z3_INTERFACE_PERFORMANCE
-    microseconds solver_start = duration_cast<microseconds>(system_clock::now().time_since_epoch());
+  number_queries_++;
+  timed_ = true;
+#else
+  timed_ = traced;
 #endif
-    //-->thuanpv
-    cout << "[DEBUG]:[z3]" << solver_.to_smt2() << "\n";
-    ofstream smt2file;
-    smt2file.open("/tmp/stoke.smt2");
-    smt2file << solver_.to_smt2();
-    smt2file.close();
-    //<--thuanpv
-    auto result = solver_.check();
+  typecheck_us_ = 0;
+  convert_us_ = 0;
+  solve_us_ = 0;
+
+  auto result = check(constraints);
+
 #ifdef DEBUG_Z3_INTERFACE_PERFORMANCE
-    microseconds solver_end = duration_cast<microseconds>(system_clock::now().time_since_epoch());
-    solver_time_ += (solver_end - solver_start).count();
+  typecheck_time_ += typecheck_us_;
+  convert_time_ += convert_us_;
+  solver_time_ += solve_us_;
 #endif
 
+  if (traced) {
+    QueryTrace::Record r;
+    SymSizeVisitor size;
+    for (auto& c : constraints)
+      r.nodes = size(c);
+    r.typecheck_us = typecheck_us_;
+    r.convert_us = convert_us_;
+    r.solve_us = solve_us_;
+    r.result = outcome_;
+    QueryTrace::record(trace_id, r, solver_.to_smt2());
+  }
+
+  return result;
+}
+
+bool Z3Solver::check(const vector<SymBool>& constraints) {
+
+  /* Reset state. */
+  error_ = "";
+  model_ = 0;
+  solver_.reset();
+  outcome_ = "error";
+
+  if (!add_constraints(constraints))
+    return false;
+
+  /* Run the solver and see */
+  try {
+    auto solver_start = timed_ ? QueryTrace::now_us() : 0;
+    auto result = solver_.check();
+    if (timed_)
+      solve_us_ = QueryTrace::now_us() - solver_start;
+
     switch (result) {
     case unsat: {
+      outcome_ = "unsat";
       return false;
     }
 
     case sat: {
+      outcome_ = "sat";
       if (model_ != NULL)
         delete model_;
       model_ = new z3::model(solver_.get_model());
@@ -131,6 +169,7 @@ bool Z3Solver::is_sat(const vector<SymBool>& constraints) {
     }
 
     case unknown: {
+      outcome_ = "unknown";
       error_ = "z3 gave up.";
       return false;
     }
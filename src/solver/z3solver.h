@@ -16,6 +16,7 @@
 #ifndef _STOKE_SRC_SOLVER_Z3SOLVER_H
 #define _STOKE_SRC_SOLVER_Z3SOLVER_H
 
+#include <atomic>
 #include <map>
 
 #include "src/ext/z3/src/api/c++/z3++.h"
@@ -32,7 +33,8 @@ class Z3Solver : public SMTSolver {
 
 public:
   /** Instantiate a new Z3 solver */
-  Z3Solver() : SMTSolver(), solver_(context_) {
+  Z3Solver() : SMTSolver(), solver_(context_), timed_(false),
+    typecheck_us_(0), convert_us_(0), solve_us_(0), outcome_("") {
     model_ = NULL;
 
     context_.set("timeout", (int)timeout_);
@@ -50,8 +52,17 @@ public:
       delete model_;
   }
 
+  /** Make a new solver with its own context and the same timeout. */
+  SMTSolver* clone() const {
+    auto s = new Z3Solver();
+    s->set_timeout(timeout_);
+    return s;
+  }
+
   /** Check if a query is satisfiable given constraints */
   bool is_sat(const std::vector<SymBool>& constraints);
+  /** Write a query as an SMT-LIB2 script without checking it; empty on error. */
+  std::string to_smt2(const std::vector<SymBool>& constraints);
 
   /** Check if a satisfying assignment is available. */
   bool has_model() const {
@@ -84,6 +95,20 @@ private:
   /** Stores the most recent satisfying assignment */
   z3::model* model_;
 
+  /** Should the current query be timed? */
+  bool timed_;
+  /** Time spent on the current query so far, in microseconds. */
+  uint64_t typecheck_us_;
+  uint64_t convert_us_;
+  uint64_t solve_us_;
+  /** How the last check() ended, for the query trace. */
+  const char* outcome_;
+
+  /** Typecheck and convert constraints, then assert them; false on error. */
+  bool add_constraints(const std::vector<SymBool>& constraints);
+  /** Run one query; is_sat() wraps this with timing and tracing. */
+  bool check(const std::vector<SymBool>& constraints);
+
   /** Helper function to build a string symbol */
   z3::symbol get_symbol(std::string s) {
     return context_.str_symbol(s.c_str());
@@ -261,10 +286,11 @@ private:
   };
 
 #ifdef DEBUG_Z3_INTERFACE_PERFORMANCE
-  static uint64_t number_queries_;
-  static uint64_t typecheck_time_;
-  static uint64_t convert_time_;
-  static uint64_t solver_time_;
+  /** Shared by every solver, including clones on other threads. */
+  static std::atomic<uint64_t> number_queries_;
+  static std::atomic<uint64_t> typecheck_time_;
+  static std::atomic<uint64_t> convert_time_;
+  static std::atomic<uint64_t> solver_time_;
 
 #endif
 };
@@ -338,11 +338,14 @@ istream& CpuState::read_bin(istream& is) {
   data.read_bin(is);
 
   // Read other segments
-  size_t seg_count;
+  size_t seg_count = 0;
   is.read((char*)&seg_count, sizeof(size_t));
-  for (size_t i = 0; i < seg_count; ++i) {
+  for (size_t i = 0; i < seg_count && is.good(); ++i) {
     Memory seg;
     seg.read_bin(is);
+    if (is.fail()) {
+      break;
+    }
     segments.push_back(seg);
   }
 
@@ -45,9 +45,15 @@ public:
     size_t size = 0;
     is.read((char*)&size, sizeof(size_t));
 
-    this->resize(size);
-    for (size_t i = 0; i < size; ++i) {
-      (*this)[i].read_bin(is);
+    // Don't allocate for more states than the stream actually holds
+    this->clear();
+    for (size_t i = 0; i < size && is.good(); ++i) {
+      CpuState cs;
+      cs.read_bin(is);
+      if (is.fail()) {
+        break;
+      }
+      this->push_back(cs);
     }
 
     return is;
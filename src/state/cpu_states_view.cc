@@ -0,0 +1,252 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/state/cpu_states_view.h"
+
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "src/ext/cpputil/include/io/fail.h"
+
+using namespace cpputil;
+using namespace std;
+
+namespace {
+
+/** Reads a range of bytes through the istream interface without copying it. */
+class ByteRangeBuf : public streambuf {
+public:
+  ByteRangeBuf(const char* begin, const char* end) {
+    setg((char*)begin, (char*)begin, (char*)end);
+  }
+};
+
+/** Size of the magic string, version and count. */
+constexpr size_t header_size = 3 * sizeof(uint64_t);
+
+uint64_t load_quad(const char* p) {
+  uint64_t q;
+  memcpy(&q, p, sizeof(q));
+  return q;
+}
+
+} // namespace
+
+namespace stoke {
+
+const char CpuStatesView::magic_[8] = {'\x89', 's', 't', 'o', 'k', 'e', 't', 'c'};
+
+CpuStatesView& CpuStatesView::open(const string& path) {
+  close();
+
+  const auto fd = ::open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    error_ = "Unable to open " + path;
+    return *this;
+  }
+  struct stat st;
+  if (fstat(fd, &st) == -1 || st.st_size == 0) {
+    ::close(fd);
+    error_ = "Unable to read " + path;
+    return *this;
+  }
+
+  auto p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED) {
+    error_ = "Unable to map " + path;
+    return *this;
+  }
+
+  data_ = (const char*)p;
+  size_ = st.st_size;
+  mapped_ = true;
+  check_index();
+  return *this;
+}
+
+CpuStatesView& CpuStatesView::open(const char* data, size_t size) {
+  close();
+
+  data_ = data;
+  size_ = size;
+  check_index();
+  return *this;
+}
+
+void CpuStatesView::close() {
+  if (mapped_) {
+    munmap((void*)data_, size_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+  count_ = 0;
+  mapped_ = false;
+  cache_.clear();
+  error_ = "";
+}
+
+void CpuStatesView::check_index() {
+  if (size_ < header_size || memcmp(data_, magic_, sizeof(magic_))) {
+    error_ = "Not an indexed testcase file";
+  } else if (load_quad(data_ + 8) != version) {
+    error_ = "Unsupported testcase file version " + to_string(load_quad(data_ + 8));
+  } else {
+    const auto count = load_quad(data_ + 16);
+    const auto index_end = header_size + (count + 1) * sizeof(uint64_t);
+    if (count > size_ / sizeof(uint64_t) || index_end > size_) {
+      error_ = "Truncated testcase index";
+    } else {
+      uint64_t last = index_end;
+      for (size_t i = 0; i <= count && error_ == ""; ++i) {
+        const auto offset = load_quad(data_ + header_size + i * sizeof(uint64_t));
+        if (offset < last || offset > size_) {
+          error_ = "Corrupt testcase index";
+        }
+        last = offset;
+      }
+      count_ = count;
+    }
+  }
+
+  if (has_error()) {
+    const auto error = error_;
+    close();
+    error_ = error;
+  } else {
+    cache_.resize(count_);
+  }
+}
+
+bool CpuStatesView::get(size_t i, CpuState& cs) {
+  assert(i < count_);
+
+  const auto offsets = data_ + header_size;
+  const auto begin = load_quad(offsets + i * sizeof(uint64_t));
+  const auto end = load_quad(offsets + (i + 1) * sizeof(uint64_t));
+
+  ByteRangeBuf buf(data_ + begin, data_ + end);
+  istream is(&buf);
+
+  cs = CpuState();
+  cs.read_bin(is);
+  if (is.fail()) {
+    error_ = "Truncated testcase " + to_string(i);
+    return false;
+  }
+  return true;
+}
+
+const CpuState& CpuStatesView::operator[](size_t i) {
+  assert(i < count_);
+  if (!cache_[i]) {
+    cache_[i].reset(new CpuState());
+    get(i, *cache_[i]);
+  }
+  return *cache_[i];
+}
+
+bool CpuStatesView::get_all(CpuStates& cs) {
+  cs.clear();
+  cs.reserve(count_);
+  for (size_t i = 0; i < count_; ++i) {
+    cs.push_back(CpuState());
+    if (!get(i, cs.back())) {
+      cs.pop_back();
+      return false;
+    }
+  }
+  return true;
+}
+
+bool CpuStatesView::is_indexed(istream& is) {
+  return is.peek() == (unsigned char)magic_[0];
+}
+
+ostream& CpuStatesView::write(ostream& os, const CpuStates& cs) {
+  vector<string> blobs;
+  blobs.reserve(cs.size());
+  for (const auto& c : cs) {
+    ostringstream oss;
+    c.write_bin(oss);
+    blobs.push_back(oss.str());
+  }
+
+  const uint64_t v = version;
+  const uint64_t count = cs.size();
+  os.write(magic_, sizeof(magic_));
+  os.write((const char*)&v, sizeof(v));
+  os.write((const char*)&count, sizeof(count));
+
+  uint64_t offset = header_size + (count + 1) * sizeof(uint64_t);
+  os.write((const char*)&offset, sizeof(offset));
+  for (const auto& b : blobs) {
+    offset += b.size();
+    os.write((const char*)&offset, sizeof(offset));
+  }
+  for (const auto& b : blobs) {
+    os.write(b.data(), b.size());
+  }
+
+  return os;
+}
+
+istream& CpuStatesView::read(istream& is, CpuStates& cs) {
+  cs.clear();
+
+  char magic[sizeof(magic_)];
+  uint64_t v = 0;
+  uint64_t count = 0;
+  is.read(magic, sizeof(magic));
+  is.read((char*)&v, sizeof(v));
+  is.read((char*)&count, sizeof(count));
+  if (!is.good() || memcmp(magic, magic_, sizeof(magic_))) {
+    fail(is) << "Not an indexed testcase file" << endl;
+    return is;
+  }
+  if (v != version) {
+    fail(is) << "Unsupported testcase file version " << v << endl;
+    return is;
+  }
+
+  if (count >= (uint64_t)numeric_limits<streamsize>::max() / sizeof(uint64_t)) {
+    fail(is) << "Corrupt testcase index" << endl;
+    return is;
+  }
+
+  // Testcases are stored back to back, so a stream can skip the index
+  is.ignore((count + 1) * sizeof(uint64_t));
+
+  // The count is only trusted as far as there are bytes to back it up
+  for (size_t i = 0; i < count && is.good(); ++i) {
+    CpuState c;
+    c.read_bin(is);
+    if (is.fail()) {
+      fail(is) << "Truncated testcase " << i << endl;
+      break;
+    }
+    cs.push_back(c);
+  }
+
+  return is;
+}
+
+} // namespace stoke
@@ -0,0 +1,110 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STOKE_STATE_CPU_STATES_VIEW_H
+#define STOKE_STATE_CPU_STATES_VIEW_H
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "src/state/cpu_state.h"
+#include "src/state/cpu_states.h"
+
+namespace stoke {
+
+/** A read-only view of a testcase file in the indexed binary format.  The file
+  is memory mapped and each testcase is only decoded when it is first asked
+  for, so opening a large file costs next to nothing.
+
+  The format is an 8 byte magic string, a 64-bit version and testcase count,
+  and count+1 64-bit offsets into the file; testcase i is the CpuState::write_bin
+  encoding between offsets i and i+1.  All integers are little endian. */
+class CpuStatesView {
+
+public:
+
+  /** The format version written by write(). */
+  static constexpr uint64_t version = 1;
+
+  CpuStatesView() : data_(nullptr), size_(0), count_(0), mapped_(false) {}
+  CpuStatesView(const CpuStatesView&) = delete;
+  CpuStatesView& operator=(const CpuStatesView&) = delete;
+  ~CpuStatesView() {
+    close();
+  }
+
+  /** Map a file; on failure the view is empty and has_error() is set. */
+  CpuStatesView& open(const std::string& path);
+  /** View a buffer that already holds a file; the buffer must outlive the view. */
+  CpuStatesView& open(const char* data, size_t size);
+  /** Unmap the file and drop all decoded testcases. */
+  void close();
+
+  /** Did the last open() fail, or a testcase fail to decode since? */
+  bool has_error() const {
+    return error_ != "";
+  }
+  /** Why the last open() or decoding failed. */
+  std::string get_error() const {
+    return error_;
+  }
+
+  /** Number of testcases. */
+  size_t size() const {
+    return count_;
+  }
+  /** Decode testcase i into a fresh state.  Returns false and sets the
+    error if the testcase is truncated or corrupt. */
+  bool get(size_t i, CpuState& cs);
+  /** Testcase i, decoded on first access and kept afterwards.  Check
+    has_error() before trusting it. */
+  const CpuState& operator[](size_t i);
+  /** Decode every testcase.  Returns false and sets the error at the first
+    one that doesn't decode. */
+  bool get_all(CpuStates& cs);
+
+  /** Does a stream start with the indexed format?  Doesn't consume anything. */
+  static bool is_indexed(std::istream& is);
+  /** Write testcases in the indexed format. */
+  static std::ostream& write(std::ostream& os, const CpuStates& cs);
+  /** Read a whole file in the indexed format from a stream. */
+  static std::istream& read(std::istream& is, CpuStates& cs);
+
+private:
+
+  /** The first bytes of every file; the leading byte can't start a text file. */
+  static const char magic_[8];
+
+  /** Check the header and index of the viewed bytes. */
+  void check_index();
+
+  /** The viewed bytes. */
+  const char* data_;
+  size_t size_;
+  /** Number of testcases. */
+  size_t count_;
+  /** Did open() map the bytes, so that close() has to unmap them? */
+  bool mapped_;
+  /** Testcases decoded so far. */
+  std::vector<std::unique_ptr<CpuState>> cache_;
+  /** Error from the last open() or decoding. */
+  std::string error_;
+
+};
+
+} // namespace stoke
+
+#endif
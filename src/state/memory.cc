@@ -75,6 +75,13 @@ istream& Memory::read_bin(istream& is) {
 
   size_t mask_size = 0;
   is.read((char*)&mask_size, sizeof(size_t));
+
+  // The mask has a bit per byte, rounded up to a whole quad
+  if (mask_size > content_size / 8 + sizeof(uint64_t)) {
+    fail(is) << "Memory mask of " << mask_size << " bytes is too large for " << content_size << " bytes of contents";
+    return is;
+  }
+
   valid_.resize_for_fixed_bytes(mask_size);
   is.read((char*)valid_.data(), mask_size);
 
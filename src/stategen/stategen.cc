@@ -14,8 +14,11 @@
 
 #include "src/stategen/stategen.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <string>
+#include <thread>
 
 #include "src/sandbox/sandbox.h"
 #include "src/sandbox/state_callback.h"
@@ -126,6 +129,54 @@ bool StateGen::get(CpuState& cs, const Cfg& cfg) {
   return false;
 }
 
+size_t StateGen::get(CpuStates& css, const Cfg& cfg, size_t count, size_t threads) {
+  threads = max<size_t>(1, min(threads, count));
+  const auto batch = batches_++;
+
+  vector<CpuState> states(count);
+  vector<char> ok(count, false);
+  vector<string> errors(count);
+  atomic<size_t> next(0);
+
+  // Each worker gets a copy of this generator's settings
+  auto work = [&](Sandbox* sb) {
+    StateGen sg(*this);
+    sg.sb_ = sb;
+    for (size_t i = next++; i < count; i = next++) {
+      seed_seq seq {(uint64_t)seed_, (uint64_t)batch, (uint64_t)i};
+      sg.gen_.seed(seq);
+      ok[i] = sg.get(states[i], cfg);
+      errors[i] = sg.error_message_;
+    }
+  };
+
+  vector<Sandbox*> sandboxes;
+  vector<std::thread> pool;
+  for (size_t i = 1; i < threads; ++i) {
+    sandboxes.push_back(new Sandbox(*sb_));
+    pool.push_back(std::thread(work, sandboxes.back()));
+  }
+  work(sb_);
+  for (auto& it : pool) {
+    it.join();
+  }
+  for (auto it : sandboxes) {
+    delete it;
+  }
+
+  // Report the error of the last failure, as a serial loop would
+  size_t added = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (ok[i]) {
+      css.push_back(states[i]);
+      added++;
+    } else {
+      error_message_ = errors[i];
+    }
+  }
+  return added;
+}
+
 bool StateGen::is_ok(const Instruction& line) {
   if (sb_->get_result(0)->code == ErrorCode::NORMAL) {
     return true;
@@ -25,13 +25,14 @@
 #include "src/cfg/cfg.h"
 #include "src/sandbox/sandbox.h"
 #include "src/state/cpu_state.h"
+#include "src/state/cpu_states.h"
 
 namespace stoke {
 
 class StateGen {
 public:
   /** Creates a new state generator. */
-  StateGen(Sandbox* sb, size_t stack_size = 16) : sb_{sb}, stack_size_(stack_size) {
+  StateGen(Sandbox* sb, size_t stack_size = 16) : sb_{sb}, stack_size_(stack_size), batches_(0) {
     set_max_attempts(16);
     set_max_memory(1024);
     set_allow_unaligned(false);
@@ -68,7 +69,9 @@ public:
   }
   /** Set seed */
   StateGen& set_seed(std::default_random_engine::result_type seed) {
+    seed_ = seed;
     gen_.seed(seed);
+    batches_ = 0;
     return *this;
   }
 
@@ -76,6 +79,13 @@ public:
   bool get(CpuState& cs);
   /** Tries to generate a state in which cfg can execute without signaling. */
   bool get(CpuState& cs, const Cfg& cfg);
+  /** Tries to generate 'count' states in which cfg can execute without
+    signaling and appends those that worked to css.  The work is split over
+    up to 'threads' threads, each with its own copy of the sandbox.  Every
+    state comes from its own random stream, derived from the seed, the index
+    of the state and the number of earlier calls, so the output doesn't
+    depend on the number of threads.  Returns the number of states added. */
+  size_t get(CpuStates& css, const Cfg& cfg, size_t count, size_t threads = 1);
 
   /** Returns the reason the last attempt to fix a dereference failed. */
   std::string get_error() const {
@@ -154,6 +164,9 @@ private:
 
   /** Random number generator */
   std::default_random_engine gen_;
+  /** The last seed set, and the number of batches generated since. */
+  std::default_random_engine::result_type seed_;
+  size_t batches_;
 
   /** The maximum allowed value for a given register. */
   std::map<size_t, uint64_t> max_register_values_;
@@ -22,8 +22,8 @@
 using namespace std;
 using namespace stoke;
 
-SymMemoryManager* SymArray::memory_manager_ = NULL;
-uint64_t SymArray::tmp_counter_ = 0;
+thread_local SymMemoryManager* SymArray::memory_manager_ = NULL;
+thread_local uint64_t SymArray::tmp_counter_ = 0;
 
 /* Various constructors */
 SymArray SymArray::var(uint16_t key_size, uint16_t val_size, string name) {
@@ -87,10 +87,10 @@ public:
 
 private:
 
-  /** Memory Manager */
-  static SymMemoryManager* memory_manager_;
+  /** Memory Manager (per thread, see SymBitVector) */
+  static thread_local SymMemoryManager* memory_manager_;
   /** Counter for temporaries. */
-  static uint64_t tmp_counter_;
+  static thread_local uint64_t tmp_counter_;
 
 };
 
@@ -21,8 +21,8 @@
 using namespace std;
 using namespace stoke;
 
-SymMemoryManager* SymBitVector::memory_manager_ = NULL;
-uint64_t SymBitVector::tmp_counter_ = 0;
+thread_local SymMemoryManager* SymBitVector::memory_manager_ = NULL;
+thread_local uint64_t SymBitVector::tmp_counter_ = 0;
 
 /* Various constructors */
 SymBitVector SymBitVector::constant(uint16_t size, uint64_t value) {
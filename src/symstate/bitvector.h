@@ -246,10 +246,11 @@ public:
 
 private:
 
-  /** Memory Manager */
-  static SymMemoryManager* memory_manager_;
+  /** Memory Manager.  Thread-local: every thread builds its own formulas,
+    e.g. when DDEC checks obligations in parallel. */
+  static thread_local SymMemoryManager* memory_manager_;
   /** Counter for temporaries. */
-  static uint64_t tmp_counter_;
+  static thread_local uint64_t tmp_counter_;
 
 };
 
@@ -21,8 +21,8 @@
 using namespace std;
 using namespace stoke;
 
-SymMemoryManager* SymBool::memory_manager_ = NULL;
-uint64_t SymBool::tmp_counter_ = 0;
+thread_local SymMemoryManager* SymBool::memory_manager_ = NULL;
+thread_local uint64_t SymBool::tmp_counter_ = 0;
 
 /* Bool constructors */
 SymBool SymBool::_false() {
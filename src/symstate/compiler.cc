@@ -0,0 +1,826 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+
+#include "src/symstate/compiler.h"
+#include "src/symstate/memo_visitor.h"
+
+using namespace std;
+using namespace x64asm;
+
+namespace stoke {
+
+/** Walks a circuit bottom-up, assigning a scratch slot to every node and
+ * recording the nodes that need code in evaluation order.  Constants are
+ * written into scratch directly and need no code at all. */
+class SymCompilerVisitor : public SymMemoVisitor<size_t, size_t, size_t> {
+
+public:
+
+  SymCompilerVisitor(SymCompiler& c) : c_(c) {}
+
+  size_t visit_binop(const SymBitVectorBinop * const bv) {
+    auto a = (*this)(bv->a_);
+    auto b = (*this)(bv->b_);
+
+    if (bv->width_ > 64) {
+      switch (bv->type()) {
+      case SymBitVector::MULT:
+      case SymBitVector::DIV:
+      case SymBitVector::MOD:
+      case SymBitVector::SIGN_DIV:
+      case SymBitVector::SIGN_MOD:
+      case SymBitVector::SIGN_SHIFT_RIGHT:
+        return unsupported(bv);
+      case SymBitVector::SHIFT_LEFT:
+      case SymBitVector::SHIFT_RIGHT:
+      case SymBitVector::ROTATE_LEFT:
+      case SymBitVector::ROTATE_RIGHT:
+        if (bv->b_->type() != SymBitVector::CONSTANT) {
+          return unsupported(bv);
+        }
+        break;
+      default:
+        break;
+      }
+    }
+
+    return step(bv, false, bv->width_, {a, b}, {bv->a_->width_, bv->b_->width_});
+  }
+
+  size_t visit_binop(const SymBoolBinop * const b) {
+    auto x = (*this)(b->a_);
+    auto y = (*this)(b->b_);
+    return step(b, true, 1, {x, y}, {1, 1});
+  }
+
+  size_t visit_unop(const SymBitVectorUnop * const bv) {
+    auto a = (*this)(bv->bv_);
+    return step(bv, false, bv->width_, {a}, {bv->bv_->width_});
+  }
+
+  size_t visit_compare(const SymBoolCompare * const b) {
+    auto x = (*this)(b->a_);
+    auto y = (*this)(b->b_);
+    return step(b, true, 1, {x, y}, {b->a_->width_, b->b_->width_});
+  }
+
+  size_t visit(const SymBitVectorConstant * const bv) {
+    auto slot = alloc(bv->width_);
+    c_.scratch_[slot] = bv->constant_;
+    if (bv->width_ < 64) {
+      c_.scratch_[slot] &= (1ull << bv->width_) - 1;
+    }
+    return slot;
+  }
+
+  size_t visit(const SymBitVectorExtract * const bv) {
+    auto a = (*this)(bv->bv_);
+    return step(bv, false, bv->width_, {a}, {bv->bv_->width_});
+  }
+
+  size_t visit(const SymBitVectorFunction * const bv) {
+    return unsupported(bv);
+  }
+
+  size_t visit(const SymBitVectorIte * const bv) {
+    auto c = (*this)(bv->cond_);
+    auto a = (*this)(bv->a_);
+    auto b = (*this)(bv->b_);
+    return step(bv, false, bv->width_, {c, a, b}, {1, bv->a_->width_, bv->b_->width_});
+  }
+
+  size_t visit(const SymBitVectorSignExtend * const bv) {
+    auto a = (*this)(bv->bv_);
+    return step(bv, false, bv->width_, {a}, {bv->bv_->width_});
+  }
+
+  size_t visit(const SymBitVectorVar * const bv) {
+    return input(bv->name_, false, bv->width_);
+  }
+
+  size_t visit(const SymBitVectorArrayLookup * const bv) {
+    return unsupported(bv);
+  }
+
+  size_t visit(const SymBoolArrayEq * const b) {
+    c_.error_ = "Arrays are not supported by the circuit compiler";
+    return 0;
+  }
+
+  size_t visit(const SymBoolFalse * const b) {
+    auto slot = alloc(1);
+    c_.scratch_[slot] = 0;
+    return slot;
+  }
+
+  size_t visit(const SymBoolNot * const b) {
+    auto x = (*this)(b->b_);
+    return step(b, true, 1, {x}, {1});
+  }
+
+  size_t visit(const SymBoolTrue * const b) {
+    auto slot = alloc(1);
+    c_.scratch_[slot] = 1;
+    return slot;
+  }
+
+  size_t visit(const SymBoolVar * const b) {
+    return input(b->name_, true, 1);
+  }
+
+  size_t visit(const SymArrayStore * const a) {
+    c_.error_ = "Arrays are not supported by the circuit compiler";
+    return 0;
+  }
+
+  size_t visit(const SymArrayVar * const a) {
+    c_.error_ = "Arrays are not supported by the circuit compiler";
+    return 0;
+  }
+
+private:
+
+  SymCompiler& c_;
+
+  /** Reserve scratch space for a value of this width. */
+  size_t alloc(uint16_t width) {
+    auto slot = c_.scratch_.size();
+    c_.scratch_.resize(slot + SymCompiler::words(width), 0);
+    return slot;
+  }
+
+  /** Record a node that needs code. */
+  size_t step(const SymAstAbstract* node, bool is_bool, uint16_t width,
+              const vector<size_t>& args, const vector<uint16_t>& widths) {
+    SymCompiler::Step s;
+    s.node = node;
+    s.is_bool = is_bool;
+    s.width = width;
+    s.slot = alloc(width);
+    for (size_t i = 0; i < 3; ++i) {
+      s.args[i] = i < args.size() ? args[i] : 0;
+      s.arg_widths[i] = i < widths.size() ? widths[i] : 0;
+    }
+    c_.steps_.push_back(s);
+    return s.slot;
+  }
+
+  /** Bind a variable to its input words. */
+  size_t input(const string& name, bool is_bool, uint16_t width) {
+    auto it = c_.inputs_.find({name, is_bool});
+    if (it == c_.inputs_.end()) {
+      c_.error_ = "Variable " + name + " is not bound to an input";
+      return 0;
+    }
+    if (it->second.second != width) {
+      c_.error_ = "Variable " + name + " is used at two different widths";
+      return 0;
+    }
+    auto slot = alloc(width);
+    c_.input_slots_.push_back({slot, it->second});
+    return slot;
+  }
+
+  /** Report a node that cannot be lowered. */
+  size_t unsupported(const SymBitVectorAbstract * const bv) {
+    stringstream ss;
+    ss << "Cannot compile " << SymBitVector(bv) << " (width " << bv->width_ << ")";
+    c_.error_ = ss.str();
+    return 0;
+  }
+};
+
+SymCompiler& SymCompiler::clear() {
+  inputs_.clear();
+  outputs_.clear();
+  input_words_ = 0;
+  output_words_ = 0;
+  steps_.clear();
+  input_slots_.clear();
+  output_slots_.clear();
+  scratch_.clear();
+  compiled_ = false;
+  error_ = "";
+  return *this;
+}
+
+size_t SymCompiler::add_input(const SymBitVector& var) {
+  assert(var.type() == SymBitVector::VAR);
+  auto v = static_cast<const SymBitVectorVar * const>(var.ptr);
+  auto offset = input_words_;
+  inputs_[ {v->name_, false}] = {offset, v->size_};
+  input_words_ += words(v->size_);
+  compiled_ = false;
+  return offset;
+}
+
+size_t SymCompiler::add_input(const SymBool& var) {
+  assert(var.type() == SymBool::VAR);
+  auto v = static_cast<const SymBoolVar * const>(var.ptr);
+  auto offset = input_words_;
+  inputs_[ {v->name_, true}] = {offset, 1};
+  input_words_++;
+  compiled_ = false;
+  return offset;
+}
+
+size_t SymCompiler::add_output(const SymBitVector& bv) {
+  auto offset = output_words_;
+  outputs_.push_back({bv.ptr, false});
+  output_words_ += words(bv.width());
+  compiled_ = false;
+  return offset;
+}
+
+size_t SymCompiler::add_output(const SymBool& b) {
+  auto offset = output_words_;
+  outputs_.push_back({b.ptr, true});
+  output_words_++;
+  compiled_ = false;
+  return offset;
+}
+
+bool SymCompiler::compile() {
+  compiled_ = false;
+  error_ = "";
+  steps_.clear();
+  input_slots_.clear();
+  output_slots_.clear();
+  scratch_.clear();
+
+  // Assign slots and order the nodes
+  SymCompilerVisitor visitor(*this);
+  for (auto& o : outputs_) {
+    if (o.second) {
+      auto slot = visitor(static_cast<const SymBoolAbstract*>(o.first));
+      output_slots_.push_back({slot, 1});
+    } else {
+      auto bv = static_cast<const SymBitVectorAbstract*>(o.first);
+      auto slot = visitor(bv);
+      output_slots_.push_back({slot, words(bv->width_)});
+    }
+    if (has_error()) {
+      return false;
+    }
+  }
+  if (scratch_.empty()) {
+    scratch_.push_back(0);
+  }
+
+  // Make sure the buffer is large enough; the widest lowering (concat over
+  // two misaligned operands) stays well under 64 bytes per word of the
+  // result and of each operand.
+  size_t bytes = 256 + 32*(input_words_ + output_words_);
+  for (const auto& s : steps_) {
+    bytes += 128 + 64*words(s.width);
+    for (auto w : s.arg_widths) {
+      bytes += 64*words(w);
+    }
+  }
+  fxn_.reserve(bytes);
+
+  // void f(const uint64_t* in, uint64_t* out, size_t n, uint64_t* scratch)
+  // %r10 = in, %r11 = out, %r9 = n, %r8 = scratch
+  assm_.start(fxn_);
+  assm_.mov(r10, rdi);
+  assm_.mov(r11, rsi);
+  assm_.mov(r9, rdx);
+  assm_.mov(r8, rcx);
+
+  Label loop;
+  Label done;
+  assm_.test(r9, r9);
+  assm_.je(done);
+  assm_.bind(loop);
+
+  // Copy inputs into scratch, clearing any bits beyond their widths
+  for (const auto& in : input_slots_) {
+    auto offset = in.second.first;
+    auto width = in.second.second;
+    for (size_t i = 0, ie = words(width); i < ie; ++i) {
+      assm_.mov(rax, M64(r10, Imm32(8*(offset + i))));
+      if (i + 1 == ie) {
+        emit_mask(rax, width);
+      }
+      assm_.mov(slot(in.first + i), rax);
+    }
+  }
+
+  for (const auto& s : steps_) {
+    if (s.is_bool) {
+      emit_bool(s);
+    } else {
+      emit_bitvector(s);
+    }
+  }
+
+  // Copy results out
+  size_t offset = 0;
+  for (const auto& out : output_slots_) {
+    for (size_t i = 0; i < out.second; ++i) {
+      assm_.mov(rax, slot(out.first + i));
+      assm_.mov(M64(r11, Imm32(8*(offset + i))), rax);
+    }
+    offset += out.second;
+  }
+
+  // Advance to the next input/output vector
+  assm_.add(r10, Imm32(8*input_words_));
+  assm_.add(r11, Imm32(8*output_words_));
+  assm_.dec(r9);
+  assm_.jne(loop);
+
+  assm_.bind(done);
+  assm_.ret();
+
+  compiled_ = assm_.finish();
+  if (!compiled_) {
+    error_ = "Failed to assemble compiled circuit";
+  }
+  return compiled_;
+}
+
+void SymCompiler::emit_mask(const R64& r, uint16_t width) {
+  auto bits = width % 64;
+  if (bits == 0) {
+    return;
+  }
+  assm_.shl(r, Imm8(64 - bits));
+  assm_.shr(r, Imm8(64 - bits));
+}
+
+void SymCompiler::emit_sign_extend(const R64& r, uint16_t bits) {
+  if (bits == 0 || bits >= 64) {
+    return;
+  }
+  assm_.shl(r, Imm8(64 - bits));
+  assm_.sar(r, Imm8(64 - bits));
+}
+
+void SymCompiler::emit_load_bits(const R64& dst, const R64& tmp, size_t base,
+                                 uint16_t width, int64_t offset) {
+  const int64_t n = words(width);
+  // floor(offset / 64), rounding towards negative infinity
+  const int64_t w = offset >= 0 ? offset / 64 : -((-offset + 63) / 64);
+  const uint8_t shift = offset - 64*w;
+
+  auto load = [&](const R64& r, int64_t word) {
+    if (word >= 0 && word < n) {
+      assm_.mov(r, slot(base + word));
+    } else {
+      assm_.mov(r, Imm32(0));
+    }
+  };
+
+  load(dst, w);
+  if (shift > 0) {
+    load(tmp, w + 1);
+    assm_.shrd(dst, tmp, Imm8(shift));
+  }
+}
+
+void SymCompiler::emit_load_top(const R64& dst, size_t base, uint16_t width) {
+  assm_.mov(dst, slot(base + words(width) - 1));
+  emit_sign_extend(dst, width % 64 == 0 ? 64 : width % 64);
+}
+
+void SymCompiler::emit_compare(size_t x, size_t y, uint16_t width, bool is_signed) {
+  const size_t n = words(width);
+
+  if (!is_signed) {
+    // The borrow out of x - y is the unsigned comparison
+    assm_.mov(rax, slot(x));
+    assm_.sub(rax, slot(y));
+    for (size_t i = 1; i < n; ++i) {
+      assm_.mov(rax, slot(x + i));
+      assm_.sbb(rax, slot(y + i));
+    }
+    return;
+  }
+
+  // Sign extend the top words first; shifting would clobber the borrow chain
+  emit_load_top(rsi, x, width);
+  emit_load_top(rdi, y, width);
+  if (n == 1) {
+    assm_.cmp(rsi, rdi);
+    return;
+  }
+  assm_.mov(rax, slot(x));
+  assm_.sub(rax, slot(y));
+  for (size_t i = 1; i + 1 < n; ++i) {
+    assm_.mov(rax, slot(x + i));
+    assm_.sbb(rax, slot(y + i));
+  }
+  assm_.sbb(rsi, rdi);
+}
+
+void SymCompiler::emit_bitvector(const Step& s) {
+  const auto bv = static_cast<const SymBitVectorAbstract*>(s.node);
+  const auto n = words(s.width);
+  const auto w = s.width;
+  const auto a = s.args[0];
+  const auto b = s.args[1];
+
+  switch (bv->type()) {
+  case SymBitVector::AND:
+  case SymBitVector::OR:
+  case SymBitVector::XOR:
+    for (size_t i = 0; i < n; ++i) {
+      assm_.mov(rax, slot(a + i));
+      if (bv->type() == SymBitVector::AND) {
+        assm_.and_(rax, slot(b + i));
+      } else if (bv->type() == SymBitVector::OR) {
+        assm_.or_(rax, slot(b + i));
+      } else {
+        assm_.xor_(rax, slot(b + i));
+      }
+      assm_.mov(slot(s.slot + i), rax);
+    }
+    break;
+
+  case SymBitVector::NOT:
+    for (size_t i = 0; i < n; ++i) {
+      assm_.mov(rax, slot(a + i));
+      assm_.not_(rax);
+      if (i + 1 == n) {
+        emit_mask(rax, w);
+      }
+      assm_.mov(slot(s.slot + i), rax);
+    }
+    break;
+
+  case SymBitVector::PLUS:
+  case SymBitVector::MINUS:
+    // mov leaves the carry alone, so the chain survives the loads and stores
+    for (size_t i = 0; i < n; ++i) {
+      assm_.mov(rax, slot(a + i));
+      if (bv->type() == SymBitVector::PLUS) {
+        i == 0 ? assm_.add(rax, slot(b + i)) : assm_.adc(rax, slot(b + i));
+      } else {
+        i == 0 ? assm_.sub(rax, slot(b + i)) : assm_.sbb(rax, slot(b + i));
+      }
+      if (i + 1 == n) {
+        emit_mask(rax, w);
+      }
+      assm_.mov(slot(s.slot + i), rax);
+    }
+    break;
+
+  case SymBitVector::U_MINUS:
+    for (size_t i = 0; i < n; ++i) {
+      assm_.mov(rax, Imm32(0));
+      i == 0 ? assm_.sub(rax, slot(a + i)) : assm_.sbb(rax, slot(a + i));
+      if (i + 1 == n) {
+        emit_mask(rax, w);
+      }
+      assm_.mov(slot(s.slot + i), rax);
+    }
+    break;
+
+  case SymBitVector::MULT:
+    assm_.mov(rax, slot(a));
+    assm_.imul(rax, slot(b));
+    emit_mask(rax, w);
+    assm_.mov(slot(s.slot), rax);
+    break;
+
+  case SymBitVector::DIV:
+  case SymBitVector::MOD: {
+    // x / 0 is all ones and x % 0 is x, as in SMT-LIB
+    Label zero;
+    Label done;
+    assm_.mov(rax, slot(a));
+    assm_.mov(rcx, slot(b));
+    assm_.test(rcx, rcx);
+    assm_.je_1(zero);
+    assm_.mov(rdx, Imm32(0));
+    assm_.div(rcx);
+    if (bv->type() == SymBitVector::MOD) {
+      assm_.mov(rax, rdx);
+    }
+    assm_.jmp_1(done);
+    assm_.bind(zero);
+    if (bv->type() == SymBitVector::DIV) {
+      assm_.mov(rax, Imm32(-1));
+    }
+    assm_.bind(done);
+    emit_mask(rax, w);
+    assm_.mov(slot(s.slot), rax);
+    break;
+  }
+
+  case SymBitVector::SIGN_DIV:
+  case SymBitVector::SIGN_MOD: {
+    // Special cases: division by zero follows SMT-LIB, and division by -1
+    // is done by hand because idiv faults on INT64_MIN / -1
+    const auto is_div = bv->type() == SymBitVector::SIGN_DIV;
+    Label zero;
+    Label normal;
+    Label done;
+    assm_.mov(rax, slot(a));
+    emit_sign_extend(rax, w);
+    assm_.mov(rcx, slot(b));
+    emit_sign_extend(rcx, w);
+    assm_.test(rcx, rcx);
+    assm_.je_1(zero);
+    assm_.cmp(rcx, Imm32(-1));
+    assm_.jne_1(normal);
+    if (is_div) {
+      assm_.neg(rax);
+    } else {
+      assm_.mov(rax, Imm32(0));
+    }
+    assm_.jmp_1(done);
+    assm_.bind(normal);
+    assm_.cqo();
+    assm_.idiv(rcx);
+    if (!is_div) {
+      assm_.mov(rax, rdx);
+    }
+    assm_.jmp_1(done);
+    assm_.bind(zero);
+    if (is_div) {
+      // a < 0 ? 1 : -1
+      assm_.sar(rax, Imm8(63));
+      assm_.add(rax, rax);
+      assm_.inc(rax);
+      assm_.neg(rax);
+    }
+    assm_.bind(done);
+    emit_mask(rax, w);
+    assm_.mov(slot(s.slot), rax);
+    break;
+  }
+
+  case SymBitVector::SHIFT_LEFT:
+  case SymBitVector::SHIFT_RIGHT:
+  case SymBitVector::ROTATE_LEFT:
+  case SymBitVector::ROTATE_RIGHT:
+    if (w > 64) {
+      // Wide shifts only by constants; every output word is a funnel shift
+      auto sbv = static_cast<const SymBitVectorBinop*>(bv);
+      uint64_t k = static_cast<const SymBitVectorConstant*>(sbv->b_)->constant_;
+      auto type = bv->type();
+      if (type == SymBitVector::ROTATE_RIGHT) {
+        k = (w - k % w) % w;
+        type = SymBitVector::ROTATE_LEFT;
+      } else if (type == SymBitVector::ROTATE_LEFT) {
+        k = k % w;
+      } else if (k > w) {
+        k = w;
+      }
+      for (size_t i = 0; i < n; ++i) {
+        int64_t offset = 64*(int64_t)i;
+        if (type == SymBitVector::SHIFT_RIGHT) {
+          emit_load_bits(rax, rdx, a, w, offset + k);
+        } else {
+          emit_load_bits(rax, rdx, a, w, offset - (int64_t)k);
+        }
+        if (type == SymBitVector::ROTATE_LEFT) {
+          emit_load_bits(rcx, rdx, a, w, offset - (int64_t)k + w);
+          assm_.or_(rax, rcx);
+        }
+        if (i + 1 == n) {
+          emit_mask(rax, w);
+        }
+        assm_.mov(slot(s.slot + i), rax);
+      }
+      break;
+    }
+
+    if (bv->type() == SymBitVector::SHIFT_LEFT || bv->type() == SymBitVector::SHIFT_RIGHT) {
+      // x86 masks the count, SMT-LIB shifts everything out
+      assm_.mov(rax, slot(a));
+      assm_.mov(rcx, slot(b));
+      if (bv->type() == SymBitVector::SHIFT_LEFT) {
+        assm_.shl(rax, cl);
+      } else {
+        assm_.shr(rax, cl);
+      }
+      assm_.mov(rdx, Imm32(0));
+      assm_.cmp(rcx, Imm32(w));
+      assm_.cmovae(rax, rdx);
+      emit_mask(rax, w);
+      assm_.mov(slot(s.slot), rax);
+      break;
+    }
+
+    // Rotates: reduce the count modulo the width
+    if ((w & (w - 1)) == 0) {
+      assm_.mov(rcx, slot(b));
+      assm_.and_(rcx, Imm32(w - 1));
+    } else {
+      assm_.mov(rax, slot(b));
+      assm_.mov(rdx, Imm32(0));
+      assm_.mov(rcx, Imm32(w));
+      assm_.div(rcx);
+      assm_.mov(rcx, rdx);
+    }
+    assm_.mov(rax, slot(a));
+    if (w == 64) {
+      if (bv->type() == SymBitVector::ROTATE_LEFT) {
+        assm_.rol(rax, cl);
+      } else {
+        assm_.ror(rax, cl);
+      }
+    } else {
+      assm_.mov(rdx, rax);
+      if (bv->type() == SymBitVector::ROTATE_LEFT) {
+        assm_.shl(rax, cl);
+      } else {
+        assm_.shr(rax, cl);
+      }
+      assm_.neg(rcx);
+      assm_.add(rcx, Imm32(w));
+      if (bv->type() == SymBitVector::ROTATE_LEFT) {
+        assm_.shr(rdx, cl);
+      } else {
+        assm_.shl(rdx, cl);
+      }
+      assm_.or_(rax, rdx);
+      emit_mask(rax, w);
+    }
+    assm_.mov(slot(s.slot), rax);
+    break;
+
+  case SymBitVector::SIGN_SHIFT_RIGHT:
+    // Counts past the width fill with the sign bit
+    assm_.mov(rax, slot(a));
+    emit_sign_extend(rax, w);
+    assm_.mov(rcx, slot(b));
+    assm_.mov(rdx, Imm32(63));
+    assm_.cmp(rcx, Imm32(63));
+    assm_.cmova(rcx, rdx);
+    assm_.sar(rax, cl);
+    emit_mask(rax, w);
+    assm_.mov(slot(s.slot), rax);
+    break;
+
+  case SymBitVector::CONCAT: {
+    const auto wa = s.arg_widths[0];
+    const auto wb = s.arg_widths[1];
+    for (size_t i = 0; i < n; ++i) {
+      emit_load_bits(rax, rdx, b, wb, 64*(int64_t)i);
+      emit_load_bits(rcx, rdx, a, wa, 64*(int64_t)i - wb);
+      assm_.or_(rax, rcx);
+      assm_.mov(slot(s.slot + i), rax);
+    }
+    break;
+  }
+
+  case SymBitVector::EXTRACT: {
+    const auto e = static_cast<const SymBitVectorExtract*>(bv);
+    for (size_t i = 0; i < n; ++i) {
+      emit_load_bits(rax, rdx, a, s.arg_widths[0], e->low_bit_ + 64*(int64_t)i);
+      if (i + 1 == n) {
+        emit_mask(rax, w);
+      }
+      assm_.mov(slot(s.slot + i), rax);
+    }
+    break;
+  }
+
+  case SymBitVector::SIGN_EXTEND: {
+    // %rcx holds the sign of the operand replicated 64 times
+    const auto wa = s.arg_widths[0];
+    const size_t top = (wa - 1) / 64;
+    const size_t bit = (wa - 1) % 64;
+    assm_.mov(rcx, slot(a + top));
+    if (bit < 63) {
+      assm_.shl(rcx, Imm8(63 - bit));
+    }
+    assm_.sar(rcx, Imm8(63));
+    for (size_t i = 0; i < n; ++i) {
+      if (i < top) {
+        assm_.mov(rax, slot(a + i));
+      } else if (i == top) {
+        assm_.mov(rax, slot(a + i));
+        if (bit < 63) {
+          assm_.mov(rdx, rcx);
+          assm_.shl(rdx, Imm8(bit + 1));
+          assm_.or_(rax, rdx);
+        }
+      } else {
+        assm_.mov(rax, rcx);
+      }
+      if (i + 1 == n) {
+        emit_mask(rax, w);
+      }
+      assm_.mov(slot(s.slot + i), rax);
+    }
+    break;
+  }
+
+  case SymBitVector::ITE:
+    // cmov leaves the flags from the test alone
+    assm_.mov(rcx, slot(a));
+    assm_.test(rcx, rcx);
+    for (size_t i = 0; i < n; ++i) {
+      assm_.mov(rax, slot(s.args[1] + i));
+      assm_.mov(rdx, slot(s.args[2] + i));
+      assm_.cmove(rax, rdx);
+      assm_.mov(slot(s.slot + i), rax);
+    }
+    break;
+
+  default:
+    assert(false);
+    break;
+  }
+}
+
+void SymCompiler::emit_bool(const Step& s) {
+  const auto b = static_cast<const SymBoolAbstract*>(s.node);
+  const auto x = s.args[0];
+  const auto y = s.args[1];
+  const auto w = s.arg_widths[0];
+
+  switch (b->type()) {
+  case SymBool::AND:
+    assm_.mov(rax, slot(x));
+    assm_.and_(rax, slot(y));
+    break;
+  case SymBool::OR:
+    assm_.mov(rax, slot(x));
+    assm_.or_(rax, slot(y));
+    break;
+  case SymBool::XOR:
+    assm_.mov(rax, slot(x));
+    assm_.xor_(rax, slot(y));
+    break;
+  case SymBool::IFF:
+    assm_.mov(rax, slot(x));
+    assm_.xor_(rax, slot(y));
+    assm_.xor_(rax, Imm32(1));
+    break;
+  case SymBool::IMPLIES:
+    assm_.mov(rax, slot(x));
+    assm_.xor_(rax, Imm32(1));
+    assm_.or_(rax, slot(y));
+    break;
+  case SymBool::NOT:
+    assm_.mov(rax, slot(x));
+    assm_.xor_(rax, Imm32(1));
+    break;
+
+  case SymBool::EQ:
+    assm_.mov(rax, slot(x));
+    assm_.xor_(rax, slot(y));
+    for (size_t i = 1, ie = words(w); i < ie; ++i) {
+      assm_.mov(rdx, slot(x + i));
+      assm_.xor_(rdx, slot(y + i));
+      assm_.or_(rax, rdx);
+    }
+    assm_.mov(rcx, Imm32(0));
+    assm_.test(rax, rax);
+    assm_.sete(cl);
+    assm_.mov(rax, rcx);
+    break;
+
+  case SymBool::LT:
+  case SymBool::GE:
+    emit_compare(x, y, w, false);
+    assm_.mov(rax, Imm32(0));
+    b->type() == SymBool::LT ? assm_.setb(al) : assm_.setae(al);
+    break;
+  case SymBool::GT:
+  case SymBool::LE:
+    emit_compare(y, x, w, false);
+    assm_.mov(rax, Imm32(0));
+    b->type() == SymBool::GT ? assm_.setb(al) : assm_.setae(al);
+    break;
+  case SymBool::SIGN_LT:
+  case SymBool::SIGN_GE:
+    emit_compare(x, y, w, true);
+    assm_.mov(rax, Imm32(0));
+    b->type() == SymBool::SIGN_LT ? assm_.setl(al) : assm_.setge(al);
+    break;
+  case SymBool::SIGN_GT:
+  case SymBool::SIGN_LE:
+    emit_compare(y, x, w, true);
+    assm_.mov(rax, Imm32(0));
+    b->type() == SymBool::SIGN_GT ? assm_.setl(al) : assm_.setge(al);
+    break;
+
+  default:
+    assert(false);
+    break;
+  }
+
+  assm_.mov(slot(s.slot), rax);
+}
+
+} // namespace stoke
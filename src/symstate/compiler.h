@@ -0,0 +1,165 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STOKE_SRC_SYMSTATE_COMPILER_H
+#define STOKE_SRC_SYMSTATE_COMPILER_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "src/ext/x64asm/include/x64asm.h"
+#include "src/symstate/bitvector.h"
+#include "src/symstate/bool.h"
+
+namespace stoke {
+
+/** Lowers a DAG of SymBitVector/SymBool circuits to straight-line x86-64 so
+ * that it can be evaluated on many concrete inputs without walking the AST.
+ *
+ * Every value is stored as a little-endian sequence of 64-bit words with all
+ * bits above its width cleared; bools take one word holding 0 or 1.  Inputs
+ * and outputs are laid out contiguously in the order in which they were added.
+ * Bitwise, arithmetic (+, -), comparison, extract, concat, sign-extend and ite
+ * operators work at any width; multiplication, division and variable shifts
+ * and rotates are limited to 64 bits.  Uninterpreted functions and arrays are
+ * not supported. */
+class SymCompiler {
+
+public:
+  SymCompiler() : fxn_(4096) {
+    clear();
+  }
+
+  /** Forget all inputs, outputs and compiled code. */
+  SymCompiler& clear();
+
+  /** Binds a bitvector variable to the next input words; returns its word offset. */
+  size_t add_input(const SymBitVector& var);
+  /** Binds a bool variable to the next input word; returns its word offset. */
+  size_t add_input(const SymBool& var);
+  /** Adds a bitvector to compute into the next output words; returns its word offset. */
+  size_t add_output(const SymBitVector& bv);
+  /** Adds a bool to compute into the next output word; returns its word offset. */
+  size_t add_output(const SymBool& b);
+
+  /** Number of 64-bit words in one input vector. */
+  size_t num_input_words() const {
+    return input_words_;
+  }
+  /** Number of 64-bit words in one output vector. */
+  size_t num_output_words() const {
+    return output_words_;
+  }
+
+  /** Compile the outputs added so far.  Returns false on error. */
+  bool compile();
+
+  /** Evaluate the compiled circuit on a single input vector. */
+  void eval(const uint64_t* in, uint64_t* out) {
+    eval_batch(in, out, 1);
+  }
+  /** Evaluate the compiled circuit on n input vectors stored back to back. */
+  void eval_batch(const uint64_t* in, uint64_t* out, size_t n) {
+    assert(compiled_);
+    ((void (*)(const uint64_t*, uint64_t*, size_t, uint64_t*))fxn_.get_entrypoint())
+    (in, out, n, scratch_.data());
+  }
+
+  /** Did an error occur while compiling? */
+  bool has_error() const {
+    return error_.size() > 0;
+  }
+  /** Get the last error message */
+  std::string get_error() const {
+    return error_;
+  }
+
+private:
+  friend class SymCompilerVisitor;
+
+  /** One node of the circuit, in evaluation order. */
+  struct Step {
+    /** The node; either a SymBitVectorAbstract or a SymBoolAbstract */
+    const SymAstAbstract* node;
+    /** Is this node a bool? */
+    bool is_bool;
+    /** First scratch word holding the result */
+    size_t slot;
+    /** Width in bits of the result */
+    uint16_t width;
+    /** Scratch slots of the operands */
+    size_t args[3];
+    /** Widths of the operands */
+    uint16_t arg_widths[3];
+  };
+
+  /** Assembler used to lower circuits. */
+  x64asm::Assembler assm_;
+  /** The compiled function. */
+  x64asm::Function fxn_;
+  /** Temporaries and constants; owned here so that evaluation never allocates. */
+  std::vector<uint64_t> scratch_;
+
+  /** Input variables (name, is_bool) mapped to their input offset and width. */
+  std::map<std::pair<std::string, bool>, std::pair<size_t, uint16_t>> inputs_;
+  /** Outputs in the order they were added. */
+  std::vector<std::pair<const SymAstAbstract*, bool>> outputs_;
+  /** Number of words per input vector. */
+  size_t input_words_;
+  /** Number of words per output vector. */
+  size_t output_words_;
+
+  /** Nodes in evaluation order. */
+  std::vector<Step> steps_;
+  /** Scratch slots assigned to each input variable. */
+  std::vector<std::pair<size_t, std::pair<size_t, uint16_t>>> input_slots_;
+  /** Scratch slots assigned to each output. */
+  std::vector<std::pair<size_t, size_t>> output_slots_;
+
+  /** Has compile() succeeded? */
+  bool compiled_;
+  /** Error message. */
+  std::string error_;
+
+  /** Number of words needed to hold a value of this width. */
+  static size_t words(uint16_t width) {
+    return width == 0 ? 1 : (width + 63) / 64;
+  }
+
+  /** Emit code for a bitvector node. */
+  void emit_bitvector(const Step& s);
+  /** Emit code for a bool node. */
+  void emit_bool(const Step& s);
+
+  /** Returns the memory operand for a scratch word. */
+  x64asm::M64 slot(size_t word) const {
+    return x64asm::M64(x64asm::r8, x64asm::Imm32(8*word));
+  }
+  /** Clears the bits of a register above the width of the top word of a value. */
+  void emit_mask(const x64asm::R64& r, uint16_t width);
+  /** Sign-extends the low bits of a register to the full 64 bits. */
+  void emit_sign_extend(const x64asm::R64& r, uint16_t bits);
+  /** Loads 64 bits of a value starting at a (possibly negative) bit offset. */
+  void emit_load_bits(const x64asm::R64& dst, const x64asm::R64& tmp,
+                      size_t slot, uint16_t width, int64_t offset);
+  /** Loads the sign-extended top word of a value into a register. */
+  void emit_load_top(const x64asm::R64& dst, size_t slot, uint16_t width);
+  /** Emits an unsigned or signed comparison chain; flags are left for setcc. */
+  void emit_compare(size_t x, size_t y, uint16_t width, bool is_signed);
+};
+
+} // namespace stoke
+
+#endif
@@ -18,7 +18,11 @@
 using namespace std;
 using namespace stoke;
 
+atomic<size_t> SymMemoryManager::next_generation_{0};
+thread_local size_t SymMemoryManager::generation_ = SymMemoryManager::next_generation_++;
+
 void SymMemoryManager::collect() {
+  generation_ = next_generation_++;
   for (const SymBitVectorAbstract* bv : bitvectors_) {
     delete bv;
   }
@@ -16,8 +16,10 @@
 #ifndef _STOKE_SRC_SYMSTATE_SYM_MEMORY_MANAGER_H
 #define _STOKE_SRC_SYMSTATE_SYM_MEMORY_MANAGER_H
 
-#include <set>
+#include <atomic>
 #include <cassert>
+#include <cstddef>
+#include <set>
 
 namespace stoke {
 
@@ -52,8 +54,20 @@ public:
   /** Free all the junk */
   void collect();
 
+  /** Changes whenever a memory manager of this thread frees its nodes.
+    Caches keyed by node pointers (see SymSimplify) use this to detect stale
+    entries.  Values are never reused, not even by other threads, so a cache
+    that moves to another thread is never taken for current. */
+  static size_t generation() {
+    return generation_;
+  }
+
 private:
 
+  /** Source of fresh generations, shared by all threads. */
+  static std::atomic<size_t> next_generation_;
+  static thread_local size_t generation_;
+
   std::set<const SymBitVectorAbstract*> bitvectors_;
   std::set<const SymBoolAbstract*> bools_;
   std::set<const SymArrayAbstract*> arrays_;
@@ -0,0 +1,117 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef _STOKE_SRC_SYMSTATE_POINTER_MAP
+#define _STOKE_SRC_SYMSTATE_POINTER_MAP
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace stoke {
+
+/* A map from AST node pointers to AST node pointers, used as a cache by the
+ * transform visitors.  Lookups happen once per visited node, so this uses
+ * open addressing with linear probing in a single flat array rather than a
+ * tree.  Entries are never erased individually; NULL keys are reserved to
+ * mark empty buckets.
+ */
+template <typename K, typename V>
+class SymPointerMap {
+
+public:
+
+  SymPointerMap() : size_(0) {
+    buckets_.resize(16, std::make_pair((K)NULL, (V)NULL));
+  }
+
+  /** Returns the value for a key, or NULL if there is none. */
+  V find(K key) const {
+    assert(key);
+    for (size_t i = hash(key);; i = (i + 1) & (buckets_.size() - 1)) {
+      auto& b = buckets_[i];
+      if (b.first == key)
+        return b.second;
+      if (b.first == NULL)
+        return NULL;
+    }
+  }
+
+  /** Is there a value for this key? */
+  bool contains(K key) const {
+    return find(key) != NULL;
+  }
+
+  /** Sets the value for a key. */
+  void insert(K key, V value) {
+    assert(key);
+    assert(value);
+    if (2*(size_ + 1) > buckets_.size())
+      grow();
+    for (size_t i = hash(key);; i = (i + 1) & (buckets_.size() - 1)) {
+      auto& b = buckets_[i];
+      if (b.first == key) {
+        b.second = value;
+        return;
+      }
+      if (b.first == NULL) {
+        b = std::make_pair(key, value);
+        size_++;
+        return;
+      }
+    }
+  }
+
+  /** Number of entries. */
+  size_t size() const {
+    return size_;
+  }
+
+  /** Remove all entries. */
+  void clear() {
+    buckets_.assign(16, std::make_pair((K)NULL, (V)NULL));
+    size_ = 0;
+  }
+
+private:
+
+  /** Power-of-two sized table of (key, value) pairs. */
+  std::vector<std::pair<K, V>> buckets_;
+  /** Number of occupied buckets. */
+  size_t size_;
+
+  /** Fibonacci hashing; the low bits of heap pointers are always zero. */
+  size_t hash(K key) const {
+    auto x = (uint64_t)(uintptr_t)key * 0x9e3779b97f4a7c15ull;
+    return (size_t)(x >> 32) & (buckets_.size() - 1);
+  }
+
+  /** Double the table and rehash everything. */
+  void grow() {
+    std::vector<std::pair<K, V>> old(2*buckets_.size(), std::make_pair((K)NULL, (V)NULL));
+    old.swap(buckets_);
+    size_ = 0;
+    for (auto& b : old)
+      if (b.first != NULL)
+        insert(b.first, b.second);
+  }
+
+};
+
+} //namespace stoke
+
+#endif
@@ -36,7 +36,7 @@ class SymMergeExtracts : public SymTransformVisitor {
 
 public:
 
-  SymMergeExtracts(map<SymBoolAbstract*, SymBoolAbstract*>& cache_bool, map<SymBitVectorAbstract*, SymBitVectorAbstract*>& cache_bits, map<SymArrayAbstract*, SymArrayAbstract*>& cache_array) : SymTransformVisitor(cache_bool, cache_bits, cache_array) {}
+  SymMergeExtracts(BoolCache& cache_bool, BitsCache& cache_bits, ArrayCache& cache_array) : SymTransformVisitor(cache_bool, cache_bits, cache_array) {}
 
   SymBitVectorAbstract* visit(const SymBitVectorExtract * const bv) {
     if (is_cached(bv)) return get_cached(bv);
@@ -84,7 +84,7 @@ class SymMoveExtractsInside : public SymTransformVisitor {
 
 public:
 
-  SymMoveExtractsInside(map<SymBoolAbstract*, SymBoolAbstract*>& cache_bool, map<SymBitVectorAbstract*, SymBitVectorAbstract*>& cache_bits, map<SymArrayAbstract*, SymArrayAbstract*>& cache_array) : SymTransformVisitor(cache_bool, cache_bits, cache_array) {}
+  SymMoveExtractsInside(BoolCache& cache_bool, BitsCache& cache_bits, ArrayCache& cache_array) : SymTransformVisitor(cache_bool, cache_bits, cache_array) {}
 
   SymBitVectorAbstract* visit(const SymBitVectorExtract * const bv) {
     if (is_cached(bv)) return get_cached(bv);
@@ -153,7 +153,7 @@ class SymConstProp : public SymTransformVisitor {
 
 public:
 
-  SymConstProp(map<SymBoolAbstract*, SymBoolAbstract*>& cache_bool, map<SymBitVectorAbstract*, SymBitVectorAbstract*>& cache_bits, map<SymArrayAbstract*, SymArrayAbstract*>& cache_array) : SymTransformVisitor(cache_bool, cache_bits, cache_array) {}
+  SymConstProp(BoolCache& cache_bool, BitsCache& cache_bits, ArrayCache& cache_array) : SymTransformVisitor(cache_bool, cache_bits, cache_array) {}
 
   SymBitVectorAbstract* visit(const SymBitVectorFunction * const bv) {
     if (is_cached(bv)) return get_cached(bv);
@@ -223,6 +223,9 @@ public:
       newval >>= 64 - inner->width_;
       return cache(bv, make_constant(bv->size_, newval));
     }
+    if (inner->width_ == bv->size_) {
+      return cache(bv, inner);
+    }
     if (inner == bv->bv_) {
       return cache(bv, (SymBitVectorExtract*)bv);
     }
@@ -235,9 +238,23 @@ public:
     if (is_const(lhs)) {
       uint64_t val = read_const(lhs);
       auto newsize = bv->high_bit_ - bv->low_bit_ + 1;
-      auto newconstant = val >> bv->low_bit_;
+      auto newconstant = bv->low_bit_ < 64 ? val >> bv->low_bit_ : 0;
       return cache(bv, make_constant(newsize, newconstant));
     }
+    if (lhs->width_ == bv->width_) {
+      return cache(bv, lhs);
+    }
+    // extract that lies entirely on one side of a concat
+    if (lhs->type() == SymBitVector::CONCAT) {
+      auto concat = (SymBitVectorConcat*)lhs;
+      auto lo = concat->b_->width_;
+      if (bv->low_bit_ >= lo) {
+        return cache(bv, (*this)(make_bitvector_extract(concat->a_, bv->high_bit_ - lo, bv->low_bit_ - lo)));
+      }
+      if (bv->high_bit_ < lo) {
+        return cache(bv, (*this)(make_bitvector_extract(concat->b_, bv->high_bit_, bv->low_bit_)));
+      }
+    }
     if (lhs == bv->bv_) {
       return cache(bv, (SymBitVectorExtract*)bv);
     }
@@ -261,33 +278,113 @@ public:
       case SymBitVector::CONCAT:
         return cache(bv, make_constant(width, (l << rhs->width_) | r));
       case SymBitVector::DIV:
-        break;
+        return cache(bv, make_constant(width, r == 0 ? -1 : l / r));
       case SymBitVector::MINUS:
-        return cache(bv, make_constant(width, ls - rs));
+        return cache(bv, make_constant(width, l - r));
       case SymBitVector::MOD:
+        return cache(bv, make_constant(width, r == 0 ? l : l % r));
       case SymBitVector::MULT:
-        return cache(bv, make_constant(width, ls * rs));
+        return cache(bv, make_constant(width, l * r));
       case SymBitVector::OR:
         return cache(bv, make_constant(width, l | r));
       case SymBitVector::PLUS:
-        return cache(bv, make_constant(width, ls + rs));
-      case SymBitVector::ROTATE_LEFT:
-        break;
-      case SymBitVector::ROTATE_RIGHT:
-        break;
+        return cache(bv, make_constant(width, l + r));
+      case SymBitVector::ROTATE_LEFT: {
+        auto n = r % width;
+        return cache(bv, make_constant(width, n == 0 ? l : (l << n) | (l >> (width - n))));
+      }
+      case SymBitVector::ROTATE_RIGHT: {
+        auto n = r % width;
+        return cache(bv, make_constant(width, n == 0 ? l : (l >> n) | (l << (width - n))));
+      }
       case SymBitVector::SHIFT_RIGHT:
-        break;
+        return cache(bv, make_constant(width, r >= width ? 0 : l >> r));
       case SymBitVector::SHIFT_LEFT:
-        break;
+        return cache(bv, make_constant(width, r >= width ? 0 : l << r));
       case SymBitVector::SIGN_DIV:
-        break;
+        if (rs == 0)
+          return cache(bv, make_constant(width, ls < 0 ? 1 : -1));
+        if (rs == -1)
+          return cache(bv, make_constant(width, -l));
+        return cache(bv, make_constant(width, ls / rs));
       case SymBitVector::SIGN_MOD:
-        break;
+        if (rs == 0)
+          return cache(bv, make_constant(width, l));
+        if (rs == -1)
+          return cache(bv, make_constant(width, 0));
+        return cache(bv, make_constant(width, ls % rs));
       case SymBitVector::SIGN_SHIFT_RIGHT:
-        break;
+        return cache(bv, make_constant(width, ls >> (r >= width ? width - 1 : r)));
       case SymBitVector::XOR:
         return cache(bv, make_constant(width, l ^ r));
+      default:
+        break;
+      }
+    }
+
+    // masking identities
+    switch (bv->type()) {
+    case SymBitVector::AND:
+      if (is_zero(lhs) || is_ones(rhs)) return cache(bv, lhs);
+      if (is_zero(rhs) || is_ones(lhs)) return cache(bv, rhs);
+      break;
+    case SymBitVector::OR:
+      if (is_zero(lhs) || is_ones(rhs)) return cache(bv, rhs);
+      if (is_zero(rhs) || is_ones(lhs)) return cache(bv, lhs);
+      break;
+    case SymBitVector::XOR:
+      if (is_zero(lhs)) return cache(bv, rhs);
+      if (is_zero(rhs)) return cache(bv, lhs);
+      if (is_ones(lhs)) return cache(bv, (*this)(make_unop(SymBitVector::NOT, rhs)));
+      if (is_ones(rhs)) return cache(bv, (*this)(make_unop(SymBitVector::NOT, lhs)));
+      break;
+    case SymBitVector::MULT:
+      if (is_zero(lhs) || is_one(rhs)) return cache(bv, lhs);
+      if (is_zero(rhs) || is_one(lhs)) return cache(bv, rhs);
+      break;
+    default:
+      break;
+    }
+
+    // shift by a constant becomes extract/concat, which the other rules
+    // know how to take apart
+    if (is_const(rhs) && width <= 64 && read_const(rhs) < 0xffff) {
+      auto n = (uint16_t)read_const(rhs);
+      switch (bv->type()) {
+      case SymBitVector::SHIFT_LEFT:
+      case SymBitVector::SHIFT_RIGHT:
+      case SymBitVector::SIGN_SHIFT_RIGHT:
+        if (n == 0) return cache(bv, lhs);
+        break;
+      case SymBitVector::ROTATE_LEFT:
+      case SymBitVector::ROTATE_RIGHT:
+        n = n % width;
+        if (n == 0) return cache(bv, lhs);
+        if (bv->type() == SymBitVector::ROTATE_RIGHT) n = width - n;
+        break;
+      default:
         break;
+      }
+      switch (bv->type()) {
+      case SymBitVector::SHIFT_LEFT:
+        if (n >= width) return cache(bv, make_constant(width, 0));
+        return cache(bv, (*this)(make_binop(SymBitVector::CONCAT,
+                                            make_bitvector_extract(lhs, width - n - 1, 0),
+                                            make_constant(n, 0))));
+      case SymBitVector::SHIFT_RIGHT:
+        if (n >= width) return cache(bv, make_constant(width, 0));
+        return cache(bv, (*this)(make_binop(SymBitVector::CONCAT,
+                                            make_constant(n, 0),
+                                            make_bitvector_extract(lhs, width - 1, n))));
+      case SymBitVector::SIGN_SHIFT_RIGHT:
+        if (n >= width) n = width - 1;
+        return cache(bv, (*this)(make_bitvector_sign_extend(
+                                   make_bitvector_extract(lhs, width - 1, n), width)));
+      case SymBitVector::ROTATE_LEFT:
+      case SymBitVector::ROTATE_RIGHT:
+        return cache(bv, (*this)(make_binop(SymBitVector::CONCAT,
+                                            make_bitvector_extract(lhs, width - n - 1, 0),
+                                            make_bitvector_extract(lhs, width - 1, width - n))));
       default:
         break;
       }
@@ -307,7 +404,7 @@ public:
     // move binop over ite
     if (lhs->type() == SymBitVector::ITE) {
       SymBitVectorIte* ite = (SymBitVectorIte*)lhs;
-      if (is_const(ite->a_) && is_const(ite->a_) && is_const(rhs)) {
+      if (is_const(ite->a_) && is_const(ite->b_) && is_const(rhs)) {
         auto a = make_binop(bv->type(), (SymBitVectorAbstract*)ite->a_, rhs);
         auto b = make_binop(bv->type(), (SymBitVectorAbstract*)ite->b_, rhs);
         return cache(bv, make_bitvector_ite(ite->cond_, a, b));
@@ -315,7 +412,7 @@ public:
     }
     if (rhs->type() == SymBitVector::ITE) {
       SymBitVectorIte* ite = (SymBitVectorIte*)rhs;
-      if (is_const(ite->a_) && is_const(ite->a_) && is_const(lhs)) {
+      if (is_const(ite->a_) && is_const(ite->b_) && is_const(lhs)) {
         auto a = make_binop(bv->type(), lhs, (SymBitVectorAbstract*)ite->a_);
         auto b = make_binop(bv->type(), lhs, (SymBitVectorAbstract*)ite->b_);
         return cache(bv, make_bitvector_ite(ite->cond_, a, b));
@@ -407,6 +504,26 @@ public:
       }
     }
 
+    // x & true, x | false, etc.
+    if (is_const(lhs) || is_const(rhs)) {
+      auto c = is_const(lhs) ? read_const(lhs) : read_const(rhs);
+      auto other = is_const(lhs) ? rhs : lhs;
+      switch (bv->type()) {
+      case SymBool::AND:
+        return cache(bv, c ? other : make_constant(false));
+      case SymBool::OR:
+        return cache(bv, c ? make_constant(true) : other);
+      case SymBool::IMPLIES:
+        if (is_const(lhs))
+          return cache(bv, c ? rhs : make_constant(true));
+        if (c)
+          return cache(bv, make_constant(true));
+        break;
+      default:
+        break;
+      }
+    }
+
     if (lhs == bv->a_ && rhs == bv->b_) {
       return cache(bv, (SymBoolBinop*)bv);
     }
@@ -420,6 +537,9 @@ public:
     if (is_const(lhs)) {
       return cache(b, make_constant(!read_const(lhs)));
     }
+    if (lhs->type() == SymBool::NOT) {
+      return cache(b, (SymBoolAbstract*)((SymBoolNot*)lhs)->b_);
+    }
 
     if (lhs == b->b_) {
       return cache(b, (SymBoolNot*)b);
@@ -463,10 +583,15 @@ public:
       return cache(bv, read_const(c) ? lhs : rhs);
     }
 
-    if (lhs->equals(rhs)) {
+    if (lhs == rhs || lhs->equals(rhs)) {
       return cache(bv, lhs);
     }
 
+    if (c->type() == SymBool::NOT) {
+      auto inner = (SymBoolAbstract*)((SymBoolNot*)c)->b_;
+      return cache(bv, make_bitvector_ite(inner, rhs, lhs));
+    }
+
     if (lhs == bv->a_ && rhs == bv->b_ && c == bv->cond_) {
       return cache(bv, (SymBitVectorIte*)bv);
     }
@@ -488,10 +613,19 @@ private:
     return is_const(b) && read_const(b) == 0;
   }
 
+  bool is_one(const SymBitVectorAbstract* const b) {
+    return is_const(b) && read_const(b) == 1;
+  }
+
+  /** Is this a constant with all bits set?  (Only up to 64 bits.) */
+  bool is_ones(const SymBitVectorAbstract* const b) {
+    return is_const(b) && b->width_ <= 64 && read_const(b) == mask(b->width_);
+  }
+
   /** Returns bit pattern consisting of 0s and ending with 'ones' many 1s. */
   uint64_t mask(uint16_t ones) {
     if (ones == 0) return 0;
-    if (ones == 64) return -1;
+    if (ones >= 64) return -1;
     return (1ULL << ones) - 1;
   }
 
@@ -530,14 +664,31 @@ private:
 } // namespace
 
 
-SymBitVector SymSimplify::simplify(const SymBitVector& b) {
-  auto ptr = b.ptr;
+SymSimplify& SymSimplify::clear() {
+  cache_bool1_.clear();
+  cache_bool2_.clear();
+  cache_bool3_.clear();
+  cache_bits1_.clear();
+  cache_bits2_.clear();
+  cache_bits3_.clear();
+  cache_array1_.clear();
+  cache_array2_.clear();
+  cache_array3_.clear();
+  done_bool_.clear();
+  done_bits_.clear();
+  done_array_.clear();
+  generation_ = SymMemoryManager::generation();
+  return *this;
+}
 
+template <typename T>
+T* SymSimplify::fixpoint(T* ptr) {
   SymMergeExtracts merger(cache_bool1_, cache_bits1_, cache_array1_);
   SymMoveExtractsInside mover(cache_bool2_, cache_bits2_, cache_array2_);
   SymConstProp constprop(cache_bool3_, cache_bits3_, cache_array3_);
 
-  // apply transformations until no further simplifications are possible
+  // apply transformations until no further simplifications are possible;
+  // every pass caches per node, so later iterations only visit new nodes
   while (true) {
     auto old = ptr;
     ptr = mover(ptr);
@@ -546,45 +697,43 @@ SymBitVector SymSimplify::simplify(const SymBitVector& b) {
     if (old == ptr) break;
   }
 
-  return SymBitVector(ptr);
+  return ptr;
 }
 
-SymBool SymSimplify::simplify(const SymBool& b) {
-  auto ptr = b.ptr;
-
-  SymMergeExtracts merger(cache_bool1_, cache_bits1_, cache_array1_);
-  SymMoveExtractsInside mover(cache_bool2_, cache_bits2_, cache_array2_);
-  SymConstProp constprop(cache_bool3_, cache_bits3_, cache_array3_);
-
-  // apply transformations until no further simplifications are possible
-  while (true) {
-    auto old = ptr;
-    ptr = mover(ptr);
-    ptr = merger(ptr);
-    ptr = constprop(ptr);
-    if (old == ptr) break;
+SymBitVector SymSimplify::simplify(const SymBitVector& b) {
+  check_generation();
+  auto ptr = (SymBitVectorAbstract*)b.ptr;
+  if (auto res = done_bits_.find(ptr)) {
+    return SymBitVector(res);
   }
+  auto res = fixpoint(ptr);
+  done_bits_.insert(ptr, res);
+  done_bits_.insert(res, res);
+  return SymBitVector(res);
+}
 
-  return SymBool(ptr);
+SymBool SymSimplify::simplify(const SymBool& b) {
+  check_generation();
+  auto ptr = (SymBoolAbstract*)b.ptr;
+  if (auto res = done_bool_.find(ptr)) {
+    return SymBool(res);
+  }
+  auto res = fixpoint(ptr);
+  done_bool_.insert(ptr, res);
+  done_bool_.insert(res, res);
+  return SymBool(res);
 }
 
 SymArray SymSimplify::simplify(const SymArray& b) {
-  auto ptr = b.ptr;
-
-  SymMergeExtracts merger(cache_bool1_, cache_bits1_, cache_array1_);
-  SymMoveExtractsInside mover(cache_bool2_, cache_bits2_, cache_array2_);
-  SymConstProp constprop(cache_bool3_, cache_bits3_, cache_array3_);
-
-  // apply transformations until no further simplifications are possible
-  while (true) {
-    auto old = ptr;
-    ptr = mover(ptr);
-    ptr = merger(ptr);
-    ptr = constprop(ptr);
-    if (old == ptr) break;
+  check_generation();
+  auto ptr = (SymArrayAbstract*)b.ptr;
+  if (auto res = done_array_.find(ptr)) {
+    return SymArray(res);
   }
-
-  return SymArray(ptr);
+  auto res = fixpoint(ptr);
+  done_array_.insert(ptr, res);
+  done_array_.insert(res, res);
+  return SymArray(res);
 }
 
 } // namespace stoke
@@ -17,8 +17,8 @@
 
 #include "src/symstate/bitvector.h"
 #include "src/symstate/bool.h"
-
-#include <map>
+#include "src/symstate/memory_manager.h"
+#include "src/symstate/transform_visitor.h"
 
 namespace stoke {
 
@@ -31,22 +31,49 @@ public:
   /** Simplify a given array */
   SymArray simplify(const SymArray& b);
 
-  /** Constructions a new simplifier.  Any node sharing will be preserved for all circuits simplified with this simplifier. */
-  SymSimplify() {}
+  /** Constructions a new simplifier.  Any node sharing will be preserved for all circuits simplified with this simplifier.
+    Results stay cached until a memory manager frees its nodes, so a single simplifier can be shared across a whole validation. */
+  SymSimplify() : generation_(SymMemoryManager::generation()) {}
+
+  /** Forget all cached simplifications. */
+  SymSimplify& clear();
+
+  /** Number of nodes whose simplified form is cached. */
+  size_t cache_size() const {
+    return done_bits_.size() + done_bool_.size() + done_array_.size();
+  }
 
 private:
   /** Simplification cache for bools. */
-  std::map<SymBoolAbstract*, SymBoolAbstract*> cache_bool1_;
-  std::map<SymBoolAbstract*, SymBoolAbstract*> cache_bool2_;
-  std::map<SymBoolAbstract*, SymBoolAbstract*> cache_bool3_;
+  SymTransformVisitor::BoolCache cache_bool1_;
+  SymTransformVisitor::BoolCache cache_bool2_;
+  SymTransformVisitor::BoolCache cache_bool3_;
   /** Simplification cache for bitvectors. */
-  std::map<SymBitVectorAbstract*, SymBitVectorAbstract*> cache_bits1_;
-  std::map<SymBitVectorAbstract*, SymBitVectorAbstract*> cache_bits2_;
-  std::map<SymBitVectorAbstract*, SymBitVectorAbstract*> cache_bits3_;
+  SymTransformVisitor::BitsCache cache_bits1_;
+  SymTransformVisitor::BitsCache cache_bits2_;
+  SymTransformVisitor::BitsCache cache_bits3_;
   /** Simplification cache for arrays. */
-  std::map<SymArrayAbstract*, SymArrayAbstract*> cache_array1_;
-  std::map<SymArrayAbstract*, SymArrayAbstract*> cache_array2_;
-  std::map<SymArrayAbstract*, SymArrayAbstract*> cache_array3_;
+  SymTransformVisitor::ArrayCache cache_array1_;
+  SymTransformVisitor::ArrayCache cache_array2_;
+  SymTransformVisitor::ArrayCache cache_array3_;
+
+  /** Final results of simplify(); these are fixed points of all passes. */
+  SymTransformVisitor::BoolCache done_bool_;
+  SymTransformVisitor::BitsCache done_bits_;
+  SymTransformVisitor::ArrayCache done_array_;
+
+  /** Memory manager generation the caches were filled in. */
+  size_t generation_;
+
+  /** Clears the caches if the nodes they refer to may have been freed. */
+  void check_generation() {
+    if (generation_ != SymMemoryManager::generation()) {
+      clear();
+    }
+  }
+  /** Runs all passes until nothing changes. */
+  template <typename T>
+  T* fixpoint(T* ptr);
 };
 
 } // namespace stoke
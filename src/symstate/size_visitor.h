@@ -0,0 +1,158 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef _STOKE_SRC_SYMSTATE_SIZE_VISITOR
+#define _STOKE_SRC_SYMSTATE_SIZE_VISITOR
+
+#include "src/symstate/memo_visitor.h"
+
+namespace stoke {
+
+/* Counts the distinct nodes reachable from a set of circuits.  Shared
+   subterms are counted once, also across calls, so the visitor can be used
+   to measure the size of a whole symbolic state. */
+class SymSizeVisitor : public SymMemoVisitor<size_t, size_t, size_t> {
+
+public:
+
+  SymSizeVisitor() : count_(0) {}
+
+  using SymMemoVisitor<size_t, size_t, size_t>::operator();
+
+  /** Add the nodes of this bit vector; returns the total count so far. */
+  size_t operator()(const SymBitVector& bv) {
+    SymMemoVisitor<size_t, size_t, size_t>::operator()(bv.ptr);
+    return count_;
+  }
+  /** Add the nodes of this bool; returns the total count so far. */
+  size_t operator()(const SymBool& b) {
+    SymMemoVisitor<size_t, size_t, size_t>::operator()(b.ptr);
+    return count_;
+  }
+  /** Add the nodes of this array; returns the total count so far. */
+  size_t operator()(const SymArray& a) {
+    SymMemoVisitor<size_t, size_t, size_t>::operator()(a.ptr);
+    return count_;
+  }
+
+  /** Number of distinct nodes seen so far. */
+  size_t get_count() const {
+    return count_;
+  }
+
+  size_t visit_binop(const SymBitVectorBinop * const bv) {
+    (*this)(bv->a_);
+    (*this)(bv->b_);
+    return ++count_;
+  }
+
+  size_t visit_binop(const SymBoolBinop * const b) {
+    (*this)(b->a_);
+    (*this)(b->b_);
+    return ++count_;
+  }
+
+  size_t visit_unop(const SymBitVectorUnop * const bv) {
+    (*this)(bv->bv_);
+    return ++count_;
+  }
+
+  size_t visit_compare(const SymBoolCompare * const b) {
+    (*this)(b->a_);
+    (*this)(b->b_);
+    return ++count_;
+  }
+
+  size_t visit(const SymBitVectorArrayLookup * const bv) {
+    (*this)(bv->a_);
+    (*this)(bv->key_);
+    return ++count_;
+  }
+
+  size_t visit(const SymBitVectorConstant * const bv) {
+    return ++count_;
+  }
+
+  size_t visit(const SymBitVectorExtract * const bv) {
+    (*this)(bv->bv_);
+    return ++count_;
+  }
+
+  size_t visit(const SymBitVectorFunction * const bv) {
+    for (auto arg : bv->args_)
+      (*this)(arg);
+    return ++count_;
+  }
+
+  size_t visit(const SymBitVectorIte * const bv) {
+    (*this)(bv->cond_);
+    (*this)(bv->a_);
+    (*this)(bv->b_);
+    return ++count_;
+  }
+
+  size_t visit(const SymBitVectorSignExtend * const bv) {
+    (*this)(bv->bv_);
+    return ++count_;
+  }
+
+  size_t visit(const SymBitVectorVar * const bv) {
+    return ++count_;
+  }
+
+  size_t visit(const SymBoolArrayEq * const b) {
+    (*this)(b->a_);
+    (*this)(b->b_);
+    return ++count_;
+  }
+
+  size_t visit(const SymBoolFalse * const b) {
+    return ++count_;
+  }
+
+  size_t visit(const SymBoolNot * const b) {
+    (*this)(b->b_);
+    return ++count_;
+  }
+
+  size_t visit(const SymBoolTrue * const b) {
+    return ++count_;
+  }
+
+  size_t visit(const SymBoolVar * const b) {
+    return ++count_;
+  }
+
+  size_t visit(const SymArrayStore * const a) {
+    (*this)(a->a_);
+    (*this)(a->key_);
+    (*this)(a->value_);
+    return ++count_;
+  }
+
+  size_t visit(const SymArrayVar * const a) {
+    return ++count_;
+  }
+
+private:
+
+  /** Number of distinct nodes seen so far. */
+  size_t count_;
+
+};
+
+} //namespace stoke
+
+#endif
@@ -19,6 +19,7 @@
 #include <map>
 #include <sstream>
 
+#include "src/symstate/pointer_map.h"
 #include "src/symstate/visitor.h"
 
 namespace stoke {
@@ -34,9 +35,14 @@ class SymTransformVisitor : public SymVisitor<SymBoolAbstract*, SymBitVectorAbst
 
 public:
 
-  SymTransformVisitor() : cache_bool_(*(new std::map<SymBoolAbstract*, SymBoolAbstract*>())), cache_bits_(*(new std::map<SymBitVectorAbstract*, SymBitVectorAbstract*>())), cache_array_(*(new std::map<SymArrayAbstract*, SymArrayAbstract*>())), delete_caches_(true) {}
+  /** Cache types; these can be shared between visitors (see SymSimplify). */
+  typedef SymPointerMap<SymBoolAbstract*, SymBoolAbstract*> BoolCache;
+  typedef SymPointerMap<SymBitVectorAbstract*, SymBitVectorAbstract*> BitsCache;
+  typedef SymPointerMap<SymArrayAbstract*, SymArrayAbstract*> ArrayCache;
 
-  SymTransformVisitor(std::map<SymBoolAbstract*, SymBoolAbstract*>& cache_bool, std::map<SymBitVectorAbstract*, SymBitVectorAbstract*>& cache_bits, std::map<SymArrayAbstract*, SymArrayAbstract*>& cache_array) : cache_bool_(cache_bool), cache_bits_(cache_bits), cache_array_(cache_array), delete_caches_(false) {}
+  SymTransformVisitor() : cache_bool_(*(new BoolCache())), cache_bits_(*(new BitsCache())), cache_array_(*(new ArrayCache())), delete_caches_(true) {}
+
+  SymTransformVisitor(BoolCache& cache_bool, BitsCache& cache_bits, ArrayCache& cache_array) : cache_bool_(cache_bool), cache_bits_(cache_bits), cache_array_(cache_array), delete_caches_(false) {}
 
   ~SymTransformVisitor() {
     if (delete_caches_) {
@@ -60,41 +66,41 @@ public:
   }
 
   SymBitVectorAbstract* cache(const SymBitVectorAbstract* const bv, SymBitVectorAbstract* res) {
-    cache_bits_[(SymBitVectorAbstract*)bv] = res;
+    cache_bits_.insert((SymBitVectorAbstract*)bv, res);
     return res;
   }
   bool is_cached(const SymBitVectorAbstract* const bv) {
-    return cache_bits_.find((SymBitVectorAbstract*)bv) != cache_bits_.end();
+    return cache_bits_.contains((SymBitVectorAbstract*)bv);
   }
   SymBitVectorAbstract* get_cached(const SymBitVectorAbstract* const bv) {
-    return (*cache_bits_.find((SymBitVectorAbstract*)bv)).second;
+    return cache_bits_.find((SymBitVectorAbstract*)bv);
   }
 
   SymBoolAbstract* cache(const SymBoolAbstract* const bv, SymBoolAbstract* res) {
-    cache_bool_[(SymBoolAbstract*)bv] = res;
+    cache_bool_.insert((SymBoolAbstract*)bv, res);
     return res;
   }
   bool is_cached(const SymBoolAbstract* const bv) {
-    return cache_bool_.find((SymBoolAbstract*)bv) != cache_bool_.end();
+    return cache_bool_.contains((SymBoolAbstract*)bv);
   }
   SymBoolAbstract* get_cached(const SymBoolAbstract* const bv) {
-    return (*cache_bool_.find((SymBoolAbstract*)bv)).second;
+    return cache_bool_.find((SymBoolAbstract*)bv);
   }
 
   SymArrayAbstract* cache(const SymArrayAbstract* const bv, SymArrayAbstract* res) {
-    cache_array_[(SymArrayAbstract*)bv] = res;
+    cache_array_.insert((SymArrayAbstract*)bv, res);
     return res;
   }
   bool is_cached(const SymArrayAbstract* const bv) {
-    return cache_array_.find((SymArrayAbstract*)bv) != cache_array_.end();
+    return cache_array_.contains((SymArrayAbstract*)bv);
   }
   SymArrayAbstract* get_cached(const SymArrayAbstract* const bv) {
-    return (*cache_array_.find((SymArrayAbstract*)bv)).second;
+    return cache_array_.find((SymArrayAbstract*)bv);
   }
 
-  std::map<SymBoolAbstract*, SymBoolAbstract*>& cache_bool_;
-  std::map<SymBitVectorAbstract*, SymBitVectorAbstract*>& cache_bits_;
-  std::map<SymArrayAbstract*, SymArrayAbstract*>& cache_array_;
+  BoolCache& cache_bool_;
+  BitsCache& cache_bits_;
+  ArrayCache& cache_array_;
   bool delete_caches_;
 
 public:
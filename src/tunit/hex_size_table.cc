@@ -0,0 +1,132 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/tunit/hex_size_table.h"
+
+#include <cassert>
+#include <unordered_map>
+
+using namespace std;
+using namespace x64asm;
+
+namespace {
+
+struct Table {
+  /** Key to length, in bytes. */
+  unordered_map<uint64_t, uint8_t> sizes;
+  /** Only used to fill in missing keys. */
+  Assembler assm;
+  size_t misses = 0;
+};
+
+Table& table() {
+  static thread_local Table t;
+  return t;
+}
+
+/** 0 for registers 0-3, 1 for 4-7 (spl..dil need REX), 2 for 8-15 (REX.R/X/B
+  or a 3-byte VEX prefix).  Also applied to immediates and labels, whose
+  encodings are fixed by the opcode; that only makes the key finer. */
+uint64_t reg_class(uint64_t val) {
+  return val < 4 ? 0 : val < 8 ? 1 : 2;
+}
+
+/** Everything about a memory operand that affects its encoded length. */
+uint64_t mem_class(const M8& m) {
+  uint64_t c = 0;
+
+  if (m.rip_offset()) {
+    c |= 0x1;
+  }
+  if (m.contains_base()) {
+    const uint64_t base = m.get_base();
+    c |= 0x2;
+    c |= (base & 0x7) == 0x4 ? 0x4 : 0;  // rsp, r12 need a SIB byte
+    c |= (base & 0x7) == 0x5 ? 0x8 : 0;  // rbp, r13 need a displacement
+    c |= base >= 8 ? 0x10 : 0;
+  }
+  if (m.contains_index()) {
+    const uint64_t index = m.get_index();
+    c |= 0x20;
+    c |= index >= 8 ? 0x40 : 0;
+  }
+
+  const auto disp = (int32_t)(int64_t)m.get_disp();
+  if (disp != 0) {
+    c |= (disp >= -128 && disp < 128) ? 0x80 : 0x100;
+  }
+
+  if (m.contains_seg()) {
+    c |= 0x200;
+  }
+  if (m.addr_or()) {
+    c |= 0x400;
+  }
+
+  return c;
+}
+
+} // namespace
+
+namespace stoke {
+
+uint64_t HexSizeTable::key(const Instruction& instr) {
+  // 16 bits of opcode, 11 bits of memory class, 2 bits per other operand
+  uint64_t k = (uint64_t)instr.get_opcode() << 48;
+
+  const auto has_mem = instr.is_explicit_memory_dereference() || instr.is_lea();
+  const auto mi = has_mem ? instr.mem_index() : instr.arity();
+  if (has_mem) {
+    k |= mem_class(instr.get_operand<M8>(mi)) << 32;
+  }
+
+  for (size_t i = 0, ie = instr.arity(); i < ie; ++i) {
+    if (i != mi) {
+      k |= reg_class((uint64_t)instr.get_operand<R64>(i)) << (2*i);
+    }
+  }
+
+  return k;
+}
+
+size_t HexSizeTable::hex_size(const Instruction& instr) {
+  // Keys only have room for this many operands; this is more than x64asm uses
+  if (instr.arity() > 16) {
+    return table().assm.hex_size(instr);
+  }
+
+  auto& t = table();
+  const auto k = key(instr);
+  const auto itr = t.sizes.find(k);
+  if (itr != t.sizes.end()) {
+    // Debug builds check that the key really determines the length
+    assert(itr->second == t.assm.hex_size(instr));
+    return itr->second;
+  }
+
+  t.misses++;
+  const auto size = t.assm.hex_size(instr);
+  t.sizes[k] = size;
+  return size;
+}
+
+size_t HexSizeTable::size() {
+  return table().sizes.size();
+}
+
+size_t HexSizeTable::misses() {
+  return table().misses;
+}
+
+} // namespace stoke
@@ -0,0 +1,53 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STOKE_SRC_TUNIT_HEX_SIZE_TABLE_H
+#define STOKE_SRC_TUNIT_HEX_SIZE_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "src/ext/x64asm/include/x64asm.h"
+
+namespace stoke {
+
+/** Encoding lengths of instructions without running the assembler.
+
+  The length of an x86-64 encoding is fixed by the opcode (which in x64asm
+  already determines operand and immediate widths) and by a few properties
+  of the operands: whether registers need REX or 3-byte VEX prefixes, and for
+  the memory operand whether it needs a SIB byte, which displacement size it
+  takes, and whether it has segment or address-size overrides.  Instructions
+  are reduced to a key made of exactly these; the assembler is run once per
+  key, and every later instruction with the same key is a table lookup.
+  Tables are per thread. */
+class HexSizeTable {
+
+public:
+  /** Returns the number of bytes this instruction assembles to. */
+  static size_t hex_size(const x64asm::Instruction& instr);
+
+  /** Number of distinct keys seen on this thread. */
+  static size_t size();
+  /** Number of times this thread had to run the assembler. */
+  static size_t misses();
+
+private:
+  /** Reduces an instruction to the properties its length depends on. */
+  static uint64_t key(const x64asm::Instruction& instr);
+};
+
+} // namespace stoke
+
+#endif
@@ -0,0 +1,82 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STOKE_SRC_TUNIT_OFFSET_TREE_H
+#define STOKE_SRC_TUNIT_OFFSET_TREE_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace stoke {
+
+/** Prefix sums over a list of instruction sizes, kept as a Fenwick tree so
+  that changing one size and reading one offset are both O(log n).  Inserting
+  or removing an entry needs a rebuild, which is linear, like the insertion
+  into the code vector that goes with it. */
+class OffsetTree {
+
+public:
+
+  /** Rebuild the tree from a list of sizes; O(n). */
+  void assign(const std::vector<size_t>& sizes) {
+    tree_.assign(sizes.size() + 1, 0);
+    for (size_t i = 1, ie = tree_.size(); i < ie; ++i) {
+      tree_[i] += sizes[i-1];
+      const auto parent = i + (i & -i);
+      if (parent < ie) {
+        tree_[parent] += tree_[i];
+      }
+    }
+  }
+
+  /** Remove all entries. */
+  void clear() {
+    tree_.assign(1, 0);
+  }
+
+  /** Number of entries. */
+  size_t size() const {
+    return tree_.empty() ? 0 : tree_.size() - 1;
+  }
+
+  /** Sum of the entries before i; i may be size(). */
+  size_t prefix(size_t i) const {
+    assert(i <= size());
+    size_t sum = 0;
+    for (; i > 0; i -= (i & -i)) {
+      sum += tree_[i];
+    }
+    return sum;
+  }
+
+  /** Add delta to entry i.  Negative deltas rely on unsigned wraparound. */
+  void add(size_t i, int64_t delta) {
+    assert(i < size());
+    for (++i; i < tree_.size(); i += (i & -i)) {
+      tree_[i] += delta;
+    }
+  }
+
+private:
+
+  /** One-based; tree_[i] holds the sum of the (i & -i) entries ending at i. */
+  std::vector<size_t> tree_;
+
+};
+
+} // namespace stoke
+
+#endif
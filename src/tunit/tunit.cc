@@ -22,6 +22,7 @@
 #include "src/ext/cpputil/include/io/fail.h"
 #include "src/ext/cpputil/include/io/filterstream.h"
 #include "src/ext/cpputil/include/io/indent.h"
+#include "src/tunit/hex_size_table.h"
 
 using namespace cpputil;
 using namespace std;
@@ -100,6 +101,21 @@ TUnit::MayMustSets TUnit::get_may_must_sets(const MayMustSets& defaults) const {
 }
 
 bool TUnit::invariant_rip_offsets() const {
+  // The index has to list exactly the rip-relative instructions, in order
+  auto itr = rip_indices_.begin();
+  for (size_t i = 0, ie = get_code().size(); i < ie; ++i) {
+    if (!is_rip(i)) {
+      continue;
+    }
+    if (itr == rip_indices_.end() || *itr != i) {
+      return false;
+    }
+    ++itr;
+  }
+  if (itr != rip_indices_.end()) {
+    return false;
+  }
+
   for (size_t i = 0, ie = get_code().size(); i < ie; ++i) {
     const auto& instr = get_code()[i];
     if (!instr.is_explicit_memory_dereference()) {
@@ -120,9 +136,8 @@ bool TUnit::invariant_rip_offsets() const {
 }
 
 bool TUnit::invariant_hex_sizes() const {
-  Assembler assm;
   for (size_t i = 0, ie = code_.size(); i < ie; ++i) {
-    if (hex_size(i) != assm.hex_size(code_[i])) {
+    if (hex_size(i) != HexSizeTable::hex_size(code_[i])) {
       return false;
     }
   }
@@ -130,13 +145,12 @@ bool TUnit::invariant_hex_sizes() const {
 }
 
 bool TUnit::invariant_hex_offsets() const {
-  Assembler assm;
   size_t offset = 0;
   for (size_t i = 0, ie = code_.size(); i < ie; ++i) {
     if (hex_offset(i) != offset) {
       return false;
     }
-    offset += assm.hex_size(code_[i]);
+    offset += HexSizeTable::hex_size(code_[i]);
   }
   return true;
 }
@@ -147,22 +161,27 @@ void TUnit::remove(size_t index) {
   // Some constants
   const int64_t offset_delta = 0 - hex_size(index);
 
-  // Update offset and size tables
-  for (size_t i = index, ie = hex_sizes_.size()-1; i < ie; ++i) {
-    hex_offsets_[i] = hex_offsets_[i+1] + offset_delta;
-    hex_sizes_[i] = hex_sizes_[i+1];
-  }
-  hex_offsets_.resize(hex_offsets_.size()-1);
-  hex_sizes_.resize(hex_sizes_.size()-1);
+  // Update offset and size tables; erasing is linear anyway, so rebuild
+  hex_sizes_.erase(hex_sizes_.begin() + index);
+  hex_offsets_.assign(hex_sizes_);
 
   // Delete this instruction
   code_.erase(code_.begin() + index);
 
-  // Rescale any rips
-  for (size_t i = index, ie = code_.size(); i < ie; ++i) {
-    if (is_rip(i)) {
-      adjust_rip(i, -offset_delta);
-    }
+  // Renumber and rescale any rips that follow
+  auto itr = rip_lower_bound(index);
+  const auto was_rip = itr != rip_indices_.end() && *itr == index;
+  if (was_rip) {
+    itr = rip_indices_.erase(itr);
+  }
+  for (auto ie = rip_indices_.end(); itr != ie; ++itr) {
+    --*itr;
+    adjust_rip(*itr, -offset_delta);
+  }
+
+  // The others keep their targets; this one's may be gone
+  if (was_rip) {
+    recompute_rip_targets();
   }
 }
 
@@ -170,23 +189,25 @@ void TUnit::insert(size_t index, const x64asm::Instruction& instr, bool rescale_
   assert(index <= code_.size());
 
   // Some constants
-  Assembler assm;
-  const auto size = assm.hex_size(instr);
+  const auto size = HexSizeTable::hex_size(instr);
   const int64_t offset_delta = size;
 
   // Always update offset and size tables (they need to grow)
-  hex_offsets_.resize(hex_offsets_.size()+1);
-  hex_sizes_.resize(hex_sizes_.size()+1);
-  for (int i = hex_offsets_.size()-1, ie = index; i > ie; --i) {
-    hex_offsets_[i] = hex_offsets_[i-1] + offset_delta;
-    hex_sizes_[i] = hex_sizes_[i-1];
-  }
-  hex_offsets_[index] = index == 0 ? 0 : hex_offsets_[index-1] + hex_sizes_[index-1];
-  hex_sizes_[index] = size;
+  hex_sizes_.insert(hex_sizes_.begin() + index, size);
+  hex_offsets_.assign(hex_sizes_);
 
   // Insert this instruction
   code_.insert(code_.begin() + index, instr);
 
+  // Renumber the rips that follow and add this one
+  auto itr = rip_lower_bound(index);
+  for (auto i = itr, ie = rip_indices_.end(); i != ie; ++i) {
+    ++*i;
+  }
+  if (is_rip(index)) {
+    itr = rip_indices_.insert(itr, index) + 1;
+  }
+
   // If rescale rip is true, we have to adjust a global rip offset
   // Otherwise we'll just use the rip offsets in this instruction as they are given
   if (rescale_rip && is_rip(index)) {
@@ -195,12 +216,15 @@ void TUnit::insert(size_t index, const x64asm::Instruction& instr, bool rescale_
 
   // If this instruction has non-zero size, adjust everything that follows
   if (offset_delta != 0) {
-    for (size_t i = index+1, ie = code_.size(); i < ie; ++i) {
-      if (is_rip(i)) {
-        adjust_rip(i, -offset_delta);
-      }
+    for (auto ie = rip_indices_.end(); itr != ie; ++itr) {
+      adjust_rip(*itr, -offset_delta);
     }
   }
+
+  // The others keep their targets; this one may add one
+  if (is_rip(index)) {
+    recompute_rip_targets();
+  }
 }
 
 void TUnit::replace(size_t index, const x64asm::Instruction& instr, bool skip_first, bool rescale_rip) {
@@ -208,37 +232,42 @@ void TUnit::replace(size_t index, const x64asm::Instruction& instr, bool skip_fi
   assert(index < code_.size());
 
   // Some constants
-  Assembler assm;
-  const auto size = assm.hex_size(instr);
+  const auto size = HexSizeTable::hex_size(instr);
   const int64_t offset_delta = size - hex_size(index);
 
   // If this instruction has a new size, update offset and size tables
   if (offset_delta != 0) {
-    for (size_t i = index+1, ie = hex_offsets_.size(); i < ie; ++i) {
-      hex_offsets_[i] += offset_delta;
-    }
+    hex_offsets_.add(index, offset_delta);
     hex_sizes_[index] = size;
   }
 
-  // Replace the instruction
+  // Replace the instruction, and keep the rip index up to date
+  const auto was_rip = is_rip(index);
   code_[index] = instr;
+  const auto now_rip = is_rip(index);
+
+  auto itr = rip_lower_bound(index);
+  if (was_rip && !now_rip) {
+    itr = rip_indices_.erase(itr);
+  } else if (!was_rip && now_rip) {
+    itr = rip_indices_.insert(itr, index);
+  }
 
   // If rescale rip is true, we have to adjust a potential global rip offset
-  if (!skip_first && is_rip(index) && rescale_rip) {
+  if (!skip_first && now_rip && rescale_rip) {
     adjust_rip(index, 0 - get_rip_offset() - hex_offset(index) - hex_size(index));
   }
 
   // If this instruction has non-zero size, adjust everything
   if (offset_delta != 0) {
     const auto begin = skip_first || rescale_rip ? index + 1 : index;
-    for (size_t i = begin, ie = code_.size(); i < ie; ++i) {
-      if (is_rip(i)) {
-        adjust_rip(i, -offset_delta);
-      }
+    for (itr = rip_lower_bound(begin); itr != rip_indices_.end(); ++itr) {
+      adjust_rip(*itr, -offset_delta);
     }
   }
 
-  recompute();
+  // Sizes and offsets are already right; only the targets can have changed
+  recompute_rip_targets();
 }
 
 void TUnit::swap(size_t i, size_t j) {
@@ -259,29 +288,36 @@ void TUnit::swap(size_t i, size_t j) {
 
   // If hex sizes have changed update offset and size tables
   if (offset_delta_inner) {
+    hex_offsets_.add(i, offset_delta_inner);
+    hex_offsets_.add(j, -offset_delta_inner);
     std::swap(hex_sizes_[i], hex_sizes_[j]);
-    std::swap(hex_offsets_[i], hex_offsets_[j]);
-    hex_offsets_[i] += offset_delta_j;
-    if (offset_delta_inner != 0) {
-      for (size_t idx = i+1; idx < j; ++idx) {
-        hex_offsets_[idx] += offset_delta_inner;
-      }
-    }
-    hex_offsets_[j] += offset_delta_i;
   }
 
-  // Swap the instructions
+  // Swap the instructions, and move them in the rip index
+  const auto rip_i = is_rip(i);
+  const auto rip_j = is_rip(j);
   std::swap(code_[i], code_[j]);
+  if (rip_i != rip_j) {
+    auto first = rip_lower_bound(i);
+    auto last = rip_lower_bound(j);
+    if (rip_i) {
+      // i is at first; it moves to j, past the ones in between
+      std::rotate(first, first + 1, last);
+      *(last - 1) = j;
+    } else {
+      // j is at last; it moves to i, before the ones in between
+      std::rotate(first, last, last + 1);
+      *first = i;
+    }
+  }
 
   // Adjust rips
   if (is_rip(i)) {
     adjust_rip(i, -offset_delta_j);
   }
   if (offset_delta_inner != 0) {
-    for (size_t idx = i+1; idx < j; ++idx) {
-      if (is_rip(idx)) {
-        adjust_rip(idx, -offset_delta_inner);
-      }
+    for (auto itr = rip_lower_bound(i+1); itr != rip_indices_.end() && *itr < j; ++itr) {
+      adjust_rip(*itr, -offset_delta_inner);
     }
   }
   if (is_rip(j)) {
@@ -304,28 +340,38 @@ void TUnit::rotate_left(size_t i, size_t j) {
   const int64_t offset_delta_small = 0 - hex_size(i);
   const int64_t offset_delta_large = span + hex_size(j);
 
-  // Update offset and size tables
+  // Update offset and size tables; offsets past j don't change
   const auto size = hex_sizes_[i];
-  const auto offset = hex_offsets_[i];
   for (size_t idx = i; idx < j; ++idx) {
-    hex_sizes_[idx] = hex_sizes_[idx+1];
-    hex_offsets_[idx] = hex_offsets_[idx+1] + offset_delta_small;
+    if (hex_sizes_[idx] != hex_sizes_[idx+1]) {
+      hex_offsets_.add(idx, (int64_t)hex_sizes_[idx+1] - (int64_t)hex_sizes_[idx]);
+      hex_sizes_[idx] = hex_sizes_[idx+1];
+    }
   }
+  hex_offsets_.add(j, (int64_t)size - (int64_t)hex_sizes_[j]);
   hex_sizes_[j] = size;
-  hex_offsets_[j] = offset + offset_delta_large;
 
-  // Rotate instructions
+  // Rotate instructions, and the rip indices in [i, j] along with them
+  const auto rip_i = is_rip(i);
   const auto instr = code_[i];
   for (size_t idx = i; idx < j; ++idx) {
     code_[idx] = code_[idx+1];
   }
   code_[j] = instr;
 
+  auto first = rip_lower_bound(i);
+  auto last = rip_lower_bound(j+1);
+  for (auto itr = first; itr != last; ++itr) {
+    --*itr;
+  }
+  if (rip_i) {
+    std::rotate(first, first + 1, last);
+    *(last - 1) = j;
+  }
+
   // Adjust rips
-  for (size_t idx = i; idx < j; ++idx) {
-    if (is_rip(idx)) {
-      adjust_rip(idx, -offset_delta_small);
-    }
+  for (auto itr = rip_lower_bound(i); itr != rip_indices_.end() && *itr < j; ++itr) {
+    adjust_rip(*itr, -offset_delta_small);
   }
   if (is_rip(j)) {
     adjust_rip(j, -offset_delta_large);
@@ -347,28 +393,38 @@ void TUnit::rotate_right(size_t i, size_t j) {
   const int64_t offset_delta_small = hex_size(j);
   const int64_t offset_delta_large = 0 - span - hex_size(i);
 
-  // Update offset and size tables
+  // Update offset and size tables; offsets past j don't change
   const auto size = hex_sizes_[j];
-  const auto offset = hex_offsets_[j];
   for (int idx = j; idx > (int)i; --idx) {
-    hex_sizes_[idx] = hex_sizes_[idx-1];
-    hex_offsets_[idx] = hex_offsets_[idx-1] + offset_delta_small;
+    if (hex_sizes_[idx] != hex_sizes_[idx-1]) {
+      hex_offsets_.add(idx, (int64_t)hex_sizes_[idx-1] - (int64_t)hex_sizes_[idx]);
+      hex_sizes_[idx] = hex_sizes_[idx-1];
+    }
   }
+  hex_offsets_.add(i, (int64_t)size - (int64_t)hex_sizes_[i]);
   hex_sizes_[i] = size;
-  hex_offsets_[i] = offset + offset_delta_large;
 
-  // Rotate instructions
+  // Rotate instructions, and the rip indices in [i, j] along with them
+  const auto rip_j = is_rip(j);
   const auto instr = code_[j];
   for (int idx = j; idx > (int)i; --idx) {
     code_[idx] = code_[idx-1];
   }
   code_[i] = instr;
 
+  auto first = rip_lower_bound(i);
+  auto last = rip_lower_bound(j+1);
+  for (auto itr = first; itr != last; ++itr) {
+    ++*itr;
+  }
+  if (rip_j) {
+    std::rotate(first, last - 1, last);
+    *first = i;
+  }
+
   // Adjust rips
-  for (int idx = j; idx > (int)i; --idx) {
-    if (is_rip(idx)) {
-      adjust_rip(idx, -offset_delta_small);
-    }
+  for (auto itr = rip_lower_bound(i+1); itr != rip_indices_.end() && *itr <= j; ++itr) {
+    adjust_rip(*itr, -offset_delta_small);
   }
   if (is_rip(i)) {
     adjust_rip(i, -offset_delta_large);
@@ -465,8 +521,8 @@ ostream& TUnit::write_text(ostream& os) const {
 
   // Print rip offsets
   col << "RIP" << endl;
-  for (auto i = hex_offset_begin(), ie = hex_offset_end(); i != ie; ++i) {
-    col << hex << showbase << rip_offset_ + *i << endl;
+  for (size_t i = 0, ie = code_.size(); i < ie; ++i) {
+    col << hex << showbase << rip_offset_ + hex_offset(i) << endl;
   }
   col.filter().next();
 
@@ -493,33 +549,36 @@ ostream& TUnit::write_text(ostream& os) const {
 }
 
 void TUnit::recompute() {
-  Assembler assm;
-
   // Recompute hex sizes
   hex_sizes_.clear();
   for (const auto& instr : get_code()) {
-    hex_sizes_.push_back(assm.hex_size(instr));
+    hex_sizes_.push_back(HexSizeTable::hex_size(instr));
   }
 
   // Recompute hex offsets
-  hex_offsets_ = {{0}};
-  for (int i = 0, ie = code_.size()-1; i < ie; ++i) {
-    hex_offsets_.push_back(hex_offsets_.back() + hex_size(i));
+  hex_offsets_.assign(hex_sizes_);
+
+  // Recompute rip indices and targets
+  rip_indices_.clear();
+  for (size_t i = 0, ie = get_code().size(); i < ie; ++i) {
+    if (is_rip(i)) {
+      rip_indices_.push_back(i);
+    }
   }
+  recompute_rip_targets();
+}
 
-  // Recomute rip offset targets
+void TUnit::recompute_rip_targets() {
   rip_offset_targets_.clear();
-  for (size_t i = 0, ie = get_code().size(); i < ie; ++i) {
+  for (auto i : rip_indices_) {
     const auto& instr = get_code()[i];
     if (!instr.is_explicit_memory_dereference()) {
       continue;
     }
     const auto op = instr.get_operand<M8>(instr.mem_index());
-    if (op.rip_offset()) {
-      const auto after_instr = rip_offset_ + hex_offset(i) + hex_size(i);
-      const auto target = after_instr + op.get_disp();
-      rip_offset_targets_.insert(target);
-    }
+    const auto after_instr = rip_offset_ + hex_offset(i) + hex_size(i);
+    const auto target = after_instr + op.get_disp();
+    rip_offset_targets_.insert(target);
   }
 }
 
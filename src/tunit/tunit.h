@@ -15,6 +15,7 @@
 #ifndef STOKE_SRC_TUNIT_TUNIT_H
 #define STOKE_SRC_TUNIT_TUNIT_H
 
+#include <algorithm>
 #include <boost/optional.hpp>
 #include <cassert>
 #include <iostream>
@@ -23,6 +24,7 @@
 #include <vector>
 
 #include "src/ext/x64asm/include/x64asm.h"
+#include "src/tunit/offset_tree.h"
 #include "src/tunit/operand_iterator.h"
 
 namespace stoke {
@@ -30,8 +32,8 @@ namespace stoke {
 struct TUnit {
   /** Iterator over global rip-offsets targets */
   typedef std::set<uint64_t>::const_iterator rip_offset_target_iterator;
-  /** Iterator over hex-offsets relative to function begin */
-  typedef std::vector<size_t>::const_iterator hex_offset_iterator;
+  /** Iterator over indices of rip-relative instructions */
+  typedef std::vector<size_t>::const_iterator rip_index_iterator;
   /** Iterator over hex-sizes */
   typedef std::vector<size_t>::const_iterator hex_size_iterator;
 
@@ -109,10 +111,10 @@ struct TUnit {
            invariant_rip_offsets();
   }
 
-  /** Returns the hex offset of this instruction */
+  /** Returns the hex offset of this instruction; O(log n) */
   size_t hex_offset(size_t index) const {
     assert(index < code_.size());
-    return hex_offsets_[index];
+    return hex_offsets_.prefix(index);
   }
   /** Returns the hex size of this instruction */
   size_t hex_size(size_t index) const {
@@ -121,8 +123,7 @@ struct TUnit {
   }
   /** Returns the total hex size of this function */
   size_t hex_size() const {
-    const auto size = code_.size();
-    return size == 0 ? 0 : hex_offset(size-1) + hex_size(size-1);
+    return hex_offsets_.prefix(hex_offsets_.size());
   }
 
   /** Iterator over global rip-offset targets */
@@ -134,13 +135,13 @@ struct TUnit {
     return rip_offset_targets_.end();
   }
 
-  /** Iterator over instruction offsets relative to function begin */
-  hex_offset_iterator hex_offset_begin() const {
-    return hex_offsets_.begin();
+  /** Iterator over indices of rip-relative instructions, in order */
+  rip_index_iterator rip_index_begin() const {
+    return rip_indices_.begin();
   }
-  /** Iterator over instruction offsets relative to function begin */
-  hex_offset_iterator hex_offset_end() const {
-    return hex_offsets_.end();
+  /** Iterator over indices of rip-relative instructions, in order */
+  rip_index_iterator rip_index_end() const {
+    return rip_indices_.end();
   }
 
   /** Iterator over hex sizes */
@@ -184,6 +185,7 @@ struct TUnit {
     code_.clear();
     hex_sizes_.clear();
     hex_offsets_.clear();
+    rip_indices_.clear();
   }
   /** Removes this instruction from the underlying code sequence; can cause invariants to fail */
   void remove(size_t index);
@@ -222,9 +224,11 @@ private:
   /** Global rip-offset targets */
   std::set<uint64_t> rip_offset_targets_;
   /** Hex offsets of every instruction relative to function begin */
-  std::vector<size_t> hex_offsets_;
+  OffsetTree hex_offsets_;
   /** Hex size of every instruction */
   std::vector<size_t> hex_sizes_;
+  /** Sorted indices of the instructions with a rip-relative operand */
+  std::vector<size_t> rip_indices_;
 
   /** User-provided maybe read set. */
   boost::optional<x64asm::RegSet> maybe_read_set_;
@@ -241,11 +245,17 @@ private:
 
   /** Recompute meta data from scratch */
   void recompute();
+  /** Recompute global rip-offset targets from the current code */
+  void recompute_rip_targets();
 
   /** Is there a rip offset at this index? */
   bool is_rip(size_t index) const;
   /** Adjust the rip offset at index i by delta */
   void adjust_rip(size_t index, int64_t delta);
+  /** Position of the first rip-relative instruction at or after index */
+  std::vector<size_t>::iterator rip_lower_bound(size_t index) {
+    return std::lower_bound(rip_indices_.begin(), rip_indices_.end(), index);
+  }
 
   /** Read a well-formatted function. */
   std::istream& read_formatted_text(std::istream& is);
@@ -17,6 +17,7 @@
 #include "src/symstate/memory/trivial.h"
 #include "src/validator/bounded.h"
 #include "src/validator/invariants/conjunction.h"
+#include "src/validator/invariants/false.h"
 #include "src/validator/invariants/memory_equality.h"
 #include "src/validator/invariants/state_equality.h"
 #include "src/validator/invariants/true.h"
@@ -64,6 +65,98 @@ bool BoundedValidator::verify_pair(const Cfg& target, const Cfg& rewrite, const
   return equiv;
 }
 
+namespace {
+
+size_t count_paths(const Cfg& cfg, size_t bound) {
+  CfgPathEnumerator paths(cfg, bound);
+  CfgPath p;
+  size_t count = 0;
+  while (paths.next(p))
+    count++;
+  return count;
+}
+
+}
+
+void BoundedValidator::learn_feasible_prefixes(const Cfg& target, const Cfg& rewrite) {
+  CfgPaths learner;
+  for (size_t i = 0; i < sandbox_->size(); ++i) {
+    CfgPath target_path;
+    CfgPath rewrite_path;
+    auto tc = *sandbox_->get_input(i);
+    if (!learner.learn_path(target_path, target, tc))
+      continue;
+    if (!learner.learn_path(rewrite_path, rewrite, tc))
+      continue;
+
+    for (auto it = target_path.begin(); it != target_path.end(); ++it)
+      feasible_target_.insert(CfgPath(target_path.begin(), it + 1));
+    for (auto it = rewrite_path.begin(); it != rewrite_path.end(); ++it)
+      feasible_pairs_.insert(make_pair(target_path, CfgPath(rewrite_path.begin(), it + 1)));
+  }
+
+  BOUNDED_DEBUG(cout << "[bv] learned " << feasible_target_.size() << " target prefixes and "
+                << feasible_pairs_.size() << " pair prefixes" << endl;)
+}
+
+bool BoundedValidator::ends_with_branch(const Cfg& cfg, const CfgPath& p) {
+  if (p.size() < 2)
+    return false;
+  auto last = p[p.size() - 2];
+  return distance(cfg.succ_begin(last), cfg.succ_end(last)) > 1;
+}
+
+bool BoundedValidator::is_infeasible_target(const CfgPath& p) {
+  if (!ends_with_branch(*current_target_, p))
+    return false;
+  if (feasible_target_.count(p))
+    return false;
+
+  Code nop_code;
+  nop_code.push_back(x64asm::Instruction(x64asm::NOP));
+  Cfg nop_cfg(nop_code);
+  CfgPath empty_path;
+  empty_path.push_back(1);
+
+  TrueInvariant _true;
+  FalseInvariant _false;
+
+  prefix_queries_++;
+  bool infeasible = check(*current_target_, nop_cfg, p, empty_path, _true, _false);
+  BOUNDED_DEBUG(if (infeasible) cout << "[bv] pruning target prefix " << p << endl;)
+  return infeasible;
+}
+
+bool BoundedValidator::is_infeasible_rewrite(const CfgPath& q) {
+  if (!ends_with_branch(*current_rewrite_, q))
+    return false;
+
+  // A prefix that can only go on to the exit is a complete path, and checking
+  // it as a pair costs about as much as the feasibility query.
+  auto last = q.back();
+  bool extensible = false;
+  for (auto it = current_rewrite_->succ_begin(last), ie = current_rewrite_->succ_end(last); it != ie; ++it)
+    if (*it != current_rewrite_->get_exit())
+      extensible = true;
+  if (!extensible)
+    return false;
+
+  if (feasible_pairs_.count(make_pair(*current_target_path_, q)))
+    return false;
+
+  StateEqualityInvariant assume_state(current_target_->def_ins());
+  MemoryEqualityInvariant memory_equal;
+  ConjunctionInvariant assume;
+  assume.add_invariant(&assume_state);
+  assume.add_invariant(&memory_equal);
+
+  FalseInvariant _false;
+
+  prefix_queries_++;
+  bool infeasible = check(*current_target_, *current_rewrite_, *current_target_path_, q, assume, _false);
+  BOUNDED_DEBUG(if (infeasible) cout << "[bv] pruning rewrite prefix " << q << " for " << *current_target_path_ << endl;)
+  return infeasible;
+}
 
 
 bool BoundedValidator::verify(const Cfg& init_target, const Cfg& init_rewrite) {
@@ -75,9 +168,6 @@ bool BoundedValidator::verify(const Cfg& init_target, const Cfg& init_rewrite) {
   // State
   counterexamples_.clear();
 
-  vector<CfgPath> target_paths;
-  vector<CfgPath> rewrite_paths;
-
   has_error_ = false;
   init_mm();
 
@@ -89,35 +179,39 @@ bool BoundedValidator::verify(const Cfg& init_target, const Cfg& init_rewrite) {
     // Step 0: Background checks
     sanity_checks(target, rewrite);
 
-    // Step 1: get all the paths from the enumerator
-    for (auto path : CfgPaths::enumerate_paths(target, bound_)) {
-      //cout << "adding TP: " << path << endl;
-      target_paths.push_back(path);
-    }
-    //cout << "REWRITE: " << endl << rewrite.get_code() << endl;
-    for (auto path : CfgPaths::enumerate_paths(rewrite, bound_)) {
-      //cout << "adding RP: " << path << endl;
-      rewrite_paths.push_back(path);
-    }
-
-    // Handle the shorter paths first, please
-    // [helps find counterexamples sooner]
-    auto by_length = [](const CfgPath& lhs, const CfgPath& rhs) {
-      return lhs.size() < rhs.size();
-    };
-    sort(target_paths.begin(), target_paths.end(), by_length);
-    sort(rewrite_paths.begin(), rewrite_paths.end(), by_length);
-
-    // Step 2: check each pair of paths
+    // Step 1: find the prefixes that the testcases execute; these are feasible
+    // and never need a query.
+    pairs_checked_ = 0;
+    pairs_skipped_ = 0;
+    prefix_queries_ = 0;
+    feasible_target_.clear();
+    feasible_pairs_.clear();
+    current_target_ = &target;
+    current_rewrite_ = &rewrite;
+    if (prune_infeasible_ && sandbox_)
+      learn_feasible_prefixes(target, rewrite);
+
+    // Step 2: check each pair of paths.  Paths are enumerated lazily, shortest
+    // first [helps find counterexamples sooner]; the rewrite paths are
+    // re-enumerated for each target path rather than kept around.  Prefixes
+    // that can't execute are pruned along with everything extending them.
     bool ok = true;
-    size_t total = target_paths.size() * rewrite_paths.size();
-    size_t count = 0;
-    for (auto target_path : target_paths) {
-      for (auto rewrite_path : rewrite_paths) {
+    size_t pruned = 0;
+    CfgPathEnumerator target_paths(target, bound_);
+    if (prune_infeasible_)
+      target_paths.set_prune_callback(prune_target, this);
+    CfgPath target_path;
+    while (target_paths.next(target_path)) {
+      current_target_path_ = &target_path;
+      CfgPathEnumerator rewrite_paths(rewrite, bound_);
+      if (prune_infeasible_)
+        rewrite_paths.set_prune_callback(prune_rewrite, this);
+      CfgPath rewrite_path;
+      while (rewrite_paths.next(rewrite_path)) {
 
         BOUNDED_DEBUG(cout << "[bv] Checking pair: " << target_path << "; " << rewrite_path << endl;)
 
-        count++;
+        pairs_checked_++;
         ok &= verify_pair(target, rewrite, target_path, rewrite_path);
 
         // Case 1: verify failed and we have ceg; return false
@@ -127,9 +221,19 @@ bool BoundedValidator::verify(const Cfg& init_target, const Cfg& init_rewrite) {
         if (bailout_ && !ok && counterexamples_.size() > 0)
           break;
       }
+      pruned += rewrite_paths.num_pruned();
       if (bailout_ && !ok && counterexamples_.size() > 0)
         break;
     }
+    pruned += target_paths.num_pruned();
+    current_target_path_ = NULL;
+
+    if (pruned > 0 && !(bailout_ && !ok && counterexamples_.size() > 0)) {
+      auto total = count_paths(target, bound_) * count_paths(rewrite, bound_);
+      pairs_skipped_ = total > pairs_checked_ ? total - pairs_checked_ : 0;
+    }
+    BOUNDED_DEBUG(cout << "[bv] checked " << pairs_checked_ << " pairs, skipped " << pairs_skipped_
+                  << " with " << prefix_queries_ << " prefix queries" << endl;)
 
     reset_mm();
     return ok;
@@ -16,6 +16,7 @@
 #define STOKE_SRC_VALIDATOR_BOUNDED_H
 
 #include <iostream>
+#include <set>
 #include <vector>
 #include <string>
 
@@ -37,11 +38,14 @@ class BoundedValidator : public ObligationChecker {
 
 public:
 
-  BoundedValidator(SMTSolver& solver) : ObligationChecker(solver), target_final_state_(), rewrite_final_state_() {
+  BoundedValidator(SMTSolver& solver) : ObligationChecker(solver), target_final_state_(), rewrite_final_state_(),
+    pairs_checked_(0), pairs_skipped_(0), prefix_queries_(0),
+    current_target_(NULL), current_rewrite_(NULL), current_target_path_(NULL) {
     set_bound(2);
     set_alias_strategy(AliasStrategy::STRING);
     set_nacl(false);
     set_no_bailout(false);
+    set_prune_infeasible(true);
     set_sandbox(NULL);
   }
 
@@ -66,9 +70,32 @@ public:
     return *this;
   }
 
+  /** If set, look for path prefixes that can't be executed (alone for the
+    target, together with the target path for the rewrite) and skip all path
+    pairs that extend them.  Prefixes taken by the sandbox testcases are known
+    to be feasible and never queried. */
+  BoundedValidator& set_prune_infeasible(bool b) {
+    prune_infeasible_ = b;
+    return *this;
+  }
+
   /** Evalue if the target and rewrite are the same */
   bool verify(const Cfg& target, const Cfg& rewrite);
 
+  /** Number of path pairs checked with the solver in the last verify(). */
+  size_t get_pairs_checked() const {
+    return pairs_checked_;
+  }
+  /** Number of path pairs skipped in the last verify() because they extend an
+    infeasible prefix.  Only exact if verify() didn't bail out early. */
+  size_t get_pairs_skipped() const {
+    return pairs_skipped_;
+  }
+  /** Number of feasibility queries for prefixes in the last verify(). */
+  size_t get_prefix_queries() const {
+    return prefix_queries_;
+  }
+
   /** Make testcases for a target. */
   std::vector<CpuState> make_testcases(const Cfg& target);
 
@@ -104,10 +131,45 @@ private:
   size_t bound_;
   /** Should we bailout early? */
   bool bailout_;
+  /** Should we skip pairs extending infeasible prefixes? */
+  bool prune_infeasible_;
+
+  /** Statistics for the last verify() */
+  size_t pairs_checked_;
+  size_t pairs_skipped_;
+  size_t prefix_queries_;
+
+  /** Target/rewrite of the current verify(), for the prune callbacks. */
+  const Cfg* current_target_;
+  const Cfg* current_rewrite_;
+  /** The target path the rewrite paths are currently paired with. */
+  const CfgPath* current_target_path_;
+
+  /** Target path prefixes executed by some testcase. */
+  std::set<CfgPath> feasible_target_;
+  /** (target path, rewrite path prefix) pairs executed by some testcase. */
+  std::set<std::pair<CfgPath, CfgPath>> feasible_pairs_;
 
   /** Verify a pair of paths. */
   bool verify_pair(const Cfg& target, const Cfg& rewrite, const CfgPath& p, const CfgPath& q);
 
+  /** Run the testcases in the sandbox and record the prefixes they take. */
+  void learn_feasible_prefixes(const Cfg& target, const Cfg& rewrite);
+  /** Is the target prefix infeasible (for any input)? */
+  bool is_infeasible_target(const CfgPath& p);
+  /** Is the rewrite prefix infeasible together with the current target path? */
+  bool is_infeasible_rewrite(const CfgPath& q);
+  /** Is this prefix worth a query?  It must end right after a branch. */
+  static bool ends_with_branch(const Cfg& cfg, const CfgPath& p);
+
+  /** Prune callbacks for CfgPathEnumerator; 'arg' is the validator. */
+  static bool prune_target(const CfgPath& p, void* arg) {
+    return static_cast<BoundedValidator*>(arg)->is_infeasible_target(p);
+  }
+  static bool prune_rewrite(const CfgPath& q, void* arg) {
+    return static_cast<BoundedValidator*>(arg)->is_infeasible_rewrite(q);
+  }
+
   /** The set of counterexamples (one per pair) that we've found. */
   std::vector<CpuState> counterexamples_;
 
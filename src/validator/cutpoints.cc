@@ -76,14 +76,11 @@ void Cutpoints::compute() {
   CfgSccs rewrite_sccs(rewrite_);
 
   // Collect data
+  target_traces_.clear();
+  rewrite_traces_.clear();
   for (size_t i = 0; i < sandbox_.size(); ++i) {
-    vector<TracePoint> trace;
-    mine_data(target_, i, trace);
-    target_traces_.push_back(trace);
-
-    trace.clear();
-    mine_data(rewrite_, i, trace);
-    rewrite_traces_.push_back(trace);
+    mine_data(target_, i, target_traces_);
+    mine_data(rewrite_, i, rewrite_traces_);
   }
 
   // Get all the possible cutpoint options.
@@ -107,8 +104,8 @@ void Cutpoints::compute() {
   DEBUG_CUTPOINTS(
     cout << "Total options: " << computed_cutpoints.size() << endl;
     cout << "Viable options: " << cutpoint_options_.size() << endl;
-    cout << "Target traces: " << target_traces_.size() << endl;
-    cout << "Rewrite traces: " << rewrite_traces_.size() << endl;
+    cout << "Target traces: " << target_traces_.trace_count() << endl;
+    cout << "Rewrite traces: " << rewrite_traces_.trace_count() << endl;
     size_t cutpt_option;
     /*
     do {
@@ -225,7 +222,7 @@ vector<Cutpoints::CutpointList> Cutpoints::get_possible_cutpoints() {
 
 
 
-void Cutpoints::mine_data(const Cfg& cfg, size_t testcase, std::vector<TracePoint>& trace) {
+void Cutpoints::mine_data(const Cfg& cfg, size_t testcase, TraceStore& traces) {
 
   size_t index;
   auto label = cfg.get_function().get_leading_label();
@@ -234,6 +231,7 @@ void Cutpoints::mine_data(const Cfg& cfg, size_t testcase, std::vector<TracePoin
   sandbox_.set_entrypoint(label);
 
   std::vector<CallbackParam*> to_free;
+  traces.begin_trace(*sandbox_.get_input(testcase));
 
   for (Cfg::id_type block = cfg.get_entry(); block != cfg.get_exit(); block++) {
 
@@ -241,17 +239,15 @@ void Cutpoints::mine_data(const Cfg& cfg, size_t testcase, std::vector<TracePoin
     to_free.push_back(cp);
 
     cp->block_id = block;
-    cp->trace = &trace;
+    cp->traces = &traces;
 
     bool has_jump = ends_with_jump(cfg, block);
 
     if (block == cfg.get_entry()) {
       // Don't run sandbox; callback manually.  This is to avoid repeated calls to the callback for jumps back to the
       // beginning of the loop... which is not what we want in general.
-      TracePoint tp;
-      tp.block_id = block;
-      tp.cs = *sandbox_.get_input(testcase);
-      trace.push_back(tp);
+      auto input = *sandbox_.get_input(testcase);
+      traces.record(block, input);
 
     } else if (has_jump) {
       index = cfg.get_index(Cfg::loc_type(block, cfg.num_instrs(block)-1));
@@ -283,25 +279,20 @@ bool Cutpoints::ends_with_jump(const Cfg& cfg, Cfg::id_type block) {
 }
 
 void Cutpoints::callback(const StateCallbackData& data, void* arg) {
-  auto args = *((CallbackParam*)arg);
-
-  TracePoint tp;
-  tp.block_id = args.block_id;
-  tp.cs = data.state;
-
-  args.trace->push_back(tp);
+  auto args = (CallbackParam*)arg;
+  args->traces->record(args->block_id, data.state);
 }
 
 
 /** Take an execution trace and extract the cutpoints/data that have been visited. */
-vector<Cutpoints::TracePoint> Cutpoints::filter_cutpoints(vector<TracePoint>& trace, vector<Cfg::id_type>& basic_blocks) {
+vector<size_t> Cutpoints::filter_cutpoints(const TraceStore& traces, size_t trace, vector<Cfg::id_type>& basic_blocks) {
 
-  vector<TracePoint> results;
+  vector<size_t> results;
 
-  for (auto state : trace) {
+  for (auto point : traces.get_trace(trace)) {
     for (auto candidate : basic_blocks) {
-      if (candidate == state.block_id) {
-        results.push_back(state);
+      if (candidate == traces.get_block(point)) {
+        results.push_back(point);
       }
     }
   }
@@ -309,9 +300,9 @@ vector<Cutpoints::TracePoint> Cutpoints::filter_cutpoints(vector<TracePoint>& tr
 }
 
 /** Find the cutpoint number that a particular trace point / basic block corresponds to */
-size_t Cutpoints::which_cutpoint(TracePoint pt, vector<Cfg::id_type>& basic_blocks) {
+size_t Cutpoints::which_cutpoint(Cfg::id_type block, vector<Cfg::id_type>& basic_blocks) {
   for (size_t i = 0; i < basic_blocks.size(); ++i) {
-    if (pt.block_id == basic_blocks[i]) {
+    if (block == basic_blocks[i]) {
       return i;
     }
   }
@@ -332,17 +323,14 @@ bool Cutpoints::check_cutpoints(CutpointList& cutpoints) {
   // (iv)  no infinite paths that don't have cutpoint
 
   /** Sanity check: there are as many target traces as rewrite traces. */
-  assert(target_traces_.size() == rewrite_traces_.size());
+  assert(target_traces_.trace_count() == rewrite_traces_.trace_count());
   /** Sanity check: as many cutpoints in target/rewrite */
   assert(cutpoints.first.size() == cutpoints.second.size());
 
   /** The main checks */
-  for (size_t i = 0; i < target_traces_.size(); ++i) {
-    auto target_trace = target_traces_[i];
-    auto rewrite_trace = rewrite_traces_[i];
-
-    auto target_cut_trace = filter_cutpoints(target_trace, cutpoints.first);
-    auto rewrite_cut_trace = filter_cutpoints(rewrite_trace, cutpoints.second);
+  for (size_t i = 0; i < target_traces_.trace_count(); ++i) {
+    auto target_cut_trace = filter_cutpoints(target_traces_, i, cutpoints.first);
+    auto rewrite_cut_trace = filter_cutpoints(rewrite_traces_, i, cutpoints.second);
 
     // check (i)
     if (target_cut_trace.size() != rewrite_cut_trace.size()) {
@@ -351,42 +339,19 @@ bool Cutpoints::check_cutpoints(CutpointList& cutpoints) {
       return false;
     }
 
-    // check (ii)
+    // check (ii); both traces start from the same testcase, so comparing what
+    // each changed is enough.
     for (size_t j = 0; j < target_cut_trace.size(); ++j) {
-      auto target_pt = target_cut_trace[j];
-      auto rewrite_pt = rewrite_cut_trace[j];
-
-      if (target_pt.cs.heap != rewrite_pt.cs.heap) {
+      if (!TraceStore::same_memory(target_traces_, target_cut_trace[j], rewrite_traces_, rewrite_cut_trace[j])) {
         DEBUG_CUTPOINTS(cout << "On trace " << i << " target/rewrite disagree on memory." << endl;)
         return false;
       }
-      if (target_pt.cs.stack != rewrite_pt.cs.stack) {
-        DEBUG_CUTPOINTS(cout << "On trace " << i << " target/rewrite disagree on memory." << endl;)
-        return false;
-      }
-      if (target_pt.cs.data != rewrite_pt.cs.data) {
-        DEBUG_CUTPOINTS(cout << "On trace " << i << " target/rewrite disagree on memory." << endl;)
-        return false;
-      }
-      if (target_pt.cs.segments.size() != rewrite_pt.cs.segments.size()) {
-        DEBUG_CUTPOINTS(cout << "On trace " << i << " target/rewrite disagree on memory." << endl;)
-        return false;
-      }
-      for (size_t k = 0; k < target_pt.cs.segments.size(); ++k) {
-        if (target_pt.cs.segments[k] != rewrite_pt.cs.segments[k]) {
-          DEBUG_CUTPOINTS(cout << "On trace " << i << " target/rewrite disagree on memory." << endl;)
-          return false;
-        }
-      }
     }
 
     // check (iii)
     for (size_t j = 0; j < target_cut_trace.size(); ++j) {
-      auto target_pt = target_cut_trace[j];
-      auto rewrite_pt = rewrite_cut_trace[j];
-
-      int target_cutpt = which_cutpoint(target_pt, cutpoints.first);
-      int rewrite_cutpt = which_cutpoint(rewrite_pt, cutpoints.second);
+      int target_cutpt = which_cutpoint(target_traces_.get_block(target_cut_trace[j]), cutpoints.first);
+      int rewrite_cutpt = which_cutpoint(rewrite_traces_.get_block(rewrite_cut_trace[j]), cutpoints.second);
 
       assert(target_cutpt != -1);
       assert(rewrite_cutpt != -1);
@@ -17,6 +17,7 @@
 
 #include "src/cfg/cfg.h"
 #include "src/sandbox/sandbox.h"
+#include "src/validator/trace_store.h"
 
 #include <vector>
 #include <map>
@@ -36,34 +37,31 @@ public:
     compute();
   }
 
-  /** Get testcases representing the data at a given cutpoint. */
-  std::vector<CpuState> data_at(size_t cutpt, bool is_rewrite) {
-    std::vector<CpuState> results;
-
-    auto chosen_cutpoints = cutpoint_options_[pos_];
-    auto cutpoints = is_rewrite ? chosen_cutpoints.second : chosen_cutpoints.first;
+  /** Get the trace points representing the data at a given cutpoint.  These
+    index into get_traces(is_rewrite); the target and rewrite lists line up. */
+  const std::vector<size_t>& data_at(size_t cutpt, bool is_rewrite) {
+    auto& chosen_cutpoints = cutpoint_options_[pos_];
+    auto& cutpoints = is_rewrite ? chosen_cutpoints.second : chosen_cutpoints.first;
     auto blk = cutpoints[cutpt];
 
-    auto& traces = is_rewrite ? rewrite_traces_ : target_traces_;
-    for (auto trace : traces) {
-      for (auto entry : trace) {
-        if (entry.block_id == blk) {
-          results.push_back(entry.cs);
-        }
-      }
-    }
+    auto& results = get_traces(is_rewrite).at_block(blk);
 
 #ifdef DEBUG_CUTPOINTS_DATA
     std::cout << "At cutpt " << cutpt << " the " << (is_rewrite ? "rewrite" : "target") << " has "
               << results.size() << " states." << std::endl;
     std::cout << "   (this is at block " << blk << ")" << std::endl;
     for (auto it : results)
-      std::cout << it << std::endl;
+      std::cout << get_traces(is_rewrite).get_state(it) << std::endl;
 #endif
 
     return results;
   }
 
+  /** Get the traces of the target or rewrite on all the testcases. */
+  const TraceStore& get_traces(bool is_rewrite) const {
+    return is_rewrite ? rewrite_traces_ : target_traces_;
+  }
+
   /** Get cutpoint locations. */
   std::vector<Cfg::id_type> target_cutpoint_locations() {
     return cutpoint_options_[pos_].first;
@@ -110,11 +108,6 @@ public:
 
 private:
 
-  struct TracePoint {
-    Cfg::id_type block_id;
-    CpuState cs;
-  };
-
   /** This data structure represents a list of target/rewrite cutpoints */
   typedef std::pair<std::vector<Cfg::id_type>, std::vector<Cfg::id_type>> CutpointList;
 
@@ -122,8 +115,8 @@ private:
    * "ANSWER STORAGE" data structures below. */
   void compute();
 
-  /** Get a complete trace from running the Cfg on a testcase and save into 'trace' */
-  void mine_data(const Cfg& cfg, size_t testcase, std::vector<TracePoint>& trace);
+  /** Get a complete trace from running the Cfg on a testcase and add it to 'traces' */
+  void mine_data(const Cfg& cfg, size_t testcase, TraceStore& traces);
 
   /** Get a list of all possible sets of cutpoints. */
   std::vector<CutpointList> get_possible_cutpoints();
@@ -138,11 +131,11 @@ private:
   static bool ends_with_jump(const Cfg& cfg, Cfg::id_type block);
 
 
-  /** Helper function:  Get the cutpoints out of a trace. */
-  std::vector<Cutpoints::TracePoint> filter_cutpoints(std::vector<TracePoint>& trace, std::vector<Cfg::id_type>& basic_blocks);
+  /** Helper function:  Get the points of a trace at cutpoints. */
+  std::vector<size_t> filter_cutpoints(const TraceStore& traces, size_t trace, std::vector<Cfg::id_type>& basic_blocks);
 
-  /** Helper function: Find the cutpoint number that a particular trace point / basic block corresponds to */
-  size_t which_cutpoint(TracePoint pt, std::vector<Cfg::id_type>& basic_blocks);
+  /** Helper function: Find the cutpoint number that a particular basic block corresponds to */
+  size_t which_cutpoint(Cfg::id_type block, std::vector<Cfg::id_type>& basic_blocks);
 
   /** For debugging: print a set of cutpoints of the target / rewrite */
   void print_option(Cutpoints::CutpointList& option);
@@ -153,8 +146,8 @@ private:
   Cfg rewrite_;
   Sandbox sandbox_;
 
-  std::vector<std::vector<TracePoint>> target_traces_;
-  std::vector<std::vector<TracePoint>> rewrite_traces_;
+  TraceStore target_traces_;
+  TraceStore rewrite_traces_;
 
   ////////////////////////////// ANSWER STORAGE ////////////////////////////////
 
@@ -167,7 +160,7 @@ private:
 
   struct CallbackParam {
     Cfg::id_type block_id;
-    std::vector<TracePoint>* trace;
+    TraceStore* traces;
   };
 
   /** The callback used for gathering data from each of the cutpoints */
@@ -34,7 +34,10 @@
 #include "src/validator/invariants/true.h"
 
 #include <algorithm>
+#include <atomic>
+#include <exception>
 #include <set>
+#include <thread>
 
 // this is configurable via build system
 #ifdef STOKE_DEBUG_DDEC
@@ -49,6 +52,51 @@ using namespace std;
 using namespace stoke;
 using namespace x64asm;
 
+namespace {
+
+/** Runs fn(task, thread) for every task on up to 'threads' threads, where
+  'thread' says which worker to use.  Once fn returns false no new tasks are
+  started.  If tasks throw, the exception of the lowest task is rethrown. */
+template <typename F>
+void run_parallel(size_t tasks, size_t threads, F fn) {
+  threads = min(threads, tasks);
+  if (threads <= 1) {
+    for (size_t t = 0; t < tasks; ++t)
+      if (!fn(t, 0))
+        break;
+    return;
+  }
+
+  atomic<size_t> next(0);
+  atomic<bool> stop(false);
+  vector<exception_ptr> errors(tasks);
+
+  auto work = [&](size_t thread) {
+    for (size_t t = next++; t < tasks && !stop; t = next++) {
+      try {
+        if (!fn(t, thread))
+          stop = true;
+      } catch (...) {
+        errors[t] = current_exception();
+        stop = true;
+      }
+    }
+  };
+
+  vector<std::thread> pool;
+  for (size_t i = 1; i < threads; ++i)
+    pool.push_back(std::thread(work, i));
+  work(0);
+  for (auto& it : pool)
+    it.join();
+
+  for (auto& it : errors)
+    if (it)
+      rethrow_exception(it);
+}
+
+} // namespace
+
 void DdecValidator::print_summary(const vector<ConjunctionInvariant*>& invariants) {
   cout << hex << endl;
   cout << endl << "*********************************************************************";
@@ -125,6 +173,18 @@ vector<ConjunctionInvariant*> DdecValidator::find_invariants(const Cfg& target,
   auto target_cuts = cutpoints_->target_cutpoint_locations();
   auto rewrite_cuts = cutpoints_->rewrite_cutpoint_locations();
 
+  // The cutpoints in the middle only read the traces, so learn them in parallel
+  vector<size_t> middle;
+  for (size_t i = 0; i < target_cuts.size(); ++i)
+    if (target_cuts[i] != target.get_entry() && target_cuts[i] != target.get_exit())
+      middle.push_back(i);
+
+  vector<ConjunctionInvariant*> learned(target_cuts.size());
+  run_parallel(middle.size(), workers_.size(), [&](size_t t, size_t thread) {
+    learned[middle[t]] = learn_disjunction_invariant(target, rewrite, middle[t]);
+    return true;
+  });
+
   // Learn invariants based on the data we have
   invariants.clear();
   for (size_t i = 0; i < target_cuts.size(); ++i) {
@@ -153,7 +213,7 @@ vector<ConjunctionInvariant*> DdecValidator::find_invariants(const Cfg& target,
 
       invariants.push_back(end);
     } else {
-      auto inv = learn_disjunction_invariant(target, rewrite, i);
+      auto inv = learned[i];
       invariants.push_back(inv);
       DDEC_DEBUG(cout << "[ddec] Learned invariant @ i=" << i << endl;)
       DDEC_DEBUG(cout << *inv << endl;)
@@ -165,14 +225,46 @@ vector<ConjunctionInvariant*> DdecValidator::find_invariants(const Cfg& target,
 }
 
 
+void DdecValidator::make_workers() {
+  free_workers();
+  workers_.push_back(this);
+
+  for (size_t i = 1; i < threads_; ++i) {
+    auto solver = solver_.clone();
+    if (!solver)
+      break;
+
+    auto worker = new ObligationChecker(*solver);
+    worker->copy_settings(*this);
+
+    worker_solvers_.push_back(solver);
+    workers_.push_back(worker);
+  }
+}
+
+void DdecValidator::free_workers() {
+  for (size_t i = 1; i < workers_.size(); ++i)
+    delete workers_[i];
+  for (auto it : worker_solvers_)
+    delete it;
+  workers_.clear();
+  worker_solvers_.clear();
+}
+
+void DdecValidator::forget_obligations(size_t cutpoint, const Invariant* removed) {
+  for (auto it = obligation_cache_.begin(); it != obligation_cache_.end(); ) {
+    if (it->first.i == cutpoint || it->first.prove == removed)
+      it = obligation_cache_.erase(it);
+    else
+      ++it;
+  }
+}
+
 void DdecValidator::make_tcs(const Cfg& target, const Cfg& rewrite) {
 
   if (no_bv_) //if not using the bounded validator for testcases, skip this entirely.
     return;
 
-  auto target_paths = CfgPaths::enumerate_paths(target, bound_);
-  auto rewrite_paths = CfgPaths::enumerate_paths(rewrite, bound_);
-
   Code nop_code;
   nop_code.push_back(x64asm::Instruction(x64asm::NOP));
   Cfg nop_cfg(nop_code);
@@ -182,14 +274,17 @@ void DdecValidator::make_tcs(const Cfg& target, const Cfg& rewrite) {
   FalseInvariant _false;
   TrueInvariant _true;
 
-  for (auto p : target_paths) {
+  CfgPath p;
+  CfgPathEnumerator target_paths(target, bound_);
+  while (target_paths.next(p)) {
     DDEC_DEBUG(cout << "Trying path " << p << " ; on target" << endl;)
     bool equiv = check(target, nop_cfg, p, empty_path, _true, _false);
     if (!equiv && checker_has_ceg()) {
       sandbox_->insert_input(checker_get_target_ceg());
     }
   }
-  for (auto p : rewrite_paths) {
+  CfgPathEnumerator rewrite_paths(rewrite, bound_);
+  while (rewrite_paths.next(p)) {
     DDEC_DEBUG(cout << "Trying path " << p << " ; on rewrite" << endl;)
     bool equiv = check(rewrite, nop_cfg, p, empty_path, _true, _false);
     if (!equiv && checker_has_ceg()) {
@@ -203,6 +298,9 @@ void DdecValidator::make_tcs(const Cfg& target, const Cfg& rewrite) {
 bool DdecValidator::verify(const Cfg& init_target, const Cfg& init_rewrite) {
 
   init_mm();
+  obligation_cache_.clear();
+  obligations_checked_ = 0;
+  obligation_cache_hits_ = 0;
 
   auto target = inline_functions(init_target);
   auto rewrite = inline_functions(init_rewrite);
@@ -215,6 +313,7 @@ bool DdecValidator::verify(const Cfg& init_target, const Cfg& init_rewrite) {
     sanity_checks(target, rewrite);
 
     make_tcs(target, rewrite);
+    make_workers();
 
     DDEC_TC_DEBUG(
       cout << "DDEC sandbox at " << sandbox_ << endl;
@@ -238,6 +337,7 @@ bool DdecValidator::verify(const Cfg& init_target, const Cfg& init_rewrite) {
     // Loop over choices of cutpoints
     while (true) {
 
+      obligation_cache_.clear();
       auto invariants = find_invariants(target, rewrite);
       DDEC_DEBUG(cout << "Got initial invariants " << invariants.size() << endl;)
       if (!invariants.size()) {
@@ -252,6 +352,8 @@ bool DdecValidator::verify(const Cfg& init_target, const Cfg& init_rewrite) {
 
         failed_invariants.clear();
         bool success = check_proof(target, rewrite, invariants, failed_invariants);
+        DDEC_DEBUG(cout << "[ddec] obligations checked: " << dec << obligations_checked_
+                   << ", cache hits: " << obligation_cache_hits_ << endl;)
         if (success) {
           reset_mm();
           return true;
@@ -271,6 +373,7 @@ bool DdecValidator::verify(const Cfg& init_target, const Cfg& init_rewrite) {
               continue;
             last = *it;
             DDEC_DEBUG(cout << "Removing " << *(*invariants[i])[*it] << endl;)
+            forget_obligations(i, (*invariants[i])[*it]);
             invariants[i]->remove(*it);
             made_a_change = true;
           }
@@ -344,7 +447,11 @@ bool DdecValidator::check_proof(const Cfg& target, const Cfg& rewrite, const vec
       DDEC_DEBUG(cout << "cutpoint blocks: " << target_cuts[i] << "  (and)  " << rewrite_cuts[j] << endl;)
 
       // 2. P in Paths_T(i, j), Q in Paths_R(i, j) => inv(i) { P; Q } inv(j)
-      bool success = true;
+      // The obligations are independent, so they are checked on all threads;
+      // failures are recorded in the order the serial loops would find them,
+      // which keeps the Houdini loop deterministic.
+      vector<pair<CfgPath, CfgPath>> path_pairs;
+      vector<ConjunctionInvariant> assumptions;
       for (auto p : target_paths_ij) {
         auto target_jump_inv = get_jump_inv(target, p, false);
         if (target.num_instrs(target_cuts[i]))
@@ -358,29 +465,52 @@ bool DdecValidator::check_proof(const Cfg& target, const Cfg& rewrite, const vec
           copy.add_invariant(target_jump_inv);
           copy.add_invariant(rewrite_jump_inv);
 
-          auto end_inv = static_cast<ConjunctionInvariant*>(invariants[j]);
-          /*
-          for(size_t k = 0; k < end_inv->size(); ++k) {
-            auto my_inv = (*end_inv)[k];
-            cout << endl << endl << "WORKING ON " << *my_inv << endl << endl;
-            bool ok = bv.verify_pair(target, rewrite, p, q, *invariants[i], *my_inv);
-            if(!ok)
-              return false;
-          }
-          */
+          path_pairs.push_back(make_pair(p, q));
+          assumptions.push_back(copy);
+        }
+      }
+
+      auto end_inv = static_cast<ConjunctionInvariant*>(invariants[j]);
+      auto end_size = end_inv->size();
+      vector<char> holds(path_pairs.size() * end_size);
+
+      // Only check what earlier rounds of the Houdini loop haven't
+      vector<ObligationKey> keys;
+      vector<size_t> todo;
+      for (size_t t = 0; t < holds.size(); ++t) {
+        auto& pq = path_pairs[t / end_size];
+        keys.push_back({i, j, j, pq.first, pq.second, (*end_inv)[t % end_size]});
+        auto it = obligation_cache_.find(keys.back());
+        if (it != obligation_cache_.end()) {
+          holds[t] = it->second;
+          obligation_cache_hits_++;
+        } else {
+          todo.push_back(t);
+        }
+      }
 
-          for (size_t m = 0; m < end_inv->size(); ++m) {
+      run_parallel(todo.size(), workers_.size(), [&](size_t x, size_t thread) {
+        auto t = todo[x];
+        auto& pq = path_pairs[t / end_size];
+        auto& copy = assumptions[t / end_size];
+        auto m = t % end_size;
 
-            DDEC_DEBUG(cout << "Checking " << copy << " { " << p << " ; " << q << " } "
-                       << *(*end_inv)[m] << endl;)
+        DDEC_DEBUG(cout << "Checking " << copy << " { " << pq.first << " ; " << pq.second << " } "
+                   << *(*end_inv)[m] << endl;)
 
-            bool equiv = check(target, rewrite, p, q, copy, *(*end_inv)[m]);
-            if (!equiv) {
-              failed_invariants[j].push_back(m);
-              success = false;
-            }
-          }
+        holds[t] = workers_[thread]->check(target, rewrite, pq.first, pq.second, copy, *(*end_inv)[m]);
+        return true;
+      });
 
+      obligations_checked_ += todo.size();
+      for (auto t : todo)
+        obligation_cache_[keys[t]] = holds[t];
+
+      bool success = true;
+      for (size_t t = 0; t < holds.size(); ++t) {
+        if (!holds[t]) {
+          failed_invariants[j].push_back(t % end_size);
+          success = false;
         }
       }
       if (!success) {
@@ -389,6 +519,9 @@ bool DdecValidator::check_proof(const Cfg& target, const Cfg& rewrite, const vec
       }
 
       // 3. P \in Paths_T(i, j), Q \in Paths_R(i, k) => inv(i) { P ; Q } false
+      vector<size_t> false_cutpoints;
+      path_pairs.clear();
+      assumptions.clear();
       for (size_t k = 0; k < rewrite_cuts.size(); ++k) {
         if (j == k)
           continue;
@@ -411,17 +544,55 @@ bool DdecValidator::check_proof(const Cfg& target, const Cfg& rewrite, const vec
             copy.add_invariant(target_jump_inv);
             copy.add_invariant(rewrite_jump_inv);
 
-            DDEC_DEBUG(cout << "Checking for cpt " << i << " -> " << j << " against " << i << " -> " << k << endl;)
-            DDEC_DEBUG(cout << "Checking " << copy << " { " << p << " ; " << q << " } false " << endl;)
-            FalseInvariant fi;
-            bool equiv = check(target, rewrite, p, q, copy, fi);
-            if (!equiv) {
-              DDEC_DEBUG(print_summary(invariants);)
-              return false;
-            }
+            false_cutpoints.push_back(k);
+            path_pairs.push_back(make_pair(p, q));
+            assumptions.push_back(copy);
           }
         }
       }
+
+      keys.clear();
+      todo.clear();
+      bool infeasible = true;
+      for (size_t t = 0; t < path_pairs.size() && infeasible; ++t) {
+        keys.push_back({i, j, false_cutpoints[t], path_pairs[t].first, path_pairs[t].second, NULL});
+        auto it = obligation_cache_.find(keys.back());
+        if (it != obligation_cache_.end()) {
+          infeasible = it->second;
+          obligation_cache_hits_++;
+        } else {
+          todo.push_back(t);
+        }
+      }
+
+      // Any failure is enough here, so stop handing out work after the first.
+      // Obligations that never ran are left as 2 and not cached.
+      vector<char> results(path_pairs.size(), 2);
+      if (infeasible) {
+        run_parallel(todo.size(), workers_.size(), [&](size_t x, size_t thread) {
+          auto t = todo[x];
+          auto& pq = path_pairs[t];
+          auto& copy = assumptions[t];
+
+          DDEC_DEBUG(cout << "Checking for cpt " << i << " -> " << j << " against " << i << " -> " << false_cutpoints[t] << endl;)
+          DDEC_DEBUG(cout << "Checking " << copy << " { " << pq.first << " ; " << pq.second << " } false " << endl;)
+          FalseInvariant fi;
+          results[t] = workers_[thread]->check(target, rewrite, pq.first, pq.second, copy, fi);
+          return (bool)results[t];
+        });
+
+        for (auto t : todo) {
+          if (results[t] == 2)
+            continue;
+          obligations_checked_++;
+          obligation_cache_[keys[t]] = results[t];
+          infeasible &= results[t];
+        }
+      }
+      if (!infeasible) {
+        DDEC_DEBUG(print_summary(invariants);)
+        return false;
+      }
     }
   }
 
@@ -517,11 +688,15 @@ ConjunctionInvariant* simplify_disjunction(DisjunctionInvariant& disjs) {
 
 ConjunctionInvariant* DdecValidator::learn_disjunction_invariant(const Cfg& target, const Cfg& rewrite, size_t cutpoint) {
 
-  /** Lets get out the relevant data here... */
-  vector<CpuState> target_states = cutpoints_->data_at(cutpoint, false);
-  vector<CpuState> rewrite_states = cutpoints_->data_at(cutpoint, true);
+  /** Lets get out the relevant data here.  The invariants are learned from
+    the trace store directly; see learn_simple_invariant(). */
+  auto& target_traces = cutpoints_->get_traces(false);
+  auto& rewrite_traces = cutpoints_->get_traces(true);
+  auto& target_points = cutpoints_->data_at(cutpoint, false);
+  auto& rewrite_points = cutpoints_->data_at(cutpoint, true);
+  assert(target_points.size() == rewrite_points.size());
 
-  DDEC_DEBUG(cout << "[ddec] learning cutpoint " << cutpoint << " invariant over " << target_states.size() << " target states, " << rewrite_states.size() << " rewrite states." << endl;)
+  DDEC_DEBUG(cout << "[ddec] learning cutpoint " << cutpoint << " invariant over " << target_points.size() << " target states, " << rewrite_points.size() << " rewrite states." << endl;)
 
   auto target_cuts = cutpoints_->target_cutpoint_locations();
   auto rewrite_cuts = cutpoints_->rewrite_cutpoint_locations();
@@ -542,30 +717,42 @@ ConjunctionInvariant* DdecValidator::learn_disjunction_invariant(const Cfg& targ
 
   /** Case 1: there's no conditional jump */
   if (!target_has_jcc && !rewrite_has_jcc) {
-    return learn_simple_invariant(target, rewrite, target_regs, rewrite_regs, target_states, rewrite_states);
-  } else if (target_has_jcc && !rewrite_has_jcc) {
-
-    vector<CpuState> target_jump_states;
-    vector<CpuState> target_fall_states;
-    vector<CpuState> rewrite_jump_states;
-    vector<CpuState> rewrite_fall_states;
-
-    for (size_t i = 0; i < target_states.size(); ++i) {
-      if (ConditionalHandler::condition_satisfied(target_cc, target_states[i])) {
-        target_jump_states.push_back(target_states[i]);
-        rewrite_jump_states.push_back(rewrite_states[i]);
-      } else {
-        target_fall_states.push_back(target_states[i]);
-        rewrite_fall_states.push_back(rewrite_states[i]);
-      }
-    }
+    return learn_simple_invariant(target, rewrite, target_regs, rewrite_regs,
+                                  target_traces, target_points, rewrite_traces, rewrite_points);
+  }
+
+  /** Otherwise split the points by which way the jumps go; conditions only
+    need the registers. */
+  CpuState target_regs_only;
+  CpuState rewrite_regs_only;
+  vector<size_t> target_case_points[2][2];
+  vector<size_t> rewrite_case_points[2][2];
+
+  for (size_t i = 0; i < target_points.size(); ++i) {
+    target_traces.get_registers(target_points[i], target_regs_only);
+    rewrite_traces.get_registers(rewrite_points[i], rewrite_regs_only);
+
+    size_t target_jumps = target_has_jcc && ConditionalHandler::condition_satisfied(target_cc, target_regs_only);
+    size_t rewrite_jumps = rewrite_has_jcc && ConditionalHandler::condition_satisfied(rewrite_cc, rewrite_regs_only);
+
+    target_case_points[target_jumps][rewrite_jumps].push_back(target_points[i]);
+    rewrite_case_points[target_jumps][rewrite_jumps].push_back(rewrite_points[i]);
+  }
+
+  auto learn_case = [&](size_t target_jumps, size_t rewrite_jumps) {
+    return learn_simple_invariant(target, rewrite, target_regs, rewrite_regs,
+                                  target_traces, target_case_points[target_jumps][rewrite_jumps],
+                                  rewrite_traces, rewrite_case_points[target_jumps][rewrite_jumps]);
+  };
+
+  if (target_has_jcc && !rewrite_has_jcc) {
 
     auto jump_inv = new FlagInvariant(last_target_instr, false, false);
-    auto jump_simple = learn_simple_invariant(target, rewrite, target_regs, rewrite_regs, target_jump_states, rewrite_jump_states);
+    auto jump_simple = learn_case(1, 0);
     jump_simple = transform_with_assumption(jump_inv, jump_simple);
 
     auto fall_inv = new FlagInvariant(last_target_instr, false, true);
-    auto fall_simple = learn_simple_invariant(target, rewrite, target_regs, rewrite_regs, target_fall_states, rewrite_fall_states);
+    auto fall_simple = learn_case(0, 0);
     fall_simple = transform_with_assumption(fall_inv, fall_simple);
 
     fall_simple->add_invariants(jump_simple);
@@ -574,28 +761,12 @@ ConjunctionInvariant* DdecValidator::learn_disjunction_invariant(const Cfg& targ
 
   } else if (!target_has_jcc && rewrite_has_jcc) {
 
-    vector<CpuState> target_jump_states;
-    vector<CpuState> target_fall_states;
-
-    vector<CpuState> rewrite_jump_states;
-    vector<CpuState> rewrite_fall_states;
-
-    for (size_t i = 0; i < rewrite_states.size(); ++i) {
-      if (ConditionalHandler::condition_satisfied(rewrite_cc, rewrite_states[i])) {
-        target_jump_states.push_back(target_states[i]);
-        rewrite_jump_states.push_back(rewrite_states[i]);
-      } else {
-        target_fall_states.push_back(target_states[i]);
-        rewrite_fall_states.push_back(rewrite_states[i]);
-      }
-    }
-
     auto jump_inv = new FlagInvariant(last_rewrite_instr, true, false);
-    auto jump_simple = learn_simple_invariant(target, rewrite, target_regs, rewrite_regs, target_jump_states, rewrite_jump_states);
+    auto jump_simple = learn_case(0, 1);
     jump_simple = transform_with_assumption(jump_inv, jump_simple);
 
     auto fall_inv = new FlagInvariant(last_rewrite_instr, true, true);
-    auto fall_simple = learn_simple_invariant(target, rewrite, target_regs, rewrite_regs, target_fall_states, rewrite_fall_states);
+    auto fall_simple = learn_case(0, 0);
     fall_simple = transform_with_assumption(fall_inv, fall_simple);
 
     fall_simple->add_invariants(jump_simple);
@@ -603,52 +774,22 @@ ConjunctionInvariant* DdecValidator::learn_disjunction_invariant(const Cfg& targ
     return fall_simple;
   } else {
     // Both have jumps!
-    vector<CpuState> jump_jump_states_target;
-    vector<CpuState> jump_fall_states_target;
-    vector<CpuState> fall_jump_states_target;
-    vector<CpuState> fall_fall_states_target;
-
-    vector<CpuState> jump_jump_states_rewrite;
-    vector<CpuState> jump_fall_states_rewrite;
-    vector<CpuState> fall_jump_states_rewrite;
-    vector<CpuState> fall_fall_states_rewrite;
-
-    for (size_t i = 0; i < target_states.size(); ++i) {
-      if ( ConditionalHandler::condition_satisfied( target_cc, target_states[i])) {
-        if ( ConditionalHandler::condition_satisfied( rewrite_cc, rewrite_states[i])) {
-          jump_jump_states_target.push_back(target_states[i]);
-          jump_jump_states_rewrite.push_back(rewrite_states[i]);
-        } else {
-          jump_fall_states_target.push_back(target_states[i]);
-          jump_fall_states_rewrite.push_back(rewrite_states[i]);
-        }
-      } else {
-        if ( ConditionalHandler::condition_satisfied( rewrite_cc, rewrite_states[i])) {
-          fall_jump_states_target.push_back(target_states[i]);
-          fall_jump_states_rewrite.push_back(rewrite_states[i]);
-        } else {
-          fall_fall_states_target.push_back(target_states[i]);
-          fall_fall_states_rewrite.push_back(rewrite_states[i]);
-        }
-      }
-    }
-
-    auto S1 = learn_simple_invariant(target, rewrite, target_regs, rewrite_regs, jump_jump_states_target, jump_jump_states_rewrite);
+    auto S1 = learn_case(1, 1);
     auto S1_target_path = new FlagInvariant(last_target_instr, false, false);
     auto S1_rewrite_path = new FlagInvariant(last_rewrite_instr, true, false);
     S1 = transform_with_assumption(S1_target_path->AND(S1_rewrite_path), S1);
 
-    auto S2 = learn_simple_invariant(target, rewrite, target_regs, rewrite_regs, jump_fall_states_target, jump_fall_states_rewrite);
+    auto S2 = learn_case(1, 0);
     auto S2_target_path = new FlagInvariant(last_target_instr, false, false);
     auto S2_rewrite_path = new FlagInvariant(last_rewrite_instr, true, true);
     S2 = transform_with_assumption(S2_target_path->AND(S2_rewrite_path), S2);
 
-    auto S3 = learn_simple_invariant(target, rewrite, target_regs, rewrite_regs, fall_jump_states_target, fall_jump_states_rewrite);
+    auto S3 = learn_case(0, 1);
     auto S3_target_path = new FlagInvariant(last_target_instr, false, true);
     auto S3_rewrite_path = new FlagInvariant(last_rewrite_instr, true, false);
     S3 = transform_with_assumption(S3_target_path->AND(S3_rewrite_path), S3);
 
-    auto S4 = learn_simple_invariant(target, rewrite, target_regs, rewrite_regs, fall_fall_states_target, fall_fall_states_rewrite);
+    auto S4 = learn_case(0, 0);
     auto S4_target_path = new FlagInvariant(last_target_instr, false, true);
     auto S4_rewrite_path = new FlagInvariant(last_rewrite_instr, true, true);
     S4 = transform_with_assumption(S4_target_path->AND(S4_rewrite_path), S4);
@@ -783,9 +924,14 @@ vector<SignInvariant*> build_sign_invariants(RegSet target_regs, RegSet rewrite_
   return invariants;
 }
 
-ConjunctionInvariant* DdecValidator::learn_simple_invariant(const Cfg& target, const Cfg& rewrite, x64asm::RegSet target_regs, x64asm::RegSet rewrite_regs, const vector<CpuState>& target_states, const vector<CpuState>& rewrite_states) {
+ConjunctionInvariant* DdecValidator::learn_simple_invariant(const Cfg& target, const Cfg& rewrite, x64asm::RegSet target_regs, x64asm::RegSet rewrite_regs, const TraceStore& target_traces, const vector<size_t>& target_points, const TraceStore& rewrite_traces, const vector<size_t>& rewrite_points) {
 
-  assert(target_states.size() == rewrite_states.size());
+  assert(target_points.size() == rewrite_points.size());
+
+  // Everything but the memory null invariants only looks at registers, so
+  // don't copy memory out of the store unless one of those needs checking.
+  auto target_states = target_traces.get_register_states(target_points);
+  auto rewrite_states = rewrite_traces.get_register_states(rewrite_points);
 
   //TODO leaks memory
 
@@ -813,7 +959,7 @@ ConjunctionInvariant* DdecValidator::learn_simple_invariant(const Cfg& target, c
       bool all_nonzero = true;
 
       if ((*it).size() == 64) {
-        for (auto state : states) {
+        for (const auto& state : states) {
           if (state.gp[*it].get_fixed_double(1) != 0) {
             all_topzero = false;
           }
@@ -822,7 +968,7 @@ ConjunctionInvariant* DdecValidator::learn_simple_invariant(const Cfg& target, c
         all_topzero = false;
       }
 
-      for (auto state : states) {
+      for (const auto& state : states) {
         if (state.gp[*it].get_fixed_quad(0) == 0) {
           all_nonzero = false;
         }
@@ -882,9 +1028,15 @@ ConjunctionInvariant* DdecValidator::learn_simple_invariant(const Cfg& target, c
   }
 
   auto potential_memory_nulls = build_memory_null_invariants(target_regs, rewrite_regs, target, rewrite);
+  vector<CpuState> target_full;
+  vector<CpuState> rewrite_full;
+  if (!potential_memory_nulls.empty()) {
+    target_full = target_traces.get_states(target_points);
+    rewrite_full = rewrite_traces.get_states(rewrite_points);
+  }
   for (auto mem_null : potential_memory_nulls) {
     //cout << "Testing " << *mem_null << endl;
-    if (mem_null->check(target_states, rewrite_states)) {
+    if (mem_null->check(target_full, rewrite_full)) {
       //cout << " * pass" << endl;
       conj->add_invariant(mem_null);
     } else {
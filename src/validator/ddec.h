@@ -15,6 +15,9 @@
 #ifndef STOKE_SRC_VALIDATOR_DDEC_H
 #define STOKE_SRC_VALIDATOR_DDEC_H
 
+#include <map>
+#include <tuple>
+
 #include "src/validator/cutpoints.h"
 #include "src/validator/invariant.h"
 #include "src/validator/invariants/conjunction.h"
@@ -29,6 +32,9 @@ public:
 
   DdecValidator(SMTSolver& solver) : ObligationChecker(solver) {
     cutpoints_ = NULL;
+    obligations_checked_ = 0;
+    obligation_cache_hits_ = 0;
+    set_threads(1);
     set_no_bv(false);
     set_sound_nullspace(false);
     set_try_sign_extend(true);
@@ -37,6 +43,7 @@ public:
   ~DdecValidator() {
     if (cutpoints_)
       delete cutpoints_;
+    free_workers();
   }
 
   /** Turn on/off invariants that sign-extend the 32-bit registers.
@@ -56,6 +63,13 @@ public:
     sound_nullspace_ = b;
     return *this;
   }
+  /** Set the number of threads used to learn invariants and check proof
+    obligations.  Each thread gets its own copy of the solver; if the solver
+    can't be copied, everything runs on one thread.  --ddec_threads */
+  DdecValidator& set_threads(size_t threads) {
+    threads_ = threads ? threads : 1;
+    return *this;
+  }
   /** Set the bound for bounded validator */
   DdecValidator& set_bound(size_t bound) {
     bound_ = bound;
@@ -65,6 +79,16 @@ public:
   /** Verify if target and rewrite are equivalent. */
   bool verify(const Cfg& target, const Cfg& rewrite);
 
+  /** Number of proof obligations sent to the solver in the last verify(). */
+  size_t get_obligations_checked() const {
+    return obligations_checked_;
+  }
+  /** Number of proof obligations answered from the cache in the last
+    verify(), i.e. not re-checked in a later round of the Houdini loop. */
+  size_t get_obligation_cache_hits() const {
+    return obligation_cache_hits_;
+  }
+
 private:
 
   /** Find all invariants with CEGAR-style search. */
@@ -72,7 +96,7 @@ private:
   /** Learn invariants from CpuStates */
   ConjunctionInvariant* learn_disjunction_invariant(const Cfg& target, const Cfg& rewrite, size_t cutpoint);
   /** Learn invariants from CpuStates */
-  ConjunctionInvariant* learn_simple_invariant(const Cfg& target, const Cfg& rewrite, x64asm::RegSet target_regs, x64asm::RegSet rewrite_regs, const std::vector<CpuState>& states, const std::vector<CpuState>& states2);
+  ConjunctionInvariant* learn_simple_invariant(const Cfg& target, const Cfg& rewrite, x64asm::RegSet target_regs, x64asm::RegSet rewrite_regs, const TraceStore& target_traces, const std::vector<size_t>& target_points, const TraceStore& rewrite_traces, const std::vector<size_t>& rewrite_points);
   /** Check that all the invariants work. */
   bool check_proof(const Cfg& target, const Cfg& rewrite, const std::vector<ConjunctionInvariant*>& invariants, std::map<size_t, std::vector<size_t>>& failed_invariants);
   /** Generate some extra testcases, for funsies. */
@@ -80,8 +104,47 @@ private:
   /** Print a summary of what we've done */
   void print_summary(const std::vector<ConjunctionInvariant*>&);
 
+  /** Identifies the obligation inv(i) { P ; Q } prove, where P goes from
+    target cutpoint i to j and Q from rewrite cutpoint i to k.  Obligations
+    that the paths can't be taken together have a NULL prove. */
+  struct ObligationKey {
+    size_t i;
+    size_t j;
+    size_t k;
+    CfgPath p;
+    CfgPath q;
+    const Invariant* prove;
+
+    bool operator<(const ObligationKey& rhs) const {
+      return std::tie(i, j, k, p, q, prove) < std::tie(rhs.i, rhs.j, rhs.k, rhs.p, rhs.q, rhs.prove);
+    }
+  };
+  /** Drop the cached obligations that depended on a conjunct that's about to
+    be removed from the invariant of a cutpoint: those assuming the
+    invariant, and those proving the conjunct. */
+  void forget_obligations(size_t cutpoint, const Invariant* removed);
+
+  /** Set up one obligation checker per thread; the first one is this. */
+  void make_workers();
+  /** Delete the obligation checkers and solvers of the other threads. */
+  void free_workers();
+
   /** Bound */
   size_t bound_;
+  /** Number of threads */
+  size_t threads_;
+
+  /** Obligation checker for each thread; workers_[0] is this. */
+  std::vector<ObligationChecker*> workers_;
+  /** Solvers owned by workers_[1..]. */
+  std::vector<SMTSolver*> worker_solvers_;
+
+  /** Results of the obligations checked for the current invariants.  Every
+    entry was checked under the current assumptions; see forget_obligations(). */
+  std::map<ObligationKey, bool> obligation_cache_;
+  /** Statistics for the last verify() */
+  size_t obligations_checked_;
+  size_t obligation_cache_hits_;
 
   /** Whatever cutpoints we've generated. */
   Cutpoints* cutpoints_;
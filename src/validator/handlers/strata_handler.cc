@@ -654,7 +654,7 @@ Handler::SupportLevel StrataHandler::get_support(const x64asm::Instruction& inst
 
 void StrataHandler::build_circuit(const x64asm::Instruction& instr, SymState& final) {
   auto& should_simplify = simplify_;
-  SymSimplify simplifier;
+  auto& simplifier = simplifier_;
 
   auto& tc = tc_;
   auto& ch = ch_;
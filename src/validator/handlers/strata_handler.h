@@ -79,6 +79,10 @@ private:
   /** A type-checker. */
   SymTypecheckVisitor tc_;
 
+  /** Simplifier shared by all calls to build_circuit, so that work on common
+    subterms is reused across instructions and paths. */
+  SymSimplify simplifier_;
+
   /** A cache for learned formulas (to avoid having to load them from disk over and over again). */
   std::map<x64asm::Opcode, SymState> formula_cache_;
 
@@ -12,8 +12,12 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <fstream>
+#include <unordered_map>
+#include <vector>
 #include <stdint.h>
 #include <malloc.h>
 #include <assert.h>
@@ -219,7 +223,6 @@ uint64_t multiplyRow(uint64_t* r1, uint64_t* r2, size_t num)
 
 bool checkOutput(uint64_t** output, uint64_t* inputs, size_t nullity, size_t rows, size_t cols)
 {
-  assert(nullity > 0);
   for (size_t i = 0; i< nullity; i++)
     for (size_t j=0; j< rows; j++)
       if (multiplyRow(output[i],inputs+j*cols,cols))
@@ -261,14 +264,14 @@ size_t rank(uint64_t a)
 #define SUB(X,Y) augmented[(X)*cols+(Y)]
 
 //rowspace of output is nullspace of input
-size_t nullspace(long* inputs, size_t rows, size_t cols, uint64_t*** output)
+size_t reference_nullspace(long* inputs, size_t rows, size_t cols, uint64_t*** output)
 {
   size_t rowrank = 0;
   uint64_t* augmented = augmentIdentity((uint64_t*)inputs,rows, cols);
   //cout << "STARTING" << endl;
   //printMat(augmented,rows+cols,cols);
   size_t currcol=0;
-  for (size_t i=0; i<rows; i++)
+  for (size_t i=0; i<rows && currcol<cols; i++)
   {
     size_t minrank = rank(SUB(i,currcol));
     size_t idx = currcol;
@@ -286,7 +289,6 @@ size_t nullspace(long* inputs, size_t rows, size_t cols, uint64_t*** output)
       continue;
     }
     rowrank++;
-    assert(rowrank<cols);
     //We have found the column with the pivot
     for (size_t j=i; j<rows+cols; j++)
     {
@@ -347,7 +349,7 @@ size_t nullspace(long* inputs, size_t rows, size_t cols, uint64_t*** output)
     if (flag)
     {
       //cout << "Found a smaller bit equation" << endl;
-      (*output)[idx]=(uint64_t*)malloc(sizeof(uint64_t)*cols);
+      (*output)[idx]=new uint64_t[cols];
       for (size_t j=rows; j<rows+cols; j++)
       {
         (*output)[idx][j-rows]=SUB(j,i);
@@ -362,4 +364,134 @@ size_t nullspace(long* inputs, size_t rows, size_t cols, uint64_t*** output)
   return idx;
 }
 
+#undef SUB
+
+//indices of the rows of a matrix, without duplicates, in order
+vector<size_t> distinctRows(uint64_t* inputs, size_t rows, size_t cols)
+{
+  vector<size_t> distinct;
+  unordered_multimap<uint64_t, size_t> seen;
+  for (size_t i=0; i<rows; i++)
+  {
+    auto row = inputs+i*cols;
+    uint64_t hash = 0;
+    for (size_t j=0; j<cols; j++)
+      hash = (hash ^ row[j])*0x100000001b3ull;
+
+    bool found = false;
+    auto range = seen.equal_range(hash);
+    for (auto it = range.first; it != range.second && !found; ++it)
+      found = !memcmp(row, inputs+it->second*cols, cols*sizeof(uint64_t));
+    if (found)
+      continue;
+
+    seen.insert(make_pair(hash, i));
+    distinct.push_back(i);
+  }
+  return distinct;
+}
+
+//b[j] -= f*a[j]; contiguous, so the compiler vectorizes it
+void subtractMultiple(uint64_t* __restrict__ b, const uint64_t* __restrict__ a, uint64_t f, size_t n)
+{
+  for (size_t j=0; j<n; j++)
+    b[j] -= f*a[j];
+}
+
+//rows processed at once when updating columns, so that the pivot column
+//stays in L1 while all the other columns go past it
+#define BLOCK_ROWS 512
+
+//Same elimination as reference_nullspace(), with two changes that don't
+//affect the result.  A duplicate row has been zeroed in every column left
+//to eliminate by the time it is reached, so it's dropped up front.  And the
+//augmented matrix is stored by column (COL(j,i) is column j, row i), since
+//every step is a column operation.
+#define COL(X,Y) augmented[(X)*total+(Y)]
+
+size_t nullspace(long* inputs, size_t rows, size_t cols, uint64_t*** output)
+{
+  auto distinct = distinctRows((uint64_t*)inputs, rows, cols);
+  size_t n = distinct.size();
+  size_t total = n+cols;
+
+  vector<uint64_t> augmented(total*cols, 0);
+  for (size_t i=0; i<n; i++)
+    for (size_t j=0; j<cols; j++)
+      COL(j,i) = ((uint64_t*)inputs)[distinct[i]*cols+j];
+  for (size_t j=0; j<cols; j++)
+    COL(j,n+j) = 1;
+
+  vector<uint64_t> factors(cols);
+  size_t rowrank = 0;
+  size_t currcol = 0;
+  for (size_t i=0; i<n && currcol<cols; i++)
+  {
+    size_t minrank = rank(COL(currcol,i));
+    size_t idx = currcol;
+    for (size_t j=currcol; j<cols; j++)
+    {
+      size_t val = rank(COL(j,i));
+      if (val<minrank)
+      {
+        minrank = val;
+        idx = j;
+      }
+    }
+    if (minrank==64)
+      continue;
+    rowrank++;
+
+    auto pivotcol = &COL(currcol,0);
+    if (idx != currcol)
+      swap_ranges(pivotcol+i, pivotcol+total, &COL(idx,i));
+
+    uint64_t pivot = pivotcol[i];
+    uint64_t odd = getOdd(pivot);
+    uint64_t twopow = pivot/odd;
+    uint64_t oddinv = invert(odd);
+    for (size_t j=i; j<total; j++)
+      pivotcol[j] *= oddinv;
+    assert(pivotcol[i]==twopow && "inversion failed");
+
+    for (size_t k=currcol+1; k<cols; k++)
+      factors[k] = COL(k,i)/twopow;
+    for (size_t b=i; b<total; b+=BLOCK_ROWS)
+    {
+      size_t e = min(b+BLOCK_ROWS, total);
+      for (size_t k=currcol+1; k<cols; k++)
+        if (factors[k])
+          subtractMultiple(&COL(k,b), pivotcol+b, factors[k], e-b);
+    }
+    currcol++;
+  }
+
+  size_t nullity = cols-rowrank;
+  *output = new uint64_t*[2*cols];
+  for (size_t i=cols-nullity; i<cols; i++)
+  {
+    (*output)[i-cols+nullity] = new uint64_t[cols];
+    memcpy((*output)[i-cols+nullity], &COL(i,n), cols*sizeof(uint64_t));
+  }
+  //adding 32 bit equations
+  size_t idx = nullity;
+  for (size_t i=0; i<cols; i++)
+  {
+    bool flag = true;
+    for (size_t j=0; j<n && flag; j++)
+      flag = (COL(i,j)<<32)==0;
+    if (flag)
+    {
+      (*output)[idx] = new uint64_t[cols];
+      for (size_t j=0; j<cols; j++)
+        (*output)[idx][j] = COL(i,n+j)<<32;
+      idx++;
+    }
+  }
+  assert(checkOutput(*output,(uint64_t*)inputs,idx,rows,cols));
+  return idx;
+}
+
+#undef COL
+
 }
@@ -18,7 +18,12 @@
 /** Sound nullspace computation */
 namespace BitvectorNullspace {
 
+/** Nullspace modulo 2^64.  Duplicate rows are dropped first, and the
+  elimination runs on columns stored contiguously. */
 size_t nullspace(long* inputs, size_t rows, size_t cols, uint64_t*** output);
+/** The original row-major elimination; gives the same output as nullspace().
+  Kept to test and benchmark the fast one against. */
+size_t reference_nullspace(long* inputs, size_t rows, size_t cols, uint64_t*** output);
 
 }
 
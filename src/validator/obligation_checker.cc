@@ -12,7 +12,9 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <chrono>
+#include <sstream>
 
 #include "src/cfg/cfg.h"
 #include "src/cfg/paths.h"
@@ -47,12 +49,14 @@ using namespace x64asm;
 using namespace std::chrono;
 
 #ifdef DEBUG_CHECKER_PERFORMANCE
-uint64_t ObligationChecker::number_queries_ = 0;
-uint64_t ObligationChecker::number_cases_ = 0;
-uint64_t ObligationChecker::constraint_gen_time_ = 0;
-uint64_t ObligationChecker::solver_time_ = 0;
-uint64_t ObligationChecker::aliasing_time_ = 0;
-uint64_t ObligationChecker::ceg_time_ = 0;
+atomic<uint64_t> ObligationChecker::number_queries_{0};
+atomic<uint64_t> ObligationChecker::number_cases_{0};
+atomic<uint64_t> ObligationChecker::constraint_gen_time_{0};
+atomic<uint64_t> ObligationChecker::solver_time_{0};
+atomic<uint64_t> ObligationChecker::aliasing_time_{0};
+atomic<uint64_t> ObligationChecker::ceg_time_{0};
+atomic<uint64_t> ObligationChecker::arrangement_cache_hits_{0};
+atomic<uint64_t> ObligationChecker::observed_cases_{0};
 #endif
 
 template <typename K, typename V>
@@ -199,6 +203,103 @@ CpuState ObligationChecker::run_sandbox_on_path(const Cfg& cfg, const CfgPath& P
 
 }
 
+const vector<CfgPath>& ObligationChecker::observe_paths(const Cfg& cfg) {
+
+  stringstream ss;
+  ss << cfg.get_code();
+  auto key = ss.str();
+  if (observed_paths_.count(key))
+    return observed_paths_[key];
+
+  // A handful of testcases is plenty to rank the common cases.
+  Sandbox sb;
+  sb.set_abi_check(false);
+  sb.set_max_jumps(4096);
+  for (size_t t = 0, te = MIN(sandbox_->size(), (size_t)16); t < te; ++t)
+    sb.insert_input(*sandbox_->get_input(t));
+
+  // This is the trace that CfgPaths::learn_path reads, for all the testcases
+  // in one run.
+  const auto& label = cfg.get_function().get_leading_label();
+  sb.insert_function(cfg);
+  sb.set_entrypoint(label);
+  sb.insert_block_trace(label);
+  sb.run();
+
+  auto& paths = observed_paths_[key];
+  for (size_t t = 0; t < sb.size(); ++t) {
+    if (sb.get_output(t)->code == ErrorCode::NORMAL && !sb.block_trace_truncated(t))
+      paths.push_back(sb.get_block_trace(t));
+    else
+      paths.push_back(CfgPath());
+  }
+  return paths;
+}
+
+map<size_t, map<size_t, uint64_t>> ObligationChecker::observe_addresses(const Cfg& cfg, const CfgPath& P, const Cfg& unroll) {
+
+  map<size_t, map<size_t, uint64_t>> result;
+
+  stringstream ss;
+  ss << unroll.get_code();
+  auto key = ss.str();
+
+  // The unrolled code only does what the original does on testcases that
+  // start down P.
+  const auto& paths = observe_paths(cfg);
+  vector<size_t> missing;
+  for (size_t t = 0; t < paths.size(); ++t) {
+    if (paths[t].empty() || !CfgPaths::is_prefix(P, paths[t]))
+      continue;
+    auto it = observed_addresses_.find(make_pair(key, t));
+    if (it != observed_addresses_.end())
+      result[t] = it->second;
+    else
+      missing.push_back(t);
+  }
+  if (missing.empty())
+    return result;
+
+  Sandbox sb;
+  sb.set_abi_check(false);
+  sb.set_max_jumps(4096);
+  for (auto t : missing)
+    sb.insert_input(*sandbox_->get_input(t));
+
+  auto new_f = unroll.get_function();
+  new_f.insert(0, x64asm::Instruction(x64asm::LABEL_DEFN, { x64asm::Label("__ObligationCheckerObserve:") }), false);
+  new_f.push_back(x64asm::Instruction(x64asm::RET));
+  Cfg new_cfg(new_f, unroll.def_ins(), unroll.live_outs());
+  const auto& label = new_f.get_leading_label();
+  sb.insert_function(new_cfg);
+  sb.set_entrypoint(label);
+
+  // Line i of the unrolled code is line i+1 here, after the label.  Each line
+  // runs at most once, so its counter ends up holding its only address.
+  auto& code = unroll.get_code();
+  map<size_t, size_t> counters;
+  for (size_t i = 0, ie = code.size(); i < ie; ++i) {
+    auto& instr = code[i];
+    if (!instr.is_memory_dereference())
+      continue;
+    if (!instr.is_explicit_memory_dereference() && !instr.is_push() && !instr.is_pop())
+      continue;
+    counters[i] = sb.insert_address_counter(label, i+1);
+  }
+
+  sb.run();
+
+  for (size_t k = 0; k < missing.size(); ++k) {
+    auto& addrs = observed_addresses_[make_pair(key, missing[k])];
+    if (sb.get_output(k)->code == ErrorCode::NORMAL) {
+      for (auto it : counters)
+        addrs[it.first] = sb.get_counter(k, it.second);
+    }
+    result[missing[k]] = addrs;
+  }
+  return result;
+}
+
 bool ObligationChecker::check_counterexample(const Cfg& target, const Cfg& rewrite, const CfgPath& P, const CfgPath& Q, const Invariant& assume, const Invariant& prove, const CpuState& ceg, const CpuState& ceg2) {
 
   // We can't do anything without a sandbox
@@ -805,7 +906,87 @@ for (size_t i = 0; i < total_accesses; ++i) {
     sa.unconstrained = false;
     done.push_back(sa);
 
-    auto options = enumerate_aliasing_helper(target, rewrite, target_unroll, rewrite_unroll, P, Q, cell_list, done, 1, assume);
+    vector<size_t> key(cell_sizes, cell_sizes + max_cell);
+    if (!arrangement_cache_.count(key)) {
+      arrangement_cache_[key] = enumerate_aliasing_helper(target, rewrite, target_unroll, rewrite_unroll, P, Q, cell_list, done, 1, assume);
+    } else {
+#ifdef DEBUG_CHECKER_PERFORMANCE
+      arrangement_cache_hits_++;
+#endif
+    }
+    auto options = arrangement_cache_[key];
+
+    // Try the arrangements that the testcases actually exhibit first; if
+    // there's a counterexample, it's most likely in one of those.  This only
+    // changes the order of the cases, so soundness doesn't depend on it.
+    if (sandbox_ && options.size() > 1) {
+      vector<size_t> seen(options.size(), 0);
+
+      // Only testcases that follow P (or Q) say anything about this pair of
+      // paths; what they say is cached across queries.
+      auto target_observed = observe_addresses(target, P, target_unroll);
+      auto rewrite_observed = observe_addresses(rewrite, Q, rewrite_unroll);
+      const map<size_t, uint64_t> none;
+
+      for (size_t t = 0, te = MIN(sandbox_->size(), (size_t)16); t < te; ++t) {
+        if (!target_observed.count(t) && !rewrite_observed.count(t))
+          continue;
+        auto& target_addrs = target_observed.count(t) ? target_observed[t] : none;
+        auto& rewrite_addrs = rewrite_observed.count(t) ? rewrite_observed[t] : none;
+
+        // Find where each mega-cell starts; give up on a mega-cell whose
+        // accesses disagree.
+        vector<uint64_t> base(max_cell, 0);
+        vector<int> known(max_cell, 0);
+        for (size_t i = 0; i < total_accesses; ++i) {
+          auto& addrs = sym_accesses[i].is_rewrite ? rewrite_addrs : target_addrs;
+          if (!addrs.count(sym_accesses[i].line))
+            continue;
+          auto b = addrs.at(sym_accesses[i].line) - offset[i];
+          if (known[cell[i]] == 0) {
+            base[cell[i]] = b;
+            known[cell[i]] = 1;
+          } else if (base[cell[i]] != b) {
+            known[cell[i]] = -1;
+          }
+        }
+
+        for (size_t k = 0; k < options.size(); ++k) {
+          auto& option = options[k];
+          bool consistent = true;
+          for (size_t c = 0; c < max_cell && consistent; ++c) {
+            for (size_t d = c+1; d < max_cell && consistent; ++d) {
+              if (known[c] != 1 || known[d] != 1)
+                continue;
+              if (option[c].cell == option[d].cell)
+                consistent = base[c] - option[c].cell_offset == base[d] - option[d].cell_offset;
+              else
+                consistent = base[c] + cell_sizes[c] <= base[d] || base[d] + cell_sizes[d] <= base[c];
+            }
+          }
+          if (consistent)
+            seen[k]++;
+        }
+      }
+
+      vector<size_t> order(options.size());
+      for (size_t k = 0; k < order.size(); ++k)
+        order[k] = k;
+      stable_sort(order.begin(), order.end(), [&seen](size_t a, size_t b) {
+        return seen[a] > seen[b];
+      });
+
+      vector<vector<CellMemory::SymbolicAccess>> sorted;
+      for (auto k : order)
+        sorted.push_back(options[k]);
+      options.swap(sorted);
+
+#ifdef DEBUG_CHECKER_PERFORMANCE
+      for (auto n : seen)
+        if (n > 0)
+          observed_cases_++;
+#endif
+    }
 
     for (auto option : options) {
       map<size_t, CellMemory::SymbolicAccess> target_map;
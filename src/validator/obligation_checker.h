@@ -15,7 +15,9 @@
 #ifndef STOKE_SRC_VALIDATOR_OBLIGATION_CHECKER_H
 #define STOKE_SRC_VALIDATOR_OBLIGATION_CHECKER_H
 
+#include <atomic>
 #include <iostream>
+#include <map>
 #include <vector>
 #include <string>
 
@@ -77,6 +79,30 @@ public:
     alias_strategy_ = as;
     return *this;
   }
+  /** Get the strategy for aliasing */
+  AliasStrategy get_alias_strategy() const {
+    return alias_strategy_;
+  }
+
+  /** Add a sandbox for ranking aliasing cases by the testcases in it. */
+  ObligationChecker& set_sandbox(Sandbox* sb) {
+    Validator::set_sandbox(sb);
+    observed_paths_.clear();
+    observed_addresses_.clear();
+    return *this;
+  }
+
+  /** Use the same settings as another checker: aliasing strategy, NaCl
+    assumption, live out memory and sandbox.  The filter stays; it's owned by
+    each checker. */
+  ObligationChecker& copy_settings(const ObligationChecker& other) {
+    set_alias_strategy(other.alias_strategy_);
+    set_nacl(other.nacl_);
+    set_heap_out(other.heap_out_);
+    set_stack_out(other.stack_out_);
+    set_sandbox(other.sandbox_);
+    return *this;
+  }
 
   ObligationChecker& set_filter(Filter* filter) {
     if (filter_)
@@ -97,6 +123,10 @@ public:
     nacl_ = b;
     return *this;
   }
+  /** Are we assuming NaCl-style memory references?  See set_nacl(). */
+  bool get_nacl() const {
+    return nacl_;
+  }
 
   enum JumpType {
     NONE, // jump target is the fallthrough
@@ -186,6 +216,27 @@ private:
     std::vector<OverlapDescriptor*>& start,
     std::vector<OverlapDescriptor>& available_cells, size_t max_size);
 
+  /** Overlaps of mega-cells computed by enumerate_aliasing_helper(), keyed by
+    the sizes of the mega-cells.  The enumeration only depends on these, so
+    path pairs with the same access pattern share it. */
+  std::map<std::vector<size_t>, std::vector<std::vector<CellMemory::SymbolicAccess>>> arrangement_cache_;
+
+  /** Paths that the first few testcases take through a function, by
+    testcase; a path is empty if its testcase didn't run cleanly.  Cached by
+    code in observed_paths_. */
+  const std::vector<CfgPath>& observe_paths(const Cfg& cfg);
+  /** Run a path-unrolled CFG (from rewrite_cfg_with_path of P through cfg) on
+    the testcases whose path through cfg starts with P; returns the address of
+    each memory dereference by line, keyed by testcase.  Cached by code and
+    testcase in observed_addresses_. */
+  std::map<size_t, std::map<size_t, uint64_t>> observe_addresses(const Cfg& cfg, const CfgPath& P, const Cfg& unroll);
+
+  /** Results of observe_paths(), keyed by the code of the function. */
+  std::map<std::string, std::vector<CfgPath>> observed_paths_;
+  /** Results of observe_addresses(), keyed by the code of the unrolled path
+    and the testcase. */
+  std::map<std::pair<std::string, size_t>, std::map<size_t, uint64_t>> observed_addresses_;
+
   /** Populate a testcase with memory. */
   bool build_testcase_cell_memory(CpuState& ceg, const CellMemory* target_memory,
                                   const CellMemory* rewrite_memory,
@@ -271,18 +322,23 @@ private:
 
 
 #ifdef DEBUG_CHECKER_PERFORMANCE
-  static uint64_t number_queries_;
-  static uint64_t number_cases_;
+  /** Shared by every checker; DDEC runs several on separate threads. */
+  static std::atomic<uint64_t> number_queries_;
+  static std::atomic<uint64_t> number_cases_;
 
-  static uint64_t constraint_gen_time_;
-  static uint64_t solver_time_;
-  static uint64_t aliasing_time_;
-  static uint64_t ceg_time_;
+  static std::atomic<uint64_t> constraint_gen_time_;
+  static std::atomic<uint64_t> solver_time_;
+  static std::atomic<uint64_t> aliasing_time_;
+  static std::atomic<uint64_t> ceg_time_;
+  static std::atomic<uint64_t> arrangement_cache_hits_;
+  static std::atomic<uint64_t> observed_cases_;
 
   void print_performance() {
     std::cout << "====== Obligation Checker Performance Report ======" << std::endl;
     std::cout << "Number queries: "<< number_queries_ << std::endl;
     std::cout << "Number aliasing cases: "<< number_cases_ << std::endl;
+    std::cout << "Arrangement cache hits: " << arrangement_cache_hits_ << std::endl;
+    std::cout << "Aliasing cases seen in testcases: " << observed_cases_ << std::endl;
     std::cout << "Alias case enumeration time (ms): " << (aliasing_time_ / 1000) << std::endl;
     std::cout << "Constraint generation time (ms): " << (constraint_gen_time_ / 1000) << std::endl;
     std::cout << "Solver time (ms): " << (solver_time_ / 1000) << std::endl;
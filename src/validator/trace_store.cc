@@ -0,0 +1,156 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstring>
+
+#include "src/validator/trace_store.h"
+
+using namespace std;
+using namespace stoke;
+
+void TraceStore::clear() {
+  inputs_.clear();
+  current_ = -1;
+
+  blocks_.clear();
+  trace_of_.clear();
+  traces_.clear();
+  by_block_.clear();
+
+  CpuState cs;
+  gp_.assign(cs.gp.size(), vector<uint64_t>());
+  sse_.assign(cs.sse.size() * sse_quads_, vector<uint64_t>());
+  rf_.clear();
+
+  delta_begin_.assign(1, 0);
+  delta_segment_.clear();
+  delta_offset_.clear();
+  delta_value_.clear();
+}
+
+void TraceStore::begin_trace(const CpuState& input) {
+  current_ = inputs_.size();
+  inputs_.push_back(input);
+  traces_.push_back(vector<size_t>());
+}
+
+void TraceStore::record(Cfg::id_type block, CpuState& cs) {
+  assert(current_ < inputs_.size());
+
+  auto point = blocks_.size();
+  blocks_.push_back(block);
+  trace_of_.push_back(current_);
+  traces_[current_].push_back(point);
+  by_block_[block].push_back(point);
+
+  for (size_t i = 0, ie = gp_.size(); i < ie; ++i)
+    gp_[i].push_back(cs.gp[i].get_fixed_quad(0));
+  for (size_t i = 0, ie = cs.sse.size(); i < ie; ++i)
+    for (size_t j = 0; j < sse_quads_; ++j)
+      sse_[i*sse_quads_ + j].push_back(cs.sse[i].get_fixed_quad(j));
+  uint64_t rf = 0;
+  for (size_t i = 0, ie = cs.rf.size(); i < ie; ++i)
+    if (cs.rf.is_set(i))
+      rf |= 1ull << i;
+  rf_.push_back(rf);
+
+  // Only keep the bytes that the code has changed.  Compare a quad at a time;
+  // most of memory is usually untouched.
+  auto& input = inputs_[current_];
+  assert(segment_count(cs) == segment_count(input));
+  for (size_t s = 0, se = segment_count(cs); s < se; ++s) {
+    auto& mem = segment(cs, s);
+    auto& orig = segment(input, s);
+    assert(mem.size() == orig.size());
+
+    auto now = (const uint8_t*)mem.data();
+    auto then = (const uint8_t*)orig.data();
+    for (size_t k = 0, ke = mem.size(); k < ke; k += 8) {
+      auto n = ke - k < 8 ? ke - k : 8;
+      if (!memcmp(now + k, then + k, n))
+        continue;
+      for (size_t b = k; b < k + n; ++b) {
+        if (now[b] != then[b]) {
+          delta_segment_.push_back(s);
+          delta_offset_.push_back(b);
+          delta_value_.push_back(now[b]);
+        }
+      }
+    }
+  }
+  delta_begin_.push_back(delta_offset_.size());
+}
+
+void TraceStore::get_registers(size_t point, CpuState& cs) const {
+  assert(point < size());
+
+  for (size_t i = 0, ie = gp_.size(); i < ie; ++i)
+    cs.gp[i].get_fixed_quad(0) = gp_[i][point];
+  for (size_t i = 0, ie = cs.sse.size(); i < ie; ++i)
+    for (size_t j = 0; j < sse_quads_; ++j)
+      cs.sse[i].get_fixed_quad(j) = sse_[i*sse_quads_ + j][point];
+
+  auto rf = rf_[point];
+  for (size_t i = 0, ie = cs.rf.size(); i < ie; ++i)
+    if (!cs.rf.is_fixed(i))
+      cs.rf.set(i, (rf >> i) & 1);
+}
+
+CpuState TraceStore::get_state(size_t point) const {
+  assert(point < size());
+
+  auto cs = inputs_[trace_of_[point]];
+  cs.code = ErrorCode::NORMAL;
+  get_registers(point, cs);
+
+  for (size_t d = delta_begin_[point], de = delta_begin_[point+1]; d < de; ++d) {
+    auto& mem = segment(cs, delta_segment_[d]);
+    ((uint8_t*)mem.data())[delta_offset_[d]] = delta_value_[d];
+  }
+
+  return cs;
+}
+
+vector<CpuState> TraceStore::get_states(const vector<size_t>& points) const {
+  vector<CpuState> states;
+  states.reserve(points.size());
+  for (auto p : points)
+    states.push_back(get_state(p));
+  return states;
+}
+
+vector<CpuState> TraceStore::get_register_states(const vector<size_t>& points) const {
+  vector<CpuState> states(points.size());
+  for (size_t i = 0, ie = points.size(); i < ie; ++i)
+    get_registers(points[i], states[i]);
+  return states;
+}
+
+bool TraceStore::same_memory(const TraceStore& a, size_t p, const TraceStore& b, size_t q) {
+  auto a_begin = a.delta_begin_[p];
+  auto a_end = a.delta_begin_[p+1];
+  auto b_begin = b.delta_begin_[q];
+  auto b_end = b.delta_begin_[q+1];
+
+  if (a_end - a_begin != b_end - b_begin)
+    return false;
+
+  for (size_t i = a_begin, j = b_begin; i < a_end; ++i, ++j) {
+    if (a.delta_segment_[i] != b.delta_segment_[j] ||
+        a.delta_offset_[i] != b.delta_offset_[j] ||
+        a.delta_value_[i] != b.delta_value_[j])
+      return false;
+  }
+  return true;
+}
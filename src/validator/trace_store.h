@@ -0,0 +1,139 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STOKE_SRC_VALIDATOR_TRACE_STORE_H
+#define STOKE_SRC_VALIDATOR_TRACE_STORE_H
+
+#include "src/cfg/cfg.h"
+#include "src/state/cpu_state.h"
+
+#include <map>
+#include <vector>
+
+namespace stoke {
+
+/** Stores execution traces (the state at each basic block entered) compactly.
+  Registers are kept in columns, one per register quad, and memory only as the
+  bytes that differ from the input of the testcase.  A point of a trace is
+  identified by its index; points are indexed by trace and by basic block, so
+  looking them up doesn't copy anything.  Full states are only rebuilt on
+  request. */
+class TraceStore {
+
+public:
+
+  TraceStore() : current_(-1) {
+    clear();
+  }
+
+  /** Remove all traces. */
+  void clear();
+
+  /** Start a new trace for a testcase; memory is stored relative to 'input'. */
+  void begin_trace(const CpuState& input);
+  /** Append the state at the entry of a block to the current trace. */
+  void record(Cfg::id_type block, CpuState& cs);
+
+  /** Number of traces. */
+  size_t trace_count() const {
+    return traces_.size();
+  }
+  /** Number of points over all traces. */
+  size_t size() const {
+    return blocks_.size();
+  }
+
+  /** Points of a trace, in execution order. */
+  const std::vector<size_t>& get_trace(size_t trace) const {
+    return traces_[trace];
+  }
+  /** Points at a block over all traces, ordered by trace and then execution. */
+  const std::vector<size_t>& at_block(Cfg::id_type block) const {
+    auto it = by_block_.find(block);
+    return it == by_block_.end() ? none_ : it->second;
+  }
+
+  /** The block of a point. */
+  Cfg::id_type get_block(size_t point) const {
+    return blocks_[point];
+  }
+  /** The trace a point belongs to. */
+  size_t get_trace_of(size_t point) const {
+    return trace_of_[point];
+  }
+
+  /** Overwrite the registers of a state with those at a point, leaving memory
+    alone.  Cheap; enough for anything that only looks at registers. */
+  void get_registers(size_t point, CpuState& cs) const;
+  /** Rebuild the full state at a point. */
+  CpuState get_state(size_t point) const;
+  /** Rebuild the full states at some points. */
+  std::vector<CpuState> get_states(const std::vector<size_t>& points) const;
+  /** The registers at some points, in otherwise empty states. */
+  std::vector<CpuState> get_register_states(const std::vector<size_t>& points) const;
+
+  /** Is memory the same at point p of a and point q of b?  Both traces must
+    start from the same input. */
+  static bool same_memory(const TraceStore& a, size_t p, const TraceStore& b, size_t q);
+
+  /** Number of bytes of memory that differ from the inputs, over all points. */
+  size_t delta_size() const {
+    return delta_offset_.size();
+  }
+
+private:
+
+  /** Number of 64-bit columns for one SSE register. */
+  static constexpr size_t sse_quads_ = 4;
+
+  /** The memory segments of a state, by number: stack, heap, data, others. */
+  static size_t segment_count(const CpuState& cs) {
+    return 3 + cs.segments.size();
+  }
+  static Memory& segment(CpuState& cs, size_t i) {
+    return i == 0 ? cs.stack : i == 1 ? cs.heap : i == 2 ? cs.data : cs.segments[i-3];
+  }
+
+  /** The testcase inputs, one per trace. */
+  std::vector<CpuState> inputs_;
+  /** The trace being recorded. */
+  size_t current_;
+
+  /** Per point: block and trace. */
+  std::vector<Cfg::id_type> blocks_;
+  std::vector<size_t> trace_of_;
+  /** Points of each trace. */
+  std::vector<std::vector<size_t>> traces_;
+  /** Points of each block. */
+  std::map<Cfg::id_type, std::vector<size_t>> by_block_;
+  /** Returned by at_block() for blocks that never ran. */
+  std::vector<size_t> none_;
+
+  /** Register columns, indexed by register and point. */
+  std::vector<std::vector<uint64_t>> gp_;
+  std::vector<std::vector<uint64_t>> sse_;
+  std::vector<uint64_t> rf_;
+
+  /** Memory deltas: entries [delta_begin_[p], delta_begin_[p+1]) belong to
+    point p and are sorted by segment and offset into the segment. */
+  std::vector<size_t> delta_begin_;
+  std::vector<uint8_t> delta_segment_;
+  std::vector<uint64_t> delta_offset_;
+  std::vector<uint8_t> delta_value_;
+
+};
+
+} // namespace stoke
+
+#endif
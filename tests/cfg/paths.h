@@ -0,0 +1,121 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _STOKE_TEST_CFG_PATHS_H
+#define _STOKE_TEST_CFG_PATHS_H
+
+#include <algorithm>
+#include <sstream>
+
+#include "src/cfg/cfg.h"
+#include "src/cfg/paths.h"
+
+namespace stoke {
+
+namespace {
+
+Cfg make_nested_loop_cfg() {
+  std::stringstream ss;
+  ss << ".foo:" << std::endl;
+  ss << "movq $0x0, %rax" << std::endl;
+  ss << ".outer:" << std::endl;
+  ss << "incq %rax" << std::endl;
+  ss << ".inner:" << std::endl;
+  ss << "decq %rcx" << std::endl;
+  ss << "jne .inner" << std::endl;
+  ss << "cmpq %rax, %rdx" << std::endl;
+  ss << "jne .outer" << std::endl;
+  ss << "retq" << std::endl;
+
+  x64asm::Code c;
+  ss >> c;
+  return Cfg(c, x64asm::RegSet::universe(), x64asm::RegSet::universe());
+}
+
+bool prune_through_block(const CfgPath& prefix, void* arg) {
+  auto block = *(Cfg::id_type*)arg;
+  return std::find(prefix.begin(), prefix.end(), block) != prefix.end();
+}
+
+}
+
+TEST(CfgPathEnumeratorTest, SamePathsAsEnumeratePaths) {
+
+  auto cfg = make_nested_loop_cfg();
+
+  for (size_t bound = 0; bound < 4; ++bound) {
+    auto expected = CfgPaths::enumerate_paths(cfg, bound);
+
+    std::vector<CfgPath> actual;
+    CfgPathEnumerator paths(cfg, bound);
+    CfgPath p;
+    while (paths.next(p)) {
+      if (actual.size()) {
+        EXPECT_LE(actual.back().size(), p.size());
+      }
+      actual.push_back(p);
+    }
+
+    std::sort(expected.begin(), expected.end());
+    std::sort(actual.begin(), actual.end());
+    EXPECT_EQ(expected, actual) << "bound " << bound;
+  }
+}
+
+TEST(CfgPathEnumeratorTest, PruneCallbackDropsExtensions) {
+
+  std::stringstream ss;
+  ss << ".foo:" << std::endl;
+  ss << "movq $0x0, %rax" << std::endl;
+  ss << ".loop:" << std::endl;
+  ss << "testq %rdx, %rdx" << std::endl;
+  ss << "je .skip" << std::endl;
+  ss << "incq %rax" << std::endl;
+  ss << ".skip:" << std::endl;
+  ss << "decq %rcx" << std::endl;
+  ss << "jne .loop" << std::endl;
+  ss << "retq" << std::endl;
+
+  x64asm::Code c;
+  ss >> c;
+  Cfg cfg(c, x64asm::RegSet::universe(), x64asm::RegSet::universe());
+
+  // skip every path that takes the increment; only some of them do
+  auto optional = cfg.get_loc(5).first;
+
+  std::vector<CfgPath> expected;
+  for (auto& p : CfgPaths::enumerate_paths(cfg, 3)) {
+    if (std::find(p.begin(), p.end(), optional) == p.end()) {
+      expected.push_back(p);
+    }
+  }
+  ASSERT_LT(0ul, expected.size());
+
+  std::vector<CfgPath> actual;
+  CfgPathEnumerator paths(cfg, 3);
+  paths.set_prune_callback(prune_through_block, &optional);
+  CfgPath p;
+  while (paths.next(p)) {
+    actual.push_back(p);
+  }
+
+  std::sort(expected.begin(), expected.end());
+  std::sort(actual.begin(), actual.end());
+  EXPECT_EQ(expected, actual);
+  EXPECT_LT(0ul, paths.num_pruned());
+}
+
+} //namespace stoke
+
+#endif
@@ -80,4 +80,18 @@ TEST_F(BinSizeCostTest, Issue651) {
 
 }
 
+TEST_F(BinSizeCostTest, PadsJumpTargets) {
+
+  code << ".factorial:" << std::endl;
+  code << "movl $0x2, %edx" << std::endl;
+  code << "movl $0x1, %eax" << std::endl;
+  code << "jmp .foo" << std::endl;
+  code << ".foo:" << std::endl;
+  code << "retq" << std::endl;
+
+  fxn_.set_target_alignment(16);
+  EXPECT_EQ((uint64_t)17, binsize());
+
+}
+
 } //namespace stoke
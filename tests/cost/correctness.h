@@ -346,4 +346,44 @@ TEST_F(CorrectnessCostTest, SignalPenalty) {
 
 }
 
+TEST_F(CorrectnessCostTest, TestcaseErrorsAddUpToSum) {
+
+  // rax is 0 on even testcases and 5 on odd ones
+  for (size_t i = 0; i < 6; ++i) {
+    auto cs = get_state();
+    cs.gp[x64asm::rax].get_fixed_quad(0) = i % 2 ? 5 : 0;
+    sb_.insert_input(cs);
+  }
+
+  std::stringstream ss;
+  x64asm::Code target, rewrite;
+
+  ss << ".foo:" << std::endl;
+  ss << "incq %rax" << std::endl;
+  ss << "retq" << std::endl;
+  ss >> target;
+
+  ss.clear();
+  ss << ".foo:" << std::endl;
+  ss << "movq $0x1, %rax" << std::endl;
+  ss << "retq" << std::endl;
+  ss >> rewrite;
+
+  auto rs = x64asm::RegSet::empty() + x64asm::rax;
+  auto cfg_t = make_cfg(target, rs);
+  auto cfg_r = make_cfg(rewrite, rs);
+
+  fxn_.set_target(cfg_t, false, false);
+  auto errors = fxn_.testcase_errors(cfg_r);
+  auto cost = fxn_(cfg_r);
+
+  ASSERT_EQ(6ul, errors.size());
+  Cost sum = 0;
+  for (size_t i = 0; i < errors.size(); ++i) {
+    EXPECT_EQ(i % 2 == 1, errors[i] > 0) << "testcase " << i;
+    sum += errors[i];
+  }
+  EXPECT_EQ(cost.second, sum);
+}
+
 } //namespace
@@ -15,4 +15,6 @@
 #include "tests/cost/binsize.h"
 #include "tests/cost/correctness.h"
 #include "tests/cost/latency.h"
+#include "tests/cost/nongoal.h"
 #include "tests/cost/parser.h"
+#include "tests/cost/timed.h"
@@ -18,6 +18,9 @@
 #include "src/cfg/cfg.h"
 #include "src/cost/cost_function.h"
 #include "src/cost/latency.h"
+#include "src/cost/loop_latency.h"
+#include "src/sandbox/sandbox.h"
+#include "src/stategen/stategen.h"
 
 namespace stoke {
 
@@ -85,5 +88,51 @@ TEST_F(LatencyCostTest, NestingDepth0) {
   EXPECT_EQ(2*xorpd, fxn_(cfg).second);
 }
 
+TEST(LoopLatencyCostTest, WeightsLoopsByHitCounts) {
+  x64asm::Code c;
+
+  std::stringstream str;
+  str << ".dummy:" << std::endl;
+  str << "movl $0x4, %ecx" << std::endl;
+  str << ".loop:" << std::endl;
+  str << "decl %ecx" << std::endl;
+  str << "jne .loop" << std::endl;
+  str << "retq" << std::endl;
+  str >> c;
+
+  Cfg cfg(c, x64asm::RegSet::empty(), x64asm::RegSet::empty());
+  const auto loop = cfg.get_loc(2).first;
+
+  // Without a sandbox, the loop is weighted by the nesting penalty
+  LoopLatencyCost fxn;
+  fxn.set_nesting_penalty(10);
+  fxn(cfg);
+  EXPECT_EQ(10ul, fxn.get_weights()[loop]);
+  EXPECT_EQ(1ul, fxn.get_weights()[cfg.get_entry() + 1]);
+
+  // With one, by how often it actually runs
+  Sandbox sb;
+  for (size_t i = 0; i < 3; ++i) {
+    CpuState cs;
+    StateGen sg(&sb);
+    sg.get(cs);
+    sb.insert_input(cs);
+  }
+
+  fxn.setup_perf_sandbox(&sb);
+  const auto cost = fxn(cfg).second;
+  EXPECT_EQ(4ul, fxn.get_weights()[loop]);
+
+  // Changing what's in a block doesn't retake the counts, even when they
+  // would come out different if it did
+  x64asm::Code edit;
+  std::stringstream ss;
+  ss << "movl $0x8, %ecx" << std::endl;
+  ss >> edit;
+  cfg.get_function().replace(1, edit[0]);
+  cfg.recompute();
+  EXPECT_EQ(cost, fxn(cfg).second);
+  EXPECT_EQ(4ul, fxn.get_weights()[loop]);
+}
 
 } //namespace stoke
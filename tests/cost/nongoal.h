@@ -0,0 +1,81 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+
+#include "src/cfg/cfg.h"
+#include "src/cost/nongoal.h"
+
+namespace stoke {
+
+namespace {
+
+TUnit make_tunit(const std::string& text) {
+  std::stringstream ss(text);
+  TUnit t;
+  ss >> t;
+  return t;
+}
+
+} // namespace
+
+TEST(NonGoalCostTest, DeadCodeDoesNotChangeFingerprint) {
+
+  auto def_ins = x64asm::RegSet::empty() + x64asm::rdi + x64asm::rsi;
+  auto live_outs = x64asm::RegSet::empty() + x64asm::rax;
+
+  auto goal = make_tunit(".foo:\nmovq %rdi, %rax\naddq %rsi, %rax\nretq\n");
+  auto padded = make_tunit(".foo:\nmovq %rdi, %rcx\nmovq %rdi, %rax\nnop\n"
+                           "addq %rsi, %rax\nmovq %rsi, %rdx\nretq\n");
+  auto other = make_tunit(".foo:\nmovq %rsi, %rax\naddq %rdi, %rax\nretq\n");
+
+  Cfg target(goal, def_ins, live_outs);
+  NonGoalCost fxn;
+  fxn.set_nongoals({goal}, target);
+
+  uint64_t a = 0;
+  uint64_t b = 0;
+  uint64_t c = 0;
+  Cfg cfg_goal(goal, def_ins, live_outs);
+  Cfg cfg_padded(padded, def_ins, live_outs);
+  Cfg cfg_other(other, def_ins, live_outs);
+  ASSERT_TRUE(fxn.fingerprint(cfg_goal, a));
+  ASSERT_TRUE(fxn.fingerprint(cfg_padded, b));
+  ASSERT_TRUE(fxn.fingerprint(cfg_other, c));
+  EXPECT_EQ(a, b);
+  EXPECT_NE(a, c);
+
+  EXPECT_EQ(1ul, fxn(cfg_goal).second);
+  EXPECT_EQ(1ul, fxn(cfg_padded).second);
+  EXPECT_EQ(0ul, fxn(cfg_other).second);
+}
+
+TEST(NonGoalCostTest, RipDisplacementsFollowRemovedCode) {
+
+  auto def_ins = x64asm::RegSet::empty();
+  auto live_outs = x64asm::RegSet::empty() + x64asm::rax;
+
+  auto goal = make_tunit(".foo:\nmovq 0x10(%rip), %rax\nretq\n");
+  // Removing the 7-byte movq moves the load up, so its displacement grows
+  auto padded = make_tunit(".foo:\nmovq $0x1, %rcx\nmovq 0x9(%rip), %rax\nretq\n");
+
+  Cfg target(goal, def_ins, live_outs);
+  NonGoalCost fxn;
+  fxn.set_nongoals({goal}, target);
+
+  Cfg cfg_padded(padded, def_ins, live_outs);
+  EXPECT_EQ(1ul, fxn(cfg_padded).second);
+}
+
+} // namespace stoke
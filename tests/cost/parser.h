@@ -233,4 +233,78 @@ TEST_F(CostParserTest, TwoLeafFunctions) {
   EXPECT_EQ(a, cf->leaf_functions());
 }
 
+namespace {
+
+/** Returns a fixed cost and counts how often it was asked. */
+class CountingCost : public CostFunction {
+public:
+  CountingCost(Cost c, uint64_t e = 1) : cost(c), calls(0), evaluation_cost(e) {}
+  result_type operator()(const Cfg& cfg, Cost max = max_cost) {
+    calls++;
+    return result_type(true, cost);
+  }
+  uint64_t get_evaluation_cost() {
+    return evaluation_cost;
+  }
+  Cost cost;
+  size_t calls;
+  uint64_t evaluation_cost;
+};
+
+} // namespace
+
+TEST(ExprCostTest, LeavesAreEvaluatedLazily) {
+
+  Cfg empty({}, x64asm::RegSet::empty(), x64asm::RegSet::empty());
+  CountingCost x(10);
+  CountingCost y(5);
+  CostParser::SymbolTable table;
+  table["x"] = &x;
+  table["y"] = &y;
+
+  auto cost = CostParser("x + y", table).run();
+  auto correct = CostParser("x == 10", table).run();
+  ASSERT_TRUE(cost && correct);
+  cost->set_correctness(correct);
+
+  // Without a bound, everything is evaluated, and x only once
+  auto res = (*cost)(empty);
+  EXPECT_TRUE(res.first);
+  EXPECT_EQ(15ul, res.second);
+  EXPECT_EQ(1ul, x.calls);
+  EXPECT_EQ(1ul, y.calls);
+
+  // Once x reaches the bound, y doesn't matter
+  res = (*cost)(empty, 8);
+  EXPECT_LE(8ul, res.second);
+  EXPECT_EQ(2ul, x.calls);
+  EXPECT_EQ(1ul, y.calls);
+
+  // Nothing times zero is still zero
+  y.cost = 0;
+  auto product = CostParser("y * x", table).run();
+  ASSERT_TRUE(product);
+  x.calls = y.calls = 0;
+  EXPECT_EQ(0ul, (*product)(empty).second);
+  EXPECT_EQ(0ul, x.calls);
+}
+
+TEST(ExprCostTest, ExpensiveLeavesAreEvaluatedLast) {
+
+  Cfg empty({}, x64asm::RegSet::empty(), x64asm::RegSet::empty());
+  CountingCost slow(10, CostFunction::max_evaluation_cost);
+  CountingCost fast(10);
+  CostParser::SymbolTable table;
+  table["slow"] = &slow;
+  table["fast"] = &fast;
+
+  // Written first, but it doesn't run: the cheap operand already reaches the
+  // bound
+  auto cost = CostParser("slow + fast", table).run();
+  ASSERT_TRUE(cost);
+  EXPECT_LE(8ul, (*cost)(empty, 8).second);
+  EXPECT_EQ(1ul, fast.calls);
+  EXPECT_EQ(0ul, slow.calls);
+}
+
 }//namespace stoke
@@ -0,0 +1,84 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+
+#include "src/cfg/cfg.h"
+#include "src/cost/timed.h"
+#include "src/sandbox/sandbox.h"
+#include "src/stategen/stategen.h"
+
+namespace stoke {
+
+// Nothing here compares timings; see timed_long.h for that.
+
+TEST(TimedCostTest, NoTestcasesCostThePenalty) {
+
+  std::stringstream ss;
+  ss << ".foo:" << std::endl;
+  ss << "retq" << std::endl;
+  x64asm::Code c;
+  ss >> c;
+  Cfg cfg(c, x64asm::RegSet::universe(), x64asm::RegSet::universe());
+
+  TimedCost fxn;
+  fxn.set_error_penalty(1234);
+
+  double cycles = 0;
+  EXPECT_FALSE(fxn.measure(cfg, cycles));
+
+  auto result = fxn(cfg);
+  EXPECT_TRUE(result.first);
+  EXPECT_EQ(1234ul, result.second);
+}
+
+TEST(TimedCostTest, FaultingTestcasesCostThePenalty) {
+
+  std::stringstream ss;
+  ss << ".foo:" << std::endl;
+  ss << "movq $0x0, %rax" << std::endl;
+  ss << "movq (%rax), %rax" << std::endl;
+  ss << "retq" << std::endl;
+  x64asm::Code c;
+  ss >> c;
+  Cfg cfg(c, x64asm::RegSet::universe(), x64asm::RegSet::universe());
+
+  Sandbox sb;
+  sb.set_abi_check(false);
+  for (size_t i = 0; i < 2; ++i) {
+    CpuState cs;
+    StateGen sg(&sb);
+    sg.get(cs);
+    sb.insert_input(cs);
+  }
+
+  TimedCost fxn;
+  fxn.set_warmup(0).set_repetitions(1);
+  fxn.set_error_penalty(1234);
+  fxn.setup_perf_sandbox(&sb);
+
+  auto result = fxn(cfg);
+  EXPECT_TRUE(result.first);
+  EXPECT_EQ(1234ul, result.second);
+
+  // The second lookup comes from the cache
+  EXPECT_EQ(1234ul, fxn(cfg).second);
+  size_t lookups = 0;
+  size_t hits = 0;
+  fxn.get_cache_statistics(lookups, hits);
+  EXPECT_EQ(2ul, lookups);
+  EXPECT_EQ(1ul, hits);
+}
+
+} // namespace stoke
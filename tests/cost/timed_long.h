@@ -0,0 +1,73 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+
+#include "src/cfg/cfg.h"
+#include "src/cost/timed.h"
+#include "src/sandbox/sandbox.h"
+#include "src/stategen/stategen.h"
+
+namespace stoke {
+
+TEST(TimedCostLongTest, SlowerCodeCostsMore) {
+
+  std::stringstream ss;
+  ss << ".foo:" << std::endl;
+  ss << "retq" << std::endl;
+  x64asm::Code fast;
+  ss >> fast;
+
+  // Divisions are slow enough that timer noise can't cover up 16 of them
+  ss.clear();
+  ss << ".foo:" << std::endl;
+  ss << "movl $0x10, %ecx" << std::endl;
+  ss << ".loop:" << std::endl;
+  ss << "movl $0x1, %edx" << std::endl;
+  ss << "movl $0xffffffff, %eax" << std::endl;
+  ss << "movl $0x3, %esi" << std::endl;
+  ss << "divl %esi" << std::endl;
+  ss << "decl %ecx" << std::endl;
+  ss << "jne .loop" << std::endl;
+  ss << "retq" << std::endl;
+  x64asm::Code slow;
+  ss >> slow;
+
+  Sandbox sb;
+  sb.set_max_jumps(32);
+  sb.set_abi_check(false);
+  for (size_t i = 0; i < 2; ++i) {
+    CpuState cs;
+    StateGen sg(&sb);
+    sg.get(cs);
+    sb.insert_input(cs);
+  }
+
+  TimedCost fxn;
+  fxn.set_repetitions(32);
+  fxn.setup_perf_sandbox(&sb);
+
+  Cfg cfg_fast(fast, x64asm::RegSet::universe(), x64asm::RegSet::universe());
+  Cfg cfg_slow(slow, x64asm::RegSet::universe(), x64asm::RegSet::universe());
+
+  const auto a = fxn(cfg_fast).second;
+  const auto b = fxn(cfg_slow).second;
+  EXPECT_LT(a, b);
+
+  // Seen before, so the same
+  EXPECT_EQ(a, fxn(cfg_fast).second);
+  EXPECT_EQ(b, fxn(cfg_slow).second);
+}
+
+} // namespace stoke
@@ -12,6 +12,14 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <elf.h>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
 #include "src/disassembler/disassembler.h"
 #include "src/tunit/tunit.h"
 
@@ -162,4 +170,84 @@ TEST(DisassemblerTest, NoShellInjection) {
   EXPECT_EQ("Character ' ' not allowed in filename for security.", d.get_error());
 }
 
+TEST(DisassemblerTest, ThreadsMatchSerial) {
+
+  auto run = [](const std::string& file, size_t threads) {
+    std::vector<std::string> result;
+    Disassembler::Callback record = [&](const FunctionCallbackData & fcd) {
+      std::stringstream ss;
+      ss << fcd.name << " " << fcd.parse_error << " " << fcd.tunit.get_file_offset() << " "
+         << fcd.tunit.get_rip_offset() << " " << fcd.tunit.hex_capacity() << std::endl;
+      if (!fcd.parse_error) {
+        ss << fcd.tunit;
+      }
+      result.push_back(ss.str());
+    };
+
+    Disassembler d;
+    d.set_function_callback(&record);
+    d.set_threads(threads);
+    d.disassemble(file);
+    EXPECT_FALSE(d.has_error()) << d.get_error();
+    return result;
+  };
+
+  for (auto f : {"sample", "popcnt", "errors"}) {
+    const auto file = std::string("tests/fixtures/disassembler/") + f;
+    const auto serial = run(file, 1);
+    EXPECT_LT(0ul, serial.size()) << file;
+    for (size_t threads : {2, 4, 16}) {
+      EXPECT_EQ(serial, run(file, threads)) << file << " with " << threads << " threads";
+    }
+  }
+}
+
+TEST(DisassemblerTest, ElfReaderFindsText) {
+  ElfReader elf;
+  elf.read("tests/fixtures/disassembler/popcnt");
+  ASSERT_FALSE(elf.has_error()) << elf.get_error();
+  ASSERT_TRUE(elf.has_section(".text"));
+  EXPECT_EQ(0x400440ul, elf.section_address(".text"));
+  EXPECT_EQ(0x400000ul, elf.section_offset(".text"));
+
+  bool found_popcnt = false;
+  for (const auto& sym : elf.get_symbols(".text")) {
+    if (sym.name == "_Z6popcntm") {
+      EXPECT_EQ(0x400570ul, sym.address);
+      found_popcnt = true;
+    }
+  }
+  EXPECT_TRUE(found_popcnt);
+
+  elf.read("tests/fixtures/simple.json");
+  EXPECT_TRUE(elf.has_error());
+}
+
+TEST(DisassemblerTest, ElfReaderRejectsHugeSection) {
+  std::ifstream ifs("tests/fixtures/disassembler/popcnt", std::ios::binary);
+  std::stringstream ss;
+  ss << ifs.rdbuf();
+  auto bytes = ss.str();
+  ASSERT_GE(bytes.size(), sizeof(Elf64_Ehdr));
+
+  // Claim that the section name table is a terabyte long
+  Elf64_Ehdr ehdr;
+  memcpy(&ehdr, bytes.data(), sizeof(ehdr));
+  const auto shdr = ehdr.e_shoff + ehdr.e_shstrndx * sizeof(Elf64_Shdr);
+  ASSERT_LE(shdr + sizeof(Elf64_Shdr), bytes.size());
+  const uint64_t huge = 1ull << 40;
+  memcpy(&bytes[shdr + offsetof(Elf64_Shdr, sh_size)], &huge, sizeof(huge));
+
+  char path[] = "/tmp/stoke_elf_XXXXXX";
+  const auto fd = mkstemp(path);
+  ASSERT_NE(-1, fd);
+  ASSERT_EQ((ssize_t)bytes.size(), write(fd, bytes.data(), bytes.size()));
+  close(fd);
+
+  ElfReader elf;
+  elf.read(path);
+  unlink(path);
+  EXPECT_TRUE(elf.has_error());
+}
+
 } //namespace stoke
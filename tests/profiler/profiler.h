@@ -0,0 +1,68 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef _STOKE_TEST_PROFILER_PROFILER_H
+#define _STOKE_TEST_PROFILER_PROFILER_H
+
+#include <sstream>
+
+#include "src/cfg/cfg.h"
+#include "src/profiler/profiler.h"
+#include "src/sandbox/sandbox.h"
+
+namespace stoke {
+
+TEST(ProfilerTest, CountsOnlyWhileEnabled) {
+
+  std::stringstream ss;
+  ss << ".foo:" << std::endl;
+  ss << "incq %rax" << std::endl;
+  ss << "retq" << std::endl;
+  x64asm::Code c;
+  ss >> c;
+
+  Profiler::set_enabled(false);
+  Profiler::clear();
+  Cfg cfg(TUnit(c), x64asm::RegSet::universe(), x64asm::RegSet::universe());
+  EXPECT_EQ(0ul, Profiler::get(Profiler::RECOMPUTE_DEFS).calls);
+
+  Sandbox sb;
+  sb.set_abi_check(false);
+  CpuState tc;
+  sb.insert_input(tc);
+  sb.insert_input(tc);
+
+  Profiler::set_enabled(true);
+  cfg.recompute_defs();
+  sb.insert_function(cfg);
+  sb.set_entrypoint(cfg.get_code()[0].get_operand<x64asm::Label>(0));
+  sb.run();
+  Profiler::set_enabled(false);
+  sb.run();
+
+  EXPECT_EQ(1ul, Profiler::get(Profiler::RECOMPUTE_DEFS).calls);
+  EXPECT_LT(0ul, Profiler::get(Profiler::RECOMPUTE_DEFS).cycles);
+  EXPECT_EQ(1ul, Profiler::get(Profiler::SANDBOX_RECOMPILE).calls);
+  EXPECT_EQ(2ul, Profiler::get(Profiler::SANDBOX_RUN).calls);
+  EXPECT_EQ(0ul, Profiler::get(Profiler::TRANSFORM).calls);
+
+  Profiler::clear();
+  EXPECT_EQ(0ul, Profiler::get(Profiler::SANDBOX_RUN).calls);
+  EXPECT_EQ(0ul, Profiler::get(Profiler::SANDBOX_RUN).cycles);
+}
+
+} //namespace stoke
+
+#endif
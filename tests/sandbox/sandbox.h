@@ -1128,4 +1128,99 @@ TEST(SandboxTest, DivideBySpl1) {
 
 }
 
+TEST(SandboxTest, CountersAndBlockTrace) {
+
+  x64asm::Code c;
+  std::stringstream ss;
+
+  ss << ".foo:" << std::endl;
+  ss << "xorq %rcx, %rcx" << std::endl;
+  ss << ".L1:" << std::endl;
+  ss << "incq %rcx" << std::endl;
+  ss << "cmpq $0x10, %rcx" << std::endl;
+  ss << "jne .L1" << std::endl;
+  ss << "retq" << std::endl;
+
+  ss >> c;
+  Cfg cfg(TUnit(c), x64asm::RegSet::universe(), x64asm::RegSet::universe());
+  const auto loop = cfg.get_loc(2).first;
+
+  Sandbox sb;
+  CpuState tc;
+  StateGen sg(&sb);
+  sg.get(tc);
+
+  sb.set_max_jumps(17);
+  sb.set_abi_check(false);
+  sb.insert_input(tc);
+  sb.insert_function(cfg);
+
+  const auto& label = cfg.get_function().get_leading_label();
+  const auto hits = sb.insert_block_counter(label, loop);
+  const auto latency = sb.insert_latency_counter();
+  const auto taken = sb.insert_branch_counter(label, 5);
+  sb.insert_block_trace(label);
+  sb.run();
+
+  // The counters are emitted between the cmpq and the jne, so the loop only
+  // ends on time if they leave the flags alone
+  ASSERT_EQ(ErrorCode::NORMAL, sb.result_begin()->code);
+  EXPECT_EQ(0x10ul, sb.result_begin()->gp[x64asm::rcx].get_fixed_quad(0));
+  EXPECT_EQ(0x10ul, sb.get_counter(0, hits));
+  EXPECT_EQ(0xful, sb.get_counter(0, taken));
+
+  uint64_t expected = 0;
+  for (size_t i = 0; i < c.size(); ++i) {
+    expected += c[i].haswell_latency() * (cfg.get_loc(i).first == loop ? 0x10 : 1);
+  }
+  EXPECT_EQ(expected, sb.get_counter(0, latency));
+
+  const auto& trace = sb.get_block_trace(0);
+  EXPECT_FALSE(sb.block_trace_truncated(0));
+  ASSERT_EQ(0x12ul, trace.size());
+  EXPECT_EQ(cfg.get_loc(0).first, trace.front());
+  EXPECT_EQ(loop, trace[1]);
+  EXPECT_EQ(cfg.get_loc(c.size() - 1).first, trace.back());
+}
+
+TEST(SandboxTest, AddressCounters) {
+
+  x64asm::Code c;
+  std::stringstream ss;
+
+  ss << ".foo:" << std::endl;
+  ss << "movq 0x8(%rsp), %rax" << std::endl;
+  ss << "pushq %rax" << std::endl;
+  ss << "popq %rdx" << std::endl;
+  ss << "movl %eax, -0x4(%rsp)" << std::endl;
+  ss << "retq" << std::endl;
+
+  ss >> c;
+  Cfg cfg(TUnit(c), x64asm::RegSet::universe(), x64asm::RegSet::universe());
+
+  Sandbox sb;
+  sb.set_abi_check(false);
+  CpuState tc;
+  StateGen sg(&sb);
+  ASSERT_TRUE(sg.get(tc, cfg)) << sg.get_error();
+
+  sb.insert_input(tc);
+  sb.insert_function(cfg);
+  const auto& label = cfg.get_function().get_leading_label();
+  std::vector<size_t> counters;
+  for (size_t i = 1; i <= 4; ++i) {
+    counters.push_back(sb.insert_address_counter(label, i));
+  }
+  sb.run();
+
+  // None of these lines change %rsp on balance, so every address is
+  // relative to the input's
+  ASSERT_EQ(ErrorCode::NORMAL, sb.result_begin()->code);
+  const auto rsp = tc.gp[x64asm::rsp].get_fixed_quad(0);
+  EXPECT_EQ(rsp + 0x8, sb.get_counter(0, counters[0]));
+  EXPECT_EQ(rsp - 0x8, sb.get_counter(0, counters[1]));
+  EXPECT_EQ(rsp - 0x8, sb.get_counter(0, counters[2]));
+  EXPECT_EQ(rsp - 0x4, sb.get_counter(0, counters[3]));
+}
+
 } //namespace
@@ -0,0 +1,107 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef _STOKE_TEST_SEARCH_METRICS_H
+#define _STOKE_TEST_SEARCH_METRICS_H
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+#include "src/search/metrics.h"
+#include "src/transform/all_transforms.h"
+#include "src/transform/weighted.h"
+
+namespace stoke {
+
+TEST(MetricsWriterTest, TotalsSurviveRestarts) {
+
+  TransformPools pools;
+  AddNopsTransform add_nops(pools);
+  DeleteTransform del(pools);
+  WeightedTransform transform(pools);
+  transform.insert_transform(&add_nops);
+  transform.insert_transform(&del);
+
+  std::vector<PhaseProfile> phases;
+  std::vector<Statistics> moves(2);
+  moves[0].num_proposed = 3;
+  moves[0].num_succeeded = 2;
+  moves[0].num_accepted = 1;
+  moves[1].num_proposed = 2;
+  StatisticsCallbackData first = {moves, 5, std::chrono::duration<double>(2.0), &transform,
+                                  10, 7, 7, std::chrono::duration<double>(0.5), std::chrono::duration<double>(1.0),
+                                  phases
+                                 };
+
+  MetricsWriter metrics;
+  metrics.record(first).next_search();
+
+  moves[0].num_proposed = 1;
+  moves[1].num_proposed = 2;
+  StatisticsCallbackData second = {moves, 3, std::chrono::duration<double>(1.5), &transform,
+                                   4, 4, 4, std::chrono::duration<double>(0.25), std::chrono::duration<double>(0.75),
+                                   phases
+                                  };
+  metrics.record(second);
+
+  std::stringstream ss;
+  metrics.write(ss);
+  const auto text = ss.str();
+
+  EXPECT_NE(std::string::npos, text.find("# TYPE stoke_search_iterations_total counter\n"));
+  EXPECT_NE(std::string::npos, text.find("\nstoke_search_iterations_total 8\n"));
+  EXPECT_NE(std::string::npos, text.find("\nstoke_search_iterations_per_second 2\n"));
+  EXPECT_NE(std::string::npos, text.find("\nstoke_search_moves_total{move=\"Add Nops\",outcome=\"proposed\"} 4\n"));
+  EXPECT_NE(std::string::npos, text.find("\nstoke_search_moves_total{move=\"Delete\",outcome=\"proposed\"} 4\n"));
+  EXPECT_NE(std::string::npos, text.find("\nstoke_search_moves_total{move=\"Add Nops\",outcome=\"accepted\"} 2\n"));
+  EXPECT_NE(std::string::npos, text.find("\nstoke_search_cost{rewrite=\"current\"} 4\n"));
+  EXPECT_NE(std::string::npos, text.find("\nstoke_search_phase_seconds_total{phase=\"transform\"} 0.75\n"));
+  EXPECT_NE(std::string::npos, text.find("\nstoke_search_phase_seconds_total{phase=\"cost\"} 1.75\n"));
+}
+
+TEST(MetricsWriterTest, UpdateReplacesFile) {
+
+  char dir[] = "/tmp/stoke_metrics_XXXXXX";
+  ASSERT_NE(nullptr, mkdtemp(dir));
+  const auto path = std::string(dir) + "/metrics.prom";
+
+  TransformPools pools;
+  WeightedTransform transform(pools);
+  std::vector<Statistics> moves;
+  std::vector<PhaseProfile> phases;
+  StatisticsCallbackData data = {moves, 1, std::chrono::duration<double>(1.0), &transform,
+                                 1, 1, 1, std::chrono::duration<double>(0.0), std::chrono::duration<double>(0.0),
+                                 phases
+                                };
+
+  MetricsWriter metrics;
+  metrics.set_path(path).update(data);
+  EXPECT_FALSE(metrics.has_error()) << metrics.get_error();
+
+  std::ifstream ifs(path);
+  std::string line;
+  ASSERT_TRUE(std::getline(ifs, line));
+  EXPECT_EQ(0ul, line.find("# HELP "));
+  EXPECT_NE(0, access((path + ".tmp").c_str(), F_OK));
+
+  metrics.set_path(std::string(dir) + "/missing/metrics.prom").update(data);
+  EXPECT_TRUE(metrics.has_error());
+}
+
+} //namespace stoke
+
+#endif
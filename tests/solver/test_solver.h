@@ -31,7 +31,14 @@ public:
       delete it;
   }
 
+  SMTSolver* clone() const {
+    auto s = new TestSolver();
+    s->set_timeout(timeout_);
+    return s;
+  }
+
   SMTSolver& set_timeout(uint64_t timeout) {
+    timeout_ = timeout;
     for (auto it : solvers_) {
       it->set_timeout(timeout);
     }
@@ -13,6 +13,13 @@
 // limitations under the License.
 
 
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+#include "src/solver/query_trace.h"
 #include "src/solver/z3solver.h"
 
 namespace stoke {
@@ -314,4 +321,41 @@ TEST(Z3SolverTest, DifferentStoreStoreLoadEqual) {
   EXPECT_FALSE(z3.has_error()) << "Z3 encountered: " << z3.get_error();
 }
 
+TEST(Z3SolverTest, QueryTraceRecordsSampledQueries) {
+
+  char dir[] = "/tmp/stoke_smt_trace_XXXXXX";
+  ASSERT_NE(nullptr, mkdtemp(dir));
+  ASSERT_TRUE(QueryTrace::open(dir, 2)) << QueryTrace::get_error();
+
+  auto x = SymBitVector::var(64, "x");
+  std::vector<SymBool> sat = { x == SymBitVector::constant(64, 3) };
+  std::vector<SymBool> unsat = { x != x };
+
+  Z3Solver z3;
+  EXPECT_TRUE(z3.is_sat(sat));
+  EXPECT_TRUE(z3.is_sat(sat));
+  EXPECT_FALSE(z3.is_sat(unsat));
+  QueryTrace::close();
+  EXPECT_FALSE(QueryTrace::enabled());
+
+  // queries 0 and 2 are sampled
+  std::ifstream index(std::string(dir) + "/queries.tsv");
+  std::vector<std::string> lines;
+  std::string line;
+  while (std::getline(index, line))
+    lines.push_back(line);
+  ASSERT_EQ(3ul, lines.size());
+  EXPECT_EQ(0ul, lines[1].find("0\t"));
+  EXPECT_NE(std::string::npos, lines[1].find("\tsat\t"));
+  EXPECT_EQ(0ul, lines[2].find("2\t"));
+  EXPECT_NE(std::string::npos, lines[2].find("\tunsat\t"));
+
+  std::ifstream script(std::string(dir) + "/query-2.smt2");
+  EXPECT_TRUE(script.is_open());
+
+  for (auto file : { "/queries.tsv", "/query-0.smt2", "/query-2.smt2" })
+    remove((std::string(dir) + file).c_str());
+  EXPECT_EQ(0, rmdir(dir));
+}
+
 }
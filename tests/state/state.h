@@ -15,6 +15,7 @@
 #include "src/ext/x64asm/include/x64asm.h"
 #include "src/cfg/cfg.h"
 #include "src/sandbox/sandbox.h"
+#include "src/state/cpu_states_view.h"
 #include "src/stategen/stategen.h"
 
 namespace stoke {
@@ -58,6 +59,88 @@ TEST_F(StateRandomTest, Issue55Text) {
   ASSERT_EQ(state_, result);
 }
 
+// Checks the indexed format through a stream and through a view
+TEST_F(StateRandomTest, IndexedRoundTrip) {
+  CpuStates tcs;
+  tcs.push_back(state_);
+  tcs.push_back(CpuState());
+  tcs.push_back(state_);
+
+  std::stringstream ss;
+  CpuStatesView::write(ss, tcs);
+  const auto bytes = ss.str();
+
+  ASSERT_TRUE(CpuStatesView::is_indexed(ss));
+  CpuStates result;
+  CpuStatesView::read(ss, result);
+  ASSERT_FALSE(ss.fail());
+  ASSERT_EQ(tcs, result);
+
+  CpuStatesView view;
+  view.open(bytes.data(), bytes.size());
+  ASSERT_FALSE(view.has_error()) << view.get_error();
+  ASSERT_EQ(tcs.size(), view.size());
+  CpuState one;
+  EXPECT_TRUE(view.get(1, one));
+  EXPECT_EQ(tcs[1], one);
+  EXPECT_EQ(tcs[2], view[2]);
+  EXPECT_EQ(&view[2], &view[2]);
+
+  auto bad = bytes;
+  bad[8] = 2;
+  view.open(bad.data(), bad.size());
+  EXPECT_TRUE(view.has_error());
+  EXPECT_EQ(0ul, view.size());
+
+  view.open(bytes.data(), bytes.size() - 1);
+  EXPECT_TRUE(view.has_error());
+}
+
+// A blob that ends early is an error, not a partial state
+TEST_F(StateRandomTest, IndexedViewTruncatedBlob) {
+  CpuStates tcs;
+  tcs.push_back(state_);
+  tcs.push_back(state_);
+
+  std::stringstream ss;
+  CpuStatesView::write(ss, tcs);
+  auto bytes = ss.str();
+
+  // Move the end of the first testcase back, so its blob is cut short
+  uint64_t end = 0;
+  memcpy(&end, &bytes[32], sizeof(end));
+  end -= 16;
+  memcpy(&bytes[32], &end, sizeof(end));
+
+  CpuStatesView view;
+  view.open(bytes.data(), bytes.size());
+  ASSERT_FALSE(view.has_error()) << view.get_error();
+
+  CpuStates result;
+  EXPECT_FALSE(view.get_all(result));
+  EXPECT_TRUE(view.has_error());
+  EXPECT_EQ(0ul, result.size());
+}
+
+// A count from the header shouldn't be trusted past the end of the data
+TEST_F(StateRandomTest, IndexedReadHugeCount) {
+  CpuStates tcs;
+  tcs.push_back(state_);
+  tcs.push_back(state_);
+
+  std::stringstream ss;
+  CpuStatesView::write(ss, tcs);
+  auto bytes = ss.str();
+  const uint64_t count = 1ull << 60;
+  memcpy(&bytes[16], &count, sizeof(count));
+
+  std::istringstream iss(bytes);
+  CpuStates result;
+  CpuStatesView::read(iss, result);
+  EXPECT_TRUE(iss.fail());
+  EXPECT_GE(tcs.size(), result.size());
+}
+
 TEST_F(StateRandomTest, GetAddrExplicit) {
 
   // Code for sandbox
@@ -370,6 +370,57 @@ TEST(StateGenTest, EasyToAvoidMisalign) {
   EXPECT_TRUE(sg.get(tc, cfg_t));
 }
 
+TEST(StateGenTest, BatchIndependentOfThreads) {
+
+  std::stringstream ss;
+  ss << ".foo:" << std::endl;
+  ss << "movq (%rdi), %rax" << std::endl;
+  ss << "movl %eax, 0x20(%rsi)" << std::endl;
+  ss << "retq" << std::endl;
+
+  x64asm::Code c;
+  ss >> c;
+  Cfg cfg_t(c, x64asm::RegSet::universe(), x64asm::RegSet::empty());
+
+  Sandbox sg_sb;
+  sg_sb.set_max_jumps(2)
+  .set_abi_check(false);
+
+  CpuStates serial;
+  StateGen sg1(&sg_sb);
+  sg1.set_max_attempts(16)
+  .set_max_memory(1000)
+  .set_seed(42);
+  EXPECT_EQ(8ul, sg1.get(serial, cfg_t, 8, 1)) << sg1.get_error();
+
+  CpuStates parallel;
+  StateGen sg4(&sg_sb);
+  sg4.set_max_attempts(16)
+  .set_max_memory(1000)
+  .set_seed(42);
+  EXPECT_EQ(8ul, sg4.get(parallel, cfg_t, 8, 4)) << sg4.get_error();
+
+  ASSERT_EQ(serial.size(), parallel.size());
+  for (size_t i = 0; i < serial.size(); ++i) {
+    EXPECT_TRUE(serial[i] == parallel[i]) << "testcase " << i;
+  }
+
+  // A second batch continues the streams instead of repeating them
+  CpuStates next;
+  sg1.get(next, cfg_t, 8, 1);
+  ASSERT_EQ(serial.size(), next.size());
+  EXPECT_FALSE(serial[0] == next[0]);
+
+  // Reseeding starts the batches over
+  CpuStates again;
+  sg1.set_seed(42);
+  sg1.get(again, cfg_t, 8, 1);
+  ASSERT_EQ(serial.size(), again.size());
+  for (size_t i = 0; i < serial.size(); ++i) {
+    EXPECT_TRUE(serial[i] == again[i]) << "testcase " << i;
+  }
+}
+
 INSTANTIATE_TEST_CASE_P(
   StategenFixtures,
   StateGenParamTest,
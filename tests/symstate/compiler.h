@@ -0,0 +1,402 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "src/sandbox/sandbox.h"
+#include "src/stategen/stategen.h"
+#include "src/symstate/compiler.h"
+#include "src/symstate/state.h"
+#include "src/validator/handlers/combo_handler.h"
+
+#include "tests/fuzzer.h"
+
+namespace stoke {
+
+TEST(SymCompilerTest, SixtyFourBitArithmetic) {
+
+  auto x = SymBitVector::var(64, "x");
+  auto y = SymBitVector::var(64, "y");
+
+  SymCompiler c;
+  c.add_input(x);
+  c.add_input(y);
+  c.add_output(x + y);
+  c.add_output(x - y);
+  c.add_output(x * y);
+  c.add_output(x / y);
+  c.add_output(x % y);
+  c.add_output(x.s_div(y));
+  c.add_output(x.s_mod(y));
+  c.add_output(x << y);
+  c.add_output(x >> y);
+  c.add_output(x.s_shr(y));
+  c.add_output(x.rol(y));
+  c.add_output(x.ror(y));
+  ASSERT_TRUE(c.compile()) << c.get_error();
+  ASSERT_EQ(2ul, c.num_input_words());
+  ASSERT_EQ(12ul, c.num_output_words());
+
+  uint64_t in[2] = { 0xfffffffffffffff0, 3 };
+  uint64_t out[12];
+  c.eval(in, out);
+
+  EXPECT_EQ(0xfffffffffffffff3ul, out[0]);
+  EXPECT_EQ(0xffffffffffffffedul, out[1]);
+  EXPECT_EQ(0xffffffffffffffd0ul, out[2]);
+  EXPECT_EQ(0xfffffffffffffff0ul / 3, out[3]);
+  EXPECT_EQ(0xfffffffffffffff0ul % 3, out[4]);
+  EXPECT_EQ((uint64_t)(-16/3), out[5]);
+  EXPECT_EQ((uint64_t)(-16%3), out[6]);
+  EXPECT_EQ(0xffffffffffffff80ul, out[7]);
+  EXPECT_EQ(0x1ffffffffffffffeul, out[8]);
+  EXPECT_EQ(0xfffffffffffffffeul, out[9]);
+  EXPECT_EQ(0xffffffffffffff87ul, out[10]);
+  EXPECT_EQ(0x1ffffffffffffffeul, out[11]);
+}
+
+TEST(SymCompilerTest, DivisionByZeroAndOverflowFollowSmtLib) {
+
+  auto x = SymBitVector::var(64, "x");
+  auto y = SymBitVector::var(64, "y");
+
+  SymCompiler c;
+  c.add_input(x);
+  c.add_input(y);
+  c.add_output(x / y);
+  c.add_output(x % y);
+  c.add_output(x.s_div(y));
+  c.add_output(x.s_mod(y));
+  ASSERT_TRUE(c.compile()) << c.get_error();
+
+  uint64_t out[4];
+
+  uint64_t zero[2] = { 7, 0 };
+  c.eval(zero, out);
+  EXPECT_EQ(0xfffffffffffffffful, out[0]);
+  EXPECT_EQ(7ul, out[1]);
+  EXPECT_EQ(0xfffffffffffffffful, out[2]);
+  EXPECT_EQ(7ul, out[3]);
+
+  uint64_t overflow[2] = { 0x8000000000000000, 0xffffffffffffffff };
+  c.eval(overflow, out);
+  EXPECT_EQ(0x8000000000000000ul, out[2]);
+  EXPECT_EQ(0ul, out[3]);
+}
+
+TEST(SymCompilerTest, NarrowWidthsAreMasked) {
+
+  auto x = SymBitVector::var(8, "x");
+  auto y = SymBitVector::var(8, "y");
+
+  SymCompiler c;
+  c.add_input(x);
+  c.add_input(y);
+  c.add_output(x + y);
+  c.add_output(!x);
+  c.add_output(x << y);
+  c.add_output(x.s_shr(y));
+  c.add_output(x.rol(y));
+  c.add_output(x.sign_extend(16));
+  c.add_output(x.s_lt(y));
+  c.add_output(x < y);
+  ASSERT_TRUE(c.compile()) << c.get_error();
+
+  // Garbage above the width of the inputs must be ignored
+  uint64_t in[2] = { 0xabcdef00000000f0, 0x1234000000000013 };
+  uint64_t out[8];
+  c.eval(in, out);
+
+  EXPECT_EQ(0x03ul, out[0]);
+  EXPECT_EQ(0x0ful, out[1]);
+  EXPECT_EQ(0x00ul, out[2]);
+  EXPECT_EQ(0xfful, out[3]);
+  EXPECT_EQ(0x87ul, out[4]);
+  EXPECT_EQ(0xfff0ul, out[5]);
+  EXPECT_EQ(1ul, out[6]);
+  EXPECT_EQ(0ul, out[7]);
+}
+
+TEST(SymCompilerTest, MultiwordValues) {
+
+  auto x = SymBitVector::var(64, "x");
+  auto y = SymBitVector::var(64, "y");
+  auto z = SymBitVector::var(128, "z");
+
+  SymCompiler c;
+  c.add_input(x);
+  c.add_input(y);
+  c.add_input(z);
+  c.add_output((x || y) + z);
+  c.add_output(((x || y) - z)[99][36]);
+  c.add_output(x.sign_extend(192));
+  c.add_output(z << SymBitVector::constant(128, 68));
+  c.add_output(z.rol(SymBitVector::constant(128, 4)));
+  c.add_output((x || y) == z);
+  c.add_output((x || y).s_lt(z));
+  c.add_output((x || y) < z);
+  ASSERT_TRUE(c.compile()) << c.get_error();
+  ASSERT_EQ(4ul, c.num_input_words());
+  ASSERT_EQ(14ul, c.num_output_words());
+
+  uint64_t in[4] = { 0x8000000000000000, 0xffffffffffffffff, 1, 0x0123456789abcdef };
+  uint64_t out[14];
+  c.eval(in, out);
+
+  // (x || y) + z, carrying out of the low word
+  EXPECT_EQ(0ul, out[0]);
+  EXPECT_EQ(0x8123456789abcdf0ul, out[1]);
+  // bits 36..99 of (x || y) - z
+  EXPECT_EQ(0x7edcba987654320ful, out[2]);
+  EXPECT_EQ(0ul, out[3]);
+  // sign extension of x
+  EXPECT_EQ(0x8000000000000000ul, out[4]);
+  EXPECT_EQ(0xfffffffffffffffful, out[5]);
+  EXPECT_EQ(0xfffffffffffffffful, out[6]);
+  // z << 68
+  EXPECT_EQ(0ul, out[7]);
+  EXPECT_EQ(0x10ul, out[8]);
+  // z rotated left by 4
+  EXPECT_EQ(0x10ul, out[9]);
+  EXPECT_EQ(0x123456789abcdef0ul, out[10]);
+  // comparisons
+  EXPECT_EQ(0ul, out[11]);
+  EXPECT_EQ(1ul, out[12]);
+  EXPECT_EQ(0ul, out[13]);
+}
+
+TEST(SymCompilerTest, BatchEvaluation) {
+
+  auto x = SymBitVector::var(32, "x");
+  auto b = SymBool::var("b");
+
+  SymCompiler c;
+  c.add_input(x);
+  c.add_input(b);
+  c.add_output(b.ite(x + SymBitVector::constant(32, 1), x));
+  c.add_output(!b | (x == SymBitVector::constant(32, 5)));
+  ASSERT_TRUE(c.compile()) << c.get_error();
+
+  const size_t n = 100;
+  std::vector<uint64_t> in(2*n);
+  std::vector<uint64_t> out(2*n);
+  for (size_t i = 0; i < n; ++i) {
+    in[2*i] = i;
+    in[2*i+1] = i % 2;
+  }
+  c.eval_batch(in.data(), out.data(), n);
+
+  for (size_t i = 0; i < n; ++i) {
+    EXPECT_EQ(i % 2 ? i + 1 : i, out[2*i]);
+    EXPECT_EQ(i % 2 == 0 || i == 5 ? 1ul : 0ul, out[2*i+1]);
+  }
+}
+
+TEST(SymCompilerTest, ReportsUnsupportedCircuits) {
+
+  auto x = SymBitVector::var(64, "x");
+  auto y = SymBitVector::var(64, "y");
+
+  SymCompiler c;
+  c.add_input(x);
+  c.add_output(x + y);
+  EXPECT_FALSE(c.compile());
+  EXPECT_TRUE(c.has_error());
+
+  auto z = SymBitVector::var(128, "z");
+  c.clear();
+  c.add_input(z);
+  c.add_output(z * z);
+  EXPECT_FALSE(c.compile());
+  EXPECT_TRUE(c.has_error());
+}
+
+class SymCompilerHandlerTest : public ::testing::Test {
+
+public:
+
+  SymCompilerHandlerTest() : sg_(&sb_) {
+    sb_.set_abi_check(false)
+    .set_max_jumps(1);
+    sg_.set_max_memory(1024)
+    .set_max_attempts(40);
+  }
+
+  /** Checks the compiled circuit of an instruction against the sandbox. */
+  void callback(const Cfg& cfg) {
+    auto instr = cfg.get_code()[1];
+    if (!(ch_.get_support(instr) & Handler::BASIC)) {
+      skipped_["unsupported by the handlers"]++;
+      return;
+    }
+
+    CpuState cs;
+    if (!sg_.get(cs, cfg)) {
+      skipped_["no testcase"]++;
+      return;
+    }
+    sb_.clear_inputs();
+    sb_.insert_input(cs);
+    sb_.insert_function(cfg);
+    sb_.set_entrypoint(cfg.get_code()[0].get_operand<x64asm::Label>(0));
+    sb_.run(0);
+    const auto& expected = *sb_.get_output(0);
+    if (expected.code != ErrorCode::NORMAL) {
+      skipped_["signal in the sandbox"]++;
+      return;
+    }
+
+    SymState vars("IN");
+    SymState state("IN");
+    ch_.build_circuit(instr, state);
+    if (ch_.has_error()) {
+      skipped_["handler error"]++;
+      return;
+    }
+
+    // Each output is compiled on its own; undefined flags are fresh variables
+    // and can't be compiled, but that shouldn't hide the other outputs.
+    auto check = [&](auto circuit, const std::vector<uint64_t>& value, const std::string& what) {
+      SymCompiler c;
+      std::vector<uint64_t> in;
+      for (size_t i = 0; i < 16; ++i) {
+        c.add_input(vars.gp[i]);
+        in.push_back(cs.gp[i].get_fixed_quad(0));
+      }
+      for (size_t i = 0; i < 16; ++i) {
+        c.add_input(vars.sse[i]);
+        for (size_t j = 0; j < 4; ++j) {
+          in.push_back(cs.sse[i].get_fixed_quad(j));
+        }
+      }
+      for (auto f : flags_) {
+        c.add_input(vars[f]);
+        in.push_back(cs.rf.is_set(f.index()));
+      }
+      c.add_output(circuit);
+      if (!c.compile()) {
+        if (c.get_error().find("Variable TMP_") == 0) {
+          skipped_["undefined output"]++;
+        } else {
+          skipped_["cannot compile"]++;
+          if (uncompiled_.size() < 10) {
+            std::stringstream ss;
+            ss << instr << " (" << what << "): " << c.get_error().substr(0, 120);
+            uncompiled_.push_back(ss.str());
+          }
+        }
+        return;
+      }
+      std::vector<uint64_t> out(c.num_output_words());
+      c.eval(in.data(), out.data());
+      for (size_t i = 0; i < value.size(); ++i) {
+        EXPECT_EQ(value[i], out[i]) << instr << " disagrees on " << what;
+      }
+      checked_++;
+    };
+
+    for (size_t i = 0; i < 16; ++i) {
+      std::stringstream ss;
+      ss << x64asm::r64s[i];
+      check(state.gp[i], {expected.gp[i].get_fixed_quad(0)}, ss.str());
+    }
+    for (size_t i = 0; i < 16; ++i) {
+      std::stringstream ss;
+      ss << x64asm::ymms[i];
+      std::vector<uint64_t> value;
+      for (size_t j = 0; j < 4; ++j) {
+        value.push_back(expected.sse[i].get_fixed_quad(j));
+      }
+      check(state.sse[i], value, ss.str());
+    }
+    for (auto f : flags_) {
+      std::stringstream ss;
+      ss << f;
+      check(state[f], {(uint64_t)expected.rf.is_set(f.index())}, ss.str());
+    }
+  }
+
+  /** Prints how many instructions and outputs were skipped, and why. */
+  void report() {
+    fuzz_print(0) << "Checked " << checked_ << " outputs" << std::endl;
+    for (const auto& s : skipped_) {
+      fuzz_print(1) << "Skipped " << s.second << ": " << s.first << std::endl;
+    }
+    for (const auto& u : uncompiled_) {
+      fuzz_print(2) << u << std::endl;
+    }
+  }
+
+protected:
+
+  size_t checked_ = 0;
+  /** Instructions and outputs that weren't checked, by reason. */
+  std::map<std::string, size_t> skipped_;
+  /** A few of the outputs that the compiler rejected. */
+  std::vector<std::string> uncompiled_;
+
+  std::vector<x64asm::Eflags> flags_ = {
+    x64asm::eflags_cf, x64asm::eflags_pf, x64asm::eflags_af,
+    x64asm::eflags_zf, x64asm::eflags_sf, x64asm::eflags_of
+  };
+
+  ComboHandler ch_;
+  Sandbox sb_;
+  StateGen sg_;
+};
+
+void sym_compiler_fuzz_callback(const Cfg& cfg, void* callback_info) {
+  static_cast<SymCompilerHandlerTest*>(callback_info)->callback(cfg);
+}
+
+TEST_F(SymCompilerHandlerTest, AgreesWithSandboxOnHandlerOpcodes) {
+
+  // A few random instances of every opcode the handlers support
+  const size_t iterations = 2;
+  const auto cpu_flags = CpuInfo::get_flags();
+
+  TransformPools tp = default_fuzzer_pool();
+  tp.set_memory_read(false);
+  tp.set_memory_write(false);
+  for (size_t i = 0; i < X64ASM_NUM_OPCODES; ++i) {
+    tp.remove_opcode((x64asm::Opcode)i);
+  }
+
+  // The states are drawn with the same seed as the instructions, so that
+  // the seed printed here is enough to replay a failure
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  const uint64_t seed = tv.tv_usec + tv.tv_sec*1000000;
+  fuzz_print(0) << "Seed is " << seed << std::endl;
+  sg_.set_seed(seed);
+
+  for (size_t k = 0; k < X64ASM_NUM_OPCODES; ++k) {
+    auto opc = (x64asm::Opcode)k;
+    x64asm::Instruction instr(opc);
+
+    if (instr.is_memory_dereference()) continue;
+    if (!Sandbox::is_supported(opc)) continue;
+    if (!instr.enabled(cpu_flags)) continue;
+    if (!(ch_.get_support(instr) & Handler::BASIC)) continue;
+
+    tp.insert_opcode(opc);
+    tp.recompute_pools();
+    fuzz(tp, iterations, &sym_compiler_fuzz_callback, (void*)this, 1, seed);
+    tp.remove_opcode(opc);
+  }
+
+  report();
+  EXPECT_GT(checked_, 0ul);
+}
+
+} //namespace stoke
@@ -0,0 +1,165 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <thread>
+
+#include "src/symstate/pointer_map.h"
+#include "src/symstate/simplify.h"
+#include "src/symstate/size_visitor.h"
+
+namespace stoke {
+
+TEST(SymPointerMapTest, InsertFindAndGrow) {
+
+  std::vector<int> keys(1000);
+  std::vector<int> values(1000);
+
+  SymPointerMap<int*, int*> map;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    map.insert(&keys[i], &values[i]);
+  }
+  map.insert(&keys[3], &values[7]);
+
+  EXPECT_EQ(keys.size(), map.size());
+  EXPECT_EQ(&values[0], map.find(&keys[0]));
+  EXPECT_EQ(&values[7], map.find(&keys[3]));
+  EXPECT_EQ(&values[999], map.find(&keys[999]));
+
+  int other;
+  EXPECT_FALSE(map.contains(&other));
+
+  map.clear();
+  EXPECT_EQ(0ul, map.size());
+  EXPECT_FALSE(map.contains(&keys[0]));
+}
+
+TEST(SymSimplifyTest, ExtractOfConcat) {
+
+  auto x = SymBitVector::var(32, "x");
+  auto y = SymBitVector::var(32, "y");
+
+  SymSimplify s;
+  EXPECT_TRUE(s.simplify((x || y)[63][32]).equals(x));
+  EXPECT_TRUE(s.simplify((x || y)[15][8]).equals(y[15][8]));
+}
+
+TEST(SymSimplifyTest, ShiftByConstant) {
+
+  auto x = SymBitVector::var(64, "x");
+
+  SymSimplify s;
+  EXPECT_TRUE(s.simplify((x << 0)).equals(x));
+  EXPECT_TRUE(s.simplify((x << 64)).equals(SymBitVector::constant(64, 0)));
+  EXPECT_TRUE(s.simplify((x << 8)[63][8]).equals(x[55][0]));
+  EXPECT_TRUE(s.simplify((x >> 8)[55][0]).equals(x[63][8]));
+  EXPECT_TRUE(s.simplify(SymBitVector::constant(8, 0x81) >> 1).equals(SymBitVector::constant(8, 0x40)));
+  EXPECT_TRUE(s.simplify(SymBitVector::constant(8, 0x81).rol(SymBitVector::constant(8, 1)))
+              .equals(SymBitVector::constant(8, 0x03)));
+  EXPECT_TRUE(s.simplify(SymBitVector::constant(8, 0x80).s_shr(SymBitVector::constant(8, 9)))
+              .equals(SymBitVector::constant(8, 0xff)));
+}
+
+TEST(SymSimplifyTest, IteWithEqualArms) {
+
+  auto x = SymBitVector::var(64, "x");
+  auto y = SymBitVector::var(64, "y");
+  auto b = SymBool::var("b");
+
+  SymSimplify s;
+  EXPECT_TRUE(s.simplify(b.ite(x + y, x + y)).equals(x + y));
+  EXPECT_TRUE(s.simplify((!b).ite(x, y)).equals(b.ite(y, x)));
+}
+
+TEST(SymSimplifyTest, MaskingIdentities) {
+
+  auto x = SymBitVector::var(16, "x");
+  auto zero = SymBitVector::constant(16, 0);
+  auto ones = SymBitVector::constant(16, 0xffff);
+
+  SymSimplify s;
+  EXPECT_TRUE(s.simplify(x & ones).equals(x));
+  EXPECT_TRUE(s.simplify(x & zero).equals(zero));
+  EXPECT_TRUE(s.simplify(x | zero).equals(x));
+  EXPECT_TRUE(s.simplify(x | ones).equals(ones));
+  EXPECT_TRUE(s.simplify(x ^ zero).equals(x));
+  EXPECT_TRUE(s.simplify(x ^ ones).equals(!x));
+
+  auto b = SymBool::var("b");
+  EXPECT_TRUE(s.simplify(b & SymBool::_true()).equals(b));
+  EXPECT_TRUE(s.simplify(b | SymBool::_true()).equals(SymBool::_true()));
+  EXPECT_TRUE(s.simplify(!!b).equals(b));
+}
+
+TEST(SymSimplifyTest, ConstantDivisionFollowsSmtLib) {
+
+  auto c = [](uint64_t v) {
+    return SymBitVector::constant(8, v);
+  };
+
+  SymSimplify s;
+  EXPECT_TRUE(s.simplify(c(7) / c(0)).equals(c(0xff)));
+  EXPECT_TRUE(s.simplify(c(7) % c(0)).equals(c(7)));
+  EXPECT_TRUE(s.simplify(c(7) % c(3)).equals(c(1)));
+  EXPECT_TRUE(s.simplify(c(0xf9).s_div(c(2))).equals(c(0xfd)));
+  EXPECT_TRUE(s.simplify(c(0x80).s_div(c(0xff))).equals(c(0x80)));
+  EXPECT_TRUE(s.simplify(c(0xf9).s_mod(c(2))).equals(c(0xff)));
+}
+
+TEST(SymSimplifyTest, ResultsAreCached) {
+
+  auto x = SymBitVector::var(64, "x");
+  auto y = SymBitVector::var(64, "y");
+  auto z = ((x || y)[95][32] ^ SymBitVector::constant(64, 0)) + y;
+
+  SymSimplify s;
+  auto a = s.simplify(z);
+  auto size = s.cache_size();
+  auto b = s.simplify(z);
+
+  EXPECT_EQ(a.ptr, b.ptr);
+  EXPECT_EQ(size, s.cache_size());
+  EXPECT_EQ(a.ptr, s.simplify(a).ptr);
+
+  SymSizeVisitor before;
+  SymSizeVisitor after;
+  EXPECT_GT(before(z), after(a));
+}
+
+TEST(SymSimplifyTest, CacheDoesNotMoveToAnotherThread) {
+
+  // Each thread starts with its own generation, so a simplifier that was
+  // filled on one thread is cleared when it's next used on another; the
+  // nodes it cached may have been freed in between.
+  SymSimplify s;
+  size_t filled = 0;
+  size_t moved = 0;
+
+  std::thread first([&]() {
+    auto x = SymBitVector::var(64, "x");
+    auto y = SymBitVector::var(64, "y");
+    s.simplify(((x || y)[95][32] ^ SymBitVector::constant(64, 0)) + y);
+    filled = s.cache_size();
+  });
+  first.join();
+
+  std::thread second([&]() {
+    s.simplify(SymBitVector::var(64, "w"));
+    moved = s.cache_size();
+  });
+  second.join();
+
+  EXPECT_LT(moved, filled);
+}
+
+} //namespace stoke
@@ -39,7 +39,9 @@ using namespace x64asm;
 
 // very fast tests (much less 1 sec per test)
 #include "tests/trivial.h"
+#include "tests/profiler/profiler.h"
 #include "tests/sandbox/sandbox.h"
+#include "tests/search/metrics.h"
 #include "tests/search/search.h"
 #include "tests/x64asm/r.h"
 #include "tests/x64asm/reg_set.h"
@@ -55,8 +57,11 @@ using namespace x64asm;
 #include "tests/state/state.h"
 #include "tests/stategen/stategen.h"
 #include "tests/symstate/bitvector.h"
+#include "tests/symstate/simplify.h"
 #include "tests/tunit/tunit.h"
 #include "tests/validator/invariants.h"
+#include "tests/validator/trace_store.h"
+#include "tests/validator/nullspace.h"
 #include "tests/verifier/verifier.h"
 #include "tests/fixture.h"
 
@@ -65,6 +70,7 @@ using namespace x64asm;
 // medium tests (at most 5 sec per test)
 #include "tests/x64asm/read_write_sets.h"
 #include "tests/x64asm/alt_read_write_sets.h"
+#include "tests/symstate/compiler.h"
 #include "tests/validator/fuzz.h"
 #include "tests/validator/simple.h"
 // #include "tests/validator/ddec.h"
@@ -77,6 +83,7 @@ using namespace x64asm;
 // large tests (anything slower)
 #include "tests/integration/integration.h"
 #include "tests/validator/bounded_long.h"
+#include "tests/cost/timed_long.h"
 // #include "tests/validator/ddec_long.h"
 #include "tests/validator/handlers.h"
 #include "tests/validator/memory.h"
@@ -18,6 +18,7 @@
 
 #include "src/ext/cpputil/include/io/fail.h"
 #include "src/ext/x64asm/src/constants.h"
+#include "src/tunit/hex_size_table.h"
 
 namespace stoke {
 
@@ -160,6 +161,111 @@ TEST(TunitParsing, NakedRead) {
   ASSERT_FALSE(ss.fail());
 }
 
+TEST(HexSizeTable, AgreesWithAssembler) {
+  std::stringstream ss;
+  ss << "movq %rax, %rbx" << std::endl;
+  ss << "movq %r8, %rbx" << std::endl;
+  ss << "movb %al, %bl" << std::endl;
+  ss << "movb %sil, %bl" << std::endl;
+  ss << "movb %ah, %bl" << std::endl;
+  ss << "addq $0x1, %rcx" << std::endl;
+  ss << "movq (%rax), %rbx" << std::endl;
+  ss << "movq (%rsp), %rbx" << std::endl;
+  ss << "movq (%rbp), %rbx" << std::endl;
+  ss << "movq (%r12), %rbx" << std::endl;
+  ss << "movq (%r13), %rbx" << std::endl;
+  ss << "movq 0x8(%rax), %rbx" << std::endl;
+  ss << "movq -0x80(%rax), %rbx" << std::endl;
+  ss << "movq 0x80(%rax), %rbx" << std::endl;
+  ss << "movq 0x1000(%rax,%rcx,8), %rbx" << std::endl;
+  ss << "movq (%rax,%r9,2), %rbx" << std::endl;
+  ss << "movq 0x10(%rip), %rbx" << std::endl;
+  ss << "movl (%eax), %ebx" << std::endl;
+  ss << "movq %fs:0x28, %rax" << std::endl;
+  ss << "leaq 0x8(%rsp), %rdi" << std::endl;
+  ss << "vaddps %ymm1, %ymm2, %ymm3" << std::endl;
+  ss << "vaddps %ymm9, %ymm2, %ymm3" << std::endl;
+  ss << "vaddps (%r8), %ymm2, %ymm3" << std::endl;
+  ss << "retq" << std::endl;
+
+  x64asm::Code code;
+  ss >> code;
+  ASSERT_FALSE(cpputil::failed(ss));
+
+  // Twice, so that the second round comes from the table
+  x64asm::Assembler assm;
+  for (size_t round = 0; round < 2; ++round) {
+    for (const auto& instr : code) {
+      EXPECT_EQ(assm.hex_size(instr), HexSizeTable::hex_size(instr)) << instr;
+    }
+  }
+
+  // Same shape, different registers and displacement: no new entry
+  const auto size = HexSizeTable::size();
+  std::stringstream ss2;
+  ss2 << "movq 0x10(%rdx), %rcx" << std::endl;
+  x64asm::Code code2;
+  ss2 >> code2;
+  ASSERT_FALSE(cpputil::failed(ss2));
+  EXPECT_EQ(assm.hex_size(code2[0]), HexSizeTable::hex_size(code2[0]));
+  EXPECT_EQ(size, HexSizeTable::size());
+}
+
+TEST(TunitEditing, OffsetsAndRipsSurviveEdits) {
+  std::stringstream ss;
+  ss << ".foo:" << std::endl;
+  ss << "movq 0x100(%rip), %rax" << std::endl;
+  ss << "addq %rax, %rbx" << std::endl;
+  ss << "movq %r9, %rcx" << std::endl;
+  ss << "leaq 0x200(%rip), %rdx" << std::endl;
+  ss << "nop" << std::endl;
+  ss << "movq 0x300(%rip), %r8" << std::endl;
+  ss << "addq $0x1, %rax" << std::endl;
+  ss << "retq" << std::endl;
+
+  x64asm::Code code;
+  ss >> code;
+  ASSERT_FALSE(cpputil::failed(ss));
+
+  TUnit fxn(code, 0, 0x1000, 0);
+  ASSERT_TRUE(fxn.check_invariants());
+  const std::set<uint64_t> targets(fxn.rip_offset_target_begin(), fxn.rip_offset_target_end());
+  ASSERT_EQ(2ul, targets.size());
+
+  auto check = [&fxn, &targets](const std::string& step) {
+    EXPECT_TRUE(fxn.check_invariants()) << step;
+    TUnit fresh(fxn.get_code(), 0, 0x1000, 0);
+    for (size_t i = 0, ie = fxn.get_code().size(); i < ie; ++i) {
+      EXPECT_EQ(fresh.hex_offset(i), fxn.hex_offset(i)) << step << " at " << i;
+    }
+    EXPECT_EQ(fresh.hex_size(), fxn.hex_size()) << step;
+
+    // The index and targets kept up by the edit match ones built from scratch
+    EXPECT_EQ(std::vector<size_t>(fresh.rip_index_begin(), fresh.rip_index_end()),
+              std::vector<size_t>(fxn.rip_index_begin(), fxn.rip_index_end())) << step;
+    EXPECT_EQ(std::set<uint64_t>(fresh.rip_offset_target_begin(), fresh.rip_offset_target_end()),
+              std::set<uint64_t>(fxn.rip_offset_target_begin(), fxn.rip_offset_target_end())) << step;
+
+    // and each rip-relative load still reaches one of the original targets
+    for (auto t = fxn.rip_offset_target_begin(); t != fxn.rip_offset_target_end(); ++t) {
+      EXPECT_EQ(1ul, targets.count(*t)) << step;
+    }
+  };
+
+  fxn.swap(1, 6);
+  check("swap");
+  fxn.rotate_left(1, 6);
+  check("rotate_left");
+  fxn.rotate_right(2, 7);
+  check("rotate_right");
+  fxn.insert(2, x64asm::Instruction(x64asm::NOP));
+  check("insert");
+  fxn.remove(1);
+  check("remove");
+  fxn.replace(3, fxn.get_code()[3]);
+  check("replace");
+}
+
 } //namespace stoke
 
 #endif
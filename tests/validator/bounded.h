@@ -178,6 +178,82 @@ TEST_F(BoundedValidatorBaseTest, NoLoopsFails) {
 
 }
 
+TEST_F(BoundedValidatorBaseTest, InfeasiblePrefixesArePruned) {
+
+  auto live_outs = all();
+
+  // Both branches test the same condition; half of the paths can't execute.
+  std::stringstream sst;
+  sst << ".foo:" << std::endl;
+  sst << "cmpq $0x0, %rdi" << std::endl;
+  sst << "je .a" << std::endl;
+  sst << "incq %rax" << std::endl;
+  sst << ".a:" << std::endl;
+  sst << "cmpq $0x0, %rdi" << std::endl;
+  sst << "je .b" << std::endl;
+  sst << "incq %rax" << std::endl;
+  sst << ".b:" << std::endl;
+  sst << "retq" << std::endl;
+  auto target = make_cfg(sst, live_outs, live_outs);
+
+  std::stringstream ssr;
+  ssr << ".foo:" << std::endl;
+  ssr << "cmpq $0x0, %rdi" << std::endl;
+  ssr << "je .a" << std::endl;
+  ssr << "addq $0x2, %rax" << std::endl;
+  ssr << ".a:" << std::endl;
+  ssr << "cmpq $0x0, %rdi" << std::endl;
+  ssr << "retq" << std::endl;
+  auto rewrite = make_cfg(ssr, live_outs, live_outs);
+
+  validator->set_prune_infeasible(false);
+  EXPECT_TRUE(validator->verify(target, rewrite));
+  EXPECT_FALSE(validator->has_error()) << validator->error();
+  auto unpruned = validator->get_pairs_checked();
+  EXPECT_EQ(0ul, validator->get_pairs_skipped());
+
+  validator->set_prune_infeasible(true);
+  EXPECT_TRUE(validator->verify(target, rewrite));
+  EXPECT_FALSE(validator->has_error()) << validator->error();
+  EXPECT_LT(0ul, validator->get_pairs_skipped());
+  EXPECT_EQ(unpruned, validator->get_pairs_checked() + validator->get_pairs_skipped());
+}
+
+TEST_F(BoundedValidatorBaseTest, PruningKeepsFeasibleFailures) {
+
+  auto live_outs = all();
+
+  std::stringstream sst;
+  sst << ".foo:" << std::endl;
+  sst << "cmpq $0x0, %rdi" << std::endl;
+  sst << "je .a" << std::endl;
+  sst << "incq %rax" << std::endl;
+  sst << ".a:" << std::endl;
+  sst << "cmpq $0x0, %rdi" << std::endl;
+  sst << "je .b" << std::endl;
+  sst << "incq %rax" << std::endl;
+  sst << ".b:" << std::endl;
+  sst << "retq" << std::endl;
+  auto target = make_cfg(sst, live_outs, live_outs);
+
+  std::stringstream ssr;
+  ssr << ".foo:" << std::endl;
+  ssr << "cmpq $0x0, %rdi" << std::endl;
+  ssr << "je .a" << std::endl;
+  ssr << "addq $0x3, %rax" << std::endl;
+  ssr << ".a:" << std::endl;
+  ssr << "cmpq $0x0, %rdi" << std::endl;
+  ssr << "retq" << std::endl;
+  auto rewrite = make_cfg(ssr, live_outs, live_outs);
+
+  EXPECT_FALSE(validator->verify(target, rewrite));
+  EXPECT_FALSE(validator->has_error()) << validator->error();
+
+  EXPECT_LE(1ul, validator->counter_examples_available());
+  for (auto it : validator->get_counter_examples())
+    check_ceg(it, target, rewrite);
+}
+
 TEST_F(BoundedValidatorBaseTest, UnsupportedInstruction) {
 
   auto live_outs = all();
@@ -670,6 +746,40 @@ TEST_F(BoundedValidatorBaseTest, WriteDifferentPointers) {
 
 }
 
+TEST_F(BoundedValidatorBaseTest, AliasCasesFromTestcasesStaySound) {
+
+  auto live_outs = x64asm::RegSet::empty() + x64asm::rax;
+
+  // Only differs when the two pointers overlap, which the testcases never do.
+  std::stringstream sst;
+  sst << ".foo:" << std::endl;
+  sst << "movl $0x1, (%rdi)" << std::endl;
+  sst << "movl $0x2, (%rsi)" << std::endl;
+  sst << "retq" << std::endl;
+  auto target = make_cfg(sst, live_outs, live_outs);
+
+  std::stringstream ssr;
+  ssr << ".foo:" << std::endl;
+  ssr << "movl $0x2, (%rsi)" << std::endl;
+  ssr << "movl $0x1, (%rdi)" << std::endl;
+  ssr << "retq" << std::endl;
+  auto rewrite = make_cfg(ssr, live_outs, live_outs);
+
+  for (size_t i = 0; i < 4; ++i)
+    sandbox->insert_input(get_state(target));
+  validator->set_sandbox(sandbox);
+
+  // The second run reuses the cached arrangements.
+  for (size_t i = 0; i < 2; ++i) {
+    EXPECT_FALSE(validator->verify(target, rewrite));
+    EXPECT_FALSE(validator->has_error()) << validator->error();
+
+    EXPECT_LE(1ul, validator->counter_examples_available());
+    for (auto it : validator->get_counter_examples())
+      check_ceg(it, target, rewrite);
+  }
+}
+
 TEST_F(BoundedValidatorBaseTest, MemoryOverlapEquiv) {
 
   auto live_outs = x64asm::RegSet::empty() + x64asm::rax;
@@ -399,6 +399,171 @@ TEST_F(DdecValidatorBaseTest, LoopMemoryEquiv) {
   EXPECT_FALSE(validator->has_error()) << validator->error();
 }
 
+TEST_F(DdecValidatorBaseTest, ThreadsAgreeWithSerial) {
+
+  auto def_ins = x64asm::RegSet::empty() + x64asm::rax + x64asm::rcx + x64asm::rdx;
+  auto live_outs = x64asm::RegSet::empty() + x64asm::rax;
+
+  std::stringstream sst;
+  sst << ".foo:" << std::endl;
+  sst << "incq %rax" << std::endl;
+  sst << "movl %ecx, (%rdx, %rax, 4)" << std::endl;
+  sst << "cmpl $0x10, %eax" << std::endl;
+  sst << "jne .foo" << std::endl;
+  sst << "retq" << std::endl;
+  auto target = make_cfg(sst, def_ins, live_outs);
+
+  std::stringstream ssr;
+  ssr << ".foo:" << std::endl;
+  ssr << "movl %ecx, 0x4(%rdx, %rax, 4)" << std::endl;
+  ssr << "incq %rax" << std::endl;
+  ssr << "cmpl $0x10, %eax" << std::endl;
+  ssr << "jne .foo" << std::endl;
+  ssr << "retq" << std::endl;
+  auto rewrite = make_cfg(ssr, def_ins, live_outs);
+
+  std::stringstream ssw;
+  ssw << ".foo:" << std::endl;
+  ssw << "movl %ecx, (%rdx, %rax, 4)" << std::endl;
+  ssw << "incq %rax" << std::endl;
+  ssw << "cmpl $0x10, %eax" << std::endl;
+  ssw << "jne .foo" << std::endl;
+  ssw << "retq" << std::endl;
+  auto wrong = make_cfg(ssw, def_ins, live_outs);
+
+  StateGen sg(sg_sandbox);
+  sg.set_max_value(x64asm::rax, 0x10);
+  sg.set_max_memory(1024);
+  sg.set_max_attempts(64);
+
+  sandbox->reset();
+  for (size_t i = 0; i < 4; ++i) {
+    CpuState tc;
+    bool b = sg.get(tc, target);
+    ASSERT_TRUE(b);
+    sandbox->insert_input(tc);
+  }
+
+  validator->set_alias_strategy(ObligationChecker::AliasStrategy::STRING);
+  validator->set_sandbox(sandbox);
+  validator->set_threads(4);
+  EXPECT_TRUE(validator->verify(target, rewrite));
+  EXPECT_FALSE(validator->has_error()) << validator->error();
+
+  validator->set_sandbox(sandbox);
+  EXPECT_FALSE(validator->verify(target, wrong));
+  EXPECT_FALSE(validator->has_error()) << validator->error();
+}
+
+TEST_F(DdecValidatorBaseTest, HoudiniRoundsReuseObligations) {
+
+  auto def_ins = x64asm::RegSet::empty() + x64asm::rax + x64asm::rcx + x64asm::rdx;
+  auto live_outs = x64asm::RegSet::empty() + x64asm::rax;
+
+  std::stringstream sst;
+  sst << ".foo:" << std::endl;
+  sst << "incq %rax" << std::endl;
+  sst << "movl %ecx, (%rdx, %rax, 4)" << std::endl;
+  sst << "cmpl $0x10, %eax" << std::endl;
+  sst << "jne .foo" << std::endl;
+  sst << "retq" << std::endl;
+  auto target = make_cfg(sst, def_ins, live_outs);
+
+  std::stringstream ssr;
+  ssr << ".foo:" << std::endl;
+  ssr << "movl %ecx, 0x4(%rdx, %rax, 4)" << std::endl;
+  ssr << "incq %rax" << std::endl;
+  ssr << "cmpl $0x10, %eax" << std::endl;
+  ssr << "jne .foo" << std::endl;
+  ssr << "retq" << std::endl;
+  auto rewrite = make_cfg(ssr, def_ins, live_outs);
+
+  StateGen sg(sg_sandbox);
+  sg.set_max_value(x64asm::rax, 0x10);
+  sg.set_max_memory(1024);
+  sg.set_max_attempts(64);
+
+  // With this few testcases some of the learned invariants are spurious, so
+  // the Houdini loop needs more than one round.
+  sandbox->reset();
+  for (size_t i = 0; i < 4; ++i) {
+    CpuState tc;
+    bool b = sg.get(tc, target);
+    ASSERT_TRUE(b);
+    sandbox->insert_input(tc);
+  }
+
+  validator->set_alias_strategy(ObligationChecker::AliasStrategy::STRING);
+  validator->set_sandbox(sandbox);
+  EXPECT_TRUE(validator->verify(target, rewrite));
+  EXPECT_FALSE(validator->has_error()) << validator->error();
+  EXPECT_LT(0ul, validator->get_obligations_checked());
+  EXPECT_LT(0ul, validator->get_obligation_cache_hits());
+}
+
+TEST_F(DdecValidatorBaseTest, ThreadsAcrossHoudiniRounds) {
+
+  auto def_ins = x64asm::RegSet::empty() + x64asm::rax + x64asm::rcx + x64asm::rdx;
+  auto live_outs = x64asm::RegSet::empty() + x64asm::rax;
+
+  std::stringstream sst;
+  sst << ".foo:" << std::endl;
+  sst << "incq %rax" << std::endl;
+  sst << "movl %ecx, (%rdx, %rax, 4)" << std::endl;
+  sst << "cmpl $0x10, %eax" << std::endl;
+  sst << "jne .foo" << std::endl;
+  sst << "retq" << std::endl;
+  auto target = make_cfg(sst, def_ins, live_outs);
+
+  std::stringstream ssr;
+  ssr << ".foo:" << std::endl;
+  ssr << "movl %ecx, 0x4(%rdx, %rax, 4)" << std::endl;
+  ssr << "incq %rax" << std::endl;
+  ssr << "cmpl $0x10, %eax" << std::endl;
+  ssr << "jne .foo" << std::endl;
+  ssr << "retq" << std::endl;
+  auto rewrite = make_cfg(ssr, def_ins, live_outs);
+
+  std::stringstream ssw;
+  ssw << ".foo:" << std::endl;
+  ssw << "movl %ecx, (%rdx, %rax, 4)" << std::endl;
+  ssw << "incq %rax" << std::endl;
+  ssw << "cmpl $0x10, %eax" << std::endl;
+  ssw << "jne .foo" << std::endl;
+  ssw << "retq" << std::endl;
+  auto wrong = make_cfg(ssw, def_ins, live_outs);
+
+  StateGen sg(sg_sandbox);
+  sg.set_max_value(x64asm::rax, 0x10);
+  sg.set_max_memory(1024);
+  sg.set_max_attempts(64);
+
+  // Few testcases, so the Houdini loop takes more than one round; each round
+  // runs the workers on new threads, after their memory was collected.
+  sandbox->reset();
+  for (size_t i = 0; i < 4; ++i) {
+    CpuState tc;
+    bool b = sg.get(tc, target);
+    ASSERT_TRUE(b);
+    sandbox->insert_input(tc);
+  }
+
+  validator->set_alias_strategy(ObligationChecker::AliasStrategy::STRING);
+  validator->set_sandbox(sandbox);
+  validator->set_threads(4);
+  EXPECT_TRUE(validator->verify(target, rewrite));
+  EXPECT_FALSE(validator->has_error()) << validator->error();
+  EXPECT_LT(0ul, validator->get_obligation_cache_hits());
+
+  validator->set_sandbox(sandbox);
+  EXPECT_FALSE(validator->verify(target, wrong));
+  EXPECT_FALSE(validator->has_error()) << validator->error();
+
+  validator->set_sandbox(sandbox);
+  EXPECT_TRUE(validator->verify(target, rewrite));
+  EXPECT_FALSE(validator->has_error()) << validator->error();
+}
+
 TEST_F(DdecValidatorBaseTest, XmmEquiv) {
 
   auto def_ins = x64asm::RegSet::empty() + x64asm::rax + x64asm::rsp;
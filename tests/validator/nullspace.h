@@ -0,0 +1,104 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _STOKE_TEST_VALIDATOR_NULLSPACE_H
+#define _STOKE_TEST_VALIDATOR_NULLSPACE_H
+
+#include <random>
+
+#include "src/validator/null.h"
+
+namespace stoke {
+
+namespace {
+
+void free_nullspace(uint64_t** rows, size_t dim) {
+  for (size_t i = 0; i < dim; ++i)
+    delete[] rows[i];
+  delete[] rows;
+}
+
+}
+
+TEST(NullspaceTest, FindsLinearRelation) {
+
+  // columns: x, y, 3x + 7y + 1, 1
+  std::vector<uint64_t> matrix;
+  for (uint64_t x = 0; x < 4; ++x) {
+    for (uint64_t y = 0; y < 4; ++y) {
+      matrix.push_back(x);
+      matrix.push_back(y);
+      matrix.push_back(3*x + 7*y + 1);
+      matrix.push_back(1);
+    }
+  }
+
+  uint64_t** out;
+  auto dim = Nullspace::bv_nullspace(matrix.data(), 16, 4, &out);
+  ASSERT_LE(1ul, dim);
+
+  for (size_t r = 0; r < 16; ++r) {
+    uint64_t sum = 0;
+    for (size_t c = 0; c < 4; ++c)
+      sum += out[0][c] * matrix[r*4 + c];
+    EXPECT_EQ(0ul, sum);
+  }
+  EXPECT_NE(0ul, out[0][2]);
+
+  free_nullspace(out, dim);
+}
+
+TEST(NullspaceTest, SameAsReference) {
+
+  std::default_random_engine gen(0);
+
+  for (size_t i = 0; i < 50; ++i) {
+    size_t rows = 1 + gen() % 64;
+    size_t cols = 2 + gen() % 16;
+
+    // Few distinct rows, some of them related, and a column of ones
+    size_t distinct = 1 + gen() % rows;
+    std::vector<uint64_t> pool(distinct * cols);
+    for (size_t d = 0; d < distinct; ++d) {
+      auto row = &pool[d * cols];
+      for (size_t c = 0; c < cols; ++c)
+        row[c] = (gen() % 4) ? gen() % 1000 : ((uint64_t)gen() << 32 | gen());
+      row[cols-1] = 1;
+      row[0] = 5 * row[cols/2] - row[cols-1];
+    }
+
+    std::vector<uint64_t> matrix(rows * cols);
+    for (size_t r = 0; r < rows; ++r) {
+      auto d = gen() % distinct;
+      std::copy(&pool[d * cols], &pool[d * cols] + cols, &matrix[r * cols]);
+    }
+
+    uint64_t** expected;
+    uint64_t** actual;
+    auto expected_dim = BitvectorNullspace::reference_nullspace((long*)matrix.data(), rows, cols, &expected);
+    auto actual_dim = BitvectorNullspace::nullspace((long*)matrix.data(), rows, cols, &actual);
+
+    ASSERT_EQ(expected_dim, actual_dim) << "matrix " << i;
+    for (size_t r = 0; r < expected_dim; ++r)
+      for (size_t c = 0; c < cols; ++c)
+        EXPECT_EQ(expected[r][c], actual[r][c]) << "matrix " << i << " row " << r;
+
+    free_nullspace(expected, expected_dim);
+    free_nullspace(actual, actual_dim);
+  }
+}
+
+} //namespace stoke
+
+#endif
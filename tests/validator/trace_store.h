@@ -0,0 +1,98 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the License);
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an AS IS BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/validator/trace_store.h"
+
+namespace stoke {
+
+class TraceStoreTest : public ::testing::Test {
+
+protected:
+
+  CpuState make_input() {
+    CpuState cs;
+    cs.heap.resize(0x1000, 64);
+    for (uint64_t i = 0x1000; i < 0x1040; ++i) {
+      cs.heap.set_valid(i, true);
+      cs.heap[i] = i & 0xff;
+    }
+    cs.gp[x64asm::rax].get_fixed_quad(0) = 0x10;
+    cs.sse[x64asm::ymm3].get_fixed_quad(2) = 0x1234;
+    return cs;
+  }
+
+};
+
+TEST_F(TraceStoreTest, RebuildsStates) {
+
+  auto input = make_input();
+  auto changed = input;
+  changed.gp[x64asm::rax].get_fixed_quad(0) = 0x20;
+  changed.sse[x64asm::ymm3].get_fixed_quad(3) = 0x5678;
+  changed.rf.set(x64asm::eflags_zf.index(), true);
+  changed.heap[0x1008] = 0xff;
+  changed.heap[0x103f] = 0;
+
+  TraceStore traces;
+  traces.begin_trace(input);
+  traces.record(1, input);
+  traces.record(2, changed);
+  traces.record(1, changed);
+
+  EXPECT_EQ(1ul, traces.trace_count());
+  EXPECT_EQ(3ul, traces.size());
+  EXPECT_EQ(4ul, traces.delta_size());
+
+  EXPECT_EQ(input, traces.get_state(0));
+  EXPECT_EQ(changed, traces.get_state(1));
+  EXPECT_EQ(changed, traces.get_state(2));
+
+  auto regs = traces.get_register_states({1});
+  ASSERT_EQ(1ul, regs.size());
+  EXPECT_EQ(changed.gp, regs[0].gp);
+  EXPECT_EQ(changed.sse, regs[0].sse);
+  EXPECT_EQ(changed.rf, regs[0].rf);
+  EXPECT_EQ(0ul, regs[0].heap.size());
+
+  auto& at_one = traces.at_block(1);
+  ASSERT_EQ(2ul, at_one.size());
+  EXPECT_EQ(0ul, at_one[0]);
+  EXPECT_EQ(2ul, at_one[1]);
+  EXPECT_EQ(0ul, traces.at_block(7).size());
+}
+
+TEST_F(TraceStoreTest, ComparesMemory) {
+
+  auto input = make_input();
+  auto a = input;
+  a.heap[0x1010] = 0x42;
+  auto b = a;
+  b.gp[x64asm::rdx].get_fixed_quad(0) = 0x99;
+  auto c = input;
+  c.heap[0x1011] = 0x42;
+
+  TraceStore target;
+  target.begin_trace(input);
+  target.record(1, a);
+
+  TraceStore rewrite;
+  rewrite.begin_trace(input);
+  rewrite.record(1, b);
+  rewrite.record(1, c);
+
+  EXPECT_TRUE(TraceStore::same_memory(target, 0, rewrite, 0));
+  EXPECT_FALSE(TraceStore::same_memory(target, 0, rewrite, 1));
+}
+
+} //namespace stoke
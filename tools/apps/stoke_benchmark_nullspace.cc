@@ -0,0 +1,140 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "src/ext/cpputil/include/command_line/command_line.h"
+#include "src/ext/cpputil/include/io/console.h"
+#include "src/ext/cpputil/include/signal/debug_handler.h"
+
+#include "src/validator/null.h"
+#include "tools/args/benchmark.inc"
+#include "tools/gadgets/seed.h"
+
+using namespace cpputil;
+using namespace std;
+using namespace std::chrono;
+using namespace stoke;
+
+auto& matrix_heading = Heading::create("Matrix Options:");
+auto& rows_arg = ValueArg<size_t>::create("rows")
+                 .usage("<int>")
+                 .description("Number of rows (testcases) per matrix")
+                 .default_val(256);
+auto& cols_arg = ValueArg<size_t>::create("cols")
+                 .usage("<int>")
+                 .description("Number of columns (register values) per matrix")
+                 .default_val(32);
+auto& distinct_arg = ValueArg<size_t>::create("distinct")
+                     .usage("<int>")
+                     .description("Number of distinct rows per matrix")
+                     .default_val(64);
+auto& matrices_arg = ValueArg<size_t>::create("matrices")
+                     .usage("<int>")
+                     .description("Number of random matrices to cycle through")
+                     .default_val(16);
+
+/** A random matrix shaped like the ones DDEC learns equalities from: a few
+  distinct rows repeated, some columns related, and a column of ones. */
+vector<uint64_t> random_matrix(default_random_engine& gen, size_t rows, size_t cols, size_t distinct) {
+  vector<uint64_t> pool(distinct * cols);
+  for (size_t d = 0; d < distinct; ++d) {
+    auto row = &pool[d * cols];
+    for (size_t c = 0; c < cols; ++c)
+      row[c] = (gen() % 4) ? gen() % 1000 : ((uint64_t)gen() << 32 | gen());
+    row[cols-1] = 1;
+    for (size_t c = 0; c + 1 < cols/2; c += 2)
+      row[c] = 3 * row[c+1] + row[cols-1];
+  }
+
+  vector<uint64_t> matrix(rows * cols);
+  for (size_t r = 0; r < rows; ++r) {
+    auto d = gen() % distinct;
+    copy(&pool[d * cols], &pool[d * cols] + cols, &matrix[r * cols]);
+  }
+  return matrix;
+}
+
+void free_nullspace(uint64_t** out, size_t dim) {
+  for (size_t i = 0; i < dim; ++i)
+    delete[] out[i];
+  delete[] out;
+}
+
+typedef size_t (*NullspaceFxn)(long*, size_t, size_t, uint64_t***);
+
+double run(NullspaceFxn fxn, vector<vector<uint64_t>>& matrices) {
+  const auto start = steady_clock::now();
+  for (size_t i = 0; i < benchmark_itr_arg; ++i) {
+    auto& m = matrices[i % matrices.size()];
+    uint64_t** out;
+    auto dim = fxn((long*)m.data(), rows_arg, cols_arg, &out);
+    free_nullspace(out, dim);
+  }
+  return duration_cast<duration<double>>(steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+  CommandLineConfig::strict_with_convenience(argc, argv);
+  DebugHandler::install_sigsegv();
+  DebugHandler::install_sigill();
+
+  if (rows_arg.value() == 0 || cols_arg.value() < 2 || distinct_arg.value() == 0 ||
+      distinct_arg.value() > rows_arg.value() || matrices_arg.value() == 0) {
+    Console::error(1) << "Need rows > 0, cols > 1, 0 < distinct <= rows and matrices > 0." << endl;
+  }
+
+  SeedGadget seed;
+  default_random_engine gen(seed);
+  vector<vector<uint64_t>> matrices;
+  for (size_t i = 0; i < matrices_arg; ++i) {
+    matrices.push_back(random_matrix(gen, rows_arg, cols_arg, distinct_arg));
+  }
+
+  // Both kernels have to agree before timing them means anything
+  for (auto& m : matrices) {
+    uint64_t** expected;
+    uint64_t** actual;
+    auto expected_dim = BitvectorNullspace::reference_nullspace((long*)m.data(), rows_arg, cols_arg, &expected);
+    auto actual_dim = BitvectorNullspace::nullspace((long*)m.data(), rows_arg, cols_arg, &actual);
+
+    bool same = expected_dim == actual_dim;
+    for (size_t i = 0; same && i < actual_dim; ++i)
+      same = equal(expected[i], expected[i] + cols_arg.value(), actual[i]);
+    free_nullspace(expected, expected_dim);
+    free_nullspace(actual, actual_dim);
+
+    if (!same) {
+      Console::error(1) << "Nullspace kernels disagree!" << endl;
+    }
+  }
+
+  Console::msg() << "BitvectorNullspace::reference_nullspace()..." << endl;
+  const auto ref = run(BitvectorNullspace::reference_nullspace, matrices);
+  Console::msg() << "BitvectorNullspace::nullspace()..." << endl;
+  const auto fast = run(BitvectorNullspace::nullspace, matrices);
+
+  Console::msg() << fixed;
+  Console::msg() << "Reference runtime:    " << ref << " seconds" << endl;
+  Console::msg() << "Reference throughput: " << benchmark_itr_arg / ref << " / second" << endl;
+  Console::msg() << "Runtime:              " << fast << " seconds" << endl;
+  Console::msg() << "Throughput:           " << benchmark_itr_arg / fast << " / second" << endl;
+  Console::msg() << "Speedup:              " << ref / fast << "x" << endl;
+
+  return 0;
+}
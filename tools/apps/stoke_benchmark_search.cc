@@ -19,6 +19,8 @@
 #include "src/ext/cpputil/include/io/console.h"
 #include "src/ext/cpputil/include/signal/debug_handler.h"
 
+#include "src/tunit/hex_size_table.h"
+
 #include "tools/args/benchmark.inc"
 #include "tools/gadgets/functions.h"
 #include "tools/gadgets/seed.h"
@@ -54,6 +56,32 @@ int main(int argc, char** argv) {
   Console::msg() << fixed;
   Console::msg() << "Runtime:    " << dur.count() << " seconds" << endl;
   Console::msg() << "Throughput: " << mps << " / second" << endl;
+  Console::msg() << "Assembler:  " << HexSizeTable::misses() << " calls for "
+                 << HexSizeTable::size() << " distinct encodings" << endl;
+  Console::msg() << endl;
+
+  // Compare instruction length lookups against running the assembler
+  Console::msg() << "Instruction lengths..." << endl;
+
+  const auto& code = target.get_code();
+  x64asm::Assembler assm;
+  size_t total = 0;
+
+  const auto table_start = steady_clock::now();
+  for (size_t i = 0; i < benchmark_itr_arg; ++i) {
+    total += HexSizeTable::hex_size(code[i % code.size()]);
+  }
+  const auto table_dur = duration_cast<duration<double>>(steady_clock::now() - table_start);
+
+  const auto assm_start = steady_clock::now();
+  for (size_t i = 0; i < benchmark_itr_arg; ++i) {
+    total -= assm.hex_size(code[i % code.size()]);
+  }
+  const auto assm_dur = duration_cast<duration<double>>(steady_clock::now() - assm_start);
+
+  Console::msg() << "Table:      " << benchmark_itr_arg / table_dur.count() << " / second" << endl;
+  Console::msg() << "Assembler:  " << benchmark_itr_arg / assm_dur.count() << " / second" << endl;
+  assert(total == 0);
 
   return 0;
 }
@@ -0,0 +1,102 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "src/ext/cpputil/include/command_line/command_line.h"
+#include "src/ext/cpputil/include/io/console.h"
+#include "src/ext/cpputil/include/signal/debug_handler.h"
+
+#include "src/state/cpu_states_view.h"
+#include "tools/args/benchmark.inc"
+#include "tools/gadgets/seed.h"
+#include "tools/gadgets/testcases.h"
+
+using namespace cpputil;
+using namespace std;
+using namespace std::chrono;
+using namespace stoke;
+
+template <typename F>
+double time_loads(const string& name, size_t itr, F load) {
+  Console::msg() << name << "..." << endl;
+
+  const auto start = steady_clock::now();
+  for (size_t i = 0; i < itr; ++i) {
+    load();
+  }
+  const auto dur = duration_cast<duration<double>>(steady_clock::now() - start);
+
+  Console::msg() << "Runtime:    " << dur.count() << " seconds" << endl;
+  Console::msg() << "Throughput: " << itr / dur.count() << " / second" << endl;
+  Console::msg() << endl;
+
+  return dur.count();
+}
+
+int main(int argc, char** argv) {
+  CommandLineConfig::strict_with_convenience(argc, argv);
+  DebugHandler::install_sigsegv();
+  DebugHandler::install_sigill();
+
+  SeedGadget seed;
+  TestcasesGadget tcs(seed);
+
+  // Load from memory so that the disk doesn't dominate either format
+  ostringstream text;
+  tcs.write_text(text);
+  const auto text_str = text.str();
+  ostringstream indexed;
+  CpuStatesView::write(indexed, tcs);
+  const auto indexed_str = indexed.str();
+
+  Console::msg() << fixed;
+  Console::msg() << "Testcases:  " << tcs.size() << endl;
+  Console::msg() << "Text:       " << text_str.size() << " bytes" << endl;
+  Console::msg() << "Indexed:    " << indexed_str.size() << " bytes" << endl;
+  Console::msg() << endl;
+
+  const auto t = time_loads("CpuStates::read_text()", benchmark_itr_arg, [&] {
+    istringstream iss(text_str);
+    CpuStates cs;
+    cs.read_text(iss);
+  });
+  const auto b = time_loads("CpuStatesView::read()", benchmark_itr_arg, [&] {
+    istringstream iss(indexed_str);
+    CpuStates cs;
+    CpuStatesView::read(iss, cs);
+  });
+  const auto v = time_loads("CpuStatesView::open() and get_all()", benchmark_itr_arg, [&] {
+    CpuStatesView view;
+    view.open(indexed_str.data(), indexed_str.size());
+    CpuStates cs;
+    view.get_all(cs);
+  });
+  const auto f = time_loads("CpuStatesView::open() and operator[](0)", benchmark_itr_arg, [&] {
+    CpuStatesView view;
+    view.open(indexed_str.data(), indexed_str.size());
+    if (view.size() > 0) {
+      view[0];
+    }
+  });
+
+  Console::msg() << "Speedup (read):           " << t / b << "x" << endl;
+  Console::msg() << "Speedup (view):           " << t / v << "x" << endl;
+  Console::msg() << "Speedup (first testcase): " << t / f << "x" << endl;
+
+  return 0;
+}
@@ -0,0 +1,111 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "src/ext/cpputil/include/command_line/command_line.h"
+#include "src/ext/cpputil/include/io/console.h"
+#include "src/ext/cpputil/include/signal/debug_handler.h"
+
+#include "src/cost/timed.h"
+#include "tools/args/benchmark.inc"
+#include "tools/gadgets/functions.h"
+#include "tools/gadgets/rewrite.h"
+#include "tools/gadgets/sandbox.h"
+#include "tools/gadgets/seed.h"
+#include "tools/gadgets/target.h"
+#include "tools/gadgets/testcases.h"
+#include "tools/gadgets/timed_cost.h"
+
+using namespace cpputil;
+using namespace std;
+using namespace stoke;
+
+namespace {
+
+/** Time a rewrite over and over and report how much the results vary. */
+void report(const string& name, TimedCost& fxn, const Cfg& cfg) {
+  vector<double> xs;
+  for (size_t i = 0; i < benchmark_itr_arg; ++i) {
+    double cycles = 0;
+    if (!fxn.measure(cfg, cycles)) {
+      Console::error(1) << "No testcases to time." << endl;
+    }
+    xs.push_back(cycles);
+  }
+
+  double mean = 0;
+  for (auto x : xs) {
+    mean += x;
+  }
+  mean /= xs.size();
+  double var = 0;
+  for (auto x : xs) {
+    var += (x - mean) * (x - mean);
+  }
+  const auto stddev = xs.size() > 1 ? sqrt(var / (xs.size() - 1)) : 0;
+
+  sort(xs.begin(), xs.end());
+
+  Console::msg() << name << endl;
+  Console::msg() << "  Mean:     " << mean << " cycles" << endl;
+  Console::msg() << "  Std. dev: " << stddev << " cycles" << endl;
+  Console::msg() << "  CV:       " << (mean > 0 ? 100 * stddev / mean : 0) << " %" << endl;
+  Console::msg() << "  Min:      " << xs.front() << " cycles" << endl;
+  Console::msg() << "  Median:   " << xs[xs.size() / 2] << " cycles" << endl;
+  Console::msg() << "  Max:      " << xs.back() << " cycles" << endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  CommandLineConfig::strict_with_convenience(argc, argv);
+  DebugHandler::install_sigsegv();
+  DebugHandler::install_sigill();
+
+  FunctionsGadget aux_fxns;
+  TargetGadget target(aux_fxns, false);
+  RewriteGadget rewrite(aux_fxns);
+
+  SeedGadget seed;
+  PerformanceSetGadget perf_tcs(seed);
+  SandboxGadget perf_sb(perf_tcs, aux_fxns);
+
+  if (benchmark_itr_arg == 0) {
+    Console::error(1) << "--iterations must be positive." << endl;
+  }
+
+  // Single samples, as a stopwatch would take them
+  TimedCost raw;
+  raw.set_warmup(0).set_repetitions(1).set_outlier_threshold(0);
+  raw.setup_perf_sandbox(&perf_sb);
+
+  // What the timed cost function does
+  TimedCostGadget robust;
+  robust.setup_perf_sandbox(&perf_sb);
+
+  Console::msg() << fixed;
+  Console::msg() << "Testcases:  " << perf_tcs.size() << endl;
+  Console::msg() << "Iterations: " << benchmark_itr_arg.value() << endl;
+  Console::msg() << endl;
+
+  report("Target, single samples:", raw, target);
+  report("Target, timed cost:", robust, target);
+  report("Rewrite, single samples:", raw, rewrite);
+  report("Rewrite, timed cost:", robust, rewrite);
+
+  return 0;
+}
@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <chrono>
 #include <iostream>
 #include <limits>
 
@@ -20,6 +21,10 @@
 #include "src/ext/cpputil/include/signal/debug_handler.h"
 
 #include "src/cfg/cfg_transforms.h"
+#include "src/symstate/memory/trivial.h"
+#include "src/symstate/simplify.h"
+#include "src/symstate/size_visitor.h"
+#include "src/validator/handlers/combo_handler.h"
 
 #include "tools/gadgets/functions.h"
 #include "tools/gadgets/target.h"
@@ -28,6 +33,59 @@ using namespace cpputil;
 using namespace std;
 using namespace stoke;
 using namespace x64asm;
+using namespace std::chrono;
+
+auto& circuit_heading = Heading::create("Circuit Simplification Options:");
+auto& circuits_arg = FlagArg::create("circuits")
+                     .description("Also simplify the symbolic circuits of the (straight-line) target and report their size");
+
+/** Simplifies the circuits for all registers and flags, and reports how many
+  distinct nodes they had before and after, and how long it took. */
+void report_circuits(const Code& code) {
+  ComboHandler ch;
+  SymState state("", true);
+  state.memory = new TrivialMemory();
+  for (auto& instr : code) {
+    if (instr.is_label_defn()) continue;
+    if (instr.is_any_return()) break;
+    if (ch.get_support(instr) == Handler::SupportLevel::NONE) {
+      Console::error() << "Instruction unsupported: " << instr << endl;
+    }
+    ch.build_circuit(instr, state);
+    if (ch.has_error()) {
+      Console::error() << "Symbolic execution failed: " << ch.error() << endl;
+    }
+  }
+
+  SymSizeVisitor before;
+  SymSizeVisitor after;
+  SymSimplify simplifier;
+
+  duration<double> elapsed(0);
+  auto simplify = [&](const auto& circuit) {
+    before(circuit);
+    auto start = steady_clock::now();
+    auto res = simplifier.simplify(circuit);
+    elapsed += duration_cast<duration<double>>(steady_clock::now() - start);
+    after(res);
+  };
+  for (size_t i = 0; i < state.gp.size(); ++i) {
+    simplify(state.gp[i]);
+  }
+  for (size_t i = 0; i < state.sse.size(); ++i) {
+    simplify(state.sse[i]);
+  }
+  for (size_t i = 0; i < state.rf.size(); ++i) {
+    simplify(state.rf[i]);
+  }
+
+  auto reduction = before.get_count() == 0 ? 0.0 :
+                   100.0 * (1.0 - (double)after.get_count() / before.get_count());
+  Console::msg() << endl << "Circuit nodes before simplification: " << before.get_count() << endl;
+  Console::msg() << "Circuit nodes after simplification:  " << after.get_count() << endl;
+  Console::msg() << "Reduction:                           " << reduction << "%" << endl;
+  Console::msg() << "Simplification time:                 " << elapsed.count() << "s" << endl;
+}
 
 int main(int argc, char** argv) {
   CommandLineConfig::strict_with_convenience(argc, argv);
@@ -43,5 +101,9 @@ int main(int argc, char** argv) {
   cout << endl << "Simplified program:" << endl << endl;
   cout << CfgTransforms::remove_redundant(target).get_function().get_code() << endl;
 
+  if (circuits_arg.value()) {
+    report_circuits(target.get_code());
+  }
+
   return 0;
 }
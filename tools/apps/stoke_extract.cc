@@ -42,6 +42,10 @@ auto& out = ValueArg<string>::create("o")
             .default_val("out");
 
 auto& flat_binary = FlagArg::create("flat_binary");
+auto& threads_arg = ValueArg<size_t>::create("threads")
+                    .usage("<int>")
+                    .description("Number of objdump processes to run at once")
+                    .default_val(1);
 
 bool make_dir() {
   /* The permission is guarded by user's umask, which is why
@@ -82,6 +86,7 @@ int main(int argc, char** argv) {
   Disassembler d;
   d.set_function_callback(callback, nullptr);
   d.set_flat_binary(flat_binary);
+  d.set_threads(threads_arg.value());
   d.disassemble(in.value());
 
   if (d.has_error()) {
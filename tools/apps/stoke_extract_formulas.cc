@@ -12,9 +12,17 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <sstream>
 #include <sys/time.h>
+#include <thread>
 
 #include "src/ext/cpputil/include/command_line/command_line.h"
 #include "src/ext/cpputil/include/io/column.h"
@@ -33,8 +41,10 @@
 
 #include "src/cfg/cfg.h"
 #include "src/cfg/paths.h"
+#include "src/solver/z3solver.h"
 #include "src/symstate/memory/trivial.h"
 #include "src/symstate/memory/flat.h"
+#include "src/symstate/simplify.h"
 #include "src/validator/bounded.h"
 #include "src/validator/invariants/conjunction.h"
 #include "src/validator/invariants/memory_equality.h"
@@ -70,8 +80,6 @@ using namespace stoke;
 using namespace chrono;
 using namespace x64asm;
 
-#define CONSTRAINT_DEBUG(X) {X}
-
 enum JumpType {
   NONE, // jump target is the fallthrough
   FALL_THROUGH,
@@ -92,6 +100,19 @@ auto& out = ValueArg<string>::create("out")
             .description("File to write successful results to")
             .default_val("result.smt2");
 
+auto& bound_arg = ValueArg<size_t>::create("bound")
+                  .usage("<int>")
+                  .description("Maximum number of times a path may go around a loop")
+                  .default_val(8);
+
+auto& threads_arg = ValueArg<size_t>::create("threads")
+                    .usage("<int>")
+                    .description("Number of path pairs to build formulas for at once")
+                    .default_val(1);
+
+auto& debug_arg = FlagArg::create("debug")
+                  .description("Print the assumption, path constraints and proof obligation of each pair");
+
 Cfg rewrite_cfg_with_path(const Cfg& cfg, const CfgPath& p, map<size_t,LineInfo>& to_populate) {
   Code code;
   auto function = cfg.get_function();
@@ -127,10 +148,8 @@ Cfg rewrite_cfg_with_path(const Cfg& cfg, const CfgPath& p, map<size_t,LineInfo>
   return new_cfg;
 }
 
-void build_circuit(const Cfg& cfg, Cfg::id_type bb, JumpType jump, SymState& state, size_t& line_no, const LineMap& line_map) {
+void build_circuit(const Cfg& cfg, Cfg::id_type bb, JumpType jump, SymState& state, size_t& line_no, const LineMap& line_map, Filter* filter) {
 
-  Handler& handler(*(new ComboHandler()));
-  Filter* filter = new DefaultFilter(handler);
   bool nacl_ = true;
 
   if (cfg.num_instrs(bb) == 0)
@@ -241,6 +260,154 @@ JumpType is_jump(const Cfg& cfg, const CfgPath& P, size_t i) {
   }
 }
 
+/** The circuit of one path, starting from fresh "<n>_INIT" registers. */
+struct PathCircuit {
+
+  PathCircuit(SymState* s) : state(s) {}
+
+  /** Heap of the initial state. */
+  SymArray init_heap;
+  /** State at the end of the path; owns its memory. */
+  unique_ptr<SymState> state;
+  /** Path and memory constraints; they hold iff the path is taken. */
+  vector<SymBool> constraints;
+  /** Equalities between the final state and "<n>_FINAL" variables. */
+  vector<SymBool> phi;
+};
+
+/** Copy a state along with its flat memory. */
+SymState* copy_state(const SymState& state) {
+  auto copy = new SymState(state);
+  copy->memory = new FlatMemory(*static_cast<FlatMemory*>(state.memory));
+  copy->memory->set_parent(copy);
+  copy->set_delete_memory(true);
+  return copy;
+}
+
+/** Builds and caches the circuits for the paths of one program.  Symbolic
+  terms belong to the thread that made them, so every worker has its own.
+  The state after each block of the last path built is kept; the next path
+  starts from the longest prefix the two have in common, so shared prefixes
+  are only executed, and simplified, once. */
+class PathBuilder {
+
+public:
+
+  PathBuilder(const Cfg& cfg, const vector<CfgPath>& paths, const string& name) :
+    cfg_(cfg), paths_(paths), name_(name), filter_(handler_), circuits_(paths.size()) {}
+
+  /** The circuit of the i-th path. */
+  PathCircuit& get(size_t i) {
+    if (!circuits_[i])
+      build(i);
+    return *circuits_[i];
+  }
+
+private:
+
+  void build(size_t i) {
+    const auto& p = paths_[i];
+
+    // Blocks [0, k) can be taken from the previous path.  The state after a
+    // block depends on the direction taken out of it, so the last shared
+    // block only counts if that agrees too.
+    size_t k = 0;
+    while (k < p.size() && k < checkpoints_.size() && p[k] == last_[k])
+      ++k;
+    if (k > 0 && is_jump(cfg_, p, k-1) != is_jump(cfg_, last_, k-1))
+      --k;
+
+    last_ = p;
+    checkpoints_.resize(k);
+    lines_.resize(k);
+
+    unique_ptr<SymState> state;
+    size_t line_no = 0;
+    if (k == 0) {
+      state.reset(new SymState(name_ + "_INIT"));
+      state->memory = new FlatMemory();
+      state->memory->set_parent(state.get());
+      state->set_delete_memory(true);
+      init_heap_ = static_cast<FlatMemory*>(state->memory)->heap_;
+    } else {
+      state.reset(copy_state(*checkpoints_[k-1]));
+      line_no = lines_[k-1];
+    }
+
+    LineMap line_map;
+    rewrite_cfg_with_path(cfg_, p, line_map);
+    for (size_t j = k; j < p.size(); ++j) {
+      build_circuit(cfg_, p[j], is_jump(cfg_, p, j), *state, line_no, line_map, &filter_);
+      checkpoints_.emplace_back(copy_state(*state));
+      lines_.push_back(line_no);
+    }
+
+    auto circuit = new PathCircuit(state.release());
+    circuit->init_heap = init_heap_;
+
+    auto& final_state = *circuit->state;
+    circuit->constraints = static_cast<FlatMemory*>(final_state.memory)->get_constraints();
+    circuit->constraints.insert(circuit->constraints.begin(),
+                                final_state.constraints.begin(), final_state.constraints.end());
+
+    SymState named_final(name_ + "_FINAL");
+    for (auto it : final_state.equality_constraints(named_final, RegSet::universe()))
+      circuit->phi.push_back(simplify_.simplify(it));
+
+    circuits_[i].reset(circuit);
+  }
+
+  const Cfg& cfg_;
+  const vector<CfgPath>& paths_;
+  /** "1" for the buggy program, "2" for the patched one. */
+  string name_;
+
+  ComboHandler handler_;
+  DefaultFilter filter_;
+  SymSimplify simplify_;
+
+  vector<unique_ptr<PathCircuit>> circuits_;
+
+  /** The path built last, the state after each of its blocks, and the line
+    number to continue from there. */
+  CfgPath last_;
+  vector<unique_ptr<SymState>> checkpoints_;
+  vector<size_t> lines_;
+  /** Heap variable of the initial state the checkpoints grew from. */
+  SymArray init_heap_;
+};
+
+/** Renumbers the temporary variables of a text in order of first appearance,
+  continuing from the numbering in 'names'.  Temporaries are numbered per
+  thread, in the order circuits happen to be built, so this is what makes the
+  output independent of the number of threads. */
+string renumber_temporaries(const string& text, map<string, string>& names) {
+  static const regex tmp("(TMP_(?:BV_[0-9]+|BOOL|ARR_[0-9]+_[0-9]+)_)[0-9]+");
+
+  string result;
+  auto last = text.begin();
+  for (sregex_iterator it(text.begin(), text.end(), tmp), ie; it != ie; ++it) {
+    result.append(last, text.begin() + it->position());
+    auto name = names.find(it->str());
+    if (name == names.end()) {
+      stringstream ss;
+      ss << (*it)[1] << names.size();
+      name = names.insert({it->str(), ss.str()}).first;
+    }
+    result += name->second;
+    last = text.begin() + it->position() + it->length();
+  }
+  result.append(last, text.end());
+  return result;
+}
+
+/** The conjunction of a list of formulas. */
+SymBool conjoin(SymBool b, const vector<SymBool>& bs) {
+  for (auto it : bs)
+    b = b & it;
+  return b;
+}
+
 int main(int argc, char** argv) {
   // Parse input arguments or config file
   CommandLineConfig::strict_with_convenience(argc, argv);
@@ -255,182 +422,161 @@ int main(int argc, char** argv) {
   CfgGadget init_buggyP(target_arg.value(),aux_fxns, init_arg == Init::ZERO);
   CfgGadget init_patchedP(rewrite_arg.value(),aux_fxns, init_arg == Init::ZERO);
 
-  // Extract all Cfg paths for both buggy and patched versions
-  vector<CfgPath> buggy_paths;
-  vector<CfgPath> patched_paths;
-
   auto buggyP = bv->inline_functions_public(init_buggyP);
   auto patchedP = bv->inline_functions_public(init_patchedP);
 
   // Background checks to make sure def_ins and live_outs are matched
   bv->sanity_checks_public(buggyP, patchedP);
 
-  // Get all the paths from the enumerator (fixed max_len value to 8 - same value used in bounded validator)
-  for (auto path : CfgPaths::enumerate_paths(buggyP, 8)) {
-    buggy_paths.push_back(path);
+  // Every path of each program, shortest first
+  vector<CfgPath> buggy_paths;
+  vector<CfgPath> patched_paths;
+  CfgPath P;
+  CfgPathEnumerator buggy_enum(buggyP, bound_arg.value());
+  while (buggy_enum.next(P))
+    buggy_paths.push_back(P);
+  CfgPathEnumerator patched_enum(patchedP, bound_arg.value());
+  while (patched_enum.next(P))
+    patched_paths.push_back(P);
+
+  if (buggy_paths.empty() || patched_paths.empty()) {
+    Console::error(1) << "No path through the target or rewrite." << endl;
   }
 
-  for (auto path : CfgPaths::enumerate_paths(patchedP, 8)) {
-    patched_paths.push_back(path);
+  ofstream ofs(out.value());
+  if (!ofs.is_open()) {
+    Console::error(1) << "Unable to open " << out.value() << " for writing." << endl;
   }
 
-  // Sort the paths by length
-  auto by_length = [](const CfgPath& lhs, const CfgPath& rhs) {
-    return lhs.size() < rhs.size();
-  };
-  sort(buggy_paths.begin(), buggy_paths.end(), by_length);
-  sort(patched_paths.begin(), patched_paths.end(), by_length);
-
-  // Build the constraints (Handle one path for each Cfg first)
-  // Build constraints on inputs and outputs based on def_ins and live_outs
-  auto P = buggy_paths[0];
-  auto Q = patched_paths[0];
-
   StateEqualityInvariant assume_state(buggyP.def_ins());
   StateEqualityInvariant prove_state(buggyP.live_outs());
 
   MemoryEqualityInvariant memory_equal;
 
-  ConjunctionInvariant assume;
-  assume.add_invariant(&assume_state);
-  assume.add_invariant(&memory_equal);
-
   ConjunctionInvariant prove;
   prove.add_invariant(&prove_state);
   prove.add_invariant(&memory_equal);
 
-  // XXX. Does not support memory objects
-  auto memories = pair<CellMemory*,CellMemory*>(NULL, NULL);
-
-  vector<SymBool> constraints,constraints2;
-  vector<SymBool> EquivInput, DistinctOutput, Phi_b, Phi_p, DiffOut, SameOut;
-  SymBool CC = SymBool::var("CC");
-  SymState state_b("1_INIT");
-  SymState state_p("2_INIT");
-
-  FlatMemory initial_buggy_flat_memory;
-  FlatMemory initial_patched_flat_memory;
-
-  if (memories.first) {
-    state_b.memory = memories.first;
-    state_b.memory->set_parent(&state_b);
-    state_p.memory = memories.second;
-    state_p.memory->set_parent(&state_p);
-  } else {
-    state_b.memory = new FlatMemory();
-    initial_buggy_flat_memory = *static_cast<FlatMemory*>(state_b.memory);
-    state_p.memory = new FlatMemory();
-    initial_patched_flat_memory = *static_cast<FlatMemory*>(state_p.memory);
-  }
-
-  // Add given assumptions
-  // TODO pass line numbers as appropriate here
-  size_t buggy_invariant_lineno = 0;
-  size_t patched_invariant_lineno = 0;
-  auto assumption = assume(state_b, state_p, buggy_invariant_lineno, patched_invariant_lineno);
-  CONSTRAINT_DEBUG(cout << "Assuming " << assumption << endl;);
-  constraints.push_back(assumption);
-
-  EquivInput.push_back(assumption);
-
-  // Compute line maps
-  LineMap buggy_line_map;
-  rewrite_cfg_with_path(buggyP, P, buggy_line_map);
-  LineMap patched_line_map;
-  rewrite_cfg_with_path(patchedP, Q, patched_line_map);
-
-  // Build the circuits
-  size_t line_no = 0;
-  for (size_t i = 0; i < P.size(); ++i)
-    build_circuit(buggyP, P[i], is_jump(buggyP,P,i), state_b, line_no, buggy_line_map);
-  line_no = 0;
-  for (size_t i = 0; i < Q.size(); ++i)
-    build_circuit(patchedP, Q[i], is_jump(patchedP,Q,i), state_p, line_no, patched_line_map);
-
-  if (memories.first)
-    constraints.push_back(memories.first->aliasing_formula(*memories.second));
-  else {
-    auto buggy_flat = dynamic_cast<FlatMemory*>(state_b.memory);
-    auto patched_flat = dynamic_cast<FlatMemory*>(state_p.memory);
-    if (buggy_flat && patched_flat) {
-      auto buggy_con = buggy_flat->get_constraints();
-      constraints.insert(constraints.begin(),
-                         buggy_con.begin(),
-                         buggy_con.end());
-      auto patched_con = patched_flat->get_constraints();
-      constraints.insert(constraints.begin(),
-                         patched_con.begin(),
-                         patched_con.end());
-    }
-  }
-
-  constraints.insert(constraints.begin(), state_b.constraints.begin(), state_b.constraints.end());
-  constraints.insert(constraints.begin(), state_p.constraints.begin(), state_p.constraints.end());
-
-  CONSTRAINT_DEBUG(
-    cout << endl << "CONSTRAINTS" << endl << endl;;
-  for (auto it : constraints) {
-  cout << it << endl;
-})
+  // Pairs are handed out in order, results are written in order.  Workers
+  // stay at most 'window' pairs ahead of the writer so that finished
+  // formulas don't pile up in memory.
+  const size_t num_pairs = buggy_paths.size() * patched_paths.size();
+  const size_t num_threads = max<size_t>(threads_arg.value(), 1);
+  const size_t window = 16 * num_threads;
+
+  vector<string> smt2(num_pairs);
+  vector<string> log(num_pairs);
+  vector<bool> done(num_pairs, false);
+  size_t next = 0;
+  size_t written = 0;
+  mutex m;
+  condition_variable cv;
+
+  auto worker = [&]() {
+    PathBuilder buggy(buggyP, buggy_paths, "1");
+    PathBuilder patched(patchedP, patched_paths, "2");
+    Z3Solver z3;
+
+    while (true) {
+      size_t k;
+      {
+        unique_lock<mutex> lock(m);
+        cv.wait(lock, [&] { return next >= num_pairs || next < written + window; });
+        if (next >= num_pairs)
+          break;
+        k = next++;
+      }
 
-  // Build inequality constraint
-  // TODO pass line numbers as appropriate
-  auto prove_constraint = !prove(state_b, state_p, buggy_invariant_lineno, patched_invariant_lineno);
-  CONSTRAINT_DEBUG(cout << "Proof inequality: " << prove_constraint << endl;)
+      const auto i = k / patched_paths.size();
+      const auto j = k % patched_paths.size();
+
+      stringstream header;
+      header << "; pair " << k << ": buggy path " << buggy_paths[i]
+             << " patched path " << patched_paths[j] << endl;
+
+      stringstream ss;
+      string text;
+      try {
+        auto& b = buggy.get(i);
+        auto& p = patched.get(j);
+
+        // The invariants only look at register names and the heaps, so fresh
+        // initial states stand in for the ones the circuits started from.
+        SymState init_b("1_INIT");
+        SymState init_p("2_INIT");
+        FlatMemory heap_b;
+        FlatMemory heap_p;
+        heap_b.heap_ = b.init_heap;
+        heap_p.heap_ = p.init_heap;
+        init_b.memory = &heap_b;
+        init_p.memory = &heap_p;
+
+        size_t buggy_invariant_lineno = 0;
+        size_t patched_invariant_lineno = 0;
+        auto assumption = assume_state(init_b, init_p, buggy_invariant_lineno, patched_invariant_lineno) &
+                          memory_equal(init_b, init_p, buggy_invariant_lineno, patched_invariant_lineno);
+        auto same_out = prove(*b.state, *p.state, buggy_invariant_lineno, patched_invariant_lineno);
+
+        if (debug_arg.value()) {
+          ss << "Assuming " << assumption << endl;
+          ss << endl << "CONSTRAINTS" << endl << endl;
+          for (auto it : p.constraints)
+            ss << it << endl;
+          for (auto it : b.constraints)
+            ss << it << endl;
+          ss << "Proof inequality: " << !same_out << endl;
+        }
 
-  constraints.push_back(prove_constraint);
+        // Both paths have to be taken for the pair to say anything
+        auto taken = conjoin(conjoin(assumption, b.constraints), p.constraints);
 
-  DiffOut.push_back(prove_constraint);
-  SameOut.push_back(prove(state_b, state_p, buggy_invariant_lineno, patched_invariant_lineno));
+        SymBool CC = SymBool::var("CC");
+        auto firstFormula = conjoin(conjoin(!CC & taken, b.phi), p.phi) & !same_out;
+        auto secondFormula = conjoin(conjoin(CC & taken, b.phi), p.phi) & same_out;
 
+        text = z3.to_smt2({firstFormula | secondFormula});
+        if (z3.has_error())
+          ss << "Error: " << z3.get_error() << endl;
+      } catch (validator_error& e) {
+        ss << "Error: " << e.get_message() << endl;
+      }
 
-  // Extract the final states of target/rewrite
-  SymState state_b_final("1_FINAL");
-  SymState state_p_final("2_FINAL");
+      map<string, string> names;
+      text = renumber_temporaries(text, names);
+      auto debug = renumber_temporaries(ss.str(), names);
 
-  for (auto it : state_b.equality_constraints(state_b_final, RegSet::universe())) {
-    Phi_b.push_back(it);
-    constraints.push_back(it);
-  }
-  for (auto it : state_p.equality_constraints(state_p_final, RegSet::universe())) {
-    Phi_p.push_back(it);
-    constraints.push_back(it);
-  }
+      {
+        lock_guard<mutex> lock(m);
+        smt2[k] = header.str() + text;
+        log[k] = header.str() + debug;
+        done[k] = true;
+      }
+      cv.notify_all();
+    }
+  };
 
-  SymBool firstFormula = SymBool::_true();
-  firstFormula = firstFormula & !CC;
-  for (auto it : EquivInput) {
-    firstFormula = firstFormula & it;
-  }
-  for (auto it : Phi_b) {
-    firstFormula = firstFormula & it;
-  }
-  for (auto it : Phi_p) {
-    firstFormula = firstFormula & it;
-  }
-  for (auto it : DiffOut) {
-    firstFormula = firstFormula & it;
-  }
+  vector<thread> pool;
+  for (size_t t = 0; t < num_threads; ++t)
+    pool.emplace_back(worker);
+
+  for (size_t k = 0; k < num_pairs; ++k) {
+    string text;
+    string debug;
+    {
+      unique_lock<mutex> lock(m);
+      cv.wait(lock, [&] { return done[k]; });
+      text.swap(smt2[k]);
+      debug.swap(log[k]);
+      written = k + 1;
+    }
+    cv.notify_all();
 
-  SymBool secondFormula = SymBool::_true();
-  secondFormula = secondFormula & CC;
-  for (auto it : EquivInput) {
-    secondFormula = secondFormula & it;
+    cout << debug;
+    ofs << text << endl;
   }
-  for (auto it : Phi_b) {
-    secondFormula = secondFormula & it;
-  }
-  for (auto it : Phi_p) {
-    secondFormula = secondFormula & it;
-  }
-  for (auto it : SameOut) {
-    secondFormula = secondFormula & it;
-  }
-
-  constraints2.push_back(firstFormula | secondFormula);
 
-  bool is_sat = solver->is_sat(constraints2);
+  for (auto& t : pool)
+    t.join();
 
-  //cout << ((Z3Solver*)solver)->solver_.to_smt2();
   return 0;
 }
@@ -54,6 +54,11 @@ auto& input_offset = FlagArg::create("input_offset")
 auto& do_not_link_arg = FlagArg::create("do_not_link")
                         .description("Don't run linker.  Could avoid errors if no function calls are being made.");
 
+auto& threads_arg = ValueArg<size_t>::create("threads")
+                    .usage("<int>")
+                    .description("Number of objdump processes to run at once when disassembling")
+                    .default_val(1);
+
 
 bool found = false;
 uint64_t fxn_offset = 0;
@@ -178,6 +183,7 @@ int main(int argc, char** argv) {
 
     Disassembler d;
     d.set_function_callback(callback, linker_ptr);
+    d.set_threads(threads_arg.value());
     found = false;
     d.disassemble(in.value());
 
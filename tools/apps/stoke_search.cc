@@ -26,6 +26,8 @@
 #include "src/expr/expr.h"
 #include "src/expr/expr_parser.h"
 #include "src/tunit/tunit.h"
+#include "src/profiler/profiler.h"
+#include "src/search/metrics.h"
 #include "src/search/progress_callback.h"
 #include "src/search/statistics_callback.h"
 #include "src/search/failed_verification_action.h"
@@ -72,6 +74,18 @@ auto& stat_int =
   .usage("<int>")
   .description("Number of iterations between statistics updates")
   .default_val(1000000);
+auto& metrics_file_arg =
+  ValueArg<string>::create("metrics_file")
+  .usage("<path/to/file>")
+  .description("File to keep up to date with search metrics in Prometheus text format; it is replaced atomically");
+auto& metrics_interval_arg =
+  ValueArg<double>::create("metrics_interval")
+  .usage("<seconds>")
+  .description("Seconds between updates of the metrics file")
+  .default_val(1.0);
+auto& profile_arg =
+  FlagArg::create("profile")
+  .description("Count the cycles spent in each phase of search and for each move type, and show them with the statistics");
 
 auto& automation_heading = Heading::create("Automation Options:");
 
@@ -162,6 +176,66 @@ struct ScbArg {
   uint32_t** cost_stats;
 };
 
+void show_profile(const StatisticsCallbackData& data, ostream& os) {
+  ofilterstream<Column> ofs(os);
+  ofs.filter().padding(5);
+
+  ofs << "Phase" << endl;
+  ofs << endl;
+  for (size_t i = 0; i < data.phases.size(); ++i) {
+    ofs << Profiler::get_name((Profiler::Phase)i) << endl;
+  }
+  ofs.filter().next();
+
+  ofs << "Calls" << endl;
+  ofs << endl;
+  for (const auto& p : data.phases) {
+    ofs << p.calls << endl;
+  }
+  ofs.filter().next();
+
+  ofs << "Cycles" << endl;
+  ofs << endl;
+  for (const auto& p : data.phases) {
+    ofs << p.cycles << endl;
+  }
+  ofs.filter().next();
+
+  ofs << "Cycles/Call" << endl;
+  ofs << endl;
+  for (const auto& p : data.phases) {
+    ofs << (p.calls == 0 ? 0 : p.cycles / p.calls) << endl;
+  }
+  ofs.filter().done();
+
+  os << endl << endl;
+
+  const WeightedTransform* transform = static_cast<const WeightedTransform*>(data.transform);
+  ofilterstream<Column> mfs(os);
+  mfs.filter().padding(5);
+
+  mfs << "Move Type" << endl;
+  mfs << endl;
+  for (size_t i = 0; i < transform->size(); ++i) {
+    mfs << transform->get_transform(i)->get_name() << endl;
+  }
+  mfs.filter().next();
+
+  mfs << "Transform Cycles/Proposal" << endl;
+  mfs << endl;
+  for (const auto& m : data.move_statistics) {
+    mfs << (m.num_proposed == 0 ? 0 : m.transform_cycles / m.num_proposed) << endl;
+  }
+  mfs.filter().next();
+
+  mfs << "Cost Cycles/Evaluation" << endl;
+  mfs << endl;
+  for (const auto& m : data.move_statistics) {
+    mfs << (m.num_succeeded == 0 ? 0 : m.cost_cycles / m.num_succeeded) << endl;
+  }
+  mfs.filter().done();
+}
+
 void show_statistics(const StatisticsCallbackData& data, ostream& os) {
   os << "Iterations:                    " << data.iterations << endl;
   os << "Elapsed Time:                  " << data.elapsed.count() << "s" << endl;
@@ -218,6 +292,11 @@ void show_statistics(const StatisticsCallbackData& data, ostream& os) {
   ofs << endl;
   ofs << 100 * (double)total.num_accepted / data.iterations << "%";
   ofs.filter().done();
+
+  if (!data.phases.empty()) {
+    os << endl << endl;
+    show_profile(data, os);
+  }
 }
 
 void scb(const StatisticsCallbackData& data, void* arg) {
@@ -233,6 +312,14 @@ void scb(const StatisticsCallbackData& data, void* arg) {
   sep(os);
 }
 
+void mcb(const StatisticsCallbackData& data, void* arg) {
+  auto& metrics = *((MetricsWriter*)arg);
+  metrics.update(data);
+  if (metrics.has_error()) {
+    Console::warn() << metrics.get_error() << endl;
+  }
+}
+
 void show_final_update(const StatisticsCallbackData& stats, SearchState& state,
                        size_t total_restarts,
                        size_t total_iterations, time_point<steady_clock> start,
@@ -278,6 +365,30 @@ void show_final_update(const StatisticsCallbackData& stats, SearchState& state,
     f << "    \"total_search_time\": " << search_elapsed.count() << "," << endl;
     f << "    \"total_time\": " << total_elapsed.count() << endl;
     f << "  }," << endl;
+    if (!stats.phases.empty()) {
+      const WeightedTransform* transform = static_cast<const WeightedTransform*>(stats.transform);
+      f << "  \"profile\": {" << endl;
+      f << "    \"phases\": {" << endl;
+      for (size_t i = 0; i < stats.phases.size(); ++i) {
+        f << "      \"" << Profiler::get_name((Profiler::Phase)i) << "\": {";
+        f << "\"calls\": " << stats.phases[i].calls << ", ";
+        f << "\"cycles\": " << stats.phases[i].cycles << "}";
+        f << (i + 1 < stats.phases.size() ? "," : "") << endl;
+      }
+      f << "    }," << endl;
+      f << "    \"moves\": {" << endl;
+      for (size_t i = 0; i < transform->size(); ++i) {
+        const auto& m = stats.move_statistics[i];
+        f << "      \"" << transform->get_transform(i)->get_name() << "\": {";
+        f << "\"proposed\": " << m.num_proposed << ", ";
+        f << "\"succeeded\": " << m.num_succeeded << ", ";
+        f << "\"transform_cycles\": " << m.transform_cycles << ", ";
+        f << "\"cost_cycles\": " << m.cost_cycles << "}";
+        f << (i + 1 < transform->size() ? "," : "") << endl;
+      }
+      f << "    }" << endl;
+      f << "  }," << endl;
+    }
     f << "  \"best_yet\": {" << endl;
     f << "    \"cost\": " << state.best_yet_cost << "," << endl;
     f << "    \"code\": \"" << code_to_string(state.best_yet.get_code()) << "\"" << endl;
@@ -332,6 +443,20 @@ int main(int argc, char** argv) {
   ScbArg scb_arg {&Console::msg(), nullptr};
   search.set_statistics_callback(scb, &scb_arg)
   .set_statistics_interval(stat_int);
+
+  Profiler::set_enabled(profile_arg.value());
+
+  MetricsWriter metrics;
+  if (metrics_file_arg.has_been_provided()) {
+    if (metrics_interval_arg.value() <= 0) {
+      Console::error(1) << "--metrics_interval must be positive." << endl;
+    }
+    metrics.set_path(metrics_file_arg.value())
+    .add_sandbox("training", &training_sb)
+    .add_sandbox("performance", &perf_sb);
+    search.set_metrics_callback(mcb, &metrics)
+    .set_metrics_period(duration<double>(metrics_interval_arg.value()));
+  }
   if (!no_progress_update_arg.value()) {
     search.set_progress_callback(pcb, &Console::msg());
   }
@@ -360,6 +485,7 @@ int main(int argc, char** argv) {
   SearchStateGadget state(target, aux_fxns);
   for (size_t i = 0; ; ++i) {
     CostFunctionGadget fxn(target, &training_sb, &perf_sb);
+    metrics.set_cost_function(&fxn);
 
     // determine iteration timeout
     Expr<size_t>* timeout_expr = i >= cycle_timeouts.size() ? cycle_timeouts[cycle_timeouts.size()-1] : cycle_timeouts[i];
@@ -402,6 +528,10 @@ int main(int argc, char** argv) {
     const auto start_search = steady_clock::now();
     search.run(target, fxn, init_arg, state, aux_fxns);
     search_elapsed += duration_cast<duration<double>>(steady_clock::now() - start_search);
+    if (metrics_file_arg.has_been_provided()) {
+      mcb(search.get_statistics(), &metrics);
+      metrics.next_search();
+    }
 
     total_iterations += search.get_statistics().iterations;
     total_restarts++;
@@ -149,18 +149,9 @@ int main(int argc, char** argv) {
   checker.set_alias_strategy(ObligationChecker::AliasStrategy::FLAT);
   checker.set_sandbox(&sb);
 
-  // Step 1: enumerate paths up to a certain bound
-  vector<CfgPath> paths;
-  paths = CfgPaths::enumerate_paths(target, bound_arg.value());
-
-  // Handle the shorter paths first
-  auto by_length = [](const CfgPath& lhs, const CfgPath& rhs) {
-    return lhs.size() < rhs.size();
-  };
-  sort(paths.begin(), paths.end(), by_length);
-
-  if (debug_arg.value())
-    cerr << "Number of paths: " << paths.size() << endl;
+  // Step 1: enumerate paths up to a certain bound, shorter paths first
+  CfgPathEnumerator paths(target, bound_arg.value());
+  size_t num_paths = 0;
 
   // Step 2: for each path, find a testcase if possible
   // (there's lots of silly setup for this)
@@ -179,7 +170,9 @@ int main(int argc, char** argv) {
   TrueInvariant _true;
 
   CpuStates outputs;
-  for (auto p : paths) {
+  CfgPath p;
+  while (paths.next(p)) {
+    num_paths++;
 
     if (debug_arg.value()) {
       cerr << "Looking for testcase on path " << p << endl;
@@ -251,6 +244,9 @@ int main(int argc, char** argv) {
     }
   }
 
+  if (debug_arg.value())
+    cerr << "Number of paths: " << num_paths << endl;
+
   outputs.write_text(cout);
 
   return 0;
@@ -0,0 +1,303 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/ext/cpputil/include/command_line/command_line.h"
+#include "src/ext/cpputil/include/io/console.h"
+#include "src/ext/cpputil/include/signal/debug_handler.h"
+
+#include "src/cfg/cfg.h"
+#include "src/sandbox/state_callback.h"
+#include "src/state/cpu_states.h"
+#include "tools/args/target.inc"
+#include "tools/gadgets/cfg.h"
+#include "tools/gadgets/correctness_cost.h"
+#include "tools/gadgets/functions.h"
+#include "tools/gadgets/sandbox.h"
+#include "tools/gadgets/seed.h"
+#include "tools/gadgets/target.h"
+#include "tools/gadgets/testcases.h"
+#include "tools/io/tunit.h"
+
+using namespace cpputil;
+using namespace std;
+using namespace std::chrono;
+using namespace stoke;
+using namespace x64asm;
+
+auto& min_opt = Heading::create("Minimization options:");
+auto& rewrites_arg = ValueArg<vector<string>>::create("rewrites")
+                     .usage("{ path/to/rewrite1.s ... }")
+                     .description("Known-incorrect rewrites; the output still tells apart from the target every one that the input does")
+                     .default_val({});
+auto& no_values_arg = FlagArg::create("ignore_values")
+                      .description("Only preserve path coverage, not the classes of live_out values");
+auto& runs_arg = ValueArg<size_t>::create("timing_runs")
+                 .usage("<int>")
+                 .description("Number of times to run the target over each set when measuring the speedup")
+                 .default_val(100);
+auto& out = ValueArg<string>::create("o")
+            .alternate("out")
+            .usage("<path/to/file.tc>")
+            .description("File to write the minimized testcases to (defaults to console if unspecified)");
+
+/** The kinds of behavior that a testcase can cover. */
+enum class Feature : uint64_t {
+  EDGE,
+  SIGNAL,
+  VALUE,
+  KILL
+};
+
+/** Records the blocks that a testcase runs through. */
+struct BlockParam {
+  Cfg::id_type block;
+  vector<Cfg::id_type>* trace;
+};
+
+void block_callback(const StateCallbackData& data, void* arg) {
+  auto bp = (BlockParam*)arg;
+  bp->trace->push_back(bp->block);
+}
+
+bool ends_with_jump(const Cfg& cfg, Cfg::id_type block) {
+  const auto n = cfg.num_instrs(block);
+  if (n == 0) {
+    return false;
+  }
+  const auto& instr = cfg.get_instr(Cfg::loc_type(block, n - 1));
+  return instr.is_any_jump() || instr.is_ret();
+}
+
+/** Buckets loop trip counts so that 3 and 4 iterations look different, but
+  40 and 41 don't. */
+uint64_t hit_bucket(size_t hits) {
+  if (hits <= 3) {
+    return hits;
+  }
+  uint64_t b = 4;
+  for (size_t h = hits; h >= 8 && b < 8; h >>= 1) {
+    b++;
+  }
+  return b;
+}
+
+/** A coarse class of a live_out value: zero, one, all ones, small, negative or large. */
+uint64_t value_class(uint64_t val, size_t bits) {
+  const auto mask = bits == 64 ? ~0ull : (1ull << bits) - 1;
+  val &= mask;
+  if (val == 0) {
+    return 0;
+  } else if (val == 1) {
+    return 1;
+  } else if (val == mask) {
+    return 2;
+  } else if (val < 0x100) {
+    return 3;
+  } else if ((val >> (bits - 1)) & 1) {
+    return 4;
+  } else {
+    return 5;
+  }
+}
+
+Cfg read_rewrite(const string& path, const vector<TUnit>& aux_fxns) {
+  ifstream ifs(path);
+  if (!ifs.is_open()) {
+    Console::error(1) << "Unable to open rewrite: " << path << "!" << endl;
+  }
+  TUnit fxn;
+  TUnitReader()(ifs, fxn);
+  if (ifs.fail()) {
+    Console::error(1) << "Unable to read rewrite: " << path << "!" << endl;
+  }
+  return CfgGadget(fxn, aux_fxns, false);
+}
+
+double time_target(Sandbox& sb, size_t runs) {
+  const auto start = steady_clock::now();
+  for (size_t i = 0; i < runs; ++i) {
+    sb.run();
+  }
+  return duration_cast<duration<double>>(steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+  CommandLineConfig::strict_with_convenience(argc, argv);
+  DebugHandler::install_sigsegv();
+  DebugHandler::install_sigill();
+
+  FunctionsGadget aux_fxns;
+  TargetGadget target(aux_fxns, false);
+  SeedGadget seed;
+  TestcasesGadget tcs(seed);
+  if (tcs.empty()) {
+    Console::error(1) << "No testcases provided." << endl;
+  }
+
+  // Features are numbered as they are first seen
+  map<pair<Feature, uint64_t>, size_t> ids;
+  vector<vector<size_t>> covers(tcs.size());
+  const auto cover = [&](size_t tc, Feature f, uint64_t val) {
+    const auto key = make_pair(f, val);
+    auto itr = ids.find(key);
+    if (itr == ids.end()) {
+      itr = ids.insert(make_pair(key, ids.size())).first;
+    }
+    covers[tc].push_back(itr->second);
+  };
+
+  // Path coverage: the edges each testcase takes, with bucketed hit counts
+  SandboxGadget sb(tcs, aux_fxns);
+  sb.insert_function(target);
+  const auto label = target.get_code()[0].get_operand<Label>(0);
+  sb.set_entrypoint(label);
+
+  vector<Cfg::id_type> trace;
+  vector<BlockParam> params;
+  params.reserve(target.num_blocks());
+  for (auto i = target.reachable_begin(), ie = target.reachable_end(); i != ie; ++i) {
+    const auto block = *i;
+    if (target.is_entry(block) || target.is_exit(block) || target.num_instrs(block) == 0) {
+      continue;
+    }
+    params.push_back({(Cfg::id_type)block, &trace});
+    const auto index = target.get_index(Cfg::loc_type(block, target.num_instrs(block) - 1));
+    if (ends_with_jump(target, block)) {
+      sb.insert_before(label, index, block_callback, &params.back());
+    } else {
+      sb.insert_after(label, index, block_callback, &params.back());
+    }
+  }
+
+  const auto rs = target.live_outs();
+  for (size_t i = 0, ie = tcs.size(); i < ie; ++i) {
+    trace.clear();
+    sb.run(i);
+
+    map<pair<Cfg::id_type, Cfg::id_type>, size_t> hits;
+    auto prev = target.get_entry();
+    for (auto b : trace) {
+      hits[make_pair(prev, b)]++;
+      prev = b;
+    }
+    for (const auto& h : hits) {
+      cover(i, Feature::EDGE, (h.first.first << 36) | (h.first.second << 4) | hit_bucket(h.second));
+    }
+
+    const auto& result = *sb.get_result(i);
+    cover(i, Feature::SIGNAL, (uint64_t)result.code);
+    if (result.code == ErrorCode::NORMAL && !no_values_arg.value()) {
+      for (auto r = rs.gp_begin(), re = rs.gp_end(); r != re; ++r) {
+        cover(i, Feature::VALUE, ((uint64_t)*r << 8) | value_class(result[*r], (*r).size()));
+      }
+    }
+  }
+  sb.clear_callbacks();
+
+  // Discriminating power: the known-incorrect rewrites each testcase tells apart
+  CorrectnessCostGadget correctness(target, &sb);
+  const auto& rewrites = rewrites_arg.value();
+  for (size_t r = 0, re = rewrites.size(); r < re; ++r) {
+    const auto rewrite = read_rewrite(rewrites[r], aux_fxns);
+    const auto errors = correctness.testcase_errors(rewrite);
+    for (size_t i = 0, ie = tcs.size(); i < ie; ++i) {
+      if (errors[i] > 0) {
+        cover(i, Feature::KILL, r);
+      }
+    }
+  }
+
+  // Greedy set cover, ties broken towards the earlier testcase
+  vector<bool> covered(ids.size(), false);
+  vector<bool> keep(tcs.size(), false);
+  while (true) {
+    size_t best = 0;
+    size_t best_gain = 0;
+    for (size_t i = 0, ie = tcs.size(); i < ie; ++i) {
+      size_t gain = 0;
+      for (auto f : covers[i]) {
+        gain += covered[f] ? 0 : 1;
+      }
+      if (gain > best_gain) {
+        best = i;
+        best_gain = gain;
+      }
+    }
+    if (best_gain == 0) {
+      break;
+    }
+    keep[best] = true;
+    for (auto f : covers[best]) {
+      covered[f] = true;
+    }
+  }
+
+  CpuStates result;
+  size_t full_kills = 0;
+  size_t kept_kills = 0;
+  for (size_t r = 0, re = rewrites.size(); r < re; ++r) {
+    const auto key = make_pair(Feature::KILL, (uint64_t)r);
+    full_kills += ids.count(key);
+    kept_kills += ids.count(key) && covered[ids[key]] ? 1 : 0;
+  }
+  for (size_t i = 0, ie = tcs.size(); i < ie; ++i) {
+    if (keep[i]) {
+      result.push_back(tcs[i]);
+    }
+  }
+
+  if (out.has_been_provided()) {
+    ofstream ofs(out.value());
+    result.write_text(ofs);
+  } else {
+    result.write_text(Console::msg());
+    Console::msg() << endl;
+  }
+
+  // Per-proposal cost is dominated by running the testcases, so time just that
+  SandboxGadget full_sb(tcs, aux_fxns);
+  full_sb.insert_function(target);
+  full_sb.set_entrypoint(label);
+  SandboxGadget min_sb(result, aux_fxns);
+  min_sb.insert_function(target);
+  min_sb.set_entrypoint(label);
+  const auto full_time = time_target(full_sb, runs_arg.value());
+  const auto min_time = time_target(min_sb, runs_arg.value());
+
+  size_t edges = 0;
+  for (const auto& id : ids) {
+    edges += id.first.first == Feature::EDGE ? 1 : 0;
+  }
+
+  auto& os = Console::msg();
+  os << endl;
+  os << "Testcases:           " << tcs.size() << " -> " << result.size() << endl;
+  os << "Features covered:    " << ids.size() << " (" << edges << " edge classes)" << endl;
+  os << "Rewrites told apart: " << kept_kills << " / " << full_kills << " (of " << rewrites.size() << " given)" << endl;
+  os << "Target runtime:      " << full_time << "s -> " << min_time << "s";
+  if (min_time > 0) {
+    os << " (" << full_time / min_time << "x)";
+  }
+  os << endl;
+
+  return 0;
+}
@@ -28,6 +28,7 @@
 #include "src/ext/x64asm/include/x64asm.h"
 
 #include "src/state/cpu_states.h"
+#include "src/state/cpu_states_view.h"
 #include "src/stategen/stategen.h"
 
 #include "tools/args/target.inc"
@@ -35,6 +36,7 @@
 #include "tools/gadgets/sandbox.h"
 #include "tools/gadgets/seed.h"
 #include "tools/gadgets/target.h"
+#include "tools/io/cpu_states.h"
 #include "tools/io/tunit.h"
 
 using namespace cpputil;
@@ -92,6 +94,10 @@ auto& stack_size = ValueArg<size_t>::create("stack_size")
                    .usage("<int>")
                    .description("The minimum stack size available to the testcase")
                    .default_val(16);
+auto& threads_arg = ValueArg<size_t>::create("threads")
+                   .usage("<int>")
+                   .description("Number of threads to generate testcases with; the testcases don't depend on it")
+                   .default_val(1);
 auto& allow_unaligned_arg = FlagArg::create("allow_unaligned")
                             .description("Allow memory accesses to be unaligned");
 auto& register_max_arg = ValueArg<string>::create("register_max")
@@ -109,6 +115,8 @@ auto& compress = FlagArg::create("compress")
                  .description("Convert testcase file from text to binary");
 auto& decompress = FlagArg::create("decompress")
                    .description("Convert testcase file from binary to text");
+auto& index_arg = FlagArg::create("index")
+                  .description("Convert testcase file from text to the indexed binary format (can be passed to --testcases)");
 auto& in = ValueArg<string>::create("in")
            .alternate("i")
            .usage("<path/to/file.tc>")
@@ -242,12 +250,7 @@ int auto_gen() {
 
   // generate testcases
   CpuStates tcs;
-  for (size_t i = 0, ie = max_tc.value(); i < ie; ++i) {
-    CpuState tc;
-    if (sg.get(tc, target)) {
-      tcs.push_back(tc);
-    }
-  }
+  sg.get(tcs, target, max_tc.value(), threads_arg.value());
 
   if (tcs.empty()) {
     Console::warn() << "Last reported error from StateGen: " << endl;
@@ -356,6 +359,28 @@ int do_decompress() {
   return 0;
 }
 
+int do_index() {
+  ifstream ifs(in.value());
+  if (!ifs.is_open()) {
+    Console::error(1) << "Unable to open input file: " << in.value() << "!" << endl;
+  }
+
+  CpuStates cs;
+  CpuStatesReader()(ifs, cs);
+  if (ifs.fail()) {
+    Console::error(1) << "Unable to read input file: " << in.value() << "!" << endl;
+  }
+
+  if (out.has_been_provided()) {
+    ofstream ofs(out.value());
+    CpuStatesView::write(ofs, cs);
+  } else {
+    CpuStatesView::write(Console::msg(), cs);
+  }
+
+  return 0;
+}
+
 int main(int argc, char** argv) {
   target_arg.required(false);
   CommandLineConfig::strict_with_convenience(argc, argv);
@@ -366,6 +391,8 @@ int main(int argc, char** argv) {
     return do_compress();
   } else if (decompress.value()) {
     return do_decompress();
+  } else if (index_arg.value()) {
+    return do_index();
   } else if (target_arg.has_been_provided()) {
     return auto_gen();
   } else {
@@ -27,6 +27,7 @@
 #include "tools/gadgets/correctness_cost.h"
 #include "tools/gadgets/latency_cost.h"
 #include "tools/gadgets/nongoal_cost.h"
+#include "tools/gadgets/timed_cost.h"
 
 namespace stoke {
 
@@ -43,19 +44,33 @@ public:
     return (*fxn_)(cfg);
   }
 
+  void get_cache_statistics(size_t& lookups, size_t& hits) const {
+    fxn_->get_cache_statistics(lookups, hits);
+  }
+
+  uint64_t get_evaluation_cost() {
+    return fxn_->get_evaluation_cost();
+  }
+
 private:
 
   CostFunction* fxn_;
 
   static CostFunction* build_fxn(const Cfg& target, Sandbox* test_sb, Sandbox* perf_sb) {
+    const auto align = binsize_align_arg.value();
+    if (align == 0 || (align & (align - 1)) != 0) {
+      cpputil::Console::error(1) << "--binsize_align must be a power of 2." << std::endl;
+    }
 
     CostParser::SymbolTable st;
-    st["binsize"] =      new BinSizeCost();
+    st["binsize"] =      &(new BinSizeCost())->set_target_alignment(binsize_align_arg.value());
     st["correctness"] =  new CorrectnessCostGadget(target, test_sb);
     st["latency"] =      new LatencyCostGadget();
+    st["loop_latency"] = new LoopLatencyCostGadget();
     st["measured"] =     new MeasuredCost();
     st["size"] =         new SizeCost();
     st["sseavx"] =       new SseAvxCost();
+    st["timed"] =        new TimedCostGadget();
     st["nongoal"] =      new NonGoalCostGadget(target);
 
     CostParser cost_p(cost_function_arg.value(), st);
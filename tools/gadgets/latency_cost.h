@@ -16,6 +16,7 @@
 #define STOKE_TOOLS_GADGETS_LATENCY_COST_H
 
 #include "src/cost/latency.h"
+#include "src/cost/loop_latency.h"
 #include "tools/args/latency.inc"
 #include "tools/args/cost.inc"
 
@@ -27,6 +28,13 @@ public:
   }
 };
 
+class LoopLatencyCostGadget : public LoopLatencyCost {
+public:
+  LoopLatencyCostGadget() : LoopLatencyCost() {
+    set_nesting_penalty(nesting_penalty_arg.value());
+  }
+};
+
 } // namespace stoke
 
 #endif
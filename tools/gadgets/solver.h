@@ -15,8 +15,11 @@
 #ifndef STOKE_TOOLS_GADGETS_SOLVER_H
 #define STOKE_TOOLS_GADGETS_SOLVER_H
 
+#include "src/ext/cpputil/include/io/console.h"
+
 #include "src/solver/smtsolver.h"
 #include "src/solver/cvc4solver.h"
+#include "src/solver/query_trace.h"
 #include "src/solver/z3solver.h"
 #include "tools/args/solver.inc"
 
@@ -38,6 +41,20 @@ public:
     }
 
     set_timeout(timeout_arg);
+
+    if (QueryTrace::get_env_error() != "") {
+      cpputil::Console::error(1) << "STOKE_SMT_TRACE: " << QueryTrace::get_env_error() << std::endl;
+    }
+    if (smt_trace_arg.value() != "" && !QueryTrace::enabled()) {
+      if (!QueryTrace::open(smt_trace_arg.value(), smt_trace_sample_arg.value(),
+                            smt_trace_max_bytes_arg.value(), smt_trace_max_files_arg.value())) {
+        cpputil::Console::error(1) << "--smt_trace: " << QueryTrace::get_error() << std::endl;
+      }
+    }
+  }
+
+  SMTSolver* clone() const {
+    return solver_->clone();
   }
 
   SMTSolver& set_timeout(uint64_t ms) {
@@ -0,0 +1,45 @@
+// Copyright 2013-2016 Stanford University
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef STOKE_TOOLS_GADGETS_TIMED_COST_H
+#define STOKE_TOOLS_GADGETS_TIMED_COST_H
+
+#include "src/ext/cpputil/include/io/console.h"
+
+#include "src/cost/timed.h"
+#include "tools/args/timed.inc"
+
+namespace stoke {
+
+class TimedCostGadget : public TimedCost {
+public:
+  TimedCostGadget() : TimedCost() {
+    if (timed_repetitions_arg.value() == 0) {
+      cpputil::Console::error(1) << "--timed_repetitions must be positive." << std::endl;
+    }
+    if (timed_quantum_arg.value() == 0) {
+      cpputil::Console::error(1) << "--timed_quantum must be positive." << std::endl;
+    }
+
+    set_warmup(timed_warmup_arg.value());
+    set_repetitions(timed_repetitions_arg.value());
+    set_outlier_threshold(timed_outlier_arg.value());
+    set_quantum(timed_quantum_arg.value());
+    set_error_penalty(timed_error_penalty_arg.value());
+  }
+};
+
+} // namespace stoke
+
+#endif
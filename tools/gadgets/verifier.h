@@ -122,6 +122,7 @@ private:
       ddec->set_sound_nullspace(sound_nullspace_arg.value());
       ddec->set_alias_strategy(parse_alias());
       ddec->set_bound(bound_arg.value());
+      ddec->set_threads(ddec_threads_arg.value());
       ddec->set_nacl(verify_nacl_arg);
       return ddec;
     } else if (s == "hold_out") {
@@ -15,15 +15,56 @@
 #ifndef STOKE_TOOLS_IO_CPU_STATES_H
 #define STOKE_TOOLS_IO_CPU_STATES_H
 
+#include <fstream>
 #include <iostream>
+#include <string>
 
+#include "src/ext/cpputil/include/io/fail.h"
 #include "src/state/cpu_states.h"
+#include "src/state/cpu_states_view.h"
 
 namespace stoke {
 
 struct CpuStatesReader {
   void operator()(std::istream& is, CpuStates& cs) {
-    cs.read_text(is);
+    if (CpuStatesView::is_indexed(is)) {
+      CpuStatesView::read(is, cs);
+    } else {
+      cs.read_text(is);
+    }
+  }
+};
+
+/** Reads testcases from the file named by an argument.  Unlike a stream,
+  an indexed file is mapped with CpuStatesView, so its testcases are decoded
+  straight from memory. */
+struct CpuStatesFileReader {
+  void operator()(std::istream& is, CpuStates& cs) {
+    std::string path;
+    std::getline(is, path);
+
+    std::ifstream ifs(path);
+    if (!ifs.is_open()) {
+      cpputil::fail(is) << "Unable to open " << path;
+      return;
+    }
+
+    if (CpuStatesView::is_indexed(ifs)) {
+      CpuStatesView view;
+      view.open(path);
+      if (view.has_error()) {
+        cpputil::fail(is) << view.get_error();
+        return;
+      }
+      if (!view.get_all(cs)) {
+        cpputil::fail(is) << view.get_error();
+      }
+    } else {
+      cs.read_text(ifs);
+      if (ifs.fail()) {
+        cpputil::fail(is) << "Unable to read testcases from " << path;
+      }
+    }
   }
 };
 